@@ -2,12 +2,16 @@
 #include "DeltaTimer.h"
 
 static DeltaTimer deltaTimer;
+//how long every update of the calling thread lasts on a thread that updates at a fixed step, 0 on the game loop thread
+static _Thread_local double threadStepTime = 0.0;
 
 void DeltaTimer_Init() {
     //initialize the values to 0.0
     deltaTimer.deltaTime = 0.0;
     deltaTimer.oldTick = 0.0;
     deltaTimer.tick = 0.0;
+    deltaTimer.fixedDeltaTime = 0.0;
+    deltaTimer.gameTime = 0.0;
 }
 
 void DeltaTimer_Update() {
@@ -20,9 +24,40 @@ void DeltaTimer_Update() {
     //get time duration between ticks and divide by 1000
     //to get number of seconds since last frame
     deltaTimer.deltaTime = (deltaTimer.tick - deltaTimer.oldTick) / 1000.0;
+
+    //with a fixed delta time the game runs the same every time, no matter how fast the frames are drawn
+    if (deltaTimer.fixedDeltaTime > 0.0) {
+        deltaTimer.deltaTime = deltaTimer.fixedDeltaTime;
+        deltaTimer.gameTime += deltaTimer.fixedDeltaTime;
+    }
 }
 
 double DeltaTimer_GetDeltaTime() {
+    //a thread with a fixed step moves on by its step, however long the frames of the game loop take
+    if (threadStepTime > 0.0) {
+        return threadStepTime;
+    }
     //return the delta time
     return deltaTimer.deltaTime;
 }
+
+//sets how many seconds every frame lasts, 0 to use the time the frames really take
+void DeltaTimer_SetFixedDeltaTime(double seconds) {
+    deltaTimer.fixedDeltaTime = seconds > 0.0 ? seconds : 0.0;
+    deltaTimer.gameTime = 0.0;
+}
+
+//sets how many seconds every update of the calling thread lasts, 0 to use the delta time of the game loop.
+//The ticks stay the same on every thread, so timers may be started on one thread and checked on another
+void DeltaTimer_SetThreadStepTime(double seconds) {
+    threadStepTime = seconds > 0.0 ? seconds : 0.0;
+}
+
+//returns the milliseconds of game time. It is the time since SDL was started, unless the delta time is fixed,
+//then it is the fixed delta time of every frame added up, so the timers run the same on every run
+Uint32 DeltaTimer_GetTicks() {
+    if (deltaTimer.fixedDeltaTime > 0.0) {
+        return (Uint32)(deltaTimer.gameTime*1000.0);
+    }
+    return SDL_GetTicks();
+}
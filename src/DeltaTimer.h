@@ -7,10 +7,15 @@ typedef struct DeltaTimer {
     Uint32 oldTick;
     Uint32 tick;
     double deltaTime;
+    double fixedDeltaTime;  //when larger than 0, every frame is this many seconds long no matter how long it took
+    double gameTime;        //seconds the frames have lasted since the fixed delta time was set
 } DeltaTimer;
 
 void DeltaTimer_Init();
 void DeltaTimer_Update();
 [[nodiscard]] double DeltaTimer_GetDeltaTime();
+void DeltaTimer_SetFixedDeltaTime(double seconds);
+void DeltaTimer_SetThreadStepTime(double seconds);
+[[nodiscard]] Uint32 DeltaTimer_GetTicks();
 
 #endif // __DELTA_TIMER_H
\ No newline at end of file
@@ -18,8 +18,9 @@ ComponentCollision *ComponentCollision_New() {
         newCollisionComponent[i].collisionType = COLLISIONTYPE_DEACTIVATED;
         //create a default collision rectangle
         SetupRect(&newCollisionComponent[i].rect,0,0,5,5);
-        //set the is colliding flag to 0
-        newCollisionComponent[i].isColliding = 0;
+        //the entity can move until it is made static
+        newCollisionComponent[i].bodyType = COLLISIONBODY_DYNAMIC;
+        newCollisionComponent[i].inStaticBroadphase = 0;
     }
     //return the pointer to the collision components
     return newCollisionComponent;
@@ -39,7 +40,8 @@ void ComponentCollision_AllocateMoreMemory(Scene *scene,int componentIndex) {
     for (j=scene->numEntities;j < scene->maxEntities; ++j) {
         newComponentCollision[j].collisionType = COLLISIONTYPE_DEACTIVATED;
         SetupRect(&newComponentCollision[j].rect,0,0,5,5);
-        newComponentCollision[j].isColliding = 0;
+        newComponentCollision[j].bodyType = COLLISIONBODY_DYNAMIC;
+        newComponentCollision[j].inStaticBroadphase = 0;
     }
     //point the data pointer to the new data
     scene->components[componentIndex].data = newComponentCollision;
@@ -73,3 +75,14 @@ void ComponentCollision_Collision(ComponentCollision *collisionComponent) {
         free(collisionComponent);
     }
 }
+
+//a static body is put in the static broadphase once and is never moved or tested against the world again.
+//Do not give a static body velocity, it would move away from where it is in the broadphase
+void ComponentCollision_SetBodyType(ComponentCollision *collisionComponent,Uint32 entity,CollisionBodyType bodyType) {
+    if (collisionComponent != NULL) {
+        collisionComponent[entity].bodyType = bodyType;
+    }
+    else {
+        WriteError("Parameter 'ComponentCollision *collisionComponent' is NULL");
+    }
+}
@@ -14,11 +14,23 @@ typedef enum CollisionType {
     COLLISIONTYPE_WORLD_AND_ENTITY  = 3,
 } CollisionType;
 
+typedef enum CollisionBodyType {
+    COLLISIONBODY_DYNAMIC           = 0,    //the entity can move, it is tested every frame while it is awake
+    COLLISIONBODY_STATIC            = 1,    //the entity never moves, it is only put in the static broadphase once
+} CollisionBodyType;
+
+//how the collision system finds the entities that may collide, it is set for every scene
+typedef enum CollisionBroadphase {
+    COLLISION_BROADPHASE_SPATIAL_HASH       = 0,    //a grid of cells, best when the entities are spread out
+    COLLISION_BROADPHASE_SWEEP_AND_PRUNE    = 1,    //sorted edges, best when many entities are close together
+} CollisionBroadphase;
+
 typedef struct ComponentCollision {
     CollisionType collisionType;   //which collisions to apply to the entity
-    SDL_Rect rect;                  //collision rectangle
-    SDL_Rect worldRect;             //collision rectangle in world coordinates
-    short isColliding;              //flag to mark that there was a collision
+    SDL_Rect rect;                  //collision rectangle in world units, from the position of the entity
+    SDL_FRect worldRect;            //collision rectangle in world coordinates, set by the collision system every frame
+    CollisionBodyType bodyType;     //static bodies and entities without velocity are only obstacles
+    short inStaticBroadphase;       //1 when the entity is in the static broadphase of the collision system
 } ComponentCollision;
 
 [[nodiscard]] ComponentCollision *ComponentCollision_New();
@@ -26,4 +38,5 @@ void ComponentCollision_AllocateMoreMemory(Scene *scene,int componentIndex);
 void ComponentCollision_Collision(ComponentCollision *collisionComponent);
 void ComponentCollision_SetCollisionType(ComponentCollision *collisionComponent, Uint32 entity, CollisionType collisionType);
 void ComponentCollision_SetCollisionRectangle(ComponentCollision *collisionComponent, Uint32 entity, SDL_Rect *collisionRect);
+void ComponentCollision_SetBodyType(ComponentCollision *collisionComponent, Uint32 entity, CollisionBodyType bodyType);
 #endif // __COMPONENT_COLLISION_H
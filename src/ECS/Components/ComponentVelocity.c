@@ -23,6 +23,12 @@ ComponentVelocity *ComponentVelocity_New() {
         newVelComponent[i].y = 0;
         newVelComponent[i].maxVelocity = 1000;
         newVelComponent[i].friction = 1;
+        newVelComponent[i].isSleeping = 0;
+        newVelComponent[i].framesAtRest = 0;
+        newVelComponent[i].mode = COMPONENT_VELOCITY_MODE_FREE;
+        newVelComponent[i].flowGoal.x = 0;
+        newVelComponent[i].flowGoal.y = 0;
+        newVelComponent[i].flowSpeed = 100;
     }
 
     //return the pointer to the velocity components
@@ -45,6 +51,12 @@ void ComponentVelocity_AllocateMoreMemory(Scene *scene,int componentIndex) {
         newComponentVelocity[j].y = 0;
         newComponentVelocity[j].friction = 1;
         newComponentVelocity[j].maxVelocity = 1000;
+        newComponentVelocity[j].isSleeping = 0;
+        newComponentVelocity[j].framesAtRest = 0;
+        newComponentVelocity[j].mode = COMPONENT_VELOCITY_MODE_FREE;
+        newComponentVelocity[j].flowGoal.x = 0;
+        newComponentVelocity[j].flowGoal.y = 0;
+        newComponentVelocity[j].flowSpeed = 100;
     }
     //point the data pointer to the new data
     scene->components[componentIndex].data = newComponentVelocity;
@@ -61,9 +73,72 @@ void ComponentVelocity_SetVelocity(ComponentVelocity *velocityComponents,Uint32
     if (velocityComponents != NULL) {
         velocityComponents[entity].x =  x;
         velocityComponents[entity].y =  y;
+        //a sleeping entity wakes up when it is given a velocity
+        if (x != 0 || y != 0) {
+            ComponentVelocity_Wake(velocityComponents,entity);
+        }
     }
 }
 
+//wakes the entity up, so it is moved and tested for collisions again until it has been still for a while
+void ComponentVelocity_Wake(ComponentVelocity *velocityComponents,Uint32 entity) {
+    if (velocityComponents != NULL) {
+        velocityComponents[entity].isSleeping = 0;
+        velocityComponents[entity].framesAtRest = 0;
+    }
+}
+
+//lets the entity walk to the goal tile along the flow field of the isometric engine. The move system sets the
+//velocity every frame, until the entity is on the goal or can not reach it
+void ComponentVelocity_FollowFlowField(ComponentVelocity *velocityComponents,Uint32 entity,int goalX,int goalY,float speed) {
+    if (velocityComponents == NULL) {
+        //write the error to the logfile
+        WriteError("Parameter:'ComponentVelocity *velocityComponents' is NULL.");
+        return;
+    }
+    if (speed < 0) {
+        //write the error to the logfile
+        WriteError("Parameter:'float speed' cannot have a negative value. Aborting.");
+        return;
+    }
+    velocityComponents[entity].mode = COMPONENT_VELOCITY_MODE_FLOW_FIELD;
+    velocityComponents[entity].flowGoal.x = goalX;
+    velocityComponents[entity].flowGoal.y = goalY;
+    velocityComponents[entity].flowSpeed = speed;
+    ComponentVelocity_Wake(velocityComponents,entity);
+}
+
+//hands the velocity of the entity back to the game, the entity keeps the velocity it has
+void ComponentVelocity_StopFlowField(ComponentVelocity *velocityComponents,Uint32 entity) {
+    if (velocityComponents != NULL) {
+        velocityComponents[entity].mode = COMPONENT_VELOCITY_MODE_FREE;
+    }
+}
+
+//points the velocity of the entity along the flow field to its goal, from the tile it stands on. The field is only
+//built for the first entity that walks to the goal, the other ones look the tile up. On the goal, or when the goal can
+//not be reached, the entity stops and its velocity is handed back to the game. Returns 1 if the entity walks on
+int ComponentVelocity_SteerAlongFlowField(ComponentVelocity *velocityComponents,Uint32 entity,IsoFlowFieldCache *flowFields,
+                                          IsoPathfinder *pathfinder,int tileX,int tileY) {
+    IsoFlowField *field = NULL;
+    SDL_FPoint direction;
+
+    if (velocityComponents == NULL || velocityComponents[entity].mode != COMPONENT_VELOCITY_MODE_FLOW_FIELD
+    || flowFields == NULL || pathfinder == NULL) {
+        return 0;
+    }
+    field = isoFlowFieldCacheGetField(flowFields,pathfinder,velocityComponents[entity].flowGoal.x,velocityComponents[entity].flowGoal.y);
+    if (isoFlowFieldGetDirection(flowFields,field,tileX,tileY,&direction)) {
+        velocityComponents[entity].x = direction.x * velocityComponents[entity].flowSpeed;
+        velocityComponents[entity].y = direction.y * velocityComponents[entity].flowSpeed;
+        return 1;
+    }
+    velocityComponents[entity].x = 0;
+    velocityComponents[entity].y = 0;
+    velocityComponents[entity].mode = COMPONENT_VELOCITY_MODE_FREE;
+    return 0;
+}
+
 void ComponentVelocity_SetMaxVelocity(ComponentVelocity *velocityComponent,Uint32 entity,int maxVelocity) {
     //if the velocity component is not NULL
     if (velocityComponent==NULL) {
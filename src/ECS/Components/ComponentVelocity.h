@@ -2,15 +2,25 @@
 #define __COMPONENT_VELOCITY_H
 
 #include <SDL2/SDL.h>
+#include "../../IsoEngine/isoFlowField.h"
 
 //forward declaration of Scene, allows us to use the Scene without causing a cross-referencing header error
 typedef struct Scene Scene;
 
+//how the velocity of the entity is set
+#define COMPONENT_VELOCITY_MODE_FREE        0   //the velocity is set by the systems and the game
+#define COMPONENT_VELOCITY_MODE_FLOW_FIELD  1   //the move system points the velocity along the flow field to flowGoal
+
 typedef struct ComponentVelocity {
     float x;            //x velocity
     float y;            //y velocity
     int maxVelocity;    //max velocity
     float friction;     //friction for the velocity
+    short isSleeping;   //1 when the entity has been still for a while, it is not moved or tested for collisions
+    Uint16 framesAtRest;//number of frames in a row the velocity has been 0
+    Uint8 mode;         //COMPONENT_VELOCITY_MODE_*
+    SDL_Point flowGoal; //the tile the entity walks to in COMPONENT_VELOCITY_MODE_FLOW_FIELD
+    float flowSpeed;    //speed along the flow field
 } ComponentVelocity;
 
 [[nodiscard]] ComponentVelocity *ComponentVelocity_New();
@@ -19,5 +29,10 @@ void ComponentVelocity_Free(ComponentVelocity *positionVelocity);
 void ComponentVelocity_SetMaxVelocity(ComponentVelocity *velocityComponent,Uint32 entity,int maxVelocity);
 void ComponentVelocity_SetFriction(ComponentVelocity *velocityComponent,Uint32 entity,float friction);
 void ComponentVelocity_SetVelocity(ComponentVelocity *velocityComponents,Uint32 entity,float x,float y);
+void ComponentVelocity_Wake(ComponentVelocity *velocityComponents,Uint32 entity);
+void ComponentVelocity_FollowFlowField(ComponentVelocity *velocityComponents,Uint32 entity,int goalX,int goalY,float speed);
+void ComponentVelocity_StopFlowField(ComponentVelocity *velocityComponents,Uint32 entity);
+int ComponentVelocity_SteerAlongFlowField(ComponentVelocity *velocityComponents,Uint32 entity,IsoFlowFieldCache *flowFields,
+                                          IsoPathfinder *pathfinder,int tileX,int tileY);
 
 #endif // __COMPONENT_VELOCITY_H
\ No newline at end of file
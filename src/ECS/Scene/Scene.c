@@ -61,7 +61,9 @@ Scene *Scene_CreateNewScene(char *name) {
     scene->exitScene = 0;
     scene->consumeLessCPU = 0;
     scene->isoEngine = NULL;
+    scene->collisionBroadphase = COLLISION_BROADPHASE_SPATIAL_HASH;
     scene->componentPointersReallocated = 0;
+    scene->componentPointersUpdated = 0;
 
     //loop through all entities
     for (i = 0;i < scene->maxEntities; ++i) {
@@ -505,6 +507,7 @@ static void allocateMoreMemoryForComponents(Scene *scene) {
 
     //flag that the component pointers has been reallocated
     scene->componentPointersReallocated = 1;
+    scene->componentPointersUpdated = 0;
 
     for (i = 0; i < scene->numComponents; ++i) {
         //// POSITION COMPONENT
@@ -719,6 +722,7 @@ int Scene_AddSystemToScene(Scene *scene,SystemType systemType) {
     if (systemType == SYSTEM_MOVE) {
         scene->systems[scene->numSystems].type = SYSTEM_MOVE;
         scene->systems[scene->numSystems].init = SystemMove_Init;
+        scene->systems[scene->numSystems].group = SYSTEM_GROUP_SIMULATION;
         scene->systems[scene->numSystems].updateEntity = SystemMove_UpdateEntity;
         scene->systems[scene->numSystems].update = SystemMove_Update;
         scene->systems[scene->numSystems].free = SystemMove_MoveSystem;
@@ -728,6 +732,7 @@ int Scene_AddSystemToScene(Scene *scene,SystemType systemType) {
     else if (systemType == SYSTEM_INPUT) {
         scene->systems[scene->numSystems].type = SYSTEM_INPUT;
         scene->systems[scene->numSystems].init = SystemInput_Init;
+        scene->systems[scene->numSystems].group = SYSTEM_GROUP_MAIN_THREAD;
         scene->systems[scene->numSystems].updateEntity = SystemInput_UpdateEntity;
         scene->systems[scene->numSystems].update = SystemInput_Update;
         scene->systems[scene->numSystems].free = SystemInput_Free;
@@ -738,8 +743,9 @@ int Scene_AddSystemToScene(Scene *scene,SystemType systemType) {
     else if (systemType == SYSTEM_RENDER_ISOMETRIC_WORLD) {
         scene->systems[scene->numSystems].type = SYSTEM_RENDER_ISOMETRIC_WORLD;
         scene->systems[scene->numSystems].init = SystemRenderIsoMetricWorld_Init;
+        scene->systems[scene->numSystems].group = SYSTEM_GROUP_MAIN_THREAD;
         scene->systems[scene->numSystems].update = SystemRenderIsoMetricWorld_Compute;
-        scene->systems[scene->numSystems].updateEntity = SystemRenderIsoMetricWorld_SortEntity;
+        scene->systems[scene->numSystems].updateEntity = SystemRenderIsoMetricWorld_UpdateEntity;
         scene->systems[scene->numSystems].free = SystemRenderIsoMetricWorld_Free;
         scene->numSystems++;
     }
@@ -747,6 +753,7 @@ int Scene_AddSystemToScene(Scene *scene,SystemType systemType) {
     else if (systemType == SYSTEM_CONTROL_ISOMETRIC_WORLD) {
         scene->systems[scene->numSystems].type = SYSTEM_CONTROL_ISOMETRIC_WORLD;
         scene->systems[scene->numSystems].init = SystemControlIsoWorld_Init;
+        scene->systems[scene->numSystems].group = SYSTEM_GROUP_MAIN_THREAD;
         scene->systems[scene->numSystems].update = SystemControlIsoWorld_Compute;
         scene->systems[scene->numSystems].updateEntity = NULL;
         scene->systems[scene->numSystems].free = SystemControlIsoWorld_Free;
@@ -756,6 +763,7 @@ int Scene_AddSystemToScene(Scene *scene,SystemType systemType) {
     else if (systemType == SYSTEM_CONTROL_ENTITY) {
         scene->systems[scene->numSystems].type = SYSTEM_CONTROL_ENTITY;
         scene->systems[scene->numSystems].init = SystemControlEntity_Init;
+        scene->systems[scene->numSystems].group = SYSTEM_GROUP_MAIN_THREAD;
         scene->systems[scene->numSystems].update = SystemControlEntity_Compute;
         scene->systems[scene->numSystems].updateEntity = NULL;
         scene->systems[scene->numSystems].free = SystemControlEntity_Free;
@@ -765,6 +773,7 @@ int Scene_AddSystemToScene(Scene *scene,SystemType systemType) {
     else if (systemType == SYSTEM_COLLISION) {
         scene->systems[scene->numSystems].type = SYSTEM_COLLISION;
         scene->systems[scene->numSystems].init = SystemCollision_Init;
+        scene->systems[scene->numSystems].group = SYSTEM_GROUP_SIMULATION;
         scene->systems[scene->numSystems].update = SystemCollision_Update;
         scene->systems[scene->numSystems].updateEntity = SystemCollision_UpdateEntity;
         scene->systems[scene->numSystems].free = SystemCollision_Free;
@@ -773,6 +782,7 @@ int Scene_AddSystemToScene(Scene *scene,SystemType systemType) {
     else if (systemType == SYSTEM_ANIMATION) {
         scene->systems[scene->numSystems].type = SYSTEM_ANIMATION;
         scene->systems[scene->numSystems].init = SystemAnimation_Init;
+        scene->systems[scene->numSystems].group = SYSTEM_GROUP_SIMULATION;
         scene->systems[scene->numSystems].update = SystemAnimation_Update;
         scene->systems[scene->numSystems].updateEntity = SystemAnimation_UpdateEntity;
         scene->systems[scene->numSystems].free = SystemAnimation_Free;
@@ -811,6 +821,11 @@ int Scene_InitSystemsInScene(Scene *scene) {
 }
 
 void Scene_UpdateSystemsInScene(Scene *scene) {
+    Scene_UpdateSystemGroups(scene,SYSTEM_GROUP_ALL);
+}
+
+//updates the systems of the groups (SYSTEM_GROUP_*) in the order they were added to the scene
+void Scene_UpdateSystemGroups(Scene *scene,int groups) {
     Uint32 i = 0;
     Uint32 j = 0;
     //No scene == NULL check here, this will be called each game loop
@@ -818,8 +833,8 @@ void Scene_UpdateSystemsInScene(Scene *scene) {
 
     //run the systems that don't require working on an entity
     for (i = 0; i < scene->numSystems; ++i) {
-        //if the system has an update function
-        if (scene->systems[i].update!=NULL) {
+        //if the system is in the groups and has an update function
+        if ((scene->systems[i].group & groups) && scene->systems[i].update!=NULL) {
             //update the system
             scene->systems[i].update(scene);
         }
@@ -830,7 +845,7 @@ void Scene_UpdateSystemsInScene(Scene *scene) {
         //loop through all the systems in the scene
         for (j = 0; j < scene->numSystems; ++j) {
             //if the system for updating entities exist
-            if (scene->systems[j].updateEntity != NULL) {
+            if ((scene->systems[j].group & groups) && scene->systems[j].updateEntity != NULL) {
                 //update the system, performing changes on the entities that match the required components
                 scene->systems[j].updateEntity(i);
             }
@@ -838,10 +853,14 @@ void Scene_UpdateSystemsInScene(Scene *scene) {
     }
 
     //if the component pointers were reallocated
-    //the systems will now have updated the pointers
+    //the systems of the groups will now have updated the pointers
     if (scene->componentPointersReallocated == 1) {
-        //Reset the pointers reallocated flag to 0
-        scene->componentPointersReallocated = 0;
+        scene->componentPointersUpdated |= groups;
+        //once the systems of every group have, reset the pointers reallocated flag to 0
+        if ((scene->componentPointersUpdated & SYSTEM_GROUP_ALL) == SYSTEM_GROUP_ALL) {
+            scene->componentPointersReallocated = 0;
+            scene->componentPointersUpdated = 0;
+        }
     }
 }
 
@@ -957,3 +976,12 @@ void Scene_SetCPUDelay(Scene *scene, int value) {
     }
 }
 
+void Scene_SetCollisionBroadphase(Scene *scene, CollisionBroadphase broadphase) {
+    if (scene == NULL) {
+        //write error to the log file and exit out of the function
+        WriteError("parameter 'Scene *scene' is NULL");
+        return;
+    }
+    scene->collisionBroadphase = broadphase;
+}
+
@@ -37,8 +37,10 @@ typedef struct Scene {
     int sceneHasInputSystem;                //if the scene has an input system
     int sceneHasInputKeyboardComponent;     //if the scene has the keyboard input component
     int componentPointersReallocated;         //if the components in the scene was reallocated
+    int componentPointersUpdated;             //the system groups that have updated their pointers since then
 
     IsoEngine *isoEngine;                   //Pointer to isometric engine
+    CollisionBroadphase collisionBroadphase;//how the collision system finds the entities that may collide
 } Scene;
 
 [[nodiscard]] Scene *Scene_CreateNewScene(char *name);
@@ -54,11 +56,13 @@ int Scene_AddSystemToScene(Scene *scene, SystemType systemType);
 int Scene_InitSystemsInScene(Scene *scene);
 
 void Scene_UpdateSystemsInScene(Scene *scene);
+void Scene_UpdateSystemGroups(Scene *scene,int groups);
 void ESC_GetSystemName(SystemType systemType,char *name);
 void ESC_GetComponentName(ComponentType componentType,char *name);
 
 [[nodiscard]] int ESC_GetComponentBit(ComponentType componentType);
 void Scene_SetCPUDelay(Scene *scene, int value);
+void Scene_SetCollisionBroadphase(Scene *scene, CollisionBroadphase broadphase);
 
 #endif // __scene_H
 
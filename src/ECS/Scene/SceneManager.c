@@ -3,9 +3,95 @@
 #include <string.h>
 #include "../../logger.h"
 #include "../../DeltaTimer.h"
+#include "../../Headless.h"
+#include "../../RenderQueue.h"
 #include "SceneManager.h"
 #include "Scene.h"
 
+//the systems of the simulation group are updated this many times a second on their own thread
+#define SCENE_MANAGER_SIMULATION_RATE       60
+//the most steps the simulation takes at once to catch up, it drops the rest of the time it is behind
+#define SCENE_MANAGER_MAX_CATCH_UP_STEPS    5
+
+typedef struct SimulationThread {
+    SDL_Thread *thread;
+    SDL_mutex *sceneLock;       //held by the game loop and the simulation thread while they update the scene
+    SDL_atomic_t quit;          //set to 1 to stop the simulation thread
+    Scene *scene;
+} SimulationThread;
+
+static SimulationThread simulation;
+
+//updates the systems of the simulation group at a fixed step until it is told to quit
+static int runSimulation(void *data) {
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 stepTicks = frequency/SCENE_MANAGER_SIMULATION_RATE;
+    Uint64 nextStep = SDL_GetPerformanceCounter();
+    Uint64 now = 0;
+    int numSteps = 0;
+    (void)data;
+
+    DeltaTimer_SetThreadStepTime(1.0/SCENE_MANAGER_SIMULATION_RATE);
+    while (SDL_AtomicGet(&simulation.quit) == 0) {
+        now = SDL_GetPerformanceCounter();
+        //wait for the next step
+        if (now < nextStep) {
+            SDL_Delay((Uint32)((nextStep - now)*1000/frequency));
+            continue;
+        }
+        //take the steps that are due, a slow machine or a thread that was not scheduled for a while takes a few
+        //steps at once to catch up
+        for (numSteps = 0; now >= nextStep && numSteps < SCENE_MANAGER_MAX_CATCH_UP_STEPS; ++numSteps) {
+            SDL_LockMutex(simulation.sceneLock);
+            Scene_UpdateSystemGroups(simulation.scene,SYSTEM_GROUP_SIMULATION);
+            SDL_UnlockMutex(simulation.sceneLock);
+            nextStep += stepTicks;
+        }
+        //if it is still behind, the world slows down instead of taking more and more steps every frame
+        if (now >= nextStep) {
+            nextStep = now + stepTicks;
+        }
+    }
+    return 0;
+}
+
+//starts the thread that updates the simulation systems of the scene.
+//Returns 1 if it started, 0 if the game loop has to update every system itself
+static int startSimulation(Scene *scene) {
+    //a headless run updates every system once a frame with a fixed delta time, so the frames are the same on every run
+    if (Headless_GetOptions()->enabled) {
+        return 0;
+    }
+    simulation.scene = scene;
+    SDL_AtomicSet(&simulation.quit,0);
+    simulation.sceneLock = SDL_CreateMutex();
+    if (simulation.sceneLock == NULL) {
+        WriteError("Could not create the scene lock, the simulation runs on the game loop thread: %s",SDL_GetError());
+        return 0;
+    }
+    simulation.thread = SDL_CreateThread(runSimulation,"Simulation",NULL);
+    if (simulation.thread == NULL) {
+        WriteError("Could not start the simulation thread, the simulation runs on the game loop thread: %s",SDL_GetError());
+        SDL_DestroyMutex(simulation.sceneLock);
+        simulation.sceneLock = NULL;
+        return 0;
+    }
+    return 1;
+}
+
+static void stopSimulation() {
+    if (simulation.thread != NULL) {
+        SDL_AtomicSet(&simulation.quit,1);
+        SDL_WaitThread(simulation.thread,NULL);
+        simulation.thread = NULL;
+    }
+    if (simulation.sceneLock != NULL) {
+        SDL_DestroyMutex(simulation.sceneLock);
+        simulation.sceneLock = NULL;
+    }
+    simulation.scene = NULL;
+}
+
 SceneManager *SceneManager_CreateNewSceneManager() {
     SceneManager *sm = malloc(sizeof(struct SceneManager));
     if (sm == NULL) {
@@ -170,6 +256,7 @@ void SceneManager_RunActiveScene(SceneManager *sceneManager) {
     //event to handle keyboard if the scene is without keyboard component and input system
     SDL_Event event;
     int handleExit = 0;
+    int simulationThread = 0;
 
     //if the scene is NULL
     if (sceneManager == NULL) {
@@ -205,6 +292,10 @@ void SceneManager_RunActiveScene(SceneManager *sceneManager) {
         //log it as an error
         WriteError("Cannot switch scene! Systems has failed to initialize for scene:%s!",sceneManager->scenes[sceneManager->activeScene]->name);
     }
+    //the input, control and render systems are updated by this thread once a frame, the rest of the systems at a
+    //fixed step on the simulation thread
+    simulationThread = startSimulation(sceneManager->scenes[sceneManager->activeScene]);
+
     //as long as exitScene is false
     while (!sceneManager->scenes[sceneManager->activeScene]->exitScene) {
         //If the scene is without keyboard input, add exit handling to the scene
@@ -234,9 +325,25 @@ void SceneManager_RunActiveScene(SceneManager *sceneManager) {
         //update the delta timer
         DeltaTimer_Update();
 
-        //update all the systems in the scene
-        Scene_UpdateSystemsInScene(sceneManager->scenes[sceneManager->activeScene]);
+        if (simulationThread == 1) {
+            //update the systems of this thread while the simulation thread is kept off the scene
+            SDL_LockMutex(simulation.sceneLock);
+            Scene_UpdateSystemGroups(sceneManager->scenes[sceneManager->activeScene],SYSTEM_GROUP_MAIN_THREAD);
+            SDL_UnlockMutex(simulation.sceneLock);
+        } else {
+            //update all the systems in the scene
+            Scene_UpdateSystemsInScene(sceneManager->scenes[sceneManager->activeScene]);
+        }
+
+        //draw and present the frame without holding the scene, so the wait for vsync does not hold up the simulation
+        RenderQueue_Present();
+
+        //a headless run quits when it has drawn all its frames
+        if (Headless_EndFrame() == 0) {
+            sceneManager->scenes[sceneManager->activeScene]->exitScene = 1;
+        }
     }
+    stopSimulation();
 }
 
 void SceneManager_FreeSceneManager(SceneManager *sceneManager) {
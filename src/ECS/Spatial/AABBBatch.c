@@ -0,0 +1,208 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "AABBBatch.h"
+#include "../../logger.h"
+
+//number of boxes there is room for before the first box is added
+#define AABB_BATCH_INITIAL_BOXES    64
+
+//makes room for twice as many boxes. Returns 0 if memory allocation failed
+static int growBoxes(AABBBatch *batch) {
+    Uint32 newMax = batch->maxBoxes > 0 ? batch->maxBoxes*2 : AABB_BATCH_INITIAL_BOXES;
+    float **edges[4] = {&batch->minX,&batch->minY,&batch->maxX,&batch->maxY};
+    float *newEdges = NULL;
+    Uint32 *newIds = NULL, *newHitMask = NULL;
+    int i = 0;
+
+    for (i = 0; i < 4; ++i) {
+        newEdges = realloc(*edges[i],sizeof(float)*newMax);
+        if (newEdges == NULL) {
+            WriteError("Could not allocate memory for %u boxes in the box batch!",newMax);
+            return 0;
+        }
+        *edges[i] = newEdges;
+    }
+    newIds = realloc(batch->ids,sizeof(Uint32)*newMax);
+    if (newIds == NULL) {
+        WriteError("Could not allocate memory for %u boxes in the box batch!",newMax);
+        return 0;
+    }
+    batch->ids = newIds;
+    newHitMask = realloc(batch->hitMask,sizeof(Uint32)*(newMax/32));
+    if (newHitMask == NULL) {
+        WriteError("Could not allocate memory for %u boxes in the box batch!",newMax);
+        return 0;
+    }
+    batch->hitMask = newHitMask;
+    batch->maxBoxes = newMax;
+    return 1;
+}
+
+AABBBatch *AABBBatch_New() {
+    AABBBatch *batch = calloc(1,sizeof(struct AABBBatch));
+
+    if (batch == NULL) {
+        WriteError("Could not allocate memory for the box batch!");
+        return NULL;
+    }
+    if (growBoxes(batch) == 0) {
+        AABBBatch_Free(batch);
+        return NULL;
+    }
+    return batch;
+}
+
+void AABBBatch_Free(AABBBatch *batch) {
+    if (batch == NULL) {
+        return;
+    }
+    free(batch->minX);
+    free(batch->minY);
+    free(batch->maxX);
+    free(batch->maxY);
+    free(batch->ids);
+    free(batch->hitMask);
+    free(batch);
+}
+
+//removes all the boxes, the memory is kept for the next test
+void AABBBatch_Clear(AABBBatch *batch) {
+    if (batch == NULL) {
+        return;
+    }
+    batch->numBoxes = 0;
+}
+
+//adds the box at the end of the batch. Returns 0 on error
+int AABBBatch_Add(AABBBatch *batch,Uint32 id,SDL_FRect *box) {
+    if (batch == NULL || box == NULL) {
+        return 0;
+    }
+    if (batch->numBoxes >= batch->maxBoxes && growBoxes(batch) == 0) {
+        return 0;
+    }
+    batch->minX[batch->numBoxes] = box->x;
+    batch->minY[batch->numBoxes] = box->y;
+    batch->maxX[batch->numBoxes] = box->x + box->w;
+    batch->maxY[batch->numBoxes] = box->y + box->h;
+    batch->ids[batch->numBoxes] = id;
+    batch->numBoxes++;
+    return 1;
+}
+
+//tests the box against the boxes of the batch one at a time, from box first. Returns the number of overlaps
+static int overlapScalar(AABBBatch *batch,Uint32 first,float minX,float minY,float maxX,float maxY) {
+    Uint32 i = 0;
+    int numHits = 0;
+
+    for (i = first; i < batch->numBoxes; ++i) {
+        if (batch->minX[i] < maxX && minX < batch->maxX[i] && batch->minY[i] < maxY && minY < batch->maxY[i]) {
+            batch->hitMask[i/32] |= 1u << (i%32);
+            numHits++;
+        }
+    }
+    return numHits;
+}
+
+//sets the bits of the boxes in the batch that overlap the box, in hitMask. Returns the number of overlaps
+int AABBBatch_Overlap(AABBBatch *batch,SDL_FRect *box) {
+#if defined(__SSE2__)
+    __m128 boxMinX, boxMinY, boxMaxX, boxMaxY;
+    __m128 overlap;
+    Uint32 i = 0, numFull = 0;
+    int bits = 0, numHits = 0;
+
+    if (batch == NULL || box == NULL) {
+        return 0;
+    }
+    memset(batch->hitMask,0,sizeof(Uint32)*((batch->numBoxes+31)/32));
+    boxMinX = _mm_set1_ps(box->x);
+    boxMinY = _mm_set1_ps(box->y);
+    boxMaxX = _mm_set1_ps(box->x + box->w);
+    boxMaxY = _mm_set1_ps(box->y + box->h);
+    //4 boxes at a time, the ones left over are tested one by one
+    numFull = batch->numBoxes & ~3u;
+    for (i = 0; i < numFull; i += 4) {
+        overlap = _mm_and_ps(_mm_cmplt_ps(_mm_loadu_ps(&batch->minX[i]),boxMaxX),_mm_cmplt_ps(boxMinX,_mm_loadu_ps(&batch->maxX[i])));
+        overlap = _mm_and_ps(overlap,_mm_cmplt_ps(_mm_loadu_ps(&batch->minY[i]),boxMaxY));
+        overlap = _mm_and_ps(overlap,_mm_cmplt_ps(boxMinY,_mm_loadu_ps(&batch->maxY[i])));
+        bits = _mm_movemask_ps(overlap);
+        if (bits != 0) {
+            //i is a multiple of 4, so the 4 bits never cross a word
+            batch->hitMask[i/32] |= (Uint32)bits << (i%32);
+            numHits += (bits & 1) + ((bits >> 1) & 1) + ((bits >> 2) & 1) + ((bits >> 3) & 1);
+        }
+    }
+    return numHits + overlapScalar(batch,numFull,box->x,box->y,box->x + box->w,box->y + box->h);
+#else
+    return AABBBatch_OverlapScalar(batch,box);
+#endif
+}
+
+//the same as AABBBatch_Overlap() without SSE2, the results are the same
+int AABBBatch_OverlapScalar(AABBBatch *batch,SDL_FRect *box) {
+    if (batch == NULL || box == NULL) {
+        return 0;
+    }
+    memset(batch->hitMask,0,sizeof(Uint32)*((batch->numBoxes+31)/32));
+    return overlapScalar(batch,0,box->x,box->y,box->x + box->w,box->y + box->h);
+}
+
+//tests box i of batch A against box i of batch B one at a time, from box first. Returns the number of overlaps
+static int overlapPairsScalar(AABBBatch *batchA,AABBBatch *batchB,Uint32 first,Uint32 numPairs) {
+    Uint32 i = 0;
+    int numHits = 0;
+
+    for (i = first; i < numPairs; ++i) {
+        if (batchA->minX[i] < batchB->maxX[i] && batchB->minX[i] < batchA->maxX[i]
+        && batchA->minY[i] < batchB->maxY[i] && batchB->minY[i] < batchA->maxY[i]) {
+            batchA->hitMask[i/32] |= 1u << (i%32);
+            numHits++;
+        }
+    }
+    return numHits;
+}
+
+//tests box i of batch A against box i of batch B, for the pairs the broadphase has found. The bits of the pairs
+//that overlap are set in the hitMask of batch A. Returns the number of overlaps
+int AABBBatch_OverlapPairs(AABBBatch *batchA,AABBBatch *batchB) {
+#if defined(__SSE2__)
+    __m128 overlap;
+    Uint32 i = 0, numPairs = 0, numFull = 0;
+    int bits = 0, numHits = 0;
+
+    if (batchA == NULL || batchB == NULL) {
+        return 0;
+    }
+    numPairs = SDL_min(batchA->numBoxes,batchB->numBoxes);
+    memset(batchA->hitMask,0,sizeof(Uint32)*((batchA->numBoxes+31)/32));
+    numFull = numPairs & ~3u;
+    for (i = 0; i < numFull; i += 4) {
+        overlap = _mm_and_ps(_mm_cmplt_ps(_mm_loadu_ps(&batchA->minX[i]),_mm_loadu_ps(&batchB->maxX[i])),
+                             _mm_cmplt_ps(_mm_loadu_ps(&batchB->minX[i]),_mm_loadu_ps(&batchA->maxX[i])));
+        overlap = _mm_and_ps(overlap,_mm_cmplt_ps(_mm_loadu_ps(&batchA->minY[i]),_mm_loadu_ps(&batchB->maxY[i])));
+        overlap = _mm_and_ps(overlap,_mm_cmplt_ps(_mm_loadu_ps(&batchB->minY[i]),_mm_loadu_ps(&batchA->maxY[i])));
+        bits = _mm_movemask_ps(overlap);
+        if (bits != 0) {
+            batchA->hitMask[i/32] |= (Uint32)bits << (i%32);
+            numHits += (bits & 1) + ((bits >> 1) & 1) + ((bits >> 2) & 1) + ((bits >> 3) & 1);
+        }
+    }
+    return numHits + overlapPairsScalar(batchA,batchB,numFull,numPairs);
+#else
+    return AABBBatch_OverlapPairsScalar(batchA,batchB);
+#endif
+}
+
+//the same as AABBBatch_OverlapPairs() without SSE2, the results are the same
+int AABBBatch_OverlapPairsScalar(AABBBatch *batchA,AABBBatch *batchB) {
+    if (batchA == NULL || batchB == NULL) {
+        return 0;
+    }
+    memset(batchA->hitMask,0,sizeof(Uint32)*((batchA->numBoxes+31)/32));
+    return overlapPairsScalar(batchA,batchB,0,SDL_min(batchA->numBoxes,batchB->numBoxes));
+}
@@ -0,0 +1,30 @@
+#ifndef __AABBBATCH_H
+#define __AABBBATCH_H
+
+#include <SDL2/SDL.h>
+
+//A list of axis aligned boxes stored as separate arrays of left, top, right and bottom edges, so one box can be
+//tested against 4 of them at a time with SSE2. The result of a test is a bit mask with one bit for every box,
+//bit i%32 of hitMask[i/32] is set when box i overlaps. Boxes that only touch do not overlap, the same as
+//SystemCollision_BoundingBoxCollisionF()
+typedef struct AABBBatch {
+    float *minX;
+    float *minY;
+    float *maxX;
+    float *maxY;
+    Uint32 *ids;                //free for the user of the batch, usually the entity of the box
+    Uint32 *hitMask;            //result of the last test, (numBoxes+31)/32 words
+    Uint32 numBoxes;
+    Uint32 maxBoxes;
+} AABBBatch;
+
+[[nodiscard]] AABBBatch *AABBBatch_New();
+void AABBBatch_Free(AABBBatch *batch);
+void AABBBatch_Clear(AABBBatch *batch);
+int AABBBatch_Add(AABBBatch *batch,Uint32 id,SDL_FRect *box);
+int AABBBatch_Overlap(AABBBatch *batch,SDL_FRect *box);
+int AABBBatch_OverlapScalar(AABBBatch *batch,SDL_FRect *box);
+int AABBBatch_OverlapPairs(AABBBatch *batchA,AABBBatch *batchB);
+int AABBBatch_OverlapPairsScalar(AABBBatch *batchA,AABBBatch *batchB);
+
+#endif // __AABBBATCH_H
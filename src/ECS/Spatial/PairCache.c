@@ -0,0 +1,167 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "PairCache.h"
+#include "../../logger.h"
+
+//size of the hash table before the first pair is added
+#define PAIR_CACHE_INITIAL_ENTRIES  64
+
+//returns the slot the pair wants to be in. The entities are already in order
+static Uint32 slotOfPair(PairCache *cache,Uint32 entityA,Uint32 entityB) {
+    Uint64 key = ((Uint64)entityA << 32) | entityB;
+
+    return (Uint32)((key*0x9e3779b97f4a7c15ULL) >> 32) & (cache->maxEntries-1);
+}
+
+//makes the hash table twice as large and puts the pairs back in. Returns 0 if memory allocation failed
+static int growEntries(PairCache *cache) {
+    PairCacheEntry *oldEntries = cache->entries;
+    Uint32 oldMax = cache->maxEntries;
+    Uint32 newMax = oldMax > 0 ? oldMax*2 : PAIR_CACHE_INITIAL_ENTRIES;
+    Uint32 i = 0, slot = 0;
+
+    cache->entries = calloc(newMax,sizeof(struct PairCacheEntry));
+    if (cache->entries == NULL) {
+        WriteError("Could not allocate memory for %u pairs in the pair cache!",newMax);
+        cache->entries = oldEntries;
+        return 0;
+    }
+    cache->maxEntries = newMax;
+    for (i = 0; i < oldMax; ++i) {
+        if (!oldEntries[i].used) {
+            continue;
+        }
+        slot = slotOfPair(cache,oldEntries[i].entityA,oldEntries[i].entityB);
+        while (cache->entries[slot].used) {
+            slot = (slot+1) & (newMax-1);
+        }
+        cache->entries[slot] = oldEntries[i];
+    }
+    free(oldEntries);
+    return 1;
+}
+
+PairCache *PairCache_New() {
+    PairCache *cache = calloc(1,sizeof(struct PairCache));
+
+    if (cache == NULL) {
+        WriteError("Could not allocate memory for the pair cache!");
+        return NULL;
+    }
+    if (growEntries(cache) == 0) {
+        free(cache);
+        return NULL;
+    }
+    return cache;
+}
+
+void PairCache_Free(PairCache *cache) {
+    if (cache == NULL) {
+        return;
+    }
+    free(cache->entries);
+    free(cache);
+}
+
+void PairCache_Clear(PairCache *cache) {
+    Uint32 i = 0;
+
+    if (cache == NULL) {
+        return;
+    }
+    for (i = 0; i < cache->maxEntries; ++i) {
+        cache->entries[i].used = 0;
+    }
+    cache->numEntries = 0;
+}
+
+//adds the pair if it is not in the cache. isNew is set to 1 when the pair was added, it can be NULL.
+//Returns the entry of the pair, or NULL on error
+PairCacheEntry *PairCache_Add(PairCache *cache,Uint32 entityA,Uint32 entityB,int *isNew) {
+    PairCacheEntry *entry = NULL;
+    Uint32 tmp = 0, slot = 0;
+
+    if (cache == NULL) {
+        return NULL;
+    }
+    if (entityA > entityB) {
+        tmp = entityA;
+        entityA = entityB;
+        entityB = tmp;
+    }
+    entry = PairCache_Find(cache,entityA,entityB);
+    if (entry != NULL) {
+        if (isNew != NULL) {
+            *isNew = 0;
+        }
+        return entry;
+    }
+    //keep the table at most half full, so the runs of used slots stay short
+    if ((cache->numEntries+1)*2 > cache->maxEntries && growEntries(cache) == 0) {
+        return NULL;
+    }
+    slot = slotOfPair(cache,entityA,entityB);
+    while (cache->entries[slot].used) {
+        slot = (slot+1) & (cache->maxEntries-1);
+    }
+    entry = &cache->entries[slot];
+    entry->entityA = entityA;
+    entry->entityB = entityB;
+    entry->frame = 0;
+    entry->used = 1;
+    cache->numEntries++;
+    if (isNew != NULL) {
+        *isNew = 1;
+    }
+    return entry;
+}
+
+//returns the entry of the pair, or NULL if the pair is not in the cache
+PairCacheEntry *PairCache_Find(PairCache *cache,Uint32 entityA,Uint32 entityB) {
+    Uint32 tmp = 0, slot = 0;
+
+    if (cache == NULL) {
+        return NULL;
+    }
+    if (entityA > entityB) {
+        tmp = entityA;
+        entityA = entityB;
+        entityB = tmp;
+    }
+    slot = slotOfPair(cache,entityA,entityB);
+    while (cache->entries[slot].used) {
+        if (cache->entries[slot].entityA == entityA && cache->entries[slot].entityB == entityB) {
+            return &cache->entries[slot];
+        }
+        slot = (slot+1) & (cache->maxEntries-1);
+    }
+    return NULL;
+}
+
+//removes the pair. The pairs after it in the same run are moved back, so no pair gets lost behind an empty slot.
+//Returns 1 if the pair was in the cache
+int PairCache_Remove(PairCache *cache,Uint32 entityA,Uint32 entityB) {
+    PairCacheEntry *entry = PairCache_Find(cache,entityA,entityB);
+    Uint32 mask = 0, empty = 0, slot = 0, wanted = 0;
+
+    if (entry == NULL) {
+        return 0;
+    }
+    mask = cache->maxEntries-1;
+    empty = (Uint32)(entry - cache->entries);
+    cache->entries[empty].used = 0;
+    cache->numEntries--;
+
+    slot = (empty+1) & mask;
+    while (cache->entries[slot].used) {
+        wanted = slotOfPair(cache,cache->entries[slot].entityA,cache->entries[slot].entityB);
+        //if the empty slot is between where the pair wants to be and where it is, move the pair into it
+        if (((slot - wanted) & mask) >= ((slot - empty) & mask)) {
+            cache->entries[empty] = cache->entries[slot];
+            cache->entries[slot].used = 0;
+            empty = slot;
+        }
+        slot = (slot+1) & mask;
+    }
+    return 1;
+}
@@ -0,0 +1,29 @@
+#ifndef __PAIRCACHE_H
+#define __PAIRCACHE_H
+
+#include <SDL2/SDL.h>
+
+typedef struct PairCacheEntry {
+    Uint32 entityA;             //the entity with the lower ID
+    Uint32 entityB;             //the entity with the higher ID
+    Uint32 frame;               //free for the user of the cache, the last frame the pair was seen
+    Uint8 used;                 //1 when the entry holds a pair
+} PairCacheEntry;
+
+//A set of entity pairs that is kept from frame to frame, so the pairs that are new, still there or gone can be
+//told apart. The pairs are stored in a hash table with open addressing, a pair is the same no matter the order
+//of the entities. Loop through the entries up to maxEntries and skip the ones that are not used
+typedef struct PairCache {
+    PairCacheEntry *entries;
+    Uint32 numEntries;          //number of pairs in the cache
+    Uint32 maxEntries;          //size of the hash table, always a power of 2
+} PairCache;
+
+[[nodiscard]] PairCache *PairCache_New();
+void PairCache_Free(PairCache *cache);
+void PairCache_Clear(PairCache *cache);
+[[nodiscard]] PairCacheEntry *PairCache_Add(PairCache *cache,Uint32 entityA,Uint32 entityB,int *isNew);
+[[nodiscard]] PairCacheEntry *PairCache_Find(PairCache *cache,Uint32 entityA,Uint32 entityB);
+int PairCache_Remove(PairCache *cache,Uint32 entityA,Uint32 entityB);
+
+#endif // __PAIRCACHE_H
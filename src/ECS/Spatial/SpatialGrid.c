@@ -0,0 +1,213 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include "SpatialGrid.h"
+#include "../../logger.h"
+
+//number of entities the grid has room for before the first entity is added
+#define SPATIAL_GRID_INITIAL_ENTITIES 256
+
+//returns the column or row of the cell a position is in, clamped to the grid
+static int cellCoordinate(SpatialGrid *grid,float position,int numCells) {
+    int cell = (int)floorf(position/grid->cellSize);
+
+    if (cell < 0) {
+        return 0;
+    }
+    if (cell >= numCells) {
+        return numCells-1;
+    }
+    return cell;
+}
+
+//makes room for entity IDs up to and including entity. Returns 0 if memory allocation failed
+static int growEntities(SpatialGrid *grid,Uint32 entity) {
+    Uint32 newMax = grid->maxEntities > 0 ? grid->maxEntities : SPATIAL_GRID_INITIAL_ENTITIES;
+    Sint32 *newNext = NULL, *newPrev = NULL, *newCell = NULL;
+    Uint32 i = 0;
+
+    while (newMax <= entity) {
+        newMax *= 2;
+    }
+    newNext = realloc(grid->nextEntity,sizeof(Sint32)*newMax);
+    if (newNext == NULL) {
+        WriteError("Could not allocate memory for %u entities in the spatial grid!",newMax);
+        return 0;
+    }
+    grid->nextEntity = newNext;
+    newPrev = realloc(grid->prevEntity,sizeof(Sint32)*newMax);
+    if (newPrev == NULL) {
+        WriteError("Could not allocate memory for %u entities in the spatial grid!",newMax);
+        return 0;
+    }
+    grid->prevEntity = newPrev;
+    newCell = realloc(grid->cellOfEntity,sizeof(Sint32)*newMax);
+    if (newCell == NULL) {
+        WriteError("Could not allocate memory for %u entities in the spatial grid!",newMax);
+        return 0;
+    }
+    grid->cellOfEntity = newCell;
+
+    for (i = grid->maxEntities; i < newMax; ++i) {
+        grid->nextEntity[i] = SPATIAL_GRID_NONE;
+        grid->prevEntity[i] = SPATIAL_GRID_NONE;
+        grid->cellOfEntity[i] = SPATIAL_GRID_NONE;
+    }
+    grid->maxEntities = newMax;
+    return 1;
+}
+
+//takes the entity out of the list of its cell
+static void unlinkEntity(SpatialGrid *grid,Uint32 entity) {
+    Sint32 cell = grid->cellOfEntity[entity];
+
+    if (grid->prevEntity[entity] != SPATIAL_GRID_NONE) {
+        grid->nextEntity[grid->prevEntity[entity]] = grid->nextEntity[entity];
+    } else {
+        grid->cellFirstEntity[cell] = grid->nextEntity[entity];
+    }
+    if (grid->nextEntity[entity] != SPATIAL_GRID_NONE) {
+        grid->prevEntity[grid->nextEntity[entity]] = grid->prevEntity[entity];
+    }
+    grid->nextEntity[entity] = SPATIAL_GRID_NONE;
+    grid->prevEntity[entity] = SPATIAL_GRID_NONE;
+    grid->cellOfEntity[entity] = SPATIAL_GRID_NONE;
+}
+
+//creates a grid that covers the world from 0,0 to width,height
+SpatialGrid *SpatialGrid_New(float width,float height,float cellSize) {
+    SpatialGrid *grid = NULL;
+    int i = 0;
+
+    if (cellSize <= 0) {
+        WriteError("The cell size of the spatial grid has to be larger than 0!");
+        return NULL;
+    }
+    grid = calloc(1,sizeof(struct SpatialGrid));
+    if (grid == NULL) {
+        WriteError("Could not allocate memory for the spatial grid!");
+        return NULL;
+    }
+    grid->cellSize = cellSize;
+    grid->numCellsX = width > cellSize ? (int)ceilf(width/cellSize) : 1;
+    grid->numCellsY = height > cellSize ? (int)ceilf(height/cellSize) : 1;
+    grid->cellFirstEntity = malloc(sizeof(Sint32)*grid->numCellsX*grid->numCellsY);
+    if (grid->cellFirstEntity == NULL) {
+        WriteError("Could not allocate memory for %d cells in the spatial grid!",grid->numCellsX*grid->numCellsY);
+        free(grid);
+        return NULL;
+    }
+    for (i = 0; i < grid->numCellsX*grid->numCellsY; ++i) {
+        grid->cellFirstEntity[i] = SPATIAL_GRID_NONE;
+    }
+    return grid;
+}
+
+void SpatialGrid_Free(SpatialGrid *grid) {
+    if (grid == NULL) {
+        return;
+    }
+    free(grid->cellFirstEntity);
+    free(grid->nextEntity);
+    free(grid->prevEntity);
+    free(grid->cellOfEntity);
+    free(grid);
+}
+
+//adds the entity at the position, or moves it there if it already is in the grid.
+//Moving inside the same cell only costs the cell lookup. Returns 0 on error
+int SpatialGrid_Update(SpatialGrid *grid,Uint32 entity,float x,float y) {
+    Sint32 cell = 0;
+
+    if (grid == NULL) {
+        return 0;
+    }
+    if (entity >= grid->maxEntities && growEntities(grid,entity) == 0) {
+        return 0;
+    }
+    cell = cellCoordinate(grid,y,grid->numCellsY)*grid->numCellsX + cellCoordinate(grid,x,grid->numCellsX);
+    if (grid->cellOfEntity[entity] == cell) {
+        return 1;
+    }
+    if (grid->cellOfEntity[entity] != SPATIAL_GRID_NONE) {
+        unlinkEntity(grid,entity);
+    } else {
+        grid->numEntities++;
+    }
+
+    //put the entity first in the list of the new cell
+    grid->nextEntity[entity] = grid->cellFirstEntity[cell];
+    grid->prevEntity[entity] = SPATIAL_GRID_NONE;
+    if (grid->cellFirstEntity[cell] != SPATIAL_GRID_NONE) {
+        grid->prevEntity[grid->cellFirstEntity[cell]] = entity;
+    }
+    grid->cellFirstEntity[cell] = entity;
+    grid->cellOfEntity[entity] = cell;
+    return 1;
+}
+
+void SpatialGrid_Remove(SpatialGrid *grid,Uint32 entity) {
+    if (grid == NULL || entity >= grid->maxEntities || grid->cellOfEntity[entity] == SPATIAL_GRID_NONE) {
+        return;
+    }
+    unlinkEntity(grid,entity);
+    grid->numEntities--;
+}
+
+//removes every entity from the grid
+void SpatialGrid_Clear(SpatialGrid *grid) {
+    Uint32 i = 0;
+    int cell = 0;
+
+    if (grid == NULL) {
+        return;
+    }
+    for (cell = 0; cell < grid->numCellsX*grid->numCellsY; ++cell) {
+        grid->cellFirstEntity[cell] = SPATIAL_GRID_NONE;
+    }
+    for (i = 0; i < grid->maxEntities; ++i) {
+        grid->nextEntity[i] = SPATIAL_GRID_NONE;
+        grid->prevEntity[i] = SPATIAL_GRID_NONE;
+        grid->cellOfEntity[i] = SPATIAL_GRID_NONE;
+    }
+    grid->numEntities = 0;
+}
+
+int SpatialGrid_Contains(SpatialGrid *grid,Uint32 entity) {
+    if (grid == NULL || entity >= grid->maxEntities) {
+        return 0;
+    }
+    return grid->cellOfEntity[entity] != SPATIAL_GRID_NONE;
+}
+
+//calls func for every entity in the cells that overlap the rectangle. The entities are only sorted into cells,
+//so some of them can be outside the rectangle. Returns the number of entities func was called for
+int SpatialGrid_Query(SpatialGrid *grid,float minX,float minY,float maxX,float maxY,spatialGridQueryFuncPointer func) {
+    int cellX0 = 0, cellY0 = 0, cellX1 = 0, cellY1 = 0;
+    int cellX = 0, cellY = 0;
+    Sint32 entity = 0;
+    Sint32 next = 0;
+    int numVisited = 0;
+
+    if (grid == NULL || func == NULL || maxX < minX || maxY < minY) {
+        return 0;
+    }
+    cellX0 = cellCoordinate(grid,minX,grid->numCellsX);
+    cellY0 = cellCoordinate(grid,minY,grid->numCellsY);
+    cellX1 = cellCoordinate(grid,maxX,grid->numCellsX);
+    cellY1 = cellCoordinate(grid,maxY,grid->numCellsY);
+
+    for (cellY = cellY0; cellY <= cellY1; ++cellY) {
+        for (cellX = cellX0; cellX <= cellX1; ++cellX) {
+            entity = grid->cellFirstEntity[cellY*grid->numCellsX + cellX];
+            while (entity != SPATIAL_GRID_NONE) {
+                //read the next entity first, so func is free to take the entity out of the grid
+                next = grid->nextEntity[entity];
+                func((Uint32)entity);
+                numVisited++;
+                entity = next;
+            }
+        }
+    }
+    return numVisited;
+}
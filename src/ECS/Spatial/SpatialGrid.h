@@ -0,0 +1,34 @@
+#ifndef __SPATIALGRID_H
+#define __SPATIALGRID_H
+
+#include <SDL2/SDL.h>
+
+//marks an empty cell, the end of a cell list and an entity that is not in the grid
+#define SPATIAL_GRID_NONE   -1
+
+typedef void (*spatialGridQueryFuncPointer)(Uint32 entity);
+
+//A uniform grid over the world positions of the entities. Every cell holds a linked list of the entities in it,
+//stored in arrays indexed by the entity ID, so moving an entity to another cell does not allocate anything.
+//Positions outside the grid are put in the closest cell on the edge
+typedef struct SpatialGrid {
+    float cellSize;             //width and height of a cell in world units
+    int numCellsX;
+    int numCellsY;
+    Sint32 *cellFirstEntity;    //first entity in every cell
+    Sint32 *nextEntity;         //next entity in the same cell, for every entity
+    Sint32 *prevEntity;         //previous entity in the same cell, for every entity
+    Sint32 *cellOfEntity;       //the cell every entity is in
+    Uint32 maxEntities;         //size of the entity arrays, they grow when a larger entity ID is added
+    Uint32 numEntities;         //number of entities in the grid
+} SpatialGrid;
+
+[[nodiscard]] SpatialGrid *SpatialGrid_New(float width,float height,float cellSize);
+void SpatialGrid_Free(SpatialGrid *grid);
+int SpatialGrid_Update(SpatialGrid *grid,Uint32 entity,float x,float y);
+void SpatialGrid_Remove(SpatialGrid *grid,Uint32 entity);
+void SpatialGrid_Clear(SpatialGrid *grid);
+[[nodiscard]] int SpatialGrid_Contains(SpatialGrid *grid,Uint32 entity);
+int SpatialGrid_Query(SpatialGrid *grid,float minX,float minY,float maxX,float maxY,spatialGridQueryFuncPointer func);
+
+#endif // __SPATIALGRID_H
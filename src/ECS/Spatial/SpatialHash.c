@@ -0,0 +1,198 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "SpatialHash.h"
+#include "../../logger.h"
+
+//number of entities the hash has room for before the first entity is added
+#define SPATIAL_HASH_INITIAL_ENTITIES   256
+//the fewest buckets the hash is built with
+#define SPATIAL_HASH_MIN_BUCKETS        16
+
+//returns the bucket of the cell. numBuckets is a power of 2
+static Uint32 bucketOfCell(Sint32 cellX,Sint32 cellY,Uint32 numBuckets) {
+    return (((Uint32)cellX*0x8da6b343u) ^ ((Uint32)cellY*0xd8163841u)) & (numBuckets-1);
+}
+
+//makes room for twice as many entities. Returns 0 if memory allocation failed
+static int growEntities(SpatialHash *hash) {
+    Uint32 newMax = hash->maxEntities > 0 ? hash->maxEntities*2 : SPATIAL_HASH_INITIAL_ENTITIES;
+    Uint32 *newEntities = NULL, *newSorted = NULL;
+    float *newX = NULL, *newY = NULL;
+    Sint32 *newCellsX = NULL, *newCellsY = NULL;
+
+    newEntities = realloc(hash->entities,sizeof(Uint32)*newMax);
+    if (newEntities == NULL) {
+        WriteError("Could not allocate memory for %u entities in the spatial hash!",newMax);
+        return 0;
+    }
+    hash->entities = newEntities;
+    newX = realloc(hash->positionsX,sizeof(float)*newMax);
+    if (newX == NULL) {
+        WriteError("Could not allocate memory for %u entities in the spatial hash!",newMax);
+        return 0;
+    }
+    hash->positionsX = newX;
+    newY = realloc(hash->positionsY,sizeof(float)*newMax);
+    if (newY == NULL) {
+        WriteError("Could not allocate memory for %u entities in the spatial hash!",newMax);
+        return 0;
+    }
+    hash->positionsY = newY;
+    newCellsX = realloc(hash->cellsX,sizeof(Sint32)*newMax);
+    if (newCellsX == NULL) {
+        WriteError("Could not allocate memory for %u entities in the spatial hash!",newMax);
+        return 0;
+    }
+    hash->cellsX = newCellsX;
+    newCellsY = realloc(hash->cellsY,sizeof(Sint32)*newMax);
+    if (newCellsY == NULL) {
+        WriteError("Could not allocate memory for %u entities in the spatial hash!",newMax);
+        return 0;
+    }
+    hash->cellsY = newCellsY;
+    newSorted = realloc(hash->sorted,sizeof(Uint32)*newMax);
+    if (newSorted == NULL) {
+        WriteError("Could not allocate memory for %u entities in the spatial hash!",newMax);
+        return 0;
+    }
+    hash->sorted = newSorted;
+    hash->maxEntities = newMax;
+    return 1;
+}
+
+SpatialHash *SpatialHash_New() {
+    SpatialHash *hash = calloc(1,sizeof(struct SpatialHash));
+
+    if (hash == NULL) {
+        WriteError("Could not allocate memory for the spatial hash!");
+        return NULL;
+    }
+    hash->cellSize = 1;
+    return hash;
+}
+
+void SpatialHash_Free(SpatialHash *hash) {
+    if (hash == NULL) {
+        return;
+    }
+    free(hash->entities);
+    free(hash->positionsX);
+    free(hash->positionsY);
+    free(hash->cellsX);
+    free(hash->cellsY);
+    free(hash->sorted);
+    free(hash->bucketStart);
+    free(hash);
+}
+
+//removes all the entities, the memory is kept for the next frame
+void SpatialHash_Clear(SpatialHash *hash) {
+    if (hash == NULL) {
+        return;
+    }
+    hash->numEntities = 0;
+    hash->numBuckets = 0;
+}
+
+//adds the entity at the position. It can be found after the hash has been built. Returns 0 on error
+int SpatialHash_Add(SpatialHash *hash,Uint32 entity,float x,float y) {
+    if (hash == NULL) {
+        return 0;
+    }
+    if (hash->numEntities >= hash->maxEntities && growEntities(hash) == 0) {
+        return 0;
+    }
+    hash->entities[hash->numEntities] = entity;
+    hash->positionsX[hash->numEntities] = x;
+    hash->positionsY[hash->numEntities] = y;
+    hash->numEntities++;
+    return 1;
+}
+
+//sorts the added entities into the cells they are in. There are about as many buckets as entities, so
+//a bucket holds few cells. Returns 0 on error
+int SpatialHash_Build(SpatialHash *hash,float cellSize) {
+    Uint32 numBuckets = SPATIAL_HASH_MIN_BUCKETS;
+    Uint32 *newBucketStart = NULL;
+    Uint32 bucket = 0;
+    Uint32 i = 0;
+
+    if (hash == NULL) {
+        return 0;
+    }
+    if (cellSize <= 0) {
+        WriteError("The cell size of the spatial hash has to be larger than 0!");
+        return 0;
+    }
+    hash->cellSize = cellSize;
+    while (numBuckets < hash->numEntities) {
+        numBuckets *= 2;
+    }
+    if (numBuckets+1 > hash->maxBuckets) {
+        newBucketStart = realloc(hash->bucketStart,sizeof(Uint32)*(numBuckets+1));
+        if (newBucketStart == NULL) {
+            WriteError("Could not allocate memory for %u buckets in the spatial hash!",numBuckets);
+            hash->numBuckets = 0;
+            return 0;
+        }
+        hash->bucketStart = newBucketStart;
+        hash->maxBuckets = numBuckets+1;
+    }
+    hash->numBuckets = numBuckets;
+
+    //count the entities in every bucket, and turn the counts into where every bucket starts
+    memset(hash->bucketStart,0,sizeof(Uint32)*(numBuckets+1));
+    for (i = 0; i < hash->numEntities; ++i) {
+        hash->cellsX[i] = (Sint32)floorf(hash->positionsX[i]/cellSize);
+        hash->cellsY[i] = (Sint32)floorf(hash->positionsY[i]/cellSize);
+        hash->bucketStart[bucketOfCell(hash->cellsX[i],hash->cellsY[i],numBuckets)+1]++;
+    }
+    for (i = 1; i <= numBuckets; ++i) {
+        hash->bucketStart[i] += hash->bucketStart[i-1];
+    }
+    //place the entities in their buckets. bucketStart is moved to the end of every bucket on the way,
+    //and moved back after
+    for (i = 0; i < hash->numEntities; ++i) {
+        bucket = bucketOfCell(hash->cellsX[i],hash->cellsY[i],numBuckets);
+        hash->sorted[hash->bucketStart[bucket]++] = i;
+    }
+    for (i = numBuckets; i > 0; --i) {
+        hash->bucketStart[i] = hash->bucketStart[i-1];
+    }
+    hash->bucketStart[0] = 0;
+    return 1;
+}
+
+//calls func for every entity in the cell of the position and the 8 cells around it. An entity that is within one
+//cell size of the position is always found. The hash is only read, so queries can run on several threads at once.
+//Returns the number of entities func was called for
+int SpatialHash_QueryNeighbours(SpatialHash *hash,float x,float y,spatialHashQueryFuncPointer func,void *data) {
+    Sint32 cellX = 0, cellY = 0;
+    Sint32 neighbourX = 0, neighbourY = 0;
+    Uint32 bucket = 0;
+    Uint32 i = 0, index = 0;
+    int numFound = 0;
+
+    if (hash == NULL || func == NULL || hash->numBuckets == 0) {
+        return 0;
+    }
+    cellX = (Sint32)floorf(x/hash->cellSize);
+    cellY = (Sint32)floorf(y/hash->cellSize);
+
+    for (neighbourY = cellY-1; neighbourY <= cellY+1; ++neighbourY) {
+        for (neighbourX = cellX-1; neighbourX <= cellX+1; ++neighbourX) {
+            bucket = bucketOfCell(neighbourX,neighbourY,hash->numBuckets);
+            for (i = hash->bucketStart[bucket]; i < hash->bucketStart[bucket+1]; ++i) {
+                index = hash->sorted[i];
+                //other cells can share the bucket. Every entity is in one cell, so it is only found once
+                if (hash->cellsX[index] == neighbourX && hash->cellsY[index] == neighbourY) {
+                    func(hash->entities[index],data);
+                    numFound++;
+                }
+            }
+        }
+    }
+    return numFound;
+}
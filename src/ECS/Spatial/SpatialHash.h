@@ -0,0 +1,35 @@
+#ifndef __SPATIALHASH_H
+#define __SPATIALHASH_H
+
+#include <SDL2/SDL.h>
+
+//called for every entity a query finds, with the data that was passed to the query
+typedef void (*spatialHashQueryFuncPointer)(Uint32 entity,void *data);
+
+//A spatial hash over the world positions of the entities, built from scratch every frame. The entities are added
+//with their position, and SpatialHash_Build() sorts them into buckets by the cell they are in with a counting sort,
+//so the entities of a bucket are next to each other in one array (compressed rows). The cells are not bounded by
+//the map, and cells that share a bucket are told apart by the cell of every entity
+typedef struct SpatialHash {
+    float cellSize;             //width and height of a cell in world units
+    Uint32 numEntities;         //number of entities added since the hash was cleared
+    Uint32 maxEntities;         //size of the entity arrays, they grow when they are full
+    Uint32 *entities;           //the added entity IDs
+    float *positionsX;          //the position of every added entity
+    float *positionsY;
+    Sint32 *cellsX;             //the cell of every added entity, set when the hash is built
+    Sint32 *cellsY;
+    Uint32 *sorted;             //indices into the added entities, grouped by bucket
+    Uint32 numBuckets;          //always a power of 2
+    Uint32 maxBuckets;
+    Uint32 *bucketStart;        //where the entities of every bucket start in sorted, and one more for the end
+} SpatialHash;
+
+[[nodiscard]] SpatialHash *SpatialHash_New();
+void SpatialHash_Free(SpatialHash *hash);
+void SpatialHash_Clear(SpatialHash *hash);
+int SpatialHash_Add(SpatialHash *hash,Uint32 entity,float x,float y);
+int SpatialHash_Build(SpatialHash *hash,float cellSize);
+int SpatialHash_QueryNeighbours(SpatialHash *hash,float x,float y,spatialHashQueryFuncPointer func,void *data);
+
+#endif // __SPATIALHASH_H
@@ -0,0 +1,298 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "SweepAndPrune.h"
+#include "../../logger.h"
+
+//number of proxies there is room for before the first box is added
+#define SWEEP_AND_PRUNE_INITIAL_PROXIES 64
+
+static int growProxies(SweepAndPrune *sap);
+static int growEntities(SweepAndPrune *sap,Uint32 entity);
+static int overlapOnX(SweepAndPrune *sap,Uint32 proxyA,Uint32 proxyB);
+static void edgeCrossed(SweepAndPrune *sap,SweepAndPruneEndpoint *moving,SweepAndPruneEndpoint *crossed,int movingLeft);
+static void swapEndpoints(SweepAndPrune *sap,Uint32 index);
+static void moveEndpointLeft(SweepAndPrune *sap,Uint32 index);
+static void moveEndpointRight(SweepAndPrune *sap,Uint32 index);
+
+SweepAndPrune *SweepAndPrune_New() {
+    SweepAndPrune *sap = calloc(1,sizeof(struct SweepAndPrune));
+
+    if (sap == NULL) {
+        WriteError("Could not allocate memory for the sweep and prune broadphase!");
+        return NULL;
+    }
+    sap->pairs = PairCache_New();
+    sap->pairBoxesA = AABBBatch_New();
+    sap->pairBoxesB = AABBBatch_New();
+    if (sap->pairs == NULL || sap->pairBoxesA == NULL || sap->pairBoxesB == NULL) {
+        SweepAndPrune_Free(sap);
+        return NULL;
+    }
+    return sap;
+}
+
+void SweepAndPrune_Free(SweepAndPrune *sap) {
+    if (sap == NULL) {
+        return;
+    }
+    free(sap->proxies);
+    free(sap->endpoints);
+    free(sap->proxyOfEntity);
+    PairCache_Free(sap->pairs);
+    AABBBatch_Free(sap->pairBoxesA);
+    AABBBatch_Free(sap->pairBoxesB);
+    free(sap);
+}
+
+//makes room for twice as many proxies and their endpoints. Returns 0 if memory allocation failed
+static int growProxies(SweepAndPrune *sap) {
+    Uint32 newMax = sap->maxProxies > 0 ? sap->maxProxies*2 : SWEEP_AND_PRUNE_INITIAL_PROXIES;
+    SweepAndPruneProxy *newProxies = NULL;
+    SweepAndPruneEndpoint *newEndpoints = NULL;
+
+    newProxies = realloc(sap->proxies,sizeof(struct SweepAndPruneProxy)*newMax);
+    if (newProxies == NULL) {
+        WriteError("Could not allocate memory for %u proxies in the sweep and prune broadphase!",newMax);
+        return 0;
+    }
+    sap->proxies = newProxies;
+    newEndpoints = realloc(sap->endpoints,sizeof(struct SweepAndPruneEndpoint)*newMax*2);
+    if (newEndpoints == NULL) {
+        WriteError("Could not allocate memory for %u proxies in the sweep and prune broadphase!",newMax);
+        return 0;
+    }
+    sap->endpoints = newEndpoints;
+    sap->maxProxies = newMax;
+    sap->maxEndpoints = newMax*2;
+    return 1;
+}
+
+//makes room for the entity in the proxy lookup. Returns 0 if memory allocation failed
+static int growEntities(SweepAndPrune *sap,Uint32 entity) {
+    Uint32 newMax = sap->maxEntities > 0 ? sap->maxEntities : SWEEP_AND_PRUNE_INITIAL_PROXIES;
+    Sint32 *newProxyOfEntity = NULL;
+    Uint32 i = 0;
+
+    while (newMax <= entity) {
+        newMax *= 2;
+    }
+    newProxyOfEntity = realloc(sap->proxyOfEntity,sizeof(Sint32)*newMax);
+    if (newProxyOfEntity == NULL) {
+        WriteError("Could not allocate memory for %u entities in the sweep and prune broadphase!",newMax);
+        return 0;
+    }
+    for (i = sap->maxEntities; i < newMax; ++i) {
+        newProxyOfEntity[i] = -1;
+    }
+    sap->proxyOfEntity = newProxyOfEntity;
+    sap->maxEntities = newMax;
+    return 1;
+}
+
+//returns 1 if the boxes of the proxies overlap on the x axis
+static int overlapOnX(SweepAndPrune *sap,Uint32 proxyA,Uint32 proxyB) {
+    SDL_FRect *a = &sap->proxies[proxyA].box;
+    SDL_FRect *b = &sap->proxies[proxyB].box;
+
+    return a->x < b->x + b->w && b->x < a->x + a->w;
+}
+
+//called when an edge moves past the edge of another box. A left edge that moves left past a right edge, or a right
+//edge that moves right past a left edge, can start an overlap. The other way around it ends the overlap
+static void edgeCrossed(SweepAndPrune *sap,SweepAndPruneEndpoint *moving,SweepAndPruneEndpoint *crossed,int movingLeft) {
+    Uint32 entityA = 0, entityB = 0;
+
+    sap->numSwaps++;
+    //if both edges are left edges or both are right edges, or they belong to the same box
+    if (moving->isMax == crossed->isMax || moving->proxy == crossed->proxy) {
+        return;
+    }
+    entityA = sap->proxies[moving->proxy].entity;
+    entityB = sap->proxies[crossed->proxy].entity;
+
+    if (moving->isMax != movingLeft) {
+        //the pair is checked with the boxes, the other edges may not have been moved yet
+        if (overlapOnX(sap,moving->proxy,crossed->proxy) && PairCache_Add(sap->pairs,entityA,entityB,NULL) == NULL) {
+            WriteError("Could not add the pair %u %u to the sweep and prune broadphase!",entityA,entityB);
+        }
+    }
+    else {
+        PairCache_Remove(sap->pairs,entityA,entityB);
+    }
+}
+
+//swaps the endpoint with the one after it
+static void swapEndpoints(SweepAndPrune *sap,Uint32 index) {
+    SweepAndPruneEndpoint tmp = sap->endpoints[index];
+    Uint32 i = 0;
+
+    sap->endpoints[index] = sap->endpoints[index+1];
+    sap->endpoints[index+1] = tmp;
+    //tell the proxies where their endpoints are now
+    for (i = index; i <= index+1; ++i) {
+        if (sap->endpoints[i].isMax) {
+            sap->proxies[sap->endpoints[i].proxy].maxEndpoint = i;
+        }
+        else {
+            sap->proxies[sap->endpoints[i].proxy].minEndpoint = i;
+        }
+    }
+}
+
+static void moveEndpointLeft(SweepAndPrune *sap,Uint32 index) {
+    while (index > 0 && sap->endpoints[index-1].value > sap->endpoints[index].value) {
+        edgeCrossed(sap,&sap->endpoints[index],&sap->endpoints[index-1],1);
+        swapEndpoints(sap,index-1);
+        index--;
+    }
+}
+
+static void moveEndpointRight(SweepAndPrune *sap,Uint32 index) {
+    while (index+1 < sap->numProxies*2 && sap->endpoints[index+1].value < sap->endpoints[index].value) {
+        edgeCrossed(sap,&sap->endpoints[index],&sap->endpoints[index+1],0);
+        swapEndpoints(sap,index);
+        index++;
+    }
+}
+
+//adds the box of the entity, or moves it to where the entity is now. Returns 0 on error
+int SweepAndPrune_SetBox(SweepAndPrune *sap,Uint32 entity,SDL_FRect *box) {
+    SweepAndPruneProxy *proxy = NULL;
+    Uint32 proxyIndex = 0;
+
+    if (sap == NULL || box == NULL) {
+        return 0;
+    }
+    if (entity >= sap->maxEntities && growEntities(sap,entity) == 0) {
+        return 0;
+    }
+
+    //if the entity is new, its edges start at the right end and are moved left into place
+    if (sap->proxyOfEntity[entity] < 0) {
+        if (sap->numProxies >= sap->maxProxies && growProxies(sap) == 0) {
+            return 0;
+        }
+        proxyIndex = sap->numProxies++;
+        sap->proxyOfEntity[entity] = proxyIndex;
+        proxy = &sap->proxies[proxyIndex];
+        proxy->entity = entity;
+        proxy->box = *box;
+        proxy->minEndpoint = proxyIndex*2;
+        proxy->maxEndpoint = proxyIndex*2+1;
+        sap->endpoints[proxy->minEndpoint].value = box->x;
+        sap->endpoints[proxy->minEndpoint].proxy = proxyIndex;
+        sap->endpoints[proxy->minEndpoint].isMax = 0;
+        sap->endpoints[proxy->maxEndpoint].value = box->x + box->w;
+        sap->endpoints[proxy->maxEndpoint].proxy = proxyIndex;
+        sap->endpoints[proxy->maxEndpoint].isMax = 1;
+        moveEndpointLeft(sap,proxy->minEndpoint);
+        moveEndpointLeft(sap,proxy->maxEndpoint);
+        return 1;
+    }
+
+    proxy = &sap->proxies[sap->proxyOfEntity[entity]];
+    proxy->box = *box;
+    sap->endpoints[proxy->minEndpoint].value = box->x;
+    sap->endpoints[proxy->maxEndpoint].value = box->x + box->w;
+    //the edge in front is moved first, so the edges of the box never cross each other.
+    //An edge that does not have to move in a direction is not moved
+    moveEndpointLeft(sap,proxy->minEndpoint);
+    moveEndpointLeft(sap,proxy->maxEndpoint);
+    moveEndpointRight(sap,proxy->maxEndpoint);
+    moveEndpointRight(sap,proxy->minEndpoint);
+    return 1;
+}
+
+//removes the box of the entity and all its pairs
+void SweepAndPrune_Remove(SweepAndPrune *sap,Uint32 entity) {
+    Uint32 proxyIndex = 0, lastProxy = 0;
+    Uint32 i = 0, numEndpoints = 0;
+    PairCacheEntry *entry = NULL;
+
+    if (!SweepAndPrune_Contains(sap,entity)) {
+        return;
+    }
+    proxyIndex = sap->proxyOfEntity[entity];
+    numEndpoints = sap->numProxies*2;
+
+    //remove the edges of the box and keep the others in order
+    for (i = 0; i < numEndpoints; ++i) {
+        if (sap->endpoints[i].proxy == proxyIndex) {
+            memmove(&sap->endpoints[i],&sap->endpoints[i+1],sizeof(struct SweepAndPruneEndpoint)*(numEndpoints-i-1));
+            numEndpoints--;
+            i--;
+        }
+    }
+    //the last proxy takes the place of the removed one
+    lastProxy = sap->numProxies-1;
+    if (proxyIndex != lastProxy) {
+        sap->proxies[proxyIndex] = sap->proxies[lastProxy];
+        sap->proxyOfEntity[sap->proxies[proxyIndex].entity] = proxyIndex;
+    }
+    sap->proxyOfEntity[entity] = -1;
+    sap->numProxies--;
+    for (i = 0; i < numEndpoints; ++i) {
+        if (sap->endpoints[i].proxy == lastProxy) {
+            sap->endpoints[i].proxy = proxyIndex;
+        }
+        if (sap->endpoints[i].isMax) {
+            sap->proxies[sap->endpoints[i].proxy].maxEndpoint = i;
+        }
+        else {
+            sap->proxies[sap->endpoints[i].proxy].minEndpoint = i;
+        }
+    }
+
+    //remove the pairs of the entity. A removed pair can move another pair back into the slot, so it is looked at again
+    i = 0;
+    while (i < sap->pairs->maxEntries) {
+        entry = &sap->pairs->entries[i];
+        if (entry->used && (entry->entityA == entity || entry->entityB == entity)) {
+            PairCache_Remove(sap->pairs,entry->entityA,entry->entityB);
+        }
+        else {
+            i++;
+        }
+    }
+}
+
+int SweepAndPrune_Contains(SweepAndPrune *sap,Uint32 entity) {
+    return sap != NULL && entity < sap->maxEntities && sap->proxyOfEntity[entity] >= 0;
+}
+
+//calls func for every pair of entities whose boxes overlap. Only the pairs that overlap on the x axis are looked at,
+//and their boxes are tested all at once. Returns the number of pairs func was called for
+int SweepAndPrune_ForEachOverlap(SweepAndPrune *sap,sweepAndPrunePairFuncPointer func) {
+    PairCacheEntry *entry = NULL;
+    Uint32 i = 0;
+    int numFound = 0;
+
+    if (sap == NULL || func == NULL) {
+        return 0;
+    }
+    AABBBatch_Clear(sap->pairBoxesA);
+    AABBBatch_Clear(sap->pairBoxesB);
+    for (i = 0; i < sap->pairs->maxEntries; ++i) {
+        entry = &sap->pairs->entries[i];
+        if (!entry->used) {
+            continue;
+        }
+        if (AABBBatch_Add(sap->pairBoxesA,entry->entityA,&sap->proxies[sap->proxyOfEntity[entry->entityA]].box) == 0
+        || AABBBatch_Add(sap->pairBoxesB,entry->entityB,&sap->proxies[sap->proxyOfEntity[entry->entityB]].box) == 0) {
+            return 0;
+        }
+    }
+    //edges with the same value are not swapped, so a pair whose boxes only touch on the x axis can be left over.
+    //The boxes are tested on both axes
+    if (AABBBatch_OverlapPairs(sap->pairBoxesA,sap->pairBoxesB) == 0) {
+        return 0;
+    }
+    for (i = 0; i < sap->pairBoxesA->numBoxes; ++i) {
+        if (sap->pairBoxesA->hitMask[i/32] & (1u << (i%32))) {
+            func(sap->pairBoxesA->ids[i],sap->pairBoxesB->ids[i]);
+            numFound++;
+        }
+    }
+    return numFound;
+}
@@ -0,0 +1,48 @@
+#ifndef __SWEEPANDPRUNE_H
+#define __SWEEPANDPRUNE_H
+
+#include <SDL2/SDL.h>
+#include "PairCache.h"
+#include "AABBBatch.h"
+
+typedef void (*sweepAndPrunePairFuncPointer)(Uint32 entityA,Uint32 entityB);
+
+typedef struct SweepAndPruneEndpoint {
+    float value;                //left or right edge of the box of the proxy
+    Uint32 proxy;               //index of the proxy the edge belongs to
+    Uint8 isMax;                //1 for the right edge
+} SweepAndPruneEndpoint;
+
+typedef struct SweepAndPruneProxy {
+    Uint32 entity;
+    SDL_FRect box;              //the box of the entity in world coordinates
+    Uint32 minEndpoint;         //where the edges of the box are in the sorted endpoints
+    Uint32 maxEndpoint;
+} SweepAndPruneProxy;
+
+//A broadphase that keeps the left and right edges of the boxes sorted along the x axis. When a box moves, its
+//edges are only moved past the edges they cross, and the pairs whose boxes start or stop overlapping on the
+//x axis are added to or removed from a pair cache. Between frames the boxes move little, so few edges are
+//crossed. Unlike a grid, it does not slow down when many entities are in the same place
+typedef struct SweepAndPrune {
+    SweepAndPruneProxy *proxies;
+    Uint32 numProxies;
+    Uint32 maxProxies;
+    SweepAndPruneEndpoint *endpoints;   //two for every proxy, sorted by value
+    Uint32 maxEndpoints;
+    Sint32 *proxyOfEntity;              //the proxy index of every entity, -1 for no proxy
+    Uint32 maxEntities;
+    PairCache *pairs;                   //the pairs of entities whose boxes overlap on the x axis
+    Uint32 numSwaps;                    //number of edges crossed since the counter was reset
+    AABBBatch *pairBoxesA;              //the boxes of the pairs, tested all at once in SweepAndPrune_ForEachOverlap()
+    AABBBatch *pairBoxesB;
+} SweepAndPrune;
+
+[[nodiscard]] SweepAndPrune *SweepAndPrune_New();
+void SweepAndPrune_Free(SweepAndPrune *sap);
+int SweepAndPrune_SetBox(SweepAndPrune *sap,Uint32 entity,SDL_FRect *box);
+void SweepAndPrune_Remove(SweepAndPrune *sap,Uint32 entity);
+[[nodiscard]] int SweepAndPrune_Contains(SweepAndPrune *sap,Uint32 entity);
+int SweepAndPrune_ForEachOverlap(SweepAndPrune *sap,sweepAndPrunePairFuncPointer func);
+
+#endif // __SWEEPANDPRUNE_H
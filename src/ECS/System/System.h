@@ -29,9 +29,15 @@ typedef enum SystemType {
     SYSTEM_GRAPHIC_UNIT_INTERFACE   = 8,    // system for handling graphic unit interface
 } SystemType;
 
+// the thread a system is updated on, see SceneManager_RunActiveScene()
+#define SYSTEM_GROUP_MAIN_THREAD    0x01    // input, control and render systems, they use SDL events and the renderer
+#define SYSTEM_GROUP_SIMULATION     0x02    // systems that move the world on, updated at a fixed step
+#define SYSTEM_GROUP_ALL            (SYSTEM_GROUP_MAIN_THREAD | SYSTEM_GROUP_SIMULATION)
+
 // system struct
 typedef struct System {
     SystemType type;                           // what kind of system this is
+    int group;                                  // SYSTEM_GROUP_* the system is updated in
     systemUpdateEntityFuncPointer updateEntity; // function pointer to run the system for an entity
     systemInitFuncPointer init;                 // function pointer to initialize the system
     systemUpdateFuncPointer update;             // function pointer to update the system
@@ -1,4 +1,7 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
 #include "System.h"
 #include "SystemCollision.h"
 #include "../../logger.h"
@@ -6,14 +9,73 @@
 #include "../Scene/Scene.h"
 #include "../Components/Component.h"
 #include "../../IsoEngine/isoEngine.h"
-#include "SystemRenderIsoMetricWorld.h"
+#include "../../ThreadPool.h"
+#include "../Spatial/SpatialHash.h"
+#include "../Spatial/SweepAndPrune.h"
+#include "../Spatial/PairCache.h"
+#include "../Spatial/AABBBatch.h"
 
 #define SYSTEM_COLLISION_MASK_SET1 (COMPONENT_SET1_POSITION | COMPONENT_SET1_VELOCITY | COMPONENT_SET1_COLLISION | COMPONENT_SET1_RENDER2D)
+//the components an entity needs to be put in the spatial hash, the render 2D component has the layer of the entity
+#define SYSTEM_COLLISION_HASH_MASK_SET1 (COMPONENT_SET1_POSITION | COMPONENT_SET1_COLLISION | COMPONENT_SET1_RENDER2D)
+//the bit that marks the second half of a pair in the contacts as a tile instead of an entity. The rest of the bits
+//are the index of the tile in the map
+#define SYSTEM_COLLISION_TILE_KEY 0x80000000u
+//how far a pushed out entity is moved past the edge of a tile, the edge it self is inside the tile
+#define SYSTEM_COLLISION_TILE_SKIN 0.01f
+//number of awake entities in one task of the parallel collision detection
+#define SYSTEM_COLLISION_ENTITIES_PER_TASK 256
+
+//a pair of entities whose collision rectangles overlap
+typedef struct CollisionPair {
+    Uint32 entityA;
+    Uint32 entityB;
+} CollisionPair;
+
+//the pairs one task of the collision detection has found, in the order it found them
+typedef struct CollisionPairList {
+    CollisionPair *pairs;
+    Uint32 numPairs;
+    Uint32 maxPairs;
+} CollisionPairList;
+
+//what one thread of the collision detection works with. The threads only read the components and the
+//broadphase, and write the pairs they find to the list of the task they are running
+typedef struct CollisionThreadContext {
+    Uint32 collider;                //the entity whose neighbours are tested
+    AABBBatch *candidates;          //the collision rectangles of the neighbours, tested against the collider at once
+    CollisionPairList *pairList;
+} CollisionThreadContext;
 
 //local global functions
 static void handleEntityWorldCollision(Uint32 entity);
-static void handleEnityToEntityCollision(Uint32 entity);
-static void checkPointCollision(Uint32 entity,int x,int y);
+static void handleEntitiesCollisions();
+static void handleSpatialHashCollisions();
+static void handleSweepAndPruneCollisions();
+static void updateSweepAndPruneRestingBodies();
+static void buildStaticHash();
+static void markStaticBodyTiles();
+static void growCellSize(SDL_Rect *rect);
+static void detectCollisionsTask(int taskIndex,int threadIndex,void *data);
+static void addCollisionCandidate(Uint32 other,void *data);
+static void addStaticCollisionCandidate(Uint32 other,void *data);
+static void testCollisionCandidates(CollisionThreadContext *context);
+static void testSweepAndPrunePair(Uint32 entityA,Uint32 entityB);
+static void addPair(CollisionPairList *pairList,Uint32 entityA,Uint32 entityB);
+static int createThreadContexts();
+static void freeThreadContexts();
+static int createPairLists(int numLists);
+static void handleFoundPairs();
+static void handleContact(Uint32 entityA,Uint32 entityB);
+static void wakeTouchedEntities();
+static void handleTileContacts();
+static void resolveContacts();
+static void endContacts();
+static CollisionEvent *appendEvent(CollisionEvent **list,Uint32 *num,Uint32 *max);
+static CollisionEvent *addEvent(CollisionEventType type,Uint32 entityA,Uint32 entityB);
+static int isRestingBody(Uint32 entity);
+static int isEntityCollider(Uint32 entity);
+static void addTileContact(Uint32 entity,IsoMapSweepHit *hit,SDL_FRect *rect,float dx,float dy);
 static void createWorldCollisionRect(Uint32 entity);
 
 //local global pointer to the data
@@ -21,9 +83,53 @@ static ComponentPosition *posComponents = NULL;
 static ComponentVelocity *velComponents = NULL;
 static ComponentRender2D *renderComponents = NULL;
 static ComponentCollision *colComponents = NULL;
-static EntitiesOnScreen *onScreenEntities = NULL;
-
 
+//local global spatial hash of the moving entities, built every frame
+static SpatialHash *dynamicHash = NULL;
+//local global spatial hash of the static and sleeping entities, only built again when one of them changes
+static SpatialHash *staticHash = NULL;
+//local global sweep and prune broadphase, used instead of the spatial hashes when the scene asks for it
+static SweepAndPrune *sweepAndPrune = NULL;
+static CollisionBroadphase broadphase = COLLISION_BROADPHASE_SPATIAL_HASH;
+//local global flag that a static or sleeping entity has changed since the resting entities were put in the broadphase
+static int restingBodiesChanged = 1;
+//local global tiles (y*mapWidth+x) under the static bodies, marked with ISO_TILE_FLAG_OCCUPIED in the map,
+//and the list they are collected in when the static bodies change
+static Uint32 *occupiedTiles = NULL;
+static Uint32 numOccupiedTiles = 0;
+static Uint32 maxOccupiedTiles = 0;
+static Uint32 *newOccupiedTiles = NULL;
+static Uint32 maxNewOccupiedTiles = 0;
+//local global cell size of both hashes. It only grows, so the static hash does not have to be built again
+//every time the moving entities change
+static float cellSize = 0;
+//local global spread of the edges of all the collision rectangles from the positions of their entities
+static int minRectLeft = 0, maxRectRight = 0, minRectTop = 0, maxRectBottom = 0;
+static int hasRectExtents = 0;
+//local global list of the entities that are awake, collected while the entities are updated, in the order of their ID
+static Uint32 *activeEntities = NULL;
+static Uint32 numActiveEntities = 0;
+static Uint32 maxActiveEntities = 0;
+//local global pairs of entities that touched last frame, and the frame they touched
+static PairCache *contacts = NULL;
+static Uint32 collisionFrame = 0;
+//local global collision events of the last update
+static CollisionEvent *events = NULL;
+static Uint32 numEvents = 0;
+static Uint32 maxEvents = 0;
+//local global contacts with the tiles, found while the entities are updated and turned into events on the next update
+static CollisionEvent *tileContacts = NULL;
+static Uint32 numTileContacts = 0;
+static Uint32 maxTileContacts = 0;
+//local global function that moves the entities apart, NULL to only find the contacts
+static collisionResolveFuncPointer resolveFunction = SystemCollision_ResolveSnapBack;
+//local global work space of every thread of the collision detection
+static CollisionThreadContext *threadContexts = NULL;
+static int numThreadContexts = 0;
+//local global pairs found by every task of the last detection, and the number of tasks
+static CollisionPairList *pairLists = NULL;
+static int numPairLists = 0;
+static int maxPairLists = 0;
 
 //local global pointer to the scene
 static Scene *scn = NULL;
@@ -120,6 +226,36 @@ int SystemCollision_Init(void *scene) {
         systemFailedToInitialize = 1;
         return 0;
     }
+
+    //create the spatial hashes for the entity to entity collisions
+    if (dynamicHash == NULL) {
+        dynamicHash = SpatialHash_New();
+    }
+    if (staticHash == NULL) {
+        staticHash = SpatialHash_New();
+    }
+    if (contacts == NULL) {
+        contacts = PairCache_New();
+    }
+    if (dynamicHash == NULL || staticHash == NULL || contacts == NULL || createThreadContexts() == 0) {
+        WriteError("Collision system failed to initialize: Could not create the spatial hashes");
+        systemFailedToInitialize = 1;
+        return 0;
+    }
+    //the sweep and prune broadphase starts over with the entities of the new scene
+    SweepAndPrune_Free(sweepAndPrune);
+    sweepAndPrune = NULL;
+    broadphase = scn->collisionBroadphase;
+    PairCache_Clear(contacts);
+    numEvents = 0;
+    numTileContacts = 0;
+    //the entities of the new scene are put in the static hash on the first update. The tiles under the static
+    //bodies of the last scene belong to its map, so they are forgotten
+    restingBodiesChanged = 1;
+    numOccupiedTiles = 0;
+    numActiveEntities = 0;
+    cellSize = 0;
+    hasRectExtents = 0;
     WriteDebug("Initializing Collision System... DONE");
     //return 1, successfully initialized the system
     return 1;
@@ -135,19 +271,50 @@ void SystemCollision_Update() {
     if (scn->componentPointersReallocated == 1) {
         updateComponentPointers();
     }
-    onScreenEntities = SystemRenderIsoMetricWorld_GetEntitiesOnScreen(1);
+    //if the system failed to initialize
+    if (systemFailedToInitialize == 1) {
+        return;
+    }
+    //the entities collide with each other here, once a frame, in world space
+    handleEntitiesCollisions();
 }
 
 void SystemCollision_UpdateEntity(Uint32 entity) {
+    Uint32 *newActiveEntities = NULL;
+    int resting = 0;
+
     //if the system failed to initialize
     if (systemFailedToInitialize == 1) {
         return;
     }
 
+    //if the entity can not be collided with
+    if ((scn->entities[entity].componentSet1 & SYSTEM_COLLISION_HASH_MASK_SET1) != SYSTEM_COLLISION_HASH_MASK_SET1) {
+        return;
+    }
+    //if the entity went to sleep or woke up, or was made static, the static hash is built again on the next update
+    resting = isRestingBody(entity);
+    if (resting != colComponents[entity].inStaticBroadphase) {
+        restingBodiesChanged = 1;
+    }
+    //static and sleeping entities cost nothing more
+    if (resting) {
+        return;
+    }
+    //remember the awake entity for the entity to entity collisions on the next update
+    if (numActiveEntities >= maxActiveEntities) {
+        newActiveEntities = realloc(activeEntities,sizeof(Uint32)*(maxActiveEntities > 0 ? maxActiveEntities*2 : 64));
+        if (newActiveEntities == NULL) {
+            WriteError("Could not allocate memory for the active collision entities!");
+            return;
+        }
+        activeEntities = newActiveEntities;
+        maxActiveEntities = maxActiveEntities > 0 ? maxActiveEntities*2 : 64;
+    }
+    activeEntities[numActiveEntities++] = entity;
+
     //if the entity has the position, velocity, render2D and collision component
-    if (scn->entities[entity].componentSet1 & SYSTEM_COLLISION_MASK_SET1) {
-        //reset is colliding to 0;
-        colComponents[entity].isColliding = 0;
+    if ((scn->entities[entity].componentSet1 & SYSTEM_COLLISION_MASK_SET1) == SYSTEM_COLLISION_MASK_SET1) {
         //if collision detection is not active for the entity
         if (colComponents[entity].collisionType == COLLISIONTYPE_DEACTIVATED) {
             //exit out of the function
@@ -158,99 +325,732 @@ void SystemCollision_UpdateEntity(Uint32 entity) {
         || colComponents[entity].collisionType == COLLISIONTYPE_WORLD_AND_ENTITY) {
             handleEntityWorldCollision(entity);
         }
-        if (colComponents[entity].collisionType == COLLISIONTYPE_ENTITY
-        || colComponents[entity].collisionType == COLLISIONTYPE_WORLD_AND_ENTITY) {
-            handleEnityToEntityCollision(entity);
-        }
+        //the entity to entity collisions are handled for all the entities at once in SystemCollision_Update()
     }
 }
 
+//sweeps the collision rectangle of the entity from where it was to where it has moved, and finds the first
+//blocking tile it runs into. The rest of the movement is swept again along the side of the tile, so an entity
+//that slides along a wall can not go through another wall on the other axis. Fast entities and long frames
+//can not jump over a tile. The contacts are resolved with the other contacts on the next update
 static void handleEntityWorldCollision(Uint32 entity) {
-    //check the bottom bottom rectangle points for the sprite collision
-    checkPointCollision(entity,0,colComponents[entity].rect.h); //bottom left corner
-    checkPointCollision(entity,colComponents[entity].rect.w,0); //bottom right corner
+    IsoMapSweepHit hit;
+    SDL_FRect rect;
+    float dx = posComponents[entity].x - posComponents[entity].oldx[0];
+    float dy = posComponents[entity].y - posComponents[entity].oldy[0];
+    int i = 0;
+
+    rect.x = posComponents[entity].oldx[0] + colComponents[entity].rect.x;
+    rect.y = posComponents[entity].oldy[0] + colComponents[entity].rect.y;
+    rect.w = colComponents[entity].rect.w;
+    rect.h = colComponents[entity].rect.h;
+
+    //one sweep for every axis the movement can be stopped on
+    for (i = 0; i < 2; ++i) {
+        if (!isoMapSweepRect(isoEngine->isoMap,&rect,dx,dy,ISO_TILE_FLAG_BLOCKING,&hit)) {
+            return;
+        }
+        addTileContact(entity,&hit,&rect,dx,dy);
+        //move to where the tile was hit and keep the movement along the side of the tile
+        rect.x += dx*hit.time;
+        rect.y += dy*hit.time;
+        dx = hit.normalX != 0 ? 0 : dx*(1 - hit.time);
+        dy = hit.normalY != 0 ? 0 : dy*(1 - hit.time);
+    }
 }
+//places the collision rectangle of the entity at its position in the world. It does not depend on the camera,
+//the zoom or what was drawn, so the entities collide the same way on and off the screen
 static void createWorldCollisionRect(Uint32 entity) {
-    SDL_FPoint point;
-    //get the entity world position
-    point.x = (posComponents[entity].x*isoEngine->zoomLevel)+isoEngine->scrollX;
-    point.y = (posComponents[entity].y*isoEngine->zoomLevel)+isoEngine->scrollY;
-    IsoEngine_Convert2DToIso(&point);
-    //apply the offset
-    point.x += posComponents[entity].xOffset*isoEngine->zoomLevel;
-    point.y += posComponents[entity].yOffset*isoEngine->zoomLevel;
-
-    //create the collision rectangle
-    //x,y start position for the rectanble
-    //multiply with 0.5 to get the center of the texture
-    colComponents[entity].worldRect.x = point.x +((renderComponents[entity].texture->cliprect.w*0.5)*isoEngine->zoomLevel)
-                                                -((colComponents[entity].rect.w*0.5)*isoEngine->zoomLevel);
-    //start at the bottom of the rectangle
-    colComponents[entity].worldRect.y = point.y +((renderComponents[entity].texture->cliprect.h)*isoEngine->zoomLevel)
-                                                -((colComponents[entity].rect.h)*isoEngine->zoomLevel);
-    //width and height of the collision rectangle
-    colComponents[entity].worldRect.w = colComponents[entity].rect.w*isoEngine->zoomLevel;
-    colComponents[entity].worldRect.h = colComponents[entity].rect.h*isoEngine->zoomLevel;
-}
-
-static void handleEnityToEntityCollision(Uint32 entity) {
+    colComponents[entity].worldRect.x = posComponents[entity].x + colComponents[entity].rect.x;
+    colComponents[entity].worldRect.y = posComponents[entity].y + colComponents[entity].rect.y;
+    colComponents[entity].worldRect.w = colComponents[entity].rect.w;
+    colComponents[entity].worldRect.h = colComponents[entity].rect.h;
+}
+
+//returns 1 if the entity does not move. Entities without velocity, static bodies and sleeping entities rest
+static int isRestingBody(Uint32 entity) {
+    return !(scn->entities[entity].componentSet1 & COMPONENT_SET1_VELOCITY)
+        || colComponents[entity].bodyType == COLLISIONBODY_STATIC
+        || velComponents[entity].isSleeping;
+}
+
+//returns 1 if the entity moves and collides with other entities
+static int isEntityCollider(Uint32 entity) {
+    return !isRestingBody(entity)
+        && (colComponents[entity].collisionType == COLLISIONTYPE_ENTITY
+        || colComponents[entity].collisionType == COLLISIONTYPE_WORLD_AND_ENTITY);
+}
+
+//grows the cell size of the hashes so that it covers the collision rectangle. Two rectangles can only overlap when
+//the positions of the entities are closer than the distance from the left edge of one rectangle to the right edge
+//of the other, so with the cells as large as the spread of all the edges, no collision is further away than one cell
+static void growCellSize(SDL_Rect *rect) {
+    if (!hasRectExtents || rect->x < minRectLeft) minRectLeft = rect->x;
+    if (!hasRectExtents || rect->x + rect->w > maxRectRight) maxRectRight = rect->x + rect->w;
+    if (!hasRectExtents || rect->y < minRectTop) minRectTop = rect->y;
+    if (!hasRectExtents || rect->y + rect->h > maxRectBottom) maxRectBottom = rect->y + rect->h;
+    hasRectExtents = 1;
+
+    if (maxRectRight - minRectLeft > cellSize) {
+        cellSize = maxRectRight - minRectLeft;
+    }
+    if (maxRectBottom - minRectTop > cellSize) {
+        cellSize = maxRectBottom - minRectTop;
+    }
+}
+
+//puts the static and sleeping entities in the static hash. It is only done when one of them has changed,
+//so the entities that do not move are not touched on the other frames
+static void buildStaticHash() {
+    Uint32 entity = 0;
+
+    SpatialHash_Clear(staticHash);
+    for (entity = 0; entity < scn->numEntities; ++entity) {
+        //if the entity does not have the position, collision and render2D component
+        if ((scn->entities[entity].componentSet1 & SYSTEM_COLLISION_HASH_MASK_SET1) != SYSTEM_COLLISION_HASH_MASK_SET1) {
+            continue;
+        }
+        colComponents[entity].inStaticBroadphase = isRestingBody(entity);
+        if (!colComponents[entity].inStaticBroadphase) {
+            continue;
+        }
+        //the collision rectangle of a resting entity does not change until it wakes up
+        createWorldCollisionRect(entity);
+        growCellSize(&colComponents[entity].rect);
+        if (SpatialHash_Add(staticHash,entity,posComponents[entity].x,posComponents[entity].y) == 0) {
+            return;
+        }
+    }
+    if (SpatialHash_Build(staticHash,cellSize) == 0) {
+        return;
+    }
+    restingBodiesChanged = 0;
+    WriteDebug("Collision system: %u static and sleeping entities in the static hash",staticHash->numEntities);
+}
+
+//marks the tiles under the collision rectangles of the static bodies with ISO_TILE_FLAG_OCCUPIED, so the
+//pathfinder leads the entities around them. The map is only changed when the tiles are not the same as last time,
+//since every change makes the pathfinder build the chunk again
+static void markStaticBodyTiles() {
+    IsoMap *isoMap = isoEngine->isoMap;
+    Uint32 *grownTiles = NULL;
+    Uint32 *swapTiles = NULL;
+    Uint32 numNewTiles = 0;
+    Uint32 entity = 0, i = 0;
+    int x = 0, y = 0, x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+
+    //collect the tiles, in the order of the entities, so the same bodies always give the same list
+    for (entity = 0; entity < scn->numEntities; ++entity) {
+        if ((scn->entities[entity].componentSet1 & SYSTEM_COLLISION_HASH_MASK_SET1) != SYSTEM_COLLISION_HASH_MASK_SET1
+        || colComponents[entity].bodyType != COLLISIONBODY_STATIC) {
+            continue;
+        }
+        createWorldCollisionRect(entity);
+        //the tiles the rectangle covers, a rectangle that ends on the edge of a tile does not cover it
+        x0 = SDL_max((int)floorf(colComponents[entity].worldRect.x/isoMap->tileSize),0);
+        y0 = SDL_max((int)floorf(colComponents[entity].worldRect.y/isoMap->tileSize),0);
+        x1 = SDL_min((int)ceilf((colComponents[entity].worldRect.x + colComponents[entity].worldRect.w)/isoMap->tileSize)-1,isoMap->mapWidth-1);
+        y1 = SDL_min((int)ceilf((colComponents[entity].worldRect.y + colComponents[entity].worldRect.h)/isoMap->tileSize)-1,isoMap->mapHeight-1);
+        for (y = y0; y <= y1; ++y) {
+            for (x = x0; x <= x1; ++x) {
+                if (numNewTiles >= maxNewOccupiedTiles) {
+                    grownTiles = realloc(newOccupiedTiles,sizeof(Uint32)*(maxNewOccupiedTiles > 0 ? maxNewOccupiedTiles*2 : 64));
+                    if (grownTiles == NULL) {
+                        WriteError("Could not allocate memory for the tiles under the static bodies!");
+                        return;
+                    }
+                    newOccupiedTiles = grownTiles;
+                    maxNewOccupiedTiles = maxNewOccupiedTiles > 0 ? maxNewOccupiedTiles*2 : 64;
+                }
+                newOccupiedTiles[numNewTiles++] = (Uint32)(y*isoMap->mapWidth + x);
+            }
+        }
+    }
+    //if no static body has changed, only sleeping bodies have
+    if (numNewTiles == numOccupiedTiles && (numNewTiles == 0 || memcmp(newOccupiedTiles,occupiedTiles,sizeof(Uint32)*numNewTiles) == 0)) {
+        return;
+    }
+
+    for (i = 0; i < numOccupiedTiles; ++i) {
+        x = occupiedTiles[i] % isoMap->mapWidth;
+        y = occupiedTiles[i] / isoMap->mapWidth;
+        isoMapSetTileFlags(isoMap,x,y,isoMapGetTileFlags(isoMap,x,y) & ~ISO_TILE_FLAG_OCCUPIED);
+    }
+    for (i = 0; i < numNewTiles; ++i) {
+        x = newOccupiedTiles[i] % isoMap->mapWidth;
+        y = newOccupiedTiles[i] / isoMap->mapWidth;
+        isoMapSetTileFlags(isoMap,x,y,isoMapGetTileFlags(isoMap,x,y) | ISO_TILE_FLAG_OCCUPIED);
+    }
+    //the new list is kept, and the old one is used to collect the tiles next time
+    swapTiles = occupiedTiles;
+    occupiedTiles = newOccupiedTiles;
+    newOccupiedTiles = swapTiles;
+    i = maxOccupiedTiles;
+    maxOccupiedTiles = maxNewOccupiedTiles;
+    maxNewOccupiedTiles = i;
+    numOccupiedTiles = numNewTiles;
+    WriteDebug("Collision system: %u tiles are occupied by static bodies",numOccupiedTiles);
+}
+
+//finds the entities that touch with the broadphase of the scene, creates the collision events of them and the
+//tile contacts, and resolves the contacts. The pairs are found on all the threads without changing anything, and
+//handled on this thread in the order of the tasks, so the events are the same with any number of threads
+static void handleEntitiesCollisions() {
+    collisionFrame++;
+    numEvents = 0;
+    numPairLists = 0;
+
+    handleTileContacts();
+    //if the thread pool has grown since the system was initialized
+    if (numThreadContexts < ThreadPool_GetNumThreads() && createThreadContexts() == 0) {
+        return;
+    }
+
+    //if the scene has changed the broadphase, the resting entities are put in the new one
+    if (scn->collisionBroadphase != broadphase) {
+        broadphase = scn->collisionBroadphase;
+        restingBodiesChanged = 1;
+    }
+    //the static bodies are marked in the map before the broadphase takes the change
+    if (restingBodiesChanged) {
+        markStaticBodyTiles();
+    }
+    if (broadphase == COLLISION_BROADPHASE_SWEEP_AND_PRUNE) {
+        handleSweepAndPruneCollisions();
+    }
+    else {
+        handleSpatialHashCollisions();
+    }
+    handleFoundPairs();
+    //the awake entities and their tile contacts are collected again while the entities are updated
+    numActiveEntities = 0;
+    numTileContacts = 0;
+    resolveContacts();
+    endContacts();
+}
+
+//puts the awake entities in the dynamic hash and tests the entities that collide with other entities against the
+//entities in the cells around them, in both hashes. Only the awake entities cost time every frame
+static void handleSpatialHashCollisions() {
+    Uint32 entity = 0;
+    Uint32 i = 0;
+
+    if (cellSize < isoEngine->isoMap->tileSize) {
+        cellSize = isoEngine->isoMap->tileSize;
+    }
+    if (restingBodiesChanged) {
+        buildStaticHash();
+    }
+
+    SpatialHash_Clear(dynamicHash);
+    for (i = 0; i < numActiveEntities; ++i) {
+        entity = activeEntities[i];
+        //if the entity has lost its components since it was updated
+        if ((scn->entities[entity].componentSet1 & SYSTEM_COLLISION_HASH_MASK_SET1) != SYSTEM_COLLISION_HASH_MASK_SET1) {
+            continue;
+        }
+        //the collision rectangle of every awake entity is only created once a frame
+        createWorldCollisionRect(entity);
+        growCellSize(&colComponents[entity].rect);
+        if (SpatialHash_Add(dynamicHash,entity,posComponents[entity].x,posComponents[entity].y) == 0) {
+            return;
+        }
+    }
+    //if a moving entity reaches further than the cells of the static hash
+    if (cellSize > staticHash->cellSize && SpatialHash_Build(staticHash,cellSize) == 0) {
+        return;
+    }
+    if (SpatialHash_Build(dynamicHash,cellSize) == 0) {
+        return;
+    }
+
+    //every task gets its own list of pairs, so the pairs can be put together in the same order on any thread
+    if (createPairLists((dynamicHash->numEntities + SYSTEM_COLLISION_ENTITIES_PER_TASK-1)/SYSTEM_COLLISION_ENTITIES_PER_TASK) == 0) {
+        return;
+    }
+    ThreadPool_ParallelFor(numPairLists,detectCollisionsTask,NULL);
+}
+
+//tests a range of the awake entities against the entities in the cells around them, in both hashes. The entities
+//are taken in the order of the buckets of the dynamic hash, so the entities of a task are close to each other
+static void detectCollisionsTask(int taskIndex,int threadIndex,void *data) {
+    CollisionThreadContext *context = &threadContexts[threadIndex];
+    Uint32 first = taskIndex*SYSTEM_COLLISION_ENTITIES_PER_TASK;
+    Uint32 last = SDL_min(first + SYSTEM_COLLISION_ENTITIES_PER_TASK,dynamicHash->numEntities);
+    Uint32 i = 0;
+
+    (void)data;
+    context->pairList = &pairLists[taskIndex];
+    context->pairList->numPairs = 0;
+    for (i = first; i < last; ++i) {
+        context->collider = dynamicHash->entities[dynamicHash->sorted[i]];
+        if (isEntityCollider(context->collider)) {
+            AABBBatch_Clear(context->candidates);
+            SpatialHash_QueryNeighbours(dynamicHash,posComponents[context->collider].x,posComponents[context->collider].y,addCollisionCandidate,context);
+            SpatialHash_QueryNeighbours(staticHash,posComponents[context->collider].x,posComponents[context->collider].y,addStaticCollisionCandidate,context);
+            testCollisionCandidates(context);
+        }
+    }
+}
+
+//moves the boxes of the awake entities in the sweep and prune broadphase and tests the pairs that overlap.
+//The resting entities keep their boxes, so their edges are only crossed by the entities that move
+static void handleSweepAndPruneCollisions() {
+    Uint32 entity = 0;
+    Uint32 i = 0;
+
+    if (sweepAndPrune == NULL) {
+        sweepAndPrune = SweepAndPrune_New();
+        if (sweepAndPrune == NULL) {
+            return;
+        }
+        restingBodiesChanged = 1;
+    }
+    if (restingBodiesChanged) {
+        updateSweepAndPruneRestingBodies();
+    }
+    for (i = 0; i < numActiveEntities; ++i) {
+        entity = activeEntities[i];
+        //if the entity has lost its components since it was updated
+        if ((scn->entities[entity].componentSet1 & SYSTEM_COLLISION_HASH_MASK_SET1) != SYSTEM_COLLISION_HASH_MASK_SET1) {
+            continue;
+        }
+        createWorldCollisionRect(entity);
+        if (SweepAndPrune_SetBox(sweepAndPrune,entity,&colComponents[entity].worldRect) == 0) {
+            return;
+        }
+    }
+    if (createPairLists(1) == 0) {
+        return;
+    }
+    pairLists[0].numPairs = 0;
+    SweepAndPrune_ForEachOverlap(sweepAndPrune,testSweepAndPrunePair);
+}
+
+//puts the boxes of the entities that went to sleep or were made static where the entities are, and removes
+//the entities that can not be collided with anymore
+static void updateSweepAndPruneRestingBodies() {
+    Uint32 entity = 0;
+
+    for (entity = 0; entity < sweepAndPrune->maxEntities || entity < scn->numEntities; ++entity) {
+        //if the entity does not have the position, collision and render2D component
+        if (entity >= scn->numEntities
+        || (scn->entities[entity].componentSet1 & SYSTEM_COLLISION_HASH_MASK_SET1) != SYSTEM_COLLISION_HASH_MASK_SET1) {
+            SweepAndPrune_Remove(sweepAndPrune,entity);
+            continue;
+        }
+        colComponents[entity].inStaticBroadphase = isRestingBody(entity);
+        if (colComponents[entity].inStaticBroadphase) {
+            createWorldCollisionRect(entity);
+            if (SweepAndPrune_SetBox(sweepAndPrune,entity,&colComponents[entity].worldRect) == 0) {
+                return;
+            }
+        }
+    }
+    restingBodiesChanged = 0;
+    WriteDebug("Collision system: %u entities in the sweep and prune broadphase",sweepAndPrune->numProxies);
+}
+
+//adds a moving entity from the cells around the collider of the thread to its candidates
+static void addCollisionCandidate(Uint32 other,void *data) {
+    CollisionThreadContext *context = (CollisionThreadContext*)data;
+
+    //if the entity is the collider it self
+    if (other == context->collider) {
+        return;
+    }
+    //a pair of two colliders is tested once, by the collider with the lower ID
+    if (other < context->collider && isEntityCollider(other)) {
+        return;
+    }
+    //entities on different layers do not collide
+    if (renderComponents[other].layer != renderComponents[context->collider].layer) {
+        return;
+    }
+    AABBBatch_Add(context->candidates,other,&colComponents[other].worldRect);
+}
+
+//adds a static or sleeping entity from the cells around the collider of the thread to its candidates
+static void addStaticCollisionCandidate(Uint32 other,void *data) {
+    CollisionThreadContext *context = (CollisionThreadContext*)data;
+
+    //if the entity has woken up or lost its components since the static hash was built
+    if (!colComponents[other].inStaticBroadphase
+    || (scn->entities[other].componentSet1 & SYSTEM_COLLISION_HASH_MASK_SET1) != SYSTEM_COLLISION_HASH_MASK_SET1) {
+        return;
+    }
+    //entities on different layers do not collide
+    if (renderComponents[other].layer != renderComponents[context->collider].layer) {
+        return;
+    }
+    AABBBatch_Add(context->candidates,other,&colComponents[other].worldRect);
+}
+
+//tests the collider of the thread against all its candidates at once, and keeps the pairs that touch
+static void testCollisionCandidates(CollisionThreadContext *context) {
     Uint32 i = 0;
 
-    createWorldCollisionRect(entity);
-    for (i = 0; i < onScreenEntities->numEntitiesLastRender; ++i) {
-        //if the entity is not it self
-        if (onScreenEntities->entityList[i].entityID!=entity) {
-            createWorldCollisionRect(onScreenEntities->entityList[i].entityID);
-
-            //if there is a collision
-            if (SystemCollision_BoundingBoxCollision(colComponents[entity].worldRect,colComponents[onScreenEntities->entityList[i].entityID].worldRect))
-            {
-                posComponents[entity].x = posComponents[entity].oldx[0];
-                posComponents[entity].y = posComponents[entity].oldy[0];
-                colComponents[entity].isColliding = 1;
+    if (AABBBatch_Overlap(context->candidates,&colComponents[context->collider].worldRect) == 0) {
+        return;
+    }
+    for (i = 0; i < context->candidates->numBoxes; ++i) {
+        if (context->candidates->hitMask[i/32] & (1u << (i%32))) {
+            addPair(context->pairList,context->collider,context->candidates->ids[i]);
+        }
+    }
+}
+
+//tests a pair of entities whose boxes overlap in the sweep and prune broadphase
+static void testSweepAndPrunePair(Uint32 entityA,Uint32 entityB) {
+    //if neither of the entities moves and collides with other entities
+    if (!isEntityCollider(entityA) && !isEntityCollider(entityB)) {
+        return;
+    }
+    //entities on different layers do not collide
+    if (renderComponents[entityA].layer != renderComponents[entityB].layer) {
+        return;
+    }
+    //the sweep and prune broadphase runs on this thread, as one task
+    addPair(&pairLists[0],entityA,entityB);
+}
+
+static void addPair(CollisionPairList *pairList,Uint32 entityA,Uint32 entityB) {
+    CollisionPair *newPairs = NULL;
+
+    if (pairList->numPairs >= pairList->maxPairs) {
+        newPairs = realloc(pairList->pairs,sizeof(struct CollisionPair)*(pairList->maxPairs > 0 ? pairList->maxPairs*2 : 64));
+        if (newPairs == NULL) {
+            WriteError("Could not allocate memory for the collision pairs!");
+            return;
+        }
+        pairList->pairs = newPairs;
+        pairList->maxPairs = pairList->maxPairs > 0 ? pairList->maxPairs*2 : 64;
+    }
+    pairList->pairs[pairList->numPairs].entityA = entityA;
+    pairList->pairs[pairList->numPairs].entityB = entityB;
+    pairList->numPairs++;
+}
+
+//creates a work space for every thread of the thread pool. Returns 0 if memory allocation failed
+static int createThreadContexts() {
+    int numThreads = ThreadPool_GetNumThreads();
+    int i = 0;
+
+    if (numThreadContexts >= numThreads) {
+        return 1;
+    }
+    freeThreadContexts();
+    threadContexts = calloc(numThreads,sizeof(struct CollisionThreadContext));
+    if (threadContexts == NULL) {
+        WriteError("Could not allocate memory for %d collision threads!",numThreads);
+        return 0;
+    }
+    numThreadContexts = numThreads;
+    for (i = 0; i < numThreads; ++i) {
+        threadContexts[i].candidates = AABBBatch_New();
+        if (threadContexts[i].candidates == NULL) {
+            freeThreadContexts();
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void freeThreadContexts() {
+    int i = 0;
+
+    for (i = 0; i < numThreadContexts; ++i) {
+        AABBBatch_Free(threadContexts[i].candidates);
+    }
+    free(threadContexts);
+    threadContexts = NULL;
+    numThreadContexts = 0;
+}
+
+//makes room for the pairs of the tasks, the lists keep their memory from frame to frame. Returns 0 if memory
+//allocation failed
+static int createPairLists(int numLists) {
+    CollisionPairList *newLists = NULL;
+    int newMax = maxPairLists > 0 ? maxPairLists : 1;
+
+    if (numLists > maxPairLists) {
+        while (newMax < numLists) {
+            newMax *= 2;
+        }
+        newLists = realloc(pairLists,sizeof(struct CollisionPairList)*newMax);
+        if (newLists == NULL) {
+            WriteError("Could not allocate memory for %d collision pair lists!",newMax);
+            return 0;
+        }
+        memset(&newLists[maxPairLists],0,sizeof(struct CollisionPairList)*(newMax-maxPairLists));
+        pairLists = newLists;
+        maxPairLists = newMax;
+    }
+    numPairLists = numLists;
+    return 1;
+}
+
+//creates the events of the pairs the tasks have found, task by task. Which thread ran a task changes from
+//frame to frame, the order of the pairs in the tasks does not
+static void handleFoundPairs() {
+    Uint32 i = 0;
+    int task = 0;
+
+    for (task = 0; task < numPairLists; ++task) {
+        for (i = 0; i < pairLists[task].numPairs; ++i) {
+            handleContact(pairLists[task].pairs[i].entityA,pairLists[task].pairs[i].entityB);
+        }
+    }
+    //the entities are woken up after all the events have been created, so every event sees the entities
+    //the way they were when the pairs were found
+    wakeTouchedEntities();
+}
+
+//creates the begin or stay event of the pair, with the axis the entities overlap the least on as the normal
+static void handleContact(Uint32 entityA,Uint32 entityB) {
+    PairCacheEntry *entry = NULL;
+    CollisionEvent *event = NULL;
+    SDL_FRect *a = NULL, *b = NULL;
+    float overlapX = 0, overlapY = 0;
+    Uint8 flags = 0;
+    int isNew = 0;
+
+    entry = PairCache_Add(contacts,entityA,entityB,&isNew);
+    //if the pair could not be added, or it has already been handled this frame
+    if (entry == NULL || entry->frame == collisionFrame) {
+        return;
+    }
+    entry->frame = collisionFrame;
+    event = addEvent(isNew ? COLLISIONEVENT_BEGIN : COLLISIONEVENT_STAY,entry->entityA,entry->entityB);
+    if (event == NULL) {
+        return;
+    }
+
+    //only the entities that move and collide with other entities are moved apart
+    flags |= isEntityCollider(event->entityA) ? COLLISIONEVENT_MOVE_A : 0;
+    flags |= isEntityCollider(event->entityB) ? COLLISIONEVENT_MOVE_B : 0;
+    event->flags = flags;
+    a = &colComponents[event->entityA].worldRect;
+    b = &colComponents[event->entityB].worldRect;
+    overlapX = SDL_min(a->x + a->w,b->x + b->w) - SDL_max(a->x,b->x);
+    overlapY = SDL_min(a->y + a->h,b->y + b->h) - SDL_max(a->y,b->y);
+    if (overlapX < overlapY) {
+        event->normal.x = a->x + a->w/2 < b->x + b->w/2 ? -1 : 1;
+        event->penetration = overlapX;
+    }
+    else {
+        event->normal.y = a->y + a->h/2 < b->y + b->h/2 ? -1 : 1;
+        event->penetration = overlapY;
+    }
+}
+
+//a sleeping entity wakes up when another entity touches it
+static void wakeTouchedEntities() {
+    Uint32 entity = 0;
+    Uint32 i = 0;
+    int j = 0;
+
+    for (i = 0; i < numEvents; ++i) {
+        if (events[i].type == COLLISIONEVENT_END || events[i].entityB == COLLISION_NO_ENTITY) {
+            continue;
+        }
+        for (j = 0; j < 2; ++j) {
+            entity = j == 0 ? events[i].entityA : events[i].entityB;
+            if ((scn->entities[entity].componentSet1 & COMPONENT_SET1_VELOCITY) && velComponents[entity].isSleeping) {
+                ComponentVelocity_Wake(velComponents,entity);
             }
         }
     }
 }
 
-static void checkPointCollision(Uint32 entity,int x,int y) {
-    SDL_FPoint point;
-    int tile = 0;
+//creates the begin or stay events of the tiles the entities moved into since the last update. A tile is kept
+//in the contacts as the second half of a pair, so it also gets an end event
+static void handleTileContacts() {
+    PairCacheEntry *entry = NULL;
+    CollisionEvent *event = NULL;
+    Uint32 tileKey = 0;
+    Uint32 i = 0;
+    int isNew = 0;
 
-    //check the width of the rectangle upwards
-    point.x = (posComponents[entity].x + x)/isoEngine->isoMap->tileSize;
-    point.y = (posComponents[entity].y + y)/isoEngine->isoMap->tileSize;
+    for (i = 0; i < numTileContacts; ++i) {
+        tileKey = SYSTEM_COLLISION_TILE_KEY | (Uint32)(tileContacts[i].tileY*isoEngine->isoMap->mapWidth + tileContacts[i].tileX);
+        entry = PairCache_Add(contacts,tileContacts[i].entityA,tileKey,&isNew);
+        //if the pair could not be added, or another point of the entity is in the same tile
+        if (entry == NULL || entry->frame == collisionFrame) {
+            continue;
+        }
+        entry->frame = collisionFrame;
+        event = addEvent(isNew ? COLLISIONEVENT_BEGIN : COLLISIONEVENT_STAY,tileContacts[i].entityA,COLLISION_NO_ENTITY);
+        if (event == NULL) {
+            return;
+        }
+        *event = tileContacts[i];
+        event->type = isNew ? COLLISIONEVENT_BEGIN : COLLISIONEVENT_STAY;
+    }
+}
 
-    //get the tile under the entity
-    tile = isoMapGetTile(isoEngine->isoMap,point.x,point.y,renderComponents[entity].layer);
+//lets the resolve function move the entities of every contact of the frame apart
+static void resolveContacts() {
+    Uint32 i = 0;
 
-    //if the tile is valid
-    if (tile!=-1) {
-        //TODO: Add list of tiles that can be collided with
-        if (tile == 2) {
-            posComponents[entity].x = posComponents[entity].oldx[0];
-            posComponents[entity].y = posComponents[entity].oldy[0];
-            //mark that the entity is colliding
-            colComponents[entity].isColliding = 1;
+    if (resolveFunction == NULL) {
+        return;
+    }
+    for (i = 0; i < numEvents; ++i) {
+        resolveFunction(scn,&events[i]);
+    }
+}
+
+//creates the end events of the pairs that did not touch this frame and forgets them.
+//A removed pair can move another pair back into the slot, so the slot is looked at again
+static void endContacts() {
+    PairCacheEntry *entry = NULL;
+    CollisionEvent *event = NULL;
+    Uint32 i = 0;
+
+    while (i < contacts->maxEntries) {
+        entry = &contacts->entries[i];
+        if (entry->used && entry->frame != collisionFrame) {
+            event = addEvent(COLLISIONEVENT_END,entry->entityA,entry->entityB);
+            //if the pair was an entity and a tile, the tile is found from its index
+            if (event != NULL && (entry->entityB & SYSTEM_COLLISION_TILE_KEY)) {
+                event->entityB = COLLISION_NO_ENTITY;
+                event->tileX = (entry->entityB & ~SYSTEM_COLLISION_TILE_KEY) % isoEngine->isoMap->mapWidth;
+                event->tileY = (entry->entityB & ~SYSTEM_COLLISION_TILE_KEY) / isoEngine->isoMap->mapWidth;
+            }
+            PairCache_Remove(contacts,entry->entityA,entry->entityB);
         }
+        else {
+            i++;
+        }
+    }
+}
+
+//returns a cleared event at the end of the list, the list grows when it is full. Returns NULL if memory
+//allocation failed
+static CollisionEvent *appendEvent(CollisionEvent **list,Uint32 *num,Uint32 *max) {
+    CollisionEvent *newList = NULL;
+
+    if (*num >= *max) {
+        newList = realloc(*list,sizeof(struct CollisionEvent)*(*max > 0 ? *max*2 : 64));
+        if (newList == NULL) {
+            WriteError("Could not allocate memory for the collision events!");
+            return NULL;
+        }
+        *list = newList;
+        *max = *max > 0 ? *max*2 : 64;
+    }
+    memset(&(*list)[*num],0,sizeof(struct CollisionEvent));
+    return &(*list)[(*num)++];
+}
+
+static CollisionEvent *addEvent(CollisionEventType type,Uint32 entityA,Uint32 entityB) {
+    CollisionEvent *event = appendEvent(&events,&numEvents,&maxEvents);
+
+    if (event == NULL) {
+        return NULL;
+    }
+    event->type = type;
+    event->entityA = entityA;
+    event->entityB = entityB;
+    return event;
+}
+
+//returns the collision events of the last update, they are kept until the next update.
+//Every pair of touching entities, and every entity and tile it has moved into, gets a begin event the first frame,
+//then stay events, and an end event the first frame they do not touch. Pairs where neither entity is awake are
+//not tested, so they end. The begin and stay events have already been resolved when the other systems read them
+CollisionEvent *SystemCollision_GetEvents(Uint32 *numCollisionEvents) {
+    if (numCollisionEvents != NULL) {
+        *numCollisionEvents = numEvents;
     }
+    return events;
+}
+
+//sets the function that moves the entities of the contacts apart. NULL only finds the contacts, and leaves
+//the entities where they are
+void SystemCollision_SetResolveFunction(collisionResolveFuncPointer resolve) {
+    resolveFunction = resolve;
+}
+
+//moves the entities of the contact back to where they were before they moved into each other or the tile
+void SystemCollision_ResolveSnapBack(Scene *scene,CollisionEvent *contact) {
+    ComponentPosition *positions = NULL;
 
-    //check the width of the rectangle downwards
-    point.x = (posComponents[entity].x - x)/isoEngine->isoMap->tileSize;
-    point.y = (posComponents[entity].y - y)/isoEngine->isoMap->tileSize;
+    if (scene == NULL || contact == NULL || contact->type == COLLISIONEVENT_END) {
+        return;
+    }
+    positions = (ComponentPosition*)Scene_GetComponent(scene,COMPONENT_SET1_POSITION);
+    if (contact->flags & COLLISIONEVENT_MOVE_A) {
+        positions[contact->entityA].x = positions[contact->entityA].oldx[0];
+        positions[contact->entityA].y = positions[contact->entityA].oldy[0];
+    }
+    if (contact->flags & COLLISIONEVENT_MOVE_B) {
+        positions[contact->entityB].x = positions[contact->entityB].oldx[0];
+        positions[contact->entityB].y = positions[contact->entityB].oldy[0];
+    }
+}
 
-    //get the tile under the entity
-    tile = isoMapGetTile(isoEngine->isoMap,point.x,point.y,renderComponents[entity].layer);
+//moves the entities of the contact out of each other along the normal, so they can slide along each other.
+//If both entities move, they are moved half of the way each
+void SystemCollision_ResolvePushOut(Scene *scene,CollisionEvent *contact) {
+    ComponentPosition *positions = NULL;
+    float distance = 0;
 
-    //if the tile is valid
-    if (tile!=-1) {
-        //TODO: Add list of tiles that can be collided with
-        if (tile == 2) {
-            posComponents[entity].x = posComponents[entity].oldx[0];
-            posComponents[entity].y = posComponents[entity].oldy[0];
-            //mark that the entity is colliding
-            colComponents[entity].isColliding = 1;
+    if (scene == NULL || contact == NULL || contact->type == COLLISIONEVENT_END) {
+        return;
+    }
+    positions = (ComponentPosition*)Scene_GetComponent(scene,COMPONENT_SET1_POSITION);
+    if (contact->entityB == COLLISION_NO_ENTITY) {
+        if (contact->flags & COLLISIONEVENT_MOVE_A) {
+            distance = contact->penetration + SYSTEM_COLLISION_TILE_SKIN;
+            positions[contact->entityA].x += contact->normal.x*distance;
+            positions[contact->entityA].y += contact->normal.y*distance;
         }
+        return;
+    }
+    distance = contact->penetration;
+    if ((contact->flags & COLLISIONEVENT_MOVE_A) && (contact->flags & COLLISIONEVENT_MOVE_B)) {
+        distance /= 2;
+    }
+    if (contact->flags & COLLISIONEVENT_MOVE_A) {
+        positions[contact->entityA].x += contact->normal.x*distance;
+        positions[contact->entityA].y += contact->normal.y*distance;
+    }
+    if (contact->flags & COLLISIONEVENT_MOVE_B) {
+        positions[contact->entityB].x -= contact->normal.x*distance;
+        positions[contact->entityB].y -= contact->normal.y*distance;
+    }
+}
+
+//adds a contact with the tile that was hit by the rectangle moving by dx,dy. The penetration is how far the
+//rectangle would have moved past the side of the tile
+static void addTileContact(Uint32 entity,IsoMapSweepHit *hit,SDL_FRect *rect,float dx,float dy) {
+    CollisionEvent *contact = NULL;
+    int tileSize = isoEngine->isoMap->tileSize;
+
+    contact = appendEvent(&tileContacts,&numTileContacts,&maxTileContacts);
+    if (contact == NULL) {
+        return;
+    }
+    contact->entityA = entity;
+    contact->entityB = COLLISION_NO_ENTITY;
+    contact->tileX = hit->tileX;
+    contact->tileY = hit->tileY;
+    contact->flags = COLLISIONEVENT_MOVE_A;
+    contact->normal.x = hit->normalX;
+    contact->normal.y = hit->normalY;
+    if (hit->normalX < 0) {
+        contact->penetration = rect->x + rect->w + dx - hit->tileX*tileSize;
+    }
+    else if (hit->normalX > 0) {
+        contact->penetration = (hit->tileX+1)*tileSize - (rect->x + dx);
+    }
+    else if (hit->normalY < 0) {
+        contact->penetration = rect->y + rect->h + dy - hit->tileY*tileSize;
+    }
+    else {
+        contact->penetration = (hit->tileY+1)*tileSize - (rect->y + dy);
     }
 }
 
@@ -263,6 +1063,53 @@ int SystemCollision_BoundingBoxCollision(SDL_Rect a,SDL_Rect b) {
     return 1;
 }
 
+//returns 1 if the rectangles overlap. Rectangles that only touch do not collide
+int SystemCollision_BoundingBoxCollisionF(SDL_FRect a,SDL_FRect b) {
+    if (b.x + b.w <= a.x) return 0;
+    if (b.x >= a.x + a.w) return 0;
+    if (b.y + b.h <= a.y) return 0;
+    if (b.y >= a.y + a.h) return 0;
+    return 1;
+}
+
 void SystemCollision_Free() {
-    //nothing to free, the system is not allocating any memory
+    int i = 0;
+
+    SpatialHash_Free(dynamicHash);
+    dynamicHash = NULL;
+    SpatialHash_Free(staticHash);
+    staticHash = NULL;
+    SweepAndPrune_Free(sweepAndPrune);
+    sweepAndPrune = NULL;
+    PairCache_Free(contacts);
+    contacts = NULL;
+    freeThreadContexts();
+    for (i = 0; i < maxPairLists; ++i) {
+        free(pairLists[i].pairs);
+    }
+    free(pairLists);
+    pairLists = NULL;
+    numPairLists = 0;
+    maxPairLists = 0;
+    free(events);
+    events = NULL;
+    numEvents = 0;
+    maxEvents = 0;
+    free(tileContacts);
+    tileContacts = NULL;
+    numTileContacts = 0;
+    maxTileContacts = 0;
+    free(activeEntities);
+    activeEntities = NULL;
+    numActiveEntities = 0;
+    maxActiveEntities = 0;
+    free(occupiedTiles);
+    occupiedTiles = NULL;
+    numOccupiedTiles = 0;
+    maxOccupiedTiles = 0;
+    free(newOccupiedTiles);
+    newOccupiedTiles = NULL;
+    maxNewOccupiedTiles = 0;
+    cellSize = 0;
+    hasRectExtents = 0;
 }
@@ -1,10 +1,46 @@
 #ifndef __COLLISION_SYSTEM_H_
 #define __COLLISION_SYSTEM_H_
 
+#include <SDL2/SDL.h>
+
+//forward declaration of Scene, allows us to use the Scene without causing a cross-referencing header error
+typedef struct Scene Scene;
+
+//entity B of a contact with a tile
+#define COLLISION_NO_ENTITY         0xffffffff
+//flags of a contact, which of the entities the resolution may move
+#define COLLISIONEVENT_MOVE_A       0x01
+#define COLLISIONEVENT_MOVE_B       0x02
+
+typedef enum CollisionEventType {
+    COLLISIONEVENT_BEGIN    = 0,    //the entities started to touch this frame
+    COLLISIONEVENT_STAY     = 1,    //the entities touched last frame and still do
+    COLLISIONEVENT_END      = 2,    //the entities touched last frame, but not anymore
+} CollisionEventType;
+
+typedef struct CollisionEvent {
+    CollisionEventType type;
+    Uint32 entityA;                 //the entity with the lower ID, or the entity that touched a tile
+    Uint32 entityB;                 //the other entity, or COLLISION_NO_ENTITY for a tile
+    int tileX;                      //the tile entity A touched, when entity B is COLLISION_NO_ENTITY
+    int tileY;
+    SDL_FPoint normal;              //the direction entity A has to move to get out of entity B or the tile
+    float penetration;              //how far entity A is inside along the normal, 0 for end events
+    Uint8 flags;                    //COLLISIONEVENT_MOVE_A and COLLISIONEVENT_MOVE_B
+} CollisionEvent;
+
+//resolves a begin or stay contact, called for every contact after all the contacts of the frame have been found
+typedef void (*collisionResolveFuncPointer)(Scene *scene,CollisionEvent *contact);
+
 int SystemCollision_Init(void *scene);
 void SystemCollision_Update();
 void SystemCollision_UpdateEntity(Uint32 entity);
 void SystemCollision_Free();
 int SystemCollision_BoundingBoxCollision(SDL_Rect a, SDL_Rect b);
+int SystemCollision_BoundingBoxCollisionF(SDL_FRect a, SDL_FRect b);
+[[nodiscard]] CollisionEvent *SystemCollision_GetEvents(Uint32 *numCollisionEvents);
+void SystemCollision_SetResolveFunction(collisionResolveFuncPointer resolve);
+void SystemCollision_ResolveSnapBack(Scene *scene,CollisionEvent *contact);
+void SystemCollision_ResolvePushOut(Scene *scene,CollisionEvent *contact);
 
 #endif // __COLLISION_SYSTEM_H_
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <string.h>
+#include <math.h>
 #include "System.h"
 #include "SystemControlIsoWorld.h"
 #include "../../logger.h"
@@ -10,11 +11,27 @@
 //define a mask for the control isometric system. It requires the keyboard component
 //it works on SET1 components, so we mark that as well in the define
 #define SYSTEM_CONTROL_ENTITY_MASK_SET1 (COMPONENT_SET1_KEYBOARD | COMPONENT_SET1_NAMETAG | COMPONENT_SET1_VELOCITY)
+//the speed the entity walks along a path with
+#define SYSTEM_CONTROL_ENTITY_PATH_SPEED 100.0f
+//how close the entity has to get to the middle of a tile of the path before it walks to the next one
+#define SYSTEM_CONTROL_ENTITY_PATH_REACHED 4.0f
+//frames the entity can walk along a path without getting closer to the next tile of it, before it is stuck
+#define SYSTEM_CONTROL_ENTITY_PATH_STUCK_FRAMES 30
+//how much closer to the next tile the entity has to get for it to count as walking on
+#define SYSTEM_CONTROL_ENTITY_PATH_PROGRESS 1.0f
+//how many times a stuck entity looks for a new path to the same tile, before it stops walking
+#define SYSTEM_CONTROL_ENTITY_PATH_MAX_REPATHS 1
 
 //function prototypes
 static void mapKeyboardControl(Scene *scene,int *key,char *action);
 static void mapMouseControl(Scene *scene,int *mouseAction,char *action);
 static void setKeysAndMouseControls(Scene *scene);
+static void requestPathToMouseTile();
+static void requestPath(int goalX,int goalY);
+static void walkFlowFieldToMouseTile();
+static void faceWalkDirection(float dx,float dy,int controlledEntityIsPlayer1,int isColliding);
+static int followPath(int controlledEntityIsPlayer1,int isColliding);
+static void stopFollowingPath();
 
 //local global variable for system failure
 static int systemFailedToInitialize = 1;
@@ -28,6 +45,7 @@ static ComponentVelocity *velocityComponents = NULL;
 static ComponentRender2D *renderComponents = NULL;
 static ComponentAnimation *animComponents = NULL;
 static ComponentCollision *colComponents = NULL;
+static ComponentPosition *posComponents = NULL;
 
 //list of the common keys
 static int keyMoveUp = -1;
@@ -36,11 +54,34 @@ static int keyMoveLeft = -1;
 static int keyMoveRight = -1;
 static int mouseWheel = -1;
 static int mouseLeftClick = -1;
+static int keyToggleFlowField = -1;
+
+//1 if a click sends the entity along the flow field to the tile, instead of along a path
+static int walkAlongFlowField = 0;
 
 //we assume that controllable entity ID:s will be less than: 2,147,483,647 (max signed int32 value)
 static Sint32 selectedEntityToControl = -1;
 static Sint32 playerEntityID = -1;
 
+//the path the controlled entity walks along, from the pathfinder of the isometric engine
+static int pathRequest = 0;
+static int nextPathTile = 0;
+//the tile of the path the entity has come closest to, how close, and how many frames ago it got any closer
+static int closestPathTile = -1;
+static float closestDistance = 0;
+static int numStuckFrames = 0;
+//new paths looked for since the entity was sent to walk
+static int numRepaths = 0;
+
+//the walk and idle animations for the directions the entity can walk in, in the order of the angles of the
+//directions in the world, starting at the x axis
+static const int pathDirections[8] = {
+    ENTITY_WORLD_DIRECTION_DOWNRIGHT,ENTITY_WORLD_DIRECTION_DOWN,ENTITY_WORLD_DIRECTION_DOWNLEFT,ENTITY_WORLD_DIRECTION_LEFT,
+    ENTITY_WORLD_DIRECTION_UPLEFT,ENTITY_WORLD_DIRECTION_UP,ENTITY_WORLD_DIRECTION_UPRIGHT,ENTITY_WORLD_DIRECTION_RIGHT
+};
+static char *pathWalkAnimations[8] = {"walkDownRight","walkDown","walkDownLeft","walkLeft","walkUpLeft","walkUp","walkUpRight","walkRight"};
+static char *pathIdleAnimations[8] = {"idleDownRight","idleDown","idleDownLeft","idleLeft","idleUpLeft","idleUp","idleUpRight","idleRight"};
+
 static void updateComponentPointers() {
     if (scn == NULL) {
         return;
@@ -61,6 +102,8 @@ static void updateComponentPointers() {
     animComponents = (ComponentAnimation*)Scene_GetComponent(scn,COMPONENT_SET1_ANIMATION);
     //get the pointer to the animation components
     colComponents = (ComponentCollision*)Scene_GetComponent(scn,COMPONENT_SET1_COLLISION);
+    //get the pointer to the position components
+    posComponents = (ComponentPosition*)Scene_GetComponent(scn,COMPONENT_SET1_POSITION);
 }
 
 int SystemControlEntity_Init(void *scene) {
@@ -143,6 +186,24 @@ int SystemControlEntity_Init(void *scene) {
         return 0;
     }
 
+    //get the pointer to the position components
+    posComponents = (ComponentPosition*)Scene_GetComponent(scn,COMPONENT_SET1_POSITION);
+    if (posComponents == NULL) {
+        //log it as an error
+        WriteError("Entity Control system failed to initialize: Scene does not have 'position' component!");
+        systemFailedToInitialize = 1;
+        return 0;
+    }
+
+    //build the pathfinder of the map. Without it the entity can only be moved with the keyboard
+    if (scn->isoEngine != NULL && scn->isoEngine->isoMap != NULL && scn->isoEngine->pathfinder == NULL) {
+        scn->isoEngine->pathfinder = isoPathfinderNew(scn->isoEngine->isoMap);
+    }
+    //the flow fields are built from the pathfinder, for the entities the move system walks to a shared goal
+    if (scn->isoEngine != NULL && scn->isoEngine->pathfinder != NULL && scn->isoEngine->flowFields == NULL) {
+        scn->isoEngine->flowFields = isoFlowFieldCacheNew(scn->isoEngine->pathfinder);
+    }
+
     //get the player ID (if it exist)
     playerEntityID = ComponentNameTag_GetEntityIDFromEntityByName(nameTagComponents,"player1",scn->numEntities);
 
@@ -157,12 +218,23 @@ void SystemControlEntity_Compute() {
     int controlledEntityIsPlayer1 = 0;
     SDL_Rect tmpRect;
     int isColliding = 0;
+    CollisionEvent *collisionEvents = NULL;
+    Uint32 numCollisionEvents = 0;
+    Uint32 i = 0;
 
     //if the system has failed to initialize
-    if (systemFailedToInitialize==1 || selectedEntityToControl==-1) {
+    if (systemFailedToInitialize==1) {
         //return out of the function
         return;
     }
+    //catch the pathfinder up with the map, and solve the paths that were requested last frame
+    if (scn->isoEngine != NULL) {
+        isoPathfinderUpdate(scn->isoEngine->pathfinder,scn->isoEngine->isoMap);
+    }
+    //if no entity is controlled
+    if (selectedEntityToControl==-1) {
+        return;
+    }
     //if the component pointers have been reallocated in the scene
     if (scn->componentPointersReallocated == 1) {
         //update the local global component pointers
@@ -187,20 +259,44 @@ void SystemControlEntity_Compute() {
     //if the left mouse button has just been pressed
     if (mouseLeftClick !=-1 && mouseInputComponents[selectedEntityToControl].actions[mouseLeftClick].state == COMPONENT_INPUTMOUSE_STATE_RELEASED
     && mouseInputComponents[selectedEntityToControl].actions[mouseLeftClick].oldState == COMPONENT_INPUTMOUSE_STATE_PRESSED) {
-        //do something
+        //walk to the tile that was clicked
+        if (walkAlongFlowField) {
+            walkFlowFieldToMouseTile();
+        } else {
+            requestPathToMouseTile();
+        }
+    }
+
+    //if the toggle flow field key has just been pressed
+    if (keyToggleFlowField != -1 && keyboardInputComponents[selectedEntityToControl].actions[keyToggleFlowField].oldState == COMPONENT_INPUTKEYBOARD_STATE_RELEASED
+    && keyboardInputComponents[selectedEntityToControl].actions[keyToggleFlowField].state == COMPONENT_INPUTKEYBOARD_STATE_PRESSED) {
+        walkAlongFlowField = !walkAlongFlowField;
+        WriteDebug("Walking along %s",walkAlongFlowField ? "flow fields" : "paths");
     }
 
     //if the entity has a collision component
     if (scn->entities[selectedEntityToControl].componentSet1 & COMPONENT_SET1_COLLISION) {
-
-        //if the entity is colliding
-        if (colComponents[selectedEntityToControl].isColliding) {
-            isColliding = 1;
+        //the entity is colliding if it touches an entity or a tile this frame
+        collisionEvents = SystemCollision_GetEvents(&numCollisionEvents);
+        for (i = 0; i < numCollisionEvents && isColliding == 0; ++i) {
+            if (collisionEvents[i].type != COLLISIONEVENT_END
+            && (collisionEvents[i].entityA == (Uint32)selectedEntityToControl || collisionEvents[i].entityB == (Uint32)selectedEntityToControl)) {
+                isColliding = 1;
+            }
         }
     }
 
     ///KEYBOARD CONTROLS
 
+    //moving the entity with the keyboard stops the walk along the path or the flow field
+    if ((keyMoveUp !=-1 && keyboardInputComponents[selectedEntityToControl].actions[keyMoveUp].state == COMPONENT_INPUTKEYBOARD_STATE_PRESSED)
+    || (keyMoveDown !=-1 && keyboardInputComponents[selectedEntityToControl].actions[keyMoveDown].state == COMPONENT_INPUTKEYBOARD_STATE_PRESSED)
+    || (keyMoveLeft !=-1 && keyboardInputComponents[selectedEntityToControl].actions[keyMoveLeft].state == COMPONENT_INPUTKEYBOARD_STATE_PRESSED)
+    || (keyMoveRight !=-1 && keyboardInputComponents[selectedEntityToControl].actions[keyMoveRight].state == COMPONENT_INPUTKEYBOARD_STATE_PRESSED)) {
+        stopFollowingPath();
+        ComponentVelocity_StopFlowField(velocityComponents,selectedEntityToControl);
+    }
+
     //if action keys: right & down is pressed
     if (keyMoveRight !=-1 && keyboardInputComponents[selectedEntityToControl].actions[keyMoveRight].state == COMPONENT_INPUTKEYBOARD_STATE_PRESSED
     && keyMoveDown !=-1 && keyboardInputComponents[selectedEntityToControl].actions[keyMoveDown].state == COMPONENT_INPUTKEYBOARD_STATE_PRESSED) {
@@ -312,6 +408,16 @@ void SystemControlEntity_Compute() {
         else{
             ComponentAnimation_SetAnimationState(animComponents,selectedEntityToControl,"idleRight");
         }
+    }
+    //if the entity is walking along a path
+    else if (followPath(controlledEntityIsPlayer1,isColliding)) {
+        //the velocity and the animation are set by the path
+    }
+    //if the entity is walking along a flow field, the move system sets the velocity
+    else if (velocityComponents[selectedEntityToControl].mode == COMPONENT_VELOCITY_MODE_FLOW_FIELD) {
+        if (velocityComponents[selectedEntityToControl].x != 0 || velocityComponents[selectedEntityToControl].y != 0) {
+            faceWalkDirection(velocityComponents[selectedEntityToControl].x,velocityComponents[selectedEntityToControl].y,controlledEntityIsPlayer1,isColliding);
+        }
     } else {
         componentKeyboardInitActionReleaseTimer(keyboardInputComponents,selectedEntityToControl);
         if (controlledEntityIsPlayer1) {
@@ -478,13 +584,151 @@ static void setKeysAndMouseControls(Scene *scene) {
     //get the mouse actions
     mapMouseControl(scene,&mouseWheel,"mouseWheel");
     mapMouseControl(scene,&mouseLeftClick,"leftButton");
+    mapKeyboardControl(scene,&keyToggleFlowField,"toggleFlowField");
 }
 
 Uint32 SystemControlEntity_GetControlledEntity() {
     return selectedEntityToControl;
 }
 
+//returns the middle of the collision rectangle of the entity in the world, or its position if it does not have one
+static void getEntityWorldCenter(SDL_FPoint *center) {
+    if (scn->entities[selectedEntityToControl].componentSet1 & COMPONENT_SET1_COLLISION) {
+        center->x = colComponents[selectedEntityToControl].worldRect.x + colComponents[selectedEntityToControl].worldRect.w/2;
+        center->y = colComponents[selectedEntityToControl].worldRect.y + colComponents[selectedEntityToControl].worldRect.h/2;
+    } else {
+        center->x = posComponents[selectedEntityToControl].x;
+        center->y = posComponents[selectedEntityToControl].y;
+    }
+}
+
+//asks the pathfinder for a path from the tile the entity stands on to the tile under the mouse.
+//The path is solved at the next update of the pathfinder, a path that was walked along is dropped
+static void requestPathToMouseTile() {
+    IsoEngine *isoEngine = scn->isoEngine;
+    SDL_FPoint mouseTilePos;
+
+    if (isoEngine == NULL || isoEngine->pathfinder == NULL) {
+        return;
+    }
+    IsoEngine_GetMouseTilePos(isoEngine,&mouseTilePos);
+    numRepaths = 0;
+    requestPath((int)mouseTilePos.x,(int)mouseTilePos.y);
+}
+
+//asks the pathfinder for a path from the tile the entity stands on to the goal, instead of the path it walks along
+static void requestPath(int goalX,int goalY) {
+    IsoEngine *isoEngine = scn->isoEngine;
+    SDL_FPoint entityPos;
+
+    getEntityWorldCenter(&entityPos);
+    stopFollowingPath();
+    ComponentVelocity_StopFlowField(velocityComponents,selectedEntityToControl);
+    pathRequest = isoPathfinderRequestPath(isoEngine->pathfinder,(int)(entityPos.x/isoEngine->isoMap->tileSize),(int)(entityPos.y/isoEngine->isoMap->tileSize),
+                                           goalX,goalY);
+    //the first tile of the path is the tile the entity stands on
+    nextPathTile = 1;
+}
+
+//sends the entity to the tile under the mouse along the flow field to it, the move system sets the velocity from then on.
+//The field is shared with every entity that walks to the same tile
+static void walkFlowFieldToMouseTile() {
+    IsoEngine *isoEngine = scn->isoEngine;
+    SDL_FPoint mouseTilePos;
+
+    if (isoEngine == NULL || isoEngine->flowFields == NULL) {
+        return;
+    }
+    IsoEngine_GetMouseTilePos(isoEngine,&mouseTilePos);
+    stopFollowingPath();
+    ComponentVelocity_FollowFlowField(velocityComponents,selectedEntityToControl,(int)mouseTilePos.x,(int)mouseTilePos.y,SYSTEM_CONTROL_ENTITY_PATH_SPEED);
+}
+
+//walks the entity toward the middle of the next tile of the path. Returns 1 if the entity is walking, and 0 when
+//there is no path, it is not solved yet or the entity has reached the end of it.
+//An entity that does not get any closer to the next tile for SYSTEM_CONTROL_ENTITY_PATH_STUCK_FRAMES frames is held
+//up by something the pathfinder does not know about, like another entity. It looks for a new path from where it
+//is, and stops walking when it is stuck again
+static int followPath(int controlledEntityIsPlayer1,int isColliding) {
+    IsoEngine *isoEngine = scn->isoEngine;
+    SDL_Point *pathTiles = NULL;
+    SDL_FPoint entityPos, target;
+    int numPathTiles = 0;
+    int state = 0;
+    float dx = 0, dy = 0, distance = 0;
+
+    if (pathRequest == 0 || isoEngine == NULL) {
+        return 0;
+    }
+    state = isoPathfinderGetPath(isoEngine->pathfinder,pathRequest,&pathTiles,&numPathTiles);
+    if (state == ISO_PATH_STATE_PENDING) {
+        return 0;
+    }
+    getEntityWorldCenter(&entityPos);
+    while (state == ISO_PATH_STATE_FOUND && nextPathTile < numPathTiles) {
+        target.x = (pathTiles[nextPathTile].x + 0.5f)*isoEngine->isoMap->tileSize;
+        target.y = (pathTiles[nextPathTile].y + 0.5f)*isoEngine->isoMap->tileSize;
+        dx = target.x - entityPos.x;
+        dy = target.y - entityPos.y;
+        distance = sqrtf(dx*dx + dy*dy);
+        if (distance >= SYSTEM_CONTROL_ENTITY_PATH_REACHED) {
+            break;
+        }
+        nextPathTile++;
+    }
+    //if the path was not found, or the entity is at the end of it
+    if (state != ISO_PATH_STATE_FOUND || nextPathTile >= numPathTiles) {
+        stopFollowingPath();
+        return 0;
+    }
+    //if the entity has reached a new tile of the path, or is closer to the next one than it has been
+    if (nextPathTile != closestPathTile || distance < closestDistance - SYSTEM_CONTROL_ENTITY_PATH_PROGRESS) {
+        closestPathTile = nextPathTile;
+        closestDistance = distance;
+        numStuckFrames = 0;
+    }
+    else if (++numStuckFrames >= SYSTEM_CONTROL_ENTITY_PATH_STUCK_FRAMES) {
+        if (numRepaths >= SYSTEM_CONTROL_ENTITY_PATH_MAX_REPATHS) {
+            WriteDebug("The controlled entity is stuck at path tile %d of %d, it stops walking",nextPathTile,numPathTiles);
+            stopFollowingPath();
+            return 0;
+        }
+        numRepaths++;
+        requestPath(pathTiles[numPathTiles-1].x,pathTiles[numPathTiles-1].y);
+        return 0;
+    }
+
+    velocityComponents[selectedEntityToControl].x = dx/distance*SYSTEM_CONTROL_ENTITY_PATH_SPEED;
+    velocityComponents[selectedEntityToControl].y = dy/distance*SYSTEM_CONTROL_ENTITY_PATH_SPEED;
+
+    faceWalkDirection(dx,dy,controlledEntityIsPlayer1,isColliding);
+    return 1;
+}
+
+//faces the entity in the direction that is closest to the direction it walks in, and sets its walk animation
+static void faceWalkDirection(float dx,float dy,int controlledEntityIsPlayer1,int isColliding) {
+    int direction = (int)lroundf(atan2f(dy,dx)/(float)(M_PI/4)) & 7;
+
+    animComponents[selectedEntityToControl].direction = pathDirections[direction];
+    if (controlledEntityIsPlayer1 && isColliding == 0) {
+        ComponentAnimation_SetAnimationState(animComponents,selectedEntityToControl,pathWalkAnimations[direction]);
+    } else {
+        ComponentAnimation_SetAnimationState(animComponents,selectedEntityToControl,pathIdleAnimations[direction]);
+    }
+}
+
+static void stopFollowingPath() {
+    if (pathRequest != 0 && scn != NULL && scn->isoEngine != NULL) {
+        isoPathfinderReleasePath(scn->isoEngine->pathfinder,pathRequest);
+    }
+    pathRequest = 0;
+    nextPathTile = 0;
+    closestPathTile = -1;
+    numStuckFrames = 0;
+}
+
 void SystemControlEntity_Free() {
-    //control entity system is not allocating anything, so we leave it empty
+    //hand the path back, the pathfinder is freed with the isometric engine
+    stopFollowingPath();
 }
 
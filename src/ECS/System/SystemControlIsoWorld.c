@@ -37,6 +37,8 @@ static int keyScrollMapDown = -1;
 static int keyScrollMapLeft = -1;
 static int keyScrollMapRight = -1;
 static int keyToggleGameMode = -1;
+static int keyToggleMinimap = -1;
+static int keyTogglePartialRedraw = -1;
 
 static int mouseWheelZoom = -1;
 static int mouseLeftClick = -1;
@@ -134,6 +136,8 @@ int SystemControlIsoWorld_Init(void *scene) {
     keyScrollMapLeft = componentInputKeyboardGetActionIndex(keyboardInputComponents,isometricControlEntityIndex,"left");
     keyScrollMapRight = componentInputKeyboardGetActionIndex(keyboardInputComponents,isometricControlEntityIndex,"right");
     keyToggleGameMode = componentInputKeyboardGetActionIndex(keyboardInputComponents,isometricControlEntityIndex,"toggleGameMode");
+    keyToggleMinimap = componentInputKeyboardGetActionIndex(keyboardInputComponents,isometricControlEntityIndex,"toggleMinimap");
+    keyTogglePartialRedraw = componentInputKeyboardGetActionIndex(keyboardInputComponents,isometricControlEntityIndex,"togglePartialRedraw");
 
     mouseWheelZoom = ComponentInputMouse_GetActionIndex(mouseInputComponents,isometricControlEntityIndex,"mouseWheel");
     mouseLeftClick = ComponentInputMouse_GetActionIndex(mouseInputComponents,isometricControlEntityIndex,"leftButton");
@@ -213,6 +217,19 @@ void SystemControlIsoWorld_Compute() {
             isoEngine->gameMode=GAME_MODE_OVERVIEW;
         }
     }
+
+    //if the toggle minimap key has just been pressed
+    if (keyboardInputComponents[isometricControlEntityIndex].actions[keyToggleMinimap].oldState == COMPONENT_INPUTKEYBOARD_STATE_RELEASED
+    && keyboardInputComponents[isometricControlEntityIndex].actions[keyToggleMinimap].state == COMPONENT_INPUTKEYBOARD_STATE_PRESSED) {
+        isoEngine->showMinimap = !isoEngine->showMinimap;
+    }
+
+    //if the toggle partial redraw key has just been pressed
+    if (keyboardInputComponents[isometricControlEntityIndex].actions[keyTogglePartialRedraw].oldState == COMPONENT_INPUTKEYBOARD_STATE_RELEASED
+    && keyboardInputComponents[isometricControlEntityIndex].actions[keyTogglePartialRedraw].state == COMPONENT_INPUTKEYBOARD_STATE_PRESSED) {
+        isoEngine->partialRedraw = !isoEngine->partialRedraw;
+        WriteDebug("Partial redraw %s",isoEngine->partialRedraw ? "on" : "off");
+    }
 }
 
 void SystemControlIsoWorld_Free() {
@@ -11,6 +11,8 @@
 #define SYSTEM_MOVE_MASK_SET1 (COMPONENT_SET1_POSITION | COMPONENT_SET1_VELOCITY)
 
 #define COMPONENT_NO_INDEX -100
+//number of frames in a row an entity has to be still before it goes to sleep
+#define SYSTEM_MOVE_FRAMES_TO_SLEEP 30
 
 //local global pointers to the data
 static ComponentPosition *posComponents = NULL;
@@ -19,6 +21,8 @@ static Scene *scn = NULL;
 //local global variable for system failure
 static int systemFailedToInitialize = 1;
 
+static void steerAlongFlowField(Uint32 entity);
+
 static void updateComponentPointers() {
     if (scn == NULL) {
         return;
@@ -109,7 +113,27 @@ void SystemMove_UpdateEntity(Uint32 entity) {
     }
 
     //if the entity has the position and velocity component
-    if (scn->entities[entity].componentSet1 & SYSTEM_MOVE_MASK_SET1) {
+    if ((scn->entities[entity].componentSet1 & SYSTEM_MOVE_MASK_SET1) == SYSTEM_MOVE_MASK_SET1) {
+        //an entity that walks along a flow field gets its velocity from the tile it stands on
+        if (velComponents[entity].mode == COMPONENT_VELOCITY_MODE_FLOW_FIELD) {
+            steerAlongFlowField(entity);
+        }
+        //if the entity is still
+        if (velComponents[entity].x == 0 && velComponents[entity].y == 0) {
+            //if it is already sleeping, there is nothing to do
+            if (velComponents[entity].isSleeping) {
+                return;
+            }
+            //put it to sleep when it has been still for long enough
+            if (++velComponents[entity].framesAtRest >= SYSTEM_MOVE_FRAMES_TO_SLEEP) {
+                velComponents[entity].isSleeping = 1;
+                return;
+            }
+        }
+        //the velocity can be set directly on the component, so a sleeping entity that got a velocity wakes up here
+        else if (velComponents[entity].isSleeping || velComponents[entity].framesAtRest > 0) {
+            ComponentVelocity_Wake(velComponents,entity);
+        }
         ComponentPosition_AddOldPositionToStack(posComponents,entity);
         //update the entity position
         posComponents[entity].x += (velComponents[entity].x * DeltaTimer_GetDeltaTime());
@@ -164,6 +188,18 @@ void SystemMove_UpdateEntity(Uint32 entity) {
     }
 }
 
+//points the velocity of the entity along the flow field to its goal, from the tile its position is on
+static void steerAlongFlowField(Uint32 entity) {
+    IsoEngine *isoEngine = scn->isoEngine;
+
+    if (isoEngine == NULL || isoEngine->isoMap == NULL) {
+        return;
+    }
+    ComponentVelocity_SteerAlongFlowField(velComponents,entity,isoEngine->flowFields,isoEngine->pathfinder,
+                                          (int)(posComponents[entity].x/isoEngine->isoMap->tileSize),
+                                          (int)(posComponents[entity].y/isoEngine->isoMap->tileSize));
+}
+
 void SystemMove_MoveSystem() {
     //move system is not allocating anything, so we leave it empty
 }
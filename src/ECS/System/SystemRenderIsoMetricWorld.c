@@ -3,16 +3,23 @@
  *  position (height) in Cartesian coordinates and also drawn them correctly behind and in-front of the isometric
  *  tiles.
  *
- *  To do this, we will first create a sorted list of on-screen entities based on their height in Cartesian
- *  coordinates, while also calculating the row on the map which they are standing on.
+ *  To do this, we will first collect the on-screen entities with their height in Cartesian coordinates and the row
+ *  on the map which they are standing on. Before drawing, the entities are bucketed by row with a counting sort, and
+ *  the entities within a row are sorted by their height. The entities are filed in a spatial grid by their position
+ *  in the world, so only the entities in the grid cells under the screen have to be tested against the screen.
  *  Secondly while drawing the map, we will keep track of which row on the map that is being drawn, and draw the
  *  entities that are standing on that row. The sorted list of entities will function like a stack, where we take
  *  the top entity of the stack and move our way down. This will simply be an integer that is iterating through
  *  the sorted list. Since the list is in the correct order we only have to take out the top entities that stand
  *  on the row that's being drawn.
  *
+ *  When partial redraw is turned on, the world is drawn into a back buffer that is kept between frames. While the
+ *  camera is still and the map has not changed, only the rectangles of the screen where sprites have moved, changed
+ *  animation frame, appeared or gone away are drawn again, tiles and entities clipped to those rectangles.
+ *
  */
 #include <math.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -26,14 +33,33 @@
 #include "../Components/Component.h"
 #include "../../Texture.h"
 #include "../../IsoEngine/isoEngine.h"
+#include "../../IsoEngine/isoChunkCache.h"
 #include "../../renderer.h"
 #include "../../FontPool.h"
+#include "../../RenderQueue.h"
+#include "../Spatial/SpatialGrid.h"
 
 //define a mask for the render isometric system. It requires a position and a render2D component.
 //it works on SET1 components, so we mark that as well in the define name
 #define SYSTEM_RENDER_ISO_MASK_SET1 (COMPONENT_SET1_POSITION | COMPONENT_SET1_RENDER2D)
 #define SYSTEM_RENDER_ISO_ANIM_MASK_SET1 (COMPONENT_SET1_POSITION | COMPONENT_SET1_ANIMATION)
 #define NUM_INITIAL_ONSCREEN_ENTITIES_PER_LAYER   100
+#define MINIMAP_WIDGET_WIDTH                      256
+#define MINIMAP_WIDGET_MARGIN                     8
+//the coherent sort gives up and the entities are sorted from scratch, when fixing last frame's order
+//takes more than this many moves per entity
+#define COHERENT_SORT_MAX_MOVES_PER_ENTITY        8
+//the most rectangles of the screen that are drawn again in one frame, more changes are merged into them
+#define MAX_DIRTY_RECTS                           32
+
+//where the sprite of an entity was drawn on the screen, and with which image
+typedef struct DrawnSprite {
+    Uint32 entityID;
+    SDL_Rect rect;          //the screen area the sprite and its collision box cover
+    SDL_Rect clip;          //the part of the image that was drawn
+    Texture *texture;
+    int matched;            //1 when the entity is drawn the same way in the next frame
+} DrawnSprite;
 
 //local global variable for system failure
 static int systemFailedToInitialize = 1;
@@ -53,6 +79,70 @@ static EntitiesOnScreen *entitiesOnScreen = NULL;
 //number of entities drawn last frame
 static int numEntitiesDrawnLastFrame = 0;
 
+//local global pointer to the pre-drawn chunks of the map
+static IsoChunkCache *chunkCache = NULL;
+
+//number of chunk textures drawn last frame
+static int numChunksDrawnLastFrame = 0;
+
+//grid of the world positions of the entities that are drawn, used to find the entities on the screen without
+//looking at every entity. The grid has one cell per map chunk
+static SpatialGrid *spatialGrid = NULL;
+//how far the largest sprite reaches from the position of its entity, at zoom level 1.0
+static float maxSpriteExtent = 0;
+//number of entities in the scene last frame, the grid is filled again when entities have been removed
+static Uint32 numSceneEntitiesLastFrame = 0;
+//number of entities found in the grid cells under the screen last frame
+static int numCandidatesLastFrame = 0;
+
+//number of render commands, sprite batches and quads drawn last frame
+static int numCommandsLastFrame = 0;
+static int numBatchesLastFrame = 0;
+static int numQuadsLastFrame = 0;
+
+//number of tiles looked at and drawn tile by tile in the last frame
+static int numTilesVisitedLastFrame = 0;
+static int numTilesDrawnLastFrame = 0;
+
+//the entities are sorted in the order of the last frame when the camera has not jumped or zoomed since then
+static float lastSortZoomLevel = 0;
+static int lastSortScrollX = 0;
+static int lastSortScrollY = 0;
+//index in the collected list of every entity ID, valid when the stamp of the entity is the current sort stamp
+static Uint32 *collectedIndexOfEntity = NULL;
+static Uint32 *collectedStampOfEntity = NULL;
+static Uint32 maxCollectedEntityIDs = 0;
+static Uint32 sortStamp = 0;
+//time spent sorting the entities last frame, and the number of layers that had to be sorted from scratch
+static double sortTimeLastFrame = 0;
+static int numFullSortsLastFrame = 0;
+
+//the back buffer the world is drawn into when partial redraw is on, and the camera it was drawn with
+static SDL_Texture *backBuffer = NULL;
+static int backBufferValid = 0;
+static float lastDrawZoomLevel = 0;
+static int lastDrawScrollX = 0;
+static int lastDrawScrollY = 0;
+//the sprites drawn this frame and in the last frame, and where every entity ID is in the last frame's list.
+//The index is valid when the stamp of the entity is the current draw stamp
+static DrawnSprite *drawnSprites = NULL;
+static DrawnSprite *lastDrawnSprites = NULL;
+static Uint32 numDrawnSprites = 0;
+static Uint32 numLastDrawnSprites = 0;
+static Uint32 maxDrawnSprites = 0;
+static Uint32 *drawnIndexOfEntity = NULL;
+static Uint32 *drawnStampOfEntity = NULL;
+static Uint32 maxDrawnEntityIDs = 0;
+static Uint32 drawStamp = 0;
+//the rectangles of the screen that are drawn again this frame
+static SDL_Rect dirtyRects[MAX_DIRTY_RECTS];
+static int numDirtyRects = 0;
+//the rectangle of the screen that is being drawn, NULL when the whole screen is drawn
+static SDL_Rect *drawRect = NULL;
+//number of rectangles and pixels drawn again last frame
+static int numDirtyRectsLastFrame = 0;
+static int dirtyAreaLastFrame = 0;
+
 //Frames / second
 static Uint32 fpsLasttime;      //the last recorded time.
 static Uint32 fpsCurrent;       //the current FPS.
@@ -69,8 +159,21 @@ static int r,g,b;
 
 //function prototypes
 static void systemRenderIsometricObject(int entity);
-static void insertionSortOnScreenEntities(EntitiesOnScreen *entities,int layer,EntityOnScreenPos *entity);
-static int binarySearchFindOnScreenEntityInsertIndex(EntitiesOnScreen *entities,int layer,EntityOnScreenPos *entity);
+static int getEntityImage(int entity,Texture **texture,SDL_Rect *clip);
+static void getEntityScreenRect(int entity,SDL_Rect *clip,SDL_Rect *rect);
+static void getCollisionScreenRect(int entity,SDL_Rect *rect);
+static void drawWorld(SDL_Rect *rect);
+static void drawWorldPartial(int fullRedraw);
+static int updateDrawnSprites();
+static void addDirtyRect(SDL_Rect *rect);
+static void collectEntity(Uint32 entity);
+static float getEntitySpriteExtent(Uint32 entity);
+static void screenToWorld(float screenX,float screenY,SDL_FPoint *worldPoint);
+static void drawEntitiesUpToRow(int layer,int row);
+static void drawMapFromMinimap();
+static void drawMinimapWidget();
+static int sortOnScreenEntities(EntitiesOnScreen *entities);
+static int coherentSortOnScreenEntities(EntitiesOnScreen *entities);
 
 static void updateComponentPointers() {
     if (scn == NULL) {
@@ -131,6 +234,26 @@ int SystemRenderIsoMetricWorld_Init(void *scene) {
         return 0;
     }
 
+    //build the minimap of the map. Without it the map is still drawn, but can not be zoomed out further than 1.0
+    if (isoEngine->minimap == NULL) {
+        isoEngine->minimap = isoMinimapNew(isoEngine->isoMap);
+    }
+
+    //create the chunk cache. Without it the map is drawn tile by tile
+    chunkCache = isoChunkCacheNew(isoEngine->isoMap);
+
+    //create the grid the entities are filed in by their world position
+    spatialGrid = SpatialGrid_New(isoEngine->isoMap->mapWidth*isoEngine->isoMap->tileSize,
+                                  isoEngine->isoMap->mapHeight*isoEngine->isoMap->tileSize,
+                                  ISO_MAP_CHUNK_SIZE*isoEngine->isoMap->tileSize);
+    if (spatialGrid == NULL) {
+        WriteError("Render isometric world system failed to initialize: could not create the spatial grid!");
+        systemFailedToInitialize = 1;
+        return 0;
+    }
+    maxSpriteExtent = 0;
+    numSceneEntitiesLastFrame = 0;
+
     //allocate memory for entities on screen struct
     entitiesOnScreen = malloc(sizeof(struct EntitiesOnScreen)*isoEngine->isoMap->numLayers);
     if (entitiesOnScreen == NULL) {
@@ -143,8 +266,11 @@ int SystemRenderIsoMetricWorld_Init(void *scene) {
 
     //allocate memory for the entities on the layers
     for (i = 0; i < (Uint32)isoEngine->isoMap->numLayers; ++i) {
-        entitiesOnScreen[i].entityList = malloc(sizeof(struct EntityOnScreenPos)*NUM_INITIAL_ONSCREEN_ENTITIES_PER_LAYER+1);
-        if (entitiesOnScreen[i].entityList == NULL) {
+        entitiesOnScreen[i].rowCounts = NULL;
+        entitiesOnScreen[i].maxRows = 0;
+        entitiesOnScreen[i].entityList = malloc(sizeof(struct EntityOnScreenPos)*NUM_INITIAL_ONSCREEN_ENTITIES_PER_LAYER);
+        entitiesOnScreen[i].collectedList = malloc(sizeof(struct EntityOnScreenPos)*NUM_INITIAL_ONSCREEN_ENTITIES_PER_LAYER);
+        if (entitiesOnScreen[i].entityList == NULL || entitiesOnScreen[i].collectedList == NULL) {
             //log it as an error
             WriteError("Could not allocate memory for layer %d :entitiesOnScreen[%d]->entityList, which stores the on-screen entities.",i,i);
             systemFailedToInitialize = 1;
@@ -159,6 +285,8 @@ int SystemRenderIsoMetricWorld_Init(void *scene) {
         }
 
         entitiesOnScreen[i].numEntities=0;
+        entitiesOnScreen[i].numCollected = 0;
+        entitiesOnScreen[i].numEntitiesLastRender = 0;
         entitiesOnScreen[i].maxEntities = NUM_INITIAL_ONSCREEN_ENTITIES_PER_LAYER;
         entitiesOnScreen[i].currentEntityToDraw = 0;
     }
@@ -231,28 +359,19 @@ int SystemRenderIsoMetricWorld_Init(void *scene) {
 }
 
 static void systemRenderIsometricObject(int entity) {
-    SDL_FPoint point,tmpPoint;
+    SDL_FPoint point;
+    SDL_Color white = {0xff,0xff,0xff,0xff};
     Texture *texture = NULL;
-    Animation *currAnim = NULL;
+    SDL_Rect clip;
+    SDL_Rect collisionRect;
 
-    //if the entity has the animation component
-    if (scn->entities[entity].componentSet1 & COMPONENT_SET1_ANIMATION) {
-        //point the currAnim pointer to the animations (for more readability)
-        currAnim = animComponents[entity].animations;
-        //get the texture
-        texture = currAnim[animComponents[entity].animationState].texture;
-        //set the clip rectangle to the current animation frame
-        texture->cliprect = currAnim[animComponents[entity].animationState].frames[currAnim[animComponents[entity].animationState].currentFrame].clipRect;
-    }
-    //else if the entity has the render2d component
-    else if (scn->entities[entity].componentSet1 & COMPONENT_SET1_RENDER2D) {
-        texture = render2DComponents[entity].texture;
-    }
     //if the entity does not have anything to render
-    else{
+    if (!getEntityImage(entity,&texture,&clip)) {
         //return out of the function
         return;
     }
+    //set the clip rectangle to the current animation frame
+    texture->cliprect = clip;
 
     point.x = (posComponents[entity].x*isoEngine->zoomLevel)+ isoEngine->scrollX;
     point.y = (posComponents[entity].y*isoEngine->zoomLevel)+ isoEngine->scrollY;
@@ -268,29 +387,455 @@ static void systemRenderIsometricObject(int entity) {
 
     // uncomment to see the collision rectangles
     
-    //draw the collision box at the base of the object
-    colComponents[entity].worldRect.x = point.x +((render2DComponents[entity].texture->cliprect.w*0.5)*isoEngine->zoomLevel)
-                                                -((colComponents[entity].rect.w*0.5)*isoEngine->zoomLevel);
-    //start at the bottom of the rectangle
-    colComponents[entity].worldRect.y = point.y +((render2DComponents[entity].texture->cliprect.h)*isoEngine->zoomLevel)
-                                                -((colComponents[entity].rect.h)*isoEngine->zoomLevel);
-    //width and height of the collision rectangle
-    colComponents[entity].worldRect.w = colComponents[entity].rect.w*isoEngine->zoomLevel;
-    colComponents[entity].worldRect.h = colComponents[entity].rect.h*isoEngine->zoomLevel;
-    SDL_SetRenderDrawColor(getRenderer(),0xff,0xff,0xff,0x00);
-    SDL_RenderDrawRect(getRenderer(),&colComponents[entity].worldRect);
+    //draw the box around the collision rectangle on the ground
+    getCollisionScreenRect(entity,&collisionRect);
+    RenderQueue_DrawRect(&collisionRect,white);
     
 }
 
-void SystemRenderIsoMetricWorld_Compute() {
-    int i,j,layer;
+//gets the image and the part of it the entity is drawn with. Returns 0 if the entity has nothing to draw
+static int getEntityImage(int entity,Texture **texture,SDL_Rect *clip) {
+    Animation *currAnim = NULL;
+
+    //if the entity has the animation component, the clip rectangle is the current animation frame
+    if (scn->entities[entity].componentSet1 & COMPONENT_SET1_ANIMATION) {
+        currAnim = &animComponents[entity].animations[animComponents[entity].animationState];
+        *texture = currAnim->texture;
+        *clip = currAnim->frames[currAnim->currentFrame].clipRect;
+        return 1;
+    }
+    //else if the entity has the render2d component
+    if (scn->entities[entity].componentSet1 & COMPONENT_SET1_RENDER2D && render2DComponents[entity].texture != NULL) {
+        *texture = render2DComponents[entity].texture;
+        *clip = (*texture)->cliprect;
+        return 1;
+    }
+    return 0;
+}
+
+//gets the area of the screen the entity covers when it is drawn with the clip rectangle, the same way as
+//systemRenderIsometricObject() draws it, with its collision box and one pixel around it
+static void getEntityScreenRect(int entity,SDL_Rect *clip,SDL_Rect *rect) {
+    SDL_FPoint point;
+    SDL_Rect spriteRect,collisionRect;
+    int extra = isoEngine->zoomLevel != 1.0 ? 1 : 0;
+
+    point.x = (posComponents[entity].x*isoEngine->zoomLevel)+ isoEngine->scrollX;
+    point.y = (posComponents[entity].y*isoEngine->zoomLevel)+ isoEngine->scrollY;
+    IsoEngine_Convert2DToIso(&point);
+    point.x += posComponents[entity].xOffset*isoEngine->zoomLevel;
+    point.y += posComponents[entity].yOffset*isoEngine->zoomLevel;
+
+    spriteRect.x = (int)point.x;
+    spriteRect.y = (int)point.y;
+    spriteRect.w = (int)(clip->w*isoEngine->zoomLevel) + extra;
+    spriteRect.h = (int)(clip->h*isoEngine->zoomLevel) + extra;
+
+    getCollisionScreenRect(entity,&collisionRect);
+    SDL_UnionRect(&spriteRect,&collisionRect,rect);
+    rect->x -= 1;
+    rect->y -= 1;
+    rect->w += 2;
+    rect->h += 2;
+}
+
+//gets the box on the screen around the collision rectangle of the entity. The rectangle is in world space,
+//so on the screen it is a diamond on the ground under the entity
+static void getCollisionScreenRect(int entity,SDL_Rect *rect) {
+    SDL_FPoint corners[4];
+    float minX = 0, maxX = 0, minY = 0, maxY = 0;
+    int i = 0;
+
+    corners[0].x = posComponents[entity].x + colComponents[entity].rect.x;
+    corners[0].y = posComponents[entity].y + colComponents[entity].rect.y;
+    corners[1].x = corners[0].x + colComponents[entity].rect.w;
+    corners[1].y = corners[0].y;
+    corners[2].x = corners[0].x;
+    corners[2].y = corners[0].y + colComponents[entity].rect.h;
+    corners[3].x = corners[1].x;
+    corners[3].y = corners[2].y;
+    for (i = 0; i < 4; ++i) {
+        corners[i].x = corners[i].x*isoEngine->zoomLevel + isoEngine->scrollX;
+        corners[i].y = corners[i].y*isoEngine->zoomLevel + isoEngine->scrollY;
+        IsoEngine_Convert2DToIso(&corners[i]);
+        if (i == 0 || corners[i].x < minX) minX = corners[i].x;
+        if (i == 0 || corners[i].x > maxX) maxX = corners[i].x;
+        if (i == 0 || corners[i].y < minY) minY = corners[i].y;
+        if (i == 0 || corners[i].y > maxY) maxY = corners[i].y;
+    }
+    rect->x = (int)minX;
+    rect->y = (int)minY;
+    rect->w = (int)(maxX - minX);
+    rect->h = (int)(maxY - minY);
+}
+
+//draws the map from the minimap when the camera is zoomed out. It only costs as much as the pixels the map covers
+//on screen, no matter how many tiles are visible. The entities are drawn on top of it in their sorted order
+static void drawMapFromMinimap() {
+    SDL_FPoint corners[4];
+    float zoomLevelTileSize = isoEngine->zoomLevel*isoEngine->isoMap->tileSize;
+    int i = 0, layer = 0;
+
+    //the corners of the map in map coordinates
+    corners[0].x = 0;
+    corners[0].y = 0;
+    corners[1].x = isoEngine->isoMap->mapWidth*zoomLevelTileSize;
+    corners[1].y = 0;
+    corners[2].x = isoEngine->isoMap->mapWidth*zoomLevelTileSize;
+    corners[2].y = isoEngine->isoMap->mapHeight*zoomLevelTileSize;
+    corners[3].x = 0;
+    corners[3].y = isoEngine->isoMap->mapHeight*zoomLevelTileSize;
+
+    //convert the corners to the screen, the same way the tiles are
+    for (i = 0; i < 4; ++i) {
+        corners[i].x += isoEngine->scrollX;
+        corners[i].y += isoEngine->scrollY;
+        IsoEngine_Convert2DToIso(&corners[i]);
+        //the top corner of a tile is in the middle of the tile image
+        corners[i].x += zoomLevelTileSize;
+    }
+    isoMinimapDraw(isoEngine->minimap,isoEngine->isoMap,isoMinimapGetLevelForScale(isoEngine->minimap,zoomLevelTileSize),corners);
+
+    //draw all the entities on screen, layer by layer
+    for (layer = 0; layer < isoEngine->isoMap->numLayers; ++layer) {
+        drawEntitiesUpToRow(layer,INT_MAX);
+    }
+}
+
+//draws the entities of the layer that are standing on the row or on any row before it, which have not been drawn yet
+static void drawEntitiesUpToRow(int layer,int row) {
+    EntitiesOnScreen *entities = &entitiesOnScreen[layer];
+    Uint32 entity = 0;
+    Texture *texture = NULL;
+    SDL_Rect clip,rect;
+
+    while (entities->currentEntityToDraw < entities->numEntities
+           && entities->entityList[entities->currentEntityToDraw].row <= row) {
+        entity = entities->entityList[entities->currentEntityToDraw].entityID;
+        //when only a part of the screen is drawn, the entities outside it are skipped
+        if (drawRect != NULL && getEntityImage(entity,&texture,&clip)) {
+            getEntityScreenRect(entity,&clip,&rect);
+            if (!SDL_HasIntersection(&rect,drawRect)) {
+                entities->currentEntityToDraw++;
+                continue;
+            }
+        }
+        systemRenderIsometricObject(entity);
+        numEntitiesDrawnLastFrame++;
+        //go to the next entity in the sorted list
+        entities->currentEntityToDraw++;
+    }
+}
+
+//draws the minimap in the top right corner of the screen, with a marker at the tile the camera is centered on
+static void drawMinimapWidget() {
+    SDL_FPoint corners[4];
+    SDL_FRect marker;
+    SDL_Color white = {0xff,0xff,0xff,0xff};
+    float mapWidth = isoEngine->isoMap->mapWidth;
+    float mapHeight = isoEngine->isoMap->mapHeight;
+    //number of pixels the minimap moves for every tile along the edges of the map
+    float tileStep = (float)MINIMAP_WIDGET_WIDTH/(mapWidth+mapHeight);
+    float left = WINDOW_WIDTH - MINIMAP_WIDGET_WIDTH - MINIMAP_WIDGET_MARGIN;
+    float top = MINIMAP_WIDGET_MARGIN;
+    float tileX = isoEngine->tilePos.x/isoEngine->isoMap->tileSize;
+    float tileY = isoEngine->tilePos.y/isoEngine->isoMap->tileSize;
+
+    corners[0].x = left + mapHeight*tileStep;
+    corners[0].y = top;
+    corners[1].x = corners[0].x + mapWidth*tileStep;
+    corners[1].y = top + mapWidth*tileStep*0.5f;
+    corners[2].x = corners[0].x + (mapWidth-mapHeight)*tileStep;
+    corners[2].y = top + (mapWidth+mapHeight)*tileStep*0.5f;
+    corners[3].x = left;
+    corners[3].y = top + mapHeight*tileStep*0.5f;
+    isoMinimapDraw(isoEngine->minimap,isoEngine->isoMap,isoMinimapGetLevelForScale(isoEngine->minimap,tileStep),corners);
+
+    marker.x = corners[0].x + (tileX-tileY)*tileStep - 2;
+    marker.y = top + (tileX+tileY)*tileStep*0.5f - 2;
+    marker.w = 5;
+    marker.h = 5;
+    RenderQueue_FillRect(&marker,white);
+}
+
+//draws the map and the entities on it. When rect is not NULL, only the tiles and entities that are in that rectangle
+//of the screen are drawn, and the pre-drawn chunks are not used
+static void drawWorld(SDL_Rect *rect) {
+    int layer;
+    int row,column;
+    int firstRow,lastRow,firstColumn,lastColumn;
     int x,y;
+    int screenX,screenY;
     int tile = 4;
+    int hasRows = 0, hasColumns = 0;
+
+    drawRect = rect;
+    //every layer starts from the top of its sorted list
+    for (layer = 0; layer < isoEngine->isoMap->numLayers; ++layer) {
+        entitiesOnScreen[layer].currentEntityToDraw = 0;
+    }
+
+    //if the camera is zoomed out, draw the map from the minimap instead of tile by tile
+    if (isoEngine->minimap != NULL && isoEngine->zoomLevel < 1.0) {
+        drawMapFromMinimap();
+    }
+    //if the map has a tile-set assigned to it
+    else if (isoEngine->isoMap->tileSet != NULL) {
+        //loop through the layers of the map
+        for (layer=0;layer<isoEngine->isoMap->numLayers; ++layer) {
+            //if there are no entities on the layer, the tiles do not have to be drawn row by row
+            //in between the entities, so the layer is drawn with the pre-drawn chunks
+            if (rect == NULL && chunkCache != NULL && entitiesOnScreen[layer].numEntities == 0) {
+                numChunksDrawnLastFrame += isoChunkCacheDrawLayer(chunkCache,isoEngine,layer);
+                continue;
+            }
+            //only the tiles that are on the screen are visited, one diagonal row at a time
+            hasRows = rect == NULL ? IsoEngine_GetVisibleRows(isoEngine,&firstRow,&lastRow)
+                                   : IsoEngine_GetRowsInRect(isoEngine,rect,&firstRow,&lastRow);
+            if (hasRows) {
+                for (row = firstRow; row <= lastRow; ++row) {
+                    //draw the entities standing on the row before its tiles
+                    drawEntitiesUpToRow(layer,row);
+
+                    hasColumns = rect == NULL ? IsoEngine_GetVisibleRowColumns(isoEngine,row,&firstColumn,&lastColumn)
+                                              : IsoEngine_GetRowColumnsInRect(isoEngine,row,rect,&firstColumn,&lastColumn);
+                    if (!hasColumns) {
+                        continue;
+                    }
+                    for (column = firstColumn; column <= lastColumn; column += 2) {
+                        //get the x & y tile coordinates for the tile on the map
+                        x = (row+column)/2;
+                        y = (row-column)/2;
+                        numTilesVisitedLastFrame++;
+
+                        tile = isoMapGetTile(isoEngine->isoMap,x,y,layer);
+                        //if the tile is valid
+                        if (tile >= 0) {
+                            IsoEngine_GetTileScreenPos(isoEngine,row,column,&screenX,&screenY);
+                            Texture_RenderXYClipScale(isoEngine->isoMap->tileSet->tilesTex,screenX,screenY,
+                                             &isoEngine->isoMap->tileSet->tileClipRects[tile],isoEngine->zoomLevel);
+                            numTilesDrawnLastFrame++;
+                        }
+                    }
+                }
+            }
+            //draw the entities standing below the last row on the screen
+            drawEntitiesUpToRow(layer,INT_MAX);
+        }
+    }
+    drawRect = NULL;
+}
+
+//draws the world into the back buffer and the back buffer on the screen. All of the world is drawn when fullRedraw
+//is 1, when the camera has moved or when the back buffer has not been drawn yet. Else only the rectangles of the
+//screen where the sprites have changed since the last frame are drawn again
+static void drawWorldPartial(int fullRedraw) {
+    SDL_Rect screen = {0,0,WINDOW_WIDTH,WINDOW_HEIGHT};
+    SDL_FRect background;
+    SDL_Color backgroundColor = {0x3b,0x3b,0x3b,0xff};
+    SDL_Color white = {0xff,0xff,0xff,0xff};
+    int i = 0;
+
+    //the sprites are compared with the last frame every frame, so the list is up to date when the camera stops
+    numDirtyRects = 0;
+    if (updateDrawnSprites() == 0) {
+        fullRedraw = 1;
+    }
+    //the map is drawn from the minimap when zoomed out, and its changes are only known from the chunk cache
+    if (!backBufferValid || chunkCache == NULL || isoEngine->zoomLevel < 1.0 || isoEngine->zoomLevel != lastDrawZoomLevel
+        || isoEngine->scrollX != lastDrawScrollX || isoEngine->scrollY != lastDrawScrollY) {
+        fullRedraw = 1;
+    }
+    lastDrawZoomLevel = isoEngine->zoomLevel;
+    lastDrawScrollX = isoEngine->scrollX;
+    lastDrawScrollY = isoEngine->scrollY;
+
+    RenderQueue_SetTarget(backBuffer);
+    if (fullRedraw) {
+        RenderQueue_Clear(0x3b,0x3b,0x3b,0xff);
+        drawWorld(NULL);
+        numDirtyRectsLastFrame = 1;
+        dirtyAreaLastFrame = WINDOW_WIDTH*WINDOW_HEIGHT;
+    }
+    else {
+        dirtyAreaLastFrame = 0;
+        for (i = 0; i < numDirtyRects; ++i) {
+            //clear the rectangle and draw everything in it again, clipped to the rectangle
+            RenderQueue_SetClipRect(&dirtyRects[i]);
+            background.x = dirtyRects[i].x;
+            background.y = dirtyRects[i].y;
+            background.w = dirtyRects[i].w;
+            background.h = dirtyRects[i].h;
+            RenderQueue_FillRect(&background,backgroundColor);
+            drawWorld(&dirtyRects[i]);
+            dirtyAreaLastFrame += dirtyRects[i].w*dirtyRects[i].h;
+        }
+        RenderQueue_SetClipRect(NULL);
+        numDirtyRectsLastFrame = numDirtyRects;
+    }
+    RenderQueue_SetTarget(NULL);
+    backBufferValid = 1;
+
+    RenderQueue_AddSprite(backBuffer,WINDOW_WIDTH,WINDOW_HEIGHT,&screen,&screen,white);
+}
+
+//finds the sprites that are on the screen this frame, and marks the screen as changed where a sprite has moved,
+//changed image, come onto the screen or gone from it since the last frame. Returns 0 on error
+static int updateDrawnSprites() {
+    DrawnSprite *newSprites = NULL;
+    DrawnSprite *tmpSprites = NULL;
+    Uint32 *newIndex = NULL, *newStamp = NULL;
+    DrawnSprite *sprite = NULL, *lastSprite = NULL;
+    Uint32 numSprites = 0, maxEntityID = 0;
+    Uint32 entity = 0;
+    Uint32 i = 0;
+    int layer = 0;
+
+    //make room for all the entities on the screen, and for their IDs in the lookup
+    for (layer = 0; layer < isoEngine->isoMap->numLayers; ++layer) {
+        numSprites += entitiesOnScreen[layer].numEntities;
+        for (i = 0; i < entitiesOnScreen[layer].numEntities; ++i) {
+            if (entitiesOnScreen[layer].entityList[i].entityID > maxEntityID) {
+                maxEntityID = entitiesOnScreen[layer].entityList[i].entityID;
+            }
+        }
+    }
+    if (numSprites > maxDrawnSprites) {
+        newSprites = realloc(drawnSprites,sizeof(struct DrawnSprite)*numSprites*2);
+        if (newSprites == NULL) {
+            WriteError("Could not allocate memory for %u drawn sprites!",numSprites*2);
+            return 0;
+        }
+        drawnSprites = newSprites;
+        newSprites = realloc(lastDrawnSprites,sizeof(struct DrawnSprite)*numSprites*2);
+        if (newSprites == NULL) {
+            WriteError("Could not allocate memory for %u drawn sprites!",numSprites*2);
+            return 0;
+        }
+        lastDrawnSprites = newSprites;
+        maxDrawnSprites = numSprites*2;
+    }
+    if (numSprites > 0 && maxEntityID >= maxDrawnEntityIDs) {
+        newIndex = realloc(drawnIndexOfEntity,sizeof(Uint32)*(maxEntityID+1)*2);
+        if (newIndex == NULL) {
+            WriteError("Could not allocate memory for %u drawn entity IDs!",(maxEntityID+1)*2);
+            return 0;
+        }
+        drawnIndexOfEntity = newIndex;
+        newStamp = realloc(drawnStampOfEntity,sizeof(Uint32)*(maxEntityID+1)*2);
+        if (newStamp == NULL) {
+            WriteError("Could not allocate memory for %u drawn entity IDs!",(maxEntityID+1)*2);
+            return 0;
+        }
+        drawnStampOfEntity = newStamp;
+        for (i = maxDrawnEntityIDs; i < (maxEntityID+1)*2; ++i) {
+            drawnStampOfEntity[i] = 0;
+        }
+        maxDrawnEntityIDs = (maxEntityID+1)*2;
+    }
+
+    //compare every sprite with where the entity was drawn in the last frame
+    numDrawnSprites = 0;
+    for (layer = 0; layer < isoEngine->isoMap->numLayers; ++layer) {
+        for (i = 0; i < entitiesOnScreen[layer].numEntities; ++i) {
+            entity = entitiesOnScreen[layer].entityList[i].entityID;
+            sprite = &drawnSprites[numDrawnSprites];
+            if (!getEntityImage(entity,&sprite->texture,&sprite->clip)) {
+                continue;
+            }
+            sprite->entityID = entity;
+            sprite->matched = 0;
+            getEntityScreenRect(entity,&sprite->clip,&sprite->rect);
+            numDrawnSprites++;
+
+            lastSprite = NULL;
+            if (drawnStampOfEntity[entity] == drawStamp && drawStamp != 0) {
+                lastSprite = &lastDrawnSprites[drawnIndexOfEntity[entity]];
+                lastSprite->matched = 1;
+                if (lastSprite->texture == sprite->texture && SDL_RectEquals(&lastSprite->rect,&sprite->rect)
+                    && SDL_RectEquals(&lastSprite->clip,&sprite->clip)) {
+                    continue;
+                }
+                addDirtyRect(&lastSprite->rect);
+            }
+            addDirtyRect(&sprite->rect);
+        }
+    }
+    //the sprites that are not drawn anymore leave a hole where they were
+    for (i = 0; i < numLastDrawnSprites; ++i) {
+        if (!lastDrawnSprites[i].matched) {
+            addDirtyRect(&lastDrawnSprites[i].rect);
+        }
+    }
+
+    //this frame's sprites are the last frame's sprites in the next frame. The stamp changes every frame,
+    //so the lookup never has to be cleared
+    drawStamp++;
+    if (drawStamp == 0) {
+        memset(drawnStampOfEntity,0,sizeof(Uint32)*maxDrawnEntityIDs);
+        drawStamp = 1;
+    }
+    for (i = 0; i < numDrawnSprites; ++i) {
+        drawnIndexOfEntity[drawnSprites[i].entityID] = i;
+        drawnStampOfEntity[drawnSprites[i].entityID] = drawStamp;
+    }
+    tmpSprites = lastDrawnSprites;
+    lastDrawnSprites = drawnSprites;
+    drawnSprites = tmpSprites;
+    numLastDrawnSprites = numDrawnSprites;
+    return 1;
+}
+
+//adds a rectangle of the screen that has to be drawn again. Rectangles that overlap are merged, and when there are
+//too many rectangles, it is merged into the rectangle that grows the least from it
+static void addDirtyRect(SDL_Rect *rect) {
+    SDL_Rect screen = {0,0,WINDOW_WIDTH,WINDOW_HEIGHT};
+    SDL_Rect newRect,merged;
+    int i = 0, best = 0;
+    int growth = 0, bestGrowth = INT_MAX;
+
+    if (!SDL_IntersectRect(rect,&screen,&newRect)) {
+        return;
+    }
+    //merge the overlapping rectangles into the new one. The merged rectangle can overlap rectangles that were
+    //already looked at, so it starts over
+    i = 0;
+    while (i < numDirtyRects) {
+        if (SDL_HasIntersection(&dirtyRects[i],&newRect)) {
+            SDL_UnionRect(&dirtyRects[i],&newRect,&newRect);
+            dirtyRects[i] = dirtyRects[--numDirtyRects];
+            i = 0;
+            continue;
+        }
+        i++;
+    }
+    if (numDirtyRects < MAX_DIRTY_RECTS) {
+        dirtyRects[numDirtyRects++] = newRect;
+        return;
+    }
+    for (i = 0; i < numDirtyRects; ++i) {
+        SDL_UnionRect(&dirtyRects[i],&newRect,&merged);
+        growth = merged.w*merged.h - dirtyRects[i].w*dirtyRects[i].h;
+        if (growth < bestGrowth) {
+            bestGrowth = growth;
+            best = i;
+        }
+    }
+    SDL_UnionRect(&dirtyRects[best],&newRect,&dirtyRects[best]);
+}
+
+void SystemRenderIsoMetricWorld_Compute() {
+    int layer;
     int controlledEntity;
-    int oldRowY = -1;
-    int tempVar = 0;
+    int fullSort = 0;
+    int numChangedChunks = 0;
+    int entitiesRemoved = 0;
+    Uint64 sortTimer = 0;
+    float margin = 0;
+    SDL_FPoint corners[4];
+    SDL_FPoint worldMin,worldMax;
+    int i = 0;
 
-    SDL_FPoint point,currentRow;
     SDL_FPoint entityPos,entitySize;
 
     //if the system has failed to initialize
@@ -317,98 +862,76 @@ void SystemRenderIsoMetricWorld_Compute() {
         }
     }
 
-    SDL_SetRenderDrawColor(getRenderer(),0x3b,0x3b,0x3b,0x00);
-    SDL_RenderClear(getRenderer());
-
-    //initialize the current row
-    currentRow.y = 0;
-    currentRow.x = 0;
-
-    //calculate the start position on the map to pick tiles from
-    int startX = -6/isoEngine->zoomLevel +(isoEngine->mapScroll2Dpos.x/isoEngine->zoomLevel/isoEngine->isoMap->tileSize)*2;
-    int startY = -20/isoEngine->zoomLevel + fabsf((isoEngine->mapScroll2Dpos.y/isoEngine->zoomLevel/isoEngine->isoMap->tileSize))*2;
-
-    //calculate number of tiles in width and height that fit on the screen
-    int numTilesInWidth = 8+ ((WINDOW_WIDTH/isoEngine->isoMap->tileSize)/isoEngine->zoomLevel);
-    //NOTE: INCREASED 26+ -> 28+ TO MAKE SURE THAT THE TREES ARE NOT CLIPPED AT THE BOTTOM THE TREE ON SCREEN
-    int numTilesInHeight = 28+ ((WINDOW_HEIGHT/isoEngine->isoMap->tileSize)/isoEngine->zoomLevel)*2;
-
-    //precalculate zoomLevel * tileSize, which gives us 2 less multiplications for each tile in the loop
-    float zoomLevelTileSizePreCalc = isoEngine->zoomLevel *isoEngine->isoMap->tileSize;
-
-    //if the map has a tile-set assigned to it
-    if (isoEngine->isoMap->tileSet != NULL) {
-        //loop through the layers of the map
-        for (layer=0;layer<isoEngine->isoMap->numLayers; ++layer) {
-            //loop through the height
-            for (i=startY;i < startY+numTilesInHeight; ++i) {
-                //loop through the width
-                for (j=startX;j < startX+numTilesInWidth; ++j) {
-
-                    //only draw when both x & y is equal, if they are not, skip to the next tile
-                    if ((j&1) != (i&1)) {
-                        continue;
-                    }
-                    //get the x & y tile coordinates for the tile on the map
-                    x = (i+j)/2;
-                    y = (i-j)/2;
-
-                    //get the tile from the map
-                    //the isoMapGetTile function also checks that the tile is within the map
-                    tile = isoMapGetTile(isoEngine->isoMap,x,y,layer);
-
-                //DRAW ENTITIES HERE
-                    //get the x & y point
-                    point.x = ((x*zoomLevelTileSizePreCalc));
-                    point.y = ((y*zoomLevelTileSizePreCalc));
-
-                    //get current row we are drawing on
-                    IsoEngine_ConvertIsoPoint2DToCartesian(isoEngine,&point,&currentRow);
-
-                    //if the map is drawing on a new row
-                    if (oldRowY!=(int)currentRow.y) {
-                        //update the old row value to the new
-                        oldRowY = (int)currentRow.y;
-
-                        //if there are any entities to draw on this layer
-                        if (entitiesOnScreen[layer].numEntities>0) {
-                            //as long as there are entities to draw on this row
-                            while (entitiesOnScreen[layer].entityList[entitiesOnScreen[layer].currentEntityToDraw].row == (int)currentRow.y/(isoEngine->isoMap->tileSize/2)) {
-                                //if all entities has been drawn
-                                if (entitiesOnScreen[layer].currentEntityToDraw >= entitiesOnScreen[layer].numEntities) {
-                                    //break out of the loop
-                                    break;
-                                }
-                                //render the entity
-                                systemRenderIsometricObject(entitiesOnScreen[layer].entityList[entitiesOnScreen[layer].currentEntityToDraw].entityID);
-                                //go to the next entity in the sorted list
-                                entitiesOnScreen[layer].currentEntityToDraw++;
-                                //uncomment to update number of entities that has been drawn this frame
-                                numEntitiesDrawnLastFrame++;
-                            }
-                        }
-                    }
-
-                    //if the tile is valid
-                    if (tile >= 0) {
-
-                        point.x = ((x*zoomLevelTileSizePreCalc) + isoEngine->scrollX);
-                        point.y = ((y*zoomLevelTileSizePreCalc) + isoEngine->scrollY);
-
-                        IsoEngine_Convert2DToIso(&point);
-
-                        //only draw the tile if it's visible on screen
-                        if (point.x + isoEngine->isoMap->tileSize*isoEngine->zoomLevel >=-128 && point.x < WINDOW_WIDTH
-                        && point.y + isoEngine->isoMap->tileSize*isoEngine->zoomLevel >=-128 && point.y < WINDOW_HEIGHT)
-                        {
-                            Texture_RenderXYClipScale(isoEngine->isoMap->tileSet->tilesTex,(int)point.x,(int)point.y,
-                                             &isoEngine->isoMap->tileSet->tileClipRects[tile],isoEngine->zoomLevel);
-                        }
-                    }
-                }
-            }
+    //the entity IDs have moved when entities were removed from the scene, so they are filed again
+    entitiesRemoved = scn->numEntities < numSceneEntitiesLastFrame;
+    if (entitiesRemoved) {
+        SpatialGrid_Clear(spatialGrid);
+        maxSpriteExtent = 0;
+    }
+    numSceneEntitiesLastFrame = scn->numEntities;
+
+    //collect the entities on the screen. The screen, grown by the largest sprite on every side, is converted to
+    //a rectangle in the world, and only the entities in the grid cells under it are tested against the screen.
+    //The extra tile covers the entities that have moved since they were filed
+    margin = maxSpriteExtent*isoEngine->zoomLevel;
+    screenToWorld(-margin,-margin,&corners[0]);
+    screenToWorld(WINDOW_WIDTH+margin,-margin,&corners[1]);
+    screenToWorld(WINDOW_WIDTH+margin,WINDOW_HEIGHT+margin,&corners[2]);
+    screenToWorld(-margin,WINDOW_HEIGHT+margin,&corners[3]);
+    worldMin = corners[0];
+    worldMax = corners[0];
+    for (i = 1; i < 4; ++i) {
+        worldMin.x = corners[i].x < worldMin.x ? corners[i].x : worldMin.x;
+        worldMin.y = corners[i].y < worldMin.y ? corners[i].y : worldMin.y;
+        worldMax.x = corners[i].x > worldMax.x ? corners[i].x : worldMax.x;
+        worldMax.y = corners[i].y > worldMax.y ? corners[i].y : worldMax.y;
+    }
+    //the sorted list is kept until the next frame is drawn, since the collision system is using it
+    for (layer=0;layer<isoEngine->isoMap->numLayers; ++layer) {
+        entitiesOnScreen[layer].numCollected = 0;
+    }
+    numEntitiesDrawnLastFrame = 0;
+    numCandidatesLastFrame = SpatialGrid_Query(spatialGrid,worldMin.x-isoEngine->isoMap->tileSize,worldMin.y-isoEngine->isoMap->tileSize,
+                                               worldMax.x+isoEngine->isoMap->tileSize,worldMax.y+isoEngine->isoMap->tileSize,collectEntity);
+
+    //sort the entities that were found on the screen since the last frame. Most entities only move a little
+    //every frame, so last frame's order is fixed up, unless the camera has zoomed or jumped to another place
+    sortTimer = SDL_GetPerformanceCounter();
+    numFullSortsLastFrame = 0;
+    fullSort = isoEngine->zoomLevel != lastSortZoomLevel
+               || abs(isoEngine->scrollX - lastSortScrollX) > WINDOW_WIDTH/2
+               || abs(isoEngine->scrollY - lastSortScrollY) > WINDOW_HEIGHT/2;
+    for (layer=0;layer<isoEngine->isoMap->numLayers; ++layer) {
+        if (fullSort || coherentSortOnScreenEntities(&entitiesOnScreen[layer]) == 0) {
+            sortOnScreenEntities(&entitiesOnScreen[layer]);
+            numFullSortsLastFrame++;
         }
     }
+    lastSortZoomLevel = isoEngine->zoomLevel;
+    lastSortScrollX = isoEngine->scrollX;
+    lastSortScrollY = isoEngine->scrollY;
+    sortTimeLastFrame = (double)(SDL_GetPerformanceCounter()-sortTimer)*1000.0/SDL_GetPerformanceFrequency();
+
+    //catch the minimap and the chunk cache up with the chunks that have changed
+    isoMinimapUpdate(isoEngine->minimap,isoEngine->isoMap);
+    numChangedChunks = isoChunkCacheBeginFrame(chunkCache,isoEngine);
+    numChunksDrawnLastFrame = 0;
+    numTilesVisitedLastFrame = 0;
+    numTilesDrawnLastFrame = 0;
+
+    //if partial redraw is on and the back buffer could be created, only the parts of the world that changed are drawn
+    if (isoEngine->partialRedraw && (backBuffer != NULL
+        || (backBuffer = RenderQueue_CreateTexture(SDL_PIXELFORMAT_ARGB8888,SDL_TEXTUREACCESS_TARGET,
+                                                   WINDOW_WIDTH,WINDOW_HEIGHT,SDL_BLENDMODE_NONE)) != NULL)) {
+        drawWorldPartial(numChangedChunks > 0 || entitiesRemoved);
+    }
+    else {
+        backBufferValid = 0;
+        numDirtyRectsLastFrame = 0;
+        dirtyAreaLastFrame = 0;
+        RenderQueue_Clear(0x3b,0x3b,0x3b,0x00);
+        drawWorld(NULL);
+    }
 
     if (Timer_Update(&colorCycle) == 1) {
         r = rand()%255;
@@ -439,13 +962,18 @@ void SystemRenderIsoMetricWorld_Compute() {
     BitmapFontStringScaleColor(gothicFont,"Offset 1x times to create a shadowed text",0,414,0.50,FontPool_GetColor(r,g,b));
 #endif
 
+    if (isoEngine->minimap != NULL && isoEngine->showMinimap == 1) {
+        drawMinimapWidget();
+    }
+
     IsoEngine_DrawIsoMouse(isoEngine);
 
     if (isoEngine->lastTileClicked!=-1) {
         Texture_RenderXYClip(isoEngine->isoMap->tileSet->tilesTex,0,0,
                             &isoEngine->isoMap->tileSet->tileClipRects[isoEngine->lastTileClicked]);
     }
-    SDL_RenderPresent(getRenderer());
+    //the frame is presented by the game loop once it has let go of the scene, these are the stats of the frame before
+    RenderQueue_GetStats(&numCommandsLastFrame,&numBatchesLastFrame,&numQuadsLastFrame);
 
 
    fpsFrames++;
@@ -458,7 +986,15 @@ void SystemRenderIsoMetricWorld_Compute() {
         // A modifier (à afficher dans l'interface)
 
         WriteDebug("FPS:%d",fpsFrames);
-        WriteDebug("Drew %d Entities last frame",numEntitiesDrawnLastFrame);
+        WriteDebug("Drew %d Entities last frame, %d of %d entities in the spatial grid were tested against the screen",
+                   numEntitiesDrawnLastFrame,numCandidatesLastFrame,spatialGrid->numEntities);
+        WriteDebug("Sorted the entities in %.3f ms last frame, %d layers from scratch",sortTimeLastFrame,numFullSortsLastFrame);
+        WriteDebug("Drew %d chunk textures last frame",numChunksDrawnLastFrame);
+        WriteDebug("Visited %d tiles and drew %d of them last frame",numTilesVisitedLastFrame,numTilesDrawnLastFrame);
+        WriteDebug("Drew %d render commands in %d sprite batches with %d quads last frame",numCommandsLastFrame,numBatchesLastFrame,numQuadsLastFrame);
+        if (isoEngine->partialRedraw) {
+            WriteDebug("Drew %d rectangles with %d pixels again last frame",numDirtyRectsLastFrame,dirtyAreaLastFrame);
+        }
 
         // ----------------------------------------------------------------
 
@@ -466,15 +1002,10 @@ void SystemRenderIsoMetricWorld_Compute() {
    }
 }
 
-void SystemRenderIsoMetricWorld_SortEntity(Uint32 entity) {
-    SDL_FPoint point,tmpPoint;
-    EntityOnScreenPos newEntity;
-    EntityOnScreenPos *newEntityList = NULL;
-    Uint32 i = 0;
-    int layer = render2DComponents[entity].layer;
-    int onScreen = 0;
-    Animation *currAnim = NULL;
-    SDL_Rect animRect;
+//files the entities that are drawn in the spatial grid by their world position. Entities without a velocity
+//component do not move, so they are only filed the first time they are seen
+void SystemRenderIsoMetricWorld_UpdateEntity(Uint32 entity) {
+    float extent = 0;
 
     //if the system has failed to initialize
     if (systemFailedToInitialize==1) {
@@ -482,16 +1013,66 @@ void SystemRenderIsoMetricWorld_SortEntity(Uint32 entity) {
         return;
     }
 
-    //if it's the first entity
-    if (entity == 0) {
-        //reset entity list
-        for (i = 0; i < (Uint32)isoEngine->isoMap->numLayers; ++i) {
-            numEntitiesDrawnLastFrame=0;
-            entitiesOnScreen[i].numEntitiesLastRender = entitiesOnScreen[i].numEntities;
-            entitiesOnScreen[i].numEntities = 0;
-            entitiesOnScreen[i].currentEntityToDraw = 0;
+    //if the entity has a position and a render2D component
+    //or a position and an animation component)
+    if (scn->entities[entity].componentSet1 & SYSTEM_RENDER_ISO_MASK_SET1
+    || scn->entities[entity].componentSet1 & SYSTEM_RENDER_ISO_ANIM_MASK_SET1) {
+        if (SpatialGrid_Contains(spatialGrid,entity)) {
+            if (!(scn->entities[entity].componentSet1 & COMPONENT_SET1_VELOCITY)) {
+                return;
+            }
         }
+        //the screen is searched as far out as the largest sprite reaches
+        else {
+            extent = getEntitySpriteExtent(entity);
+            if (extent > maxSpriteExtent) {
+                maxSpriteExtent = extent;
+            }
+        }
+        SpatialGrid_Update(spatialGrid,entity,posComponents[entity].x,posComponents[entity].y);
+    }
+}
+
+//returns how far the sprite of the entity reaches from the position of the entity on the screen, at zoom level 1.0
+static float getEntitySpriteExtent(Uint32 entity) {
+    Animation *anim = NULL;
+    int w = 0, h = 0;
+    int i = 0, j = 0;
+
+    if (scn->entities[entity].componentSet1 & COMPONENT_SET1_ANIMATION) {
+        //the largest frame of all the animations
+        for (i = 0; i < animComponents[entity].numAnimations; ++i) {
+            anim = &animComponents[entity].animations[i];
+            for (j = 0; j < anim->numFrames; ++j) {
+                w = anim->frames[j].clipRect.w > w ? anim->frames[j].clipRect.w : w;
+                h = anim->frames[j].clipRect.h > h ? anim->frames[j].clipRect.h : h;
+            }
+        }
+    }
+    else if (render2DComponents[entity].texture != NULL) {
+        w = render2DComponents[entity].texture->width;
+        h = render2DComponents[entity].texture->height;
     }
+    return (w > h ? w : h) + fabsf(posComponents[entity].xOffset) + fabsf(posComponents[entity].yOffset);
+}
+
+//converts a point on the screen to a position in the world, the inverse of how the entities are put on the screen
+static void screenToWorld(float screenX,float screenY,SDL_FPoint *worldPoint) {
+    worldPoint->x = (screenY + screenX*0.5f - isoEngine->scrollX)/isoEngine->zoomLevel;
+    worldPoint->y = (screenY - screenX*0.5f - isoEngine->scrollY)/isoEngine->zoomLevel;
+}
+
+//adds the entity to the collected entities of its layer if it is on the screen.
+//Called for the entities found in the grid cells under the screen
+static void collectEntity(Uint32 entity) {
+    SDL_FPoint point,tmpPoint;
+    EntityOnScreenPos newEntity;
+    EntityOnScreenPos *newEntityList = NULL;
+    int layer = render2DComponents[entity].layer;
+    int onScreen = 0;
+    Animation *currAnim = NULL;
+    SDL_Rect animRect;
+
     //if the entity has a position and a render2D component
     //or a position and an animation component)
     if (scn->entities[entity].componentSet1 & SYSTEM_RENDER_ISO_MASK_SET1
@@ -546,142 +1127,240 @@ void SystemRenderIsoMetricWorld_SortEntity(Uint32 entity) {
             //store the entity y position (its height on screen)
             newEntity.cartesianYPos = tmpPoint.y;
         //Step 2: Store the entity tile height
-            //Get the tile position for the entity
-            tmpPoint.y = posComponents[entity].y/(isoEngine->isoMap->tileSize*0.5);   //*0.5 is the same as /2
-            tmpPoint.x = posComponents[entity].x/(isoEngine->isoMap->tileSize*0.5);   //*0.5 is the same as /2
-            //convert the point so we can track its row in the isometric world
-            IsoEngine_ConvertIsoPoint2DToCartesian(isoEngine,&tmpPoint,&tmpPoint);
-            //Store the row for the entity, make sure to multiply with the zoom level
-            //so it will work when the game screen is zoomed in too
-            newEntity.row = (int)tmpPoint.y*isoEngine->zoomLevel;
+            //Store the diagonal row (x+y in tiles) the entity is standing on, the same row numbers the map is
+            //drawn with, so it does not depend on the zoom level
+            newEntity.row = (int)floorf((posComponents[entity].x + posComponents[entity].y)/isoEngine->isoMap->tileSize);
         //step 3: Store the entity ID
             newEntity.entityID = entity;
         //Step 4: Allocate more memory if needed
-            //To make sure we never write outside the allocated memory, we add another 1000 entities
-            //whenever the number of entities is half of the max entities.
-            //memmove inside of insertionSortOnScreenEntities() is moving entities forward in memory
-            if (entitiesOnScreen[layer].numEntities >=entitiesOnScreen[layer].maxEntities/2) {
-                entitiesOnScreen[layer].maxEntities+=1000;
-                newEntityList = realloc(entitiesOnScreen[layer].entityList,sizeof(struct EntityOnScreenPos)*entitiesOnScreen[layer].maxEntities);
-                //if memory allocation failed
+            if (layer < 0 || layer >= isoEngine->isoMap->numLayers) {
+                return;
+            }
+            //double the size of the lists when they are full, so they stop growing once the
+            //number of entities on the screen settles
+            if (entitiesOnScreen[layer].numCollected >= entitiesOnScreen[layer].maxEntities) {
+                newEntityList = realloc(entitiesOnScreen[layer].collectedList,sizeof(struct EntityOnScreenPos)*entitiesOnScreen[layer].maxEntities*2);
                 if (newEntityList == NULL) {
-                    //roll back number of entities
-                    entitiesOnScreen[layer].maxEntities-=1000;
-                    //Log error here if you want
-                    //fprintf(stderr,"Error in....");
-                    //return out of the function
+                    WriteError("Could not allocate memory for more entities on screen on layer %d!",layer);
                     return;
                 }
-                //if memory allocation was ok
-                else {
-                    //point the entity list to the new memory
-                    entitiesOnScreen[layer].entityList = newEntityList;
-                    //initialize the entities
-                    for (i=entitiesOnScreen[layer].numEntities;i < entitiesOnScreen[layer].maxEntities; ++i) {
-                        entitiesOnScreen[layer].entityList[i].cartesianYPos = 0;
-                        entitiesOnScreen[layer].entityList[i].entityID = 0;
-                        entitiesOnScreen[layer].entityList[i].row = -1;
-                    }
+                entitiesOnScreen[layer].collectedList = newEntityList;
+                newEntityList = realloc(entitiesOnScreen[layer].entityList,sizeof(struct EntityOnScreenPos)*entitiesOnScreen[layer].maxEntities*2);
+                if (newEntityList == NULL) {
+                    WriteError("Could not allocate memory for more entities on screen on layer %d!",layer);
+                    return;
                 }
+                entitiesOnScreen[layer].entityList = newEntityList;
+                entitiesOnScreen[layer].maxEntities *= 2;
             }
-        //Step 5: Perform binary insert sort for the entity to the entities list
-            if (render2DComponents[entity].layer>=0) {
-                insertionSortOnScreenEntities(entitiesOnScreen,layer,&newEntity);
-            }
+        //Step 5: Add the entity to the collected entities, they are sorted before the next frame is drawn
+            entitiesOnScreen[layer].collectedList[entitiesOnScreen[layer].numCollected] = newEntity;
+            entitiesOnScreen[layer].numCollected++;
         }
     }
 }
 
-static void insertionSortOnScreenEntities(EntitiesOnScreen *entities,int layer,EntityOnScreenPos *entity) {
-    //if there are no entities in the array
-    if (entities[layer].numEntities==0) {
-        //insert the entity to index 0
-        entities[layer].entityList[0] = *entity;
-        //increase counter for number of entities in the array
-        entities[layer].numEntities+=1;
-        //return out of the function
-        return;
+//sorts the collected entities into the entity list. The entities are bucketed by row with a counting sort,
+//and the few entities in every row are then insertion sorted by their height. Returns -1 on error
+static int sortOnScreenEntities(EntitiesOnScreen *entities) {
+    Uint32 *newRowCounts = NULL;
+    EntityOnScreenPos entity;
+    int minRow = 0, maxRow = 0;
+    Uint32 numRows = 0;
+    Uint32 i = 0, j = 0;
+    Uint32 rowStart = 0, rowEnd = 0, count = 0;
+
+    entities->numEntities = 0;
+    entities->currentEntityToDraw = 0;
+    entities->numEntitiesLastRender = 0;
+    if (entities->numCollected == 0) {
+        return 0;
     }
-    //Get the index where the next entity should be inserted
-    int insertIndex = binarySearchFindOnScreenEntityInsertIndex(entities,layer,entity);
-    if (insertIndex!=-1) {
 
-        //If it's the first index
-        if (insertIndex==0) {
-            //move everything one step forward in the entities array
-            memmove(entities[layer].entityList+1,entities[layer].entityList,sizeof(EntityOnScreenPos)*entities[layer].numEntities+1);
-        } else{
-            //move everything from the insertIndex forward
-            memmove(entities[layer].entityList+insertIndex,entities[layer].entityList+insertIndex-1,sizeof(EntityOnScreenPos)*entities[layer].numEntities+1);
+    //find the rows the entities are standing on
+    minRow = entities->collectedList[0].row;
+    maxRow = minRow;
+    for (i = 1; i < entities->numCollected; ++i) {
+        if (entities->collectedList[i].row < minRow) {
+            minRow = entities->collectedList[i].row;
+        } else if (entities->collectedList[i].row > maxRow) {
+            maxRow = entities->collectedList[i].row;
         }
-        //write the entity at the insert index in the array
-        entities[layer].entityList[insertIndex] = *entity;
-        entities[layer].numEntities++;
     }
-}
+    //one extra count for the end of the last row
+    numRows = (Uint32)(maxRow - minRow) + 2;
+    if (numRows > entities->maxRows) {
+        newRowCounts = realloc(entities->rowCounts,sizeof(Uint32)*numRows);
+        if (newRowCounts == NULL) {
+            WriteError("Could not allocate memory for %u rows of entities!",numRows);
+            return -1;
+        }
+        entities->rowCounts = newRowCounts;
+        entities->maxRows = numRows;
+    }
 
-static int binarySearchFindOnScreenEntityInsertIndex(EntitiesOnScreen *entities,int layer,EntityOnScreenPos *entity) {
-    int first = 0;                      //initialize the first index to 0
-    int last = entities[layer].numEntities-1; //initialize the last index to the number of entities in the entities list
-    int search = (first+last)/2;        //initialize the first search position to the middle of the entities list
-
-    //as long as the first index is less or equal to the last
-    while (first  <=  last) {
-        //check if we have found the position to insert the entity into
-        if (
-            //If the search index cartesianYPos is identical to the entity cartesianYPos
-            entities[layer].entityList[search].cartesianYPos == entity->cartesianYPos
-            //or if the search index cartesianYPos is less than the entity cartesianYPos
-            //and the next search index in the entities is larger than the entity cartesianYPos
-            || (entities[layer].numEntities>=1 && (entities[layer].entityList[search].cartesianYPos < entity->cartesianYPos)
-            && (entities[layer].entityList[search+1].cartesianYPos > entity->cartesianYPos))
-            //or if the search index -1 is less than the number and the search index is larger than the number
-            || (entities[layer].numEntities>=1 && search>0 && (entities[layer].entityList[search-1].cartesianYPos < entity->cartesianYPos)
-            && (entities[layer].entityList[search].cartesianYPos > entity->cartesianYPos))
-            //or if the search point has reached the first or the last index in the entities
-            || search == first || search == last) {
-            //if the search index cartesianYPos is less than the entity cartesianYPos
-            if (entities[layer].entityList[search].cartesianYPos < entity->cartesianYPos) {
-                //special case for when first and last position are next to one another
-                if (first+1 == last) {
-                    //check if the last index cartesianYPos is lower than the entity cartesianYPos
-                    if (entities[layer].entityList[search+1].cartesianYPos < entity->cartesianYPos) {
-                        //if so, the index to insert the entity into is at the end
-                        return search+2;
-                    }
-                }
-                //return the search index +1
-                return search+1;
-            }
-            //if not, return the search index
-            else{
-                return search;
+    //count the entities on every row, and turn the counts into the index of the first entity of every row
+    memset(entities->rowCounts,0,sizeof(Uint32)*numRows);
+    for (i = 0; i < entities->numCollected; ++i) {
+        entities->rowCounts[entities->collectedList[i].row - minRow + 1]++;
+    }
+    for (i = 1; i < numRows; ++i) {
+        entities->rowCounts[i] += entities->rowCounts[i-1];
+    }
+    //place the entities in their rows, keeping the order they were collected in
+    for (i = 0; i < entities->numCollected; ++i) {
+        entities->entityList[entities->rowCounts[entities->collectedList[i].row - minRow]++] = entities->collectedList[i];
+    }
+
+    //sort every row by the height of the entities. rowCounts now holds the end of every row
+    rowStart = 0;
+    for (i = 0; i < numRows-1; ++i) {
+        rowEnd = entities->rowCounts[i];
+        for (count = rowStart+1; count < rowEnd; ++count) {
+            entity = entities->entityList[count];
+            j = count;
+            while (j > rowStart && entities->entityList[j-1].cartesianYPos > entity.cartesianYPos) {
+                entities->entityList[j] = entities->entityList[j-1];
+                j--;
             }
+            entities->entityList[j] = entity;
+        }
+        rowStart = rowEnd;
+    }
+
+    entities->numEntities = entities->numCollected;
+    entities->numEntitiesLastRender = entities->numEntities;
+    return 0;
+}
+
+//sorts the collected entities in the order they had in the last frame, and then fixes that order with an
+//insertion sort. That is close to linear when the entities have only moved a little since the last frame.
+//Returns 0 if the order changed too much, then the entities have to be sorted from scratch
+static int coherentSortOnScreenEntities(EntitiesOnScreen *entities) {
+    Uint32 *newIndex = NULL, *newStamp = NULL;
+    EntityOnScreenPos entity;
+    Uint32 entityID = 0;
+    Uint32 numSorted = 0;
+    Uint32 numMoves = 0, maxMoves = 0;
+    Uint32 i = 0, j = 0;
 
+    if (entities->numCollected == 0) {
+        entities->numEntities = 0;
+        entities->currentEntityToDraw = 0;
+        entities->numEntitiesLastRender = 0;
+        return 1;
+    }
+
+    //make room for the largest entity ID in the lookup
+    for (i = 0; i < entities->numCollected; ++i) {
+        if (entities->collectedList[i].entityID > entityID) {
+            entityID = entities->collectedList[i].entityID;
         }
-        //if the entity cartesianYPos is less than the requested entity cartesianYPos
-        else if (entities[layer].entityList[search].cartesianYPos < entity->cartesianYPos) {
-            //set the first index to the search position +1
-            first = search + 1;
+    }
+    if (entityID >= maxCollectedEntityIDs) {
+        newIndex = realloc(collectedIndexOfEntity,sizeof(Uint32)*(entityID+1)*2);
+        if (newIndex == NULL) {
+            return 0;
         }
-        //otherwise if the search number is larger than the requested number
-        else {
-            //set the last position to the search -1
-            last = search - 1;
+        collectedIndexOfEntity = newIndex;
+        newStamp = realloc(collectedStampOfEntity,sizeof(Uint32)*(entityID+1)*2);
+        if (newStamp == NULL) {
+            return 0;
+        }
+        collectedStampOfEntity = newStamp;
+        for (i = maxCollectedEntityIDs; i < (entityID+1)*2; ++i) {
+            collectedStampOfEntity[i] = 0;
         }
-        //move the the search position
-        search = (first + last)/2;
+        maxCollectedEntityIDs = (entityID+1)*2;
     }
-    return -1;
+
+    //mark where every entity is in the collected list. The stamp changes every sort, so the lookup never has to be cleared
+    sortStamp++;
+    if (sortStamp == 0) {
+        memset(collectedStampOfEntity,0,sizeof(Uint32)*maxCollectedEntityIDs);
+        sortStamp = 1;
+    }
+    for (i = 0; i < entities->numCollected; ++i) {
+        collectedIndexOfEntity[entities->collectedList[i].entityID] = i;
+        collectedStampOfEntity[entities->collectedList[i].entityID] = sortStamp;
+    }
+
+    //put the entities that are still on the screen in last frame's order, with their new positions.
+    //Nothing is written past the entity being read, so it is done in place
+    for (i = 0; i < entities->numEntities; ++i) {
+        entityID = entities->entityList[i].entityID;
+        if (entityID < maxCollectedEntityIDs && collectedStampOfEntity[entityID] == sortStamp) {
+            entities->entityList[numSorted++] = entities->collectedList[collectedIndexOfEntity[entityID]];
+            //mark the entity as placed
+            collectedStampOfEntity[entityID] = sortStamp-1;
+        }
+    }
+    //the entities that came onto the screen go last
+    for (i = 0; i < entities->numCollected; ++i) {
+        if (collectedStampOfEntity[entities->collectedList[i].entityID] == sortStamp) {
+            entities->entityList[numSorted++] = entities->collectedList[i];
+        }
+    }
+
+    //fix the order with an insertion sort, and give up when it is doing too many moves
+    maxMoves = entities->numCollected*COHERENT_SORT_MAX_MOVES_PER_ENTITY;
+    for (i = 1; i < numSorted; ++i) {
+        entity = entities->entityList[i];
+        j = i;
+        while (j > 0 && (entities->entityList[j-1].row > entity.row
+               || (entities->entityList[j-1].row == entity.row && entities->entityList[j-1].cartesianYPos > entity.cartesianYPos))) {
+            entities->entityList[j] = entities->entityList[j-1];
+            j--;
+            numMoves++;
+        }
+        entities->entityList[j] = entity;
+        if (numMoves > maxMoves) {
+            return 0;
+        }
+    }
+
+    entities->numEntities = numSorted;
+    entities->currentEntityToDraw = 0;
+    entities->numEntitiesLastRender = numSorted;
+    return 1;
 }
 
 void SystemRenderIsoMetricWorld_Free() {
-    int i = 0;    //if memory has been allocated for the entities on screen
+    int i = 0;
+
+    isoChunkCacheFree(chunkCache);
+    chunkCache = NULL;
+    SpatialGrid_Free(spatialGrid);
+    spatialGrid = NULL;
+    free(collectedIndexOfEntity);
+    free(collectedStampOfEntity);
+    collectedIndexOfEntity = NULL;
+    collectedStampOfEntity = NULL;
+    maxCollectedEntityIDs = 0;
+    RenderQueue_DestroyTexture(backBuffer);
+    backBuffer = NULL;
+    backBufferValid = 0;
+    free(drawnSprites);
+    free(lastDrawnSprites);
+    free(drawnIndexOfEntity);
+    free(drawnStampOfEntity);
+    drawnSprites = NULL;
+    lastDrawnSprites = NULL;
+    drawnIndexOfEntity = NULL;
+    drawnStampOfEntity = NULL;
+    numDrawnSprites = 0;
+    numLastDrawnSprites = 0;
+    maxDrawnSprites = 0;
+    maxDrawnEntityIDs = 0;
+
+    //if memory has been allocated for the entities on screen
     if (entitiesOnScreen!=NULL) {
         //loop through each layer
         for (i = 0; i < isoEngine->isoMap->numLayers; ++i) {
             //free the allocated entities for each layer
             free(entitiesOnScreen[i].entityList);
+            free(entitiesOnScreen[i].collectedList);
+            free(entitiesOnScreen[i].rowCounts);
         }
         //free the allocated memory for entities on screen
         free(entitiesOnScreen);
@@ -10,18 +10,22 @@ typedef struct EntityOnScreenPos {
 
 //Local struct to store entities that will be drawn on the screen
 typedef struct EntitiesOnScreen {
-    EntityOnScreenPos *entityList;     //list with entities on the screen
-    Uint32 maxEntities;                 //current max entities on screen
+    EntityOnScreenPos *entityList;     //list with entities on the screen, sorted by row and then cartesianYPos
+    EntityOnScreenPos *collectedList;  //entities found on the screen in the spatial grid, not sorted
+    Uint32 maxEntities;                 //current max entities on screen, the size of both lists
     Uint32 numEntities;                 //number entities on screen
+    Uint32 numCollected;                //number of entities in the collected list
     Uint32 numEntitiesLastRender;       //number of entities last render call. Used by the collision system
     Uint32 currentEntityToDraw;         //current index in the sortedIndexList we want to draw
+    Uint32 *rowCounts;                  //number of entities on every row, used to bucket the entities by row
+    Uint32 maxRows;                     //size of rowCounts
 } EntitiesOnScreen;
 
 
 int SystemRenderIsoMetricWorld_Init(void *scene);
 void SystemRenderIsoMetricWorld_Compute();
 void SystemRenderIsoMetricWorld_Free();
-void SystemRenderIsoMetricWorld_SortEntity(Uint32 entity);
+void SystemRenderIsoMetricWorld_UpdateEntity(Uint32 entity);
 [[nodiscard]] EntitiesOnScreen *SystemRenderIsoMetricWorld_GetEntitiesOnScreen(int layer);
 
 #endif // __RENDER_ISOMETRIC_SYSTEM_H_
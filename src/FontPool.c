@@ -226,10 +226,10 @@ void BitmapFontStringColor(Font *font,char *string,int x,int y,SDL_Color color)
     length = strlen(string);
 
     //get the current color mod
-    SDL_GetTextureColorMod(font->texture.texture,&original.r,&original.g,&original.b);
+    original = font->texture.colorMod;
 
     //set the new color
-    SDL_SetTextureColorMod(font->texture.texture,color.r,color.g,color.b);
+    Texture_SetColorMod(&font->texture,color.r,color.g,color.b);
 
     for (i = 0; i < length; ++i) {
         //map the character to the character in the texture
@@ -251,7 +251,7 @@ void BitmapFontStringColor(Font *font,char *string,int x,int y,SDL_Color color)
         }
     }
     //restore the original color
-    SDL_SetTextureColorMod(font->texture.texture,original.r,original.g,original.b);
+    Texture_SetColorMod(&font->texture,original.r,original.g,original.b);
 }
 
 void BitmapFontStringScale(Font *font,char *string,int x,int y,float scale) {
@@ -320,10 +320,10 @@ void BitmapFontStringScaleColor(Font *font,char *string,int x,int y,float scale,
     }
 
     //get the current color mod
-    SDL_GetTextureColorMod(font->texture.texture,&original.r,&original.g,&original.b);
+    original = font->texture.colorMod;
 
     //set the new color
-    SDL_SetTextureColorMod(font->texture.texture,color.r,color.g,color.b);
+    Texture_SetColorMod(&font->texture,color.r,color.g,color.b);
 
     //get the length of the string
     length = strlen(string);
@@ -348,7 +348,7 @@ void BitmapFontStringScaleColor(Font *font,char *string,int x,int y,float scale,
     }
 
     //restore the original color
-    SDL_SetTextureColorMod(font->texture.texture,original.r,original.g,original.b);
+    Texture_SetColorMod(&font->texture,original.r,original.g,original.b);
 }
 void BitmapFontStringCenterScale(Font *font,char *string,int x,int y,float scale) {
     int i = 0;    int length=0;
@@ -427,10 +427,10 @@ void BitmapFontStringCenterScaleColor(Font *font,char *string,int x,int y,float
     x=x - font->space[0] * length/2;
 
     //get the current color mod
-    SDL_GetTextureColorMod(font->texture.texture,&original.r,&original.g,&original.b);
+    original = font->texture.colorMod;
 
     //set the new color
-    SDL_SetTextureColorMod(font->texture.texture,color.r,color.g,color.b);
+    Texture_SetColorMod(&font->texture,color.r,color.g,color.b);
 
     for (i = 0; i < length; ++i) {
         //map the character to the character in the texture
@@ -451,7 +451,7 @@ void BitmapFontStringCenterScaleColor(Font *font,char *string,int x,int y,float
         }
     }
     //restore the original color
-    SDL_SetTextureColorMod(font->texture.texture,original.r,original.g,original.b);
+    Texture_SetColorMod(&font->texture,original.r,original.g,original.b);
 }
 
 SDL_Color FontPool_GetColor(int r,int g,int b) {
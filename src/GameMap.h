@@ -0,0 +1,18 @@
+#ifndef __GAME_MAP_H
+#define __GAME_MAP_H
+
+//the map the game plays on. It is generated from the seed the first time the game starts, and saved to MAP_FILE.
+//A saved map that was generated with other settings or an older world generator is generated again
+#define MAP_HEIGHT 640
+#define MAP_WIDTH 640
+#define MAP_NUM_LAYERS 2
+#define MAP_TILE_SIZE 64
+#define MAP_FILE "data/testmap.isomap"
+#define MAP_SEED 1232
+#define MAP_TERRAIN_HEIGHT 20
+
+//hash of the map generated with MAP_SEED and MAP_TERRAIN_HEIGHT, checked by TestWorldGenerator. If the world
+//generator changes on purpose, update the hash with the one the test prints and increase ISO_MAP_GENERATOR_VERSION
+#define MAP_GOLDEN_HASH 0x56529b540ba317deULL
+
+#endif // __GAME_MAP_H
@@ -0,0 +1,283 @@
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "Headless.h"
+#include "renderer.h"
+#include "DeltaTimer.h"
+#include "logger.h"
+
+//color the pixels that differ from the golden image get in the difference image
+#define HEADLESS_DIFF_COLOR     0xffff00ff
+//length of the file names of the saved frames and the golden images, with the directory
+#define HEADLESS_PATH_LENGTH    4096
+
+static HeadlessOptions options = {0,HEADLESS_DEFAULT_FRAMES,0,HEADLESS_DEFAULT_FPS,HEADLESS_DEFAULT_TOLERANCE,0,NULL,NULL};
+
+static int frameNumber = 0;
+static int numFramesCaptured = 0;
+static int numFramesFailed = 0;
+static Uint64 runTimer = 0;
+//time spent saving and comparing frames, it is not counted in the time it took to draw the frames
+static Uint64 captureTime = 0;
+
+static int parseNumber(char *text,int min,int *number);
+static int parseDirectory(char *text,char **directory);
+static int joinPath(char *path,size_t size,char *directory,char *filename);
+static void captureFrame(SDL_Surface *frame);
+static int compareWithGolden(SDL_Surface *frame,char *goldenFilename,char *diffFilename);
+
+//reads the headless options from the command line. Returns 0 if an argument is not known or has a bad value
+int Headless_ParseArguments(int argc,char *argv[]) {
+    int i = 0;
+
+    for (i = 1; i < argc; ++i) {
+        if (strcmp(argv[i],"--headless") == 0) {
+            options.enabled = 1;
+        }
+        else if (strcmp(argv[i],"--partial-redraw") == 0) {
+            options.partialRedraw = 1;
+        }
+        else if (strcmp(argv[i],"--frames") == 0 && i+1 < argc) {
+            if (!parseNumber(argv[++i],1,&options.numFrames)) {
+                return 0;
+            }
+        }
+        else if (strcmp(argv[i],"--capture-every") == 0 && i+1 < argc) {
+            if (!parseNumber(argv[++i],0,&options.captureInterval)) {
+                return 0;
+            }
+        }
+        else if (strcmp(argv[i],"--fps") == 0 && i+1 < argc) {
+            if (!parseNumber(argv[++i],1,&options.fps)) {
+                return 0;
+            }
+        }
+        else if (strcmp(argv[i],"--tolerance") == 0 && i+1 < argc) {
+            if (!parseNumber(argv[++i],0,&options.tolerance)) {
+                return 0;
+            }
+        }
+        else if (strcmp(argv[i],"--dump-dir") == 0 && i+1 < argc) {
+            if (!parseDirectory(argv[++i],&options.dumpDirectory)) {
+                return 0;
+            }
+        }
+        else if (strcmp(argv[i],"--golden-dir") == 0 && i+1 < argc) {
+            if (!parseDirectory(argv[++i],&options.goldenDirectory)) {
+                return 0;
+            }
+        }
+        else {
+            WriteError("Unknown argument or missing value: %s",argv[i]);
+            WriteError("Usage: %s [--headless] [--frames n] [--capture-every n] [--fps n] [--dump-dir directory] "
+                       "[--golden-dir directory] [--tolerance n] [--partial-redraw]",argv[0]);
+            return 0;
+        }
+    }
+    if (!options.enabled && (options.dumpDirectory != NULL || options.goldenDirectory != NULL)) {
+        WriteWarning("Frames are only saved and compared with --headless");
+    }
+    return 1;
+}
+
+HeadlessOptions *Headless_GetOptions() {
+    return &options;
+}
+
+//fixes the delta time and starts the clock of the run. Call it right before the game loop
+void Headless_Start() {
+    if (!options.enabled) {
+        return;
+    }
+    DeltaTimer_SetFixedDeltaTime(1.0/options.fps);
+    frameNumber = 0;
+    numFramesCaptured = 0;
+    numFramesFailed = 0;
+    captureTime = 0;
+    WriteInfo("Headless run of %d frames at %d fps game time started",options.numFrames,options.fps);
+    runTimer = SDL_GetPerformanceCounter();
+}
+
+//called after every frame. Captures the frame when it is time to, and returns 0 when all the frames have been drawn
+int Headless_EndFrame() {
+    Uint64 timer = 0;
+    int capture = 0;
+
+    if (!options.enabled) {
+        return 1;
+    }
+    frameNumber++;
+    capture = options.captureInterval > 0 ? frameNumber % options.captureInterval == 0 : frameNumber == options.numFrames;
+    if (capture && (options.dumpDirectory != NULL || options.goldenDirectory != NULL)) {
+        timer = SDL_GetPerformanceCounter();
+        captureFrame(getFrameSurface());
+        captureTime += SDL_GetPerformanceCounter() - timer;
+    }
+    return frameNumber < options.numFrames;
+}
+
+//writes how fast the frames were drawn and how they compared with the golden images.
+//Returns the number of frames that did not match their golden image
+int Headless_Finish() {
+    double seconds = 0;
+
+    if (!options.enabled) {
+        return 0;
+    }
+    seconds = (double)(SDL_GetPerformanceCounter() - runTimer - captureTime)/SDL_GetPerformanceFrequency();
+    WriteInfo("Drew %d frames in %.3f s, %.3f ms per frame, %.1f frames per second",frameNumber,seconds,
+              frameNumber > 0 ? seconds*1000.0/frameNumber : 0.0,seconds > 0 ? frameNumber/seconds : 0.0);
+    if (options.goldenDirectory != NULL) {
+        WriteInfo("%d of %d captured frames matched their golden image",numFramesCaptured-numFramesFailed,numFramesCaptured);
+    }
+    return numFramesFailed;
+}
+
+//reads a whole number of at least min. Returns 0 if the text is not such a number
+static int parseNumber(char *text,int min,int *number) {
+    char *end = NULL;
+    long value = strtol(text,&end,10);
+
+    if (end == text || *end != '\0' || value < min || value > INT_MAX) {
+        WriteError("'%s' is not a number of at least %d!",text,min);
+        return 0;
+    }
+    *number = (int)value;
+    return 1;
+}
+
+//takes the directory when the frame file names still fit behind it. Returns 0 if the directory name is too long
+static int parseDirectory(char *text,char **directory) {
+    char path[HEADLESS_PATH_LENGTH];
+
+    if (!joinPath(path,sizeof(path),text,"frame_00000_diff.png")) {
+        return 0;
+    }
+    *directory = text;
+    return 1;
+}
+
+//writes directory/filename into path. Returns 0 if it does not fit, instead of using a cut off file name
+static int joinPath(char *path,size_t size,char *directory,char *filename) {
+    int length = snprintf(path,size,"%s/%s",directory,filename);
+
+    if (length < 0 || (size_t)length >= size) {
+        WriteError("The path %s/%s is too long, it has to be shorter than %d characters!",directory,filename,(int)size);
+        path[0] = '\0';
+        return 0;
+    }
+    return 1;
+}
+
+//saves the frame in the dump directory and compares it with its golden image
+static void captureFrame(SDL_Surface *frame) {
+    char filename[32];
+    char diffName[32];
+    char goldenFilename[HEADLESS_PATH_LENGTH];
+    char diffFilename[HEADLESS_PATH_LENGTH];
+
+    if (frame == NULL) {
+        return;
+    }
+    numFramesCaptured++;
+    snprintf(filename,sizeof(filename),"frame_%05d.png",frameNumber);
+    snprintf(diffName,sizeof(diffName),"frame_%05d_diff.png",frameNumber);
+
+    if (options.dumpDirectory != NULL && joinPath(diffFilename,sizeof(diffFilename),options.dumpDirectory,filename)) {
+        if (IMG_SavePNG(frame,diffFilename) != 0) {
+            WriteError("Could not save frame %s! SDL_image error:%s",diffFilename,IMG_GetError());
+        }
+    }
+    if (options.goldenDirectory != NULL) {
+        //a golden image that can not be named can not be compared, so the frame fails
+        if (!joinPath(goldenFilename,sizeof(goldenFilename),options.goldenDirectory,filename)) {
+            numFramesFailed++;
+            return;
+        }
+        //the difference image goes next to the frame, when the frames are saved
+        diffFilename[0] = '\0';
+        if (options.dumpDirectory != NULL) {
+            joinPath(diffFilename,sizeof(diffFilename),options.dumpDirectory,diffName);
+        }
+        if (compareWithGolden(frame,goldenFilename,diffFilename) == 0) {
+            numFramesFailed++;
+        }
+    }
+}
+
+//compares the frame with the golden image, pixel by pixel. A pixel is the same when none of its color channels differ
+//more than the tolerance. When pixels differ and diffFilename is not empty, the frame is saved there with the
+//pixels that differ marked. Returns 1 if the frame matches the golden image
+static int compareWithGolden(SDL_Surface *frame,char *goldenFilename,char *diffFilename) {
+    SDL_Surface *loaded = NULL, *golden = NULL, *diff = NULL;
+    Uint32 *framePixels = NULL, *goldenPixels = NULL, *diffPixels = NULL;
+    Uint32 a = 0, b = 0;
+    int channel = 0, difference = 0, maxDifference = 0, pixelDiffers = 0;
+    int numDifferent = 0;
+    int x = 0, y = 0;
+
+    loaded = IMG_Load(goldenFilename);
+    if (loaded == NULL) {
+        WriteError("Could not load golden image %s! SDL_image error:%s",goldenFilename,IMG_GetError());
+        return 0;
+    }
+    golden = SDL_ConvertSurfaceFormat(loaded,SDL_PIXELFORMAT_RGB888,0);
+    SDL_FreeSurface(loaded);
+    if (golden == NULL) {
+        WriteError("Could not convert golden image %s! SDL Error:%s",goldenFilename,SDL_GetError());
+        return 0;
+    }
+    if (golden->w != frame->w || golden->h != frame->h) {
+        WriteError("Golden image %s is %dx%d, the frame is %dx%d!",goldenFilename,golden->w,golden->h,frame->w,frame->h);
+        SDL_FreeSurface(golden);
+        return 0;
+    }
+    if (diffFilename[0] != '\0') {
+        diff = SDL_ConvertSurfaceFormat(frame,SDL_PIXELFORMAT_RGB888,0);
+    }
+
+    SDL_LockSurface(frame);
+    for (y = 0; y < frame->h; ++y) {
+        framePixels = (Uint32*)((Uint8*)frame->pixels + y*frame->pitch);
+        goldenPixels = (Uint32*)((Uint8*)golden->pixels + y*golden->pitch);
+        diffPixels = diff != NULL ? (Uint32*)((Uint8*)diff->pixels + y*diff->pitch) : NULL;
+        for (x = 0; x < frame->w; ++x) {
+            a = framePixels[x];
+            b = goldenPixels[x];
+            if (a == b) {
+                continue;
+            }
+            //the frame has no alpha channel, so only the colors are compared
+            pixelDiffers = 0;
+            for (channel = 0; channel < 24; channel += 8) {
+                difference = abs((int)((a >> channel) & 0xff) - (int)((b >> channel) & 0xff));
+                if (difference > maxDifference) {
+                    maxDifference = difference;
+                }
+                if (difference > options.tolerance) {
+                    pixelDiffers = 1;
+                }
+            }
+            if (pixelDiffers) {
+                numDifferent++;
+                if (diffPixels != NULL) {
+                    diffPixels[x] = HEADLESS_DIFF_COLOR;
+                }
+            }
+        }
+    }
+    SDL_UnlockSurface(frame);
+    SDL_FreeSurface(golden);
+
+    if (numDifferent > 0) {
+        WriteError("Frame %d differs from golden image %s in %d pixels, by up to %d",frameNumber,goldenFilename,numDifferent,maxDifference);
+        if (diff != NULL && IMG_SavePNG(diff,diffFilename) != 0) {
+            WriteError("Could not save difference image %s! SDL_image error:%s",diffFilename,IMG_GetError());
+        }
+    }
+    SDL_FreeSurface(diff);
+    return numDifferent == 0;
+}
@@ -0,0 +1,31 @@
+#ifndef __HEADLESS_H
+#define __HEADLESS_H
+
+#include <SDL2/SDL.h>
+
+#define HEADLESS_DEFAULT_FRAMES     300
+#define HEADLESS_DEFAULT_FPS        60
+//largest difference of a color channel from the golden image that still counts as the same color
+#define HEADLESS_DEFAULT_TOLERANCE  2
+
+typedef struct HeadlessOptions {
+    int enabled;                //1 when the game is drawn without a window
+    int numFrames;              //frames to draw before the game quits
+    int captureInterval;        //a frame is captured every this many frames, 0 to only capture the last frame
+    int fps;                    //the game time of every frame is 1/fps seconds, no matter how long it takes to draw
+    int tolerance;
+    int partialRedraw;          //1 to start with partial redraw turned on
+    char *dumpDirectory;        //the captured frames are saved here as PNG, NULL to not save them
+    char *goldenDirectory;      //the captured frames are compared with the PNG images with the same name here, NULL to not compare
+} HeadlessOptions;
+
+//The headless mode draws a fixed number of frames into a surface in memory instead of a window, with a fixed
+//delta time and without vsync, so it runs the same on every run and on machines without a display. The frames
+//can be saved and compared with golden images, and the time it took to draw them is written to the log
+int Headless_ParseArguments(int argc,char *argv[]);
+[[nodiscard]] HeadlessOptions *Headless_GetOptions();
+void Headless_Start();
+int Headless_EndFrame();
+int Headless_Finish();
+
+#endif // __HEADLESS_H
@@ -0,0 +1,311 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include "isoChunkCache.h"
+#include "../logger.h"
+#include "../renderer.h"
+#include "../RenderQueue.h"
+
+static void resetCache(IsoChunkCache *chunkCache);
+static void setZoomLevel(IsoChunkCache *chunkCache,IsoEngine *isoEngine);
+static IsoChunkCacheEntry *getEntry(IsoChunkCache *chunkCache,IsoMap *isoMap,int chunkIndex,int layer);
+static void renderEntry(IsoChunkCache *chunkCache,IsoEngine *isoEngine,IsoChunkCacheEntry *entry,int chunkX,int chunkY);
+static void drawChunkTiles(IsoEngine *isoEngine,int chunkX,int chunkY,int layer,int originX,int originY);
+
+IsoChunkCache *isoChunkCacheNew(IsoMap *isoMap) {
+    IsoChunkCache *chunkCache = NULL;
+    int i = 0;
+
+    if (isoMap == NULL) {
+        WriteError("Parameter: 'IsoMap *isoMap' is NULL!");
+        return NULL;
+    }
+
+    chunkCache = calloc(1,sizeof(struct IsoChunkCache));
+    if (chunkCache == NULL) {
+        WriteError("Could not allocate memory for the chunk cache!");
+        return NULL;
+    }
+
+    chunkCache->numChunkLayers = isoMap->numChunksX * isoMap->numChunksY * isoMap->numLayers;
+    chunkCache->entryIndex = malloc(sizeof(int)*chunkCache->numChunkLayers);
+    if (chunkCache->entryIndex == NULL) {
+        WriteError("Could not allocate memory for the chunk cache entry indexes!");
+        free(chunkCache);
+        return NULL;
+    }
+    for (i = 0; i < chunkCache->numChunkLayers; ++i) {
+        chunkCache->entryIndex[i] = -1;
+    }
+    for (i = 0; i < ISO_CHUNK_CACHE_MAX_ENTRIES; ++i) {
+        chunkCache->entries[i].chunkIndex = -1;
+    }
+    //the texture size is set up on the first frame
+    chunkCache->zoomLevel = 0;
+
+    return chunkCache;
+}
+
+void isoChunkCacheFree(IsoChunkCache *chunkCache) {
+    if (chunkCache == NULL) {
+        return;
+    }
+    resetCache(chunkCache);
+    free(chunkCache->entryIndex);
+    free(chunkCache);
+}
+
+//drops the chunks that have changed since the last frame, and all chunks when the zoom level has changed.
+//Returns the number of chunks whose tiles have changed since the last frame
+int isoChunkCacheBeginFrame(IsoChunkCache *chunkCache,IsoEngine *isoEngine) {
+    IsoMap *isoMap = NULL;
+    int chunkIndex = 0;
+    int layer = 0;
+    int index = 0;
+    int numChanged = 0;
+
+    if (chunkCache == NULL || isoEngine == NULL || isoEngine->isoMap == NULL) {
+        return 0;
+    }
+    isoMap = isoEngine->isoMap;
+    chunkCache->frame++;
+    chunkCache->numChunksRendered = 0;
+
+    if (isoEngine->zoomLevel != chunkCache->zoomLevel) {
+        setZoomLevel(chunkCache,isoEngine);
+    }
+
+    for (chunkIndex = 0; chunkIndex < isoMap->numChunksX*isoMap->numChunksY; ++chunkIndex) {
+        if (!isoMapChunkIsDirty(isoMap,chunkIndex,ISO_MAP_CHUNK_DIRTY_RENDER)) {
+            continue;
+        }
+        for (layer = 0; layer < isoMap->numLayers; ++layer) {
+            index = chunkCache->entryIndex[chunkIndex*isoMap->numLayers + layer];
+            if (index >= 0) {
+                chunkCache->entries[index].isValid = 0;
+            }
+        }
+        isoMapClearChunkDirty(isoMap,chunkIndex,ISO_MAP_CHUNK_DIRTY_RENDER);
+        numChanged++;
+    }
+    return numChanged;
+}
+
+//draws a layer of the map with the chunk textures, and returns the number of chunk textures drawn.
+//The chunks are drawn in the order of chunkX+chunkY, which keeps the tiles that overlap
+//across chunk borders in the same order as when the map is drawn tile by tile
+int isoChunkCacheDrawLayer(IsoChunkCache *chunkCache,IsoEngine *isoEngine,int layer) {
+    IsoMap *isoMap = NULL;
+    IsoChunkCacheEntry *entry = NULL;
+    SDL_FPoint point;
+    SDL_Rect quad;
+    SDL_Rect textureRect;
+    SDL_Color white = {0xff,0xff,0xff,0xff};
+    float zoomLevelTileSize = 0;
+    int diagonal = 0;
+    int chunkX = 0, chunkY = 0;
+    int numDrawn = 0;
+
+    if (chunkCache == NULL || isoEngine == NULL || isoEngine->isoMap == NULL || isoEngine->isoMap->tileSet == NULL) {
+        return 0;
+    }
+    isoMap = isoEngine->isoMap;
+    zoomLevelTileSize = isoEngine->zoomLevel*isoMap->tileSize;
+    SetupRect(&textureRect,0,0,chunkCache->textureWidth,chunkCache->textureHeight);
+
+    for (diagonal = 0; diagonal < isoMap->numChunksX+isoMap->numChunksY-1; ++diagonal) {
+        for (chunkX = 0; chunkX < isoMap->numChunksX; ++chunkX) {
+            chunkY = diagonal - chunkX;
+            if (chunkY < 0 || chunkY >= isoMap->numChunksY) {
+                continue;
+            }
+
+            //get the position of the first tile in the chunk on screen, the same way the tiles are drawn
+            point.x = ((chunkX << ISO_MAP_CHUNK_SHIFT)*zoomLevelTileSize) + isoEngine->scrollX;
+            point.y = ((chunkY << ISO_MAP_CHUNK_SHIFT)*zoomLevelTileSize) + isoEngine->scrollY;
+            IsoEngine_Convert2DToIso(&point);
+            SetupRect(&quad,(int)point.x-chunkCache->textureOffsetX,(int)point.y,chunkCache->textureWidth,chunkCache->textureHeight);
+
+            //skip the chunks that are not on screen
+            if (quad.x+quad.w < 0 || quad.x >= WINDOW_WIDTH || quad.y+quad.h < 0 || quad.y >= WINDOW_HEIGHT) {
+                continue;
+            }
+
+            entry = getEntry(chunkCache,isoMap,chunkY*isoMap->numChunksX + chunkX,layer);
+            //if every entry is already used this frame, draw the tiles of the chunk one by one
+            if (entry == NULL) {
+                drawChunkTiles(isoEngine,chunkX,chunkY,layer,(int)point.x,(int)point.y);
+                continue;
+            }
+            entry->lastUsedFrame = chunkCache->frame;
+            if (entry->isValid == 0) {
+                renderEntry(chunkCache,isoEngine,entry,chunkX,chunkY);
+            }
+            if (entry->isEmpty == 1) {
+                continue;
+            }
+            //if the texture could not be created, draw the tiles instead
+            if (entry->texture == NULL) {
+                drawChunkTiles(isoEngine,chunkX,chunkY,layer,(int)point.x,(int)point.y);
+                continue;
+            }
+            RenderQueue_AddSprite(entry->texture,chunkCache->textureWidth,chunkCache->textureHeight,&textureRect,&quad,white);
+            numDrawn++;
+        }
+    }
+    return numDrawn;
+}
+
+static void resetCache(IsoChunkCache *chunkCache) {
+    int i = 0;
+
+    for (i = 0; i < ISO_CHUNK_CACHE_MAX_ENTRIES; ++i) {
+        RenderQueue_DestroyTexture(chunkCache->entries[i].texture);
+        chunkCache->entries[i].texture = NULL;
+        chunkCache->entries[i].chunkIndex = -1;
+        chunkCache->entries[i].isValid = 0;
+        chunkCache->entries[i].isEmpty = 0;
+    }
+    for (i = 0; i < chunkCache->numChunkLayers; ++i) {
+        chunkCache->entryIndex[i] = -1;
+    }
+}
+
+//the chunk textures are drawn at the zoom level, so they all have to be created again when it changes
+static void setZoomLevel(IsoChunkCache *chunkCache,IsoEngine *isoEngine) {
+    IsoTileSet *tileSet = isoEngine->isoMap->tileSet;
+    float zoomLevelTileSize = isoEngine->zoomLevel*isoEngine->isoMap->tileSize;
+    int tileWidth = 0, tileHeight = 0;
+
+    resetCache(chunkCache);
+    chunkCache->zoomLevel = isoEngine->zoomLevel;
+
+    if (tileSet != NULL) {
+        tileWidth = tileSet->tileWidth;
+        tileHeight = tileSet->tileHeight;
+    }
+    //the first tile of the chunk is at the top, the chunk reaches ISO_MAP_CHUNK_SIZE-1 tiles to the left and right of it.
+    //One pixel is added to the tiles, since they are drawn one pixel larger when they are scaled
+    chunkCache->textureOffsetX = (int)ceilf((ISO_MAP_CHUNK_SIZE-1)*zoomLevelTileSize);
+    chunkCache->textureWidth = chunkCache->textureOffsetX*2 + (int)ceilf(tileWidth*isoEngine->zoomLevel) + 2;
+    chunkCache->textureHeight = (int)ceilf((ISO_MAP_CHUNK_SIZE-1)*zoomLevelTileSize + tileHeight*isoEngine->zoomLevel) + 2;
+
+    chunkCache->maxEntries = ISO_CHUNK_CACHE_MAX_PIXELS / (chunkCache->textureWidth*chunkCache->textureHeight);
+    if (chunkCache->maxEntries < 1) {
+        chunkCache->maxEntries = 1;
+    } else if (chunkCache->maxEntries > ISO_CHUNK_CACHE_MAX_ENTRIES) {
+        chunkCache->maxEntries = ISO_CHUNK_CACHE_MAX_ENTRIES;
+    }
+    WriteDebug("Chunk cache: %d chunk textures of %dx%d at zoom level %.3f",chunkCache->maxEntries,
+               chunkCache->textureWidth,chunkCache->textureHeight,isoEngine->zoomLevel);
+}
+
+//returns the entry of the chunk layer. If it is not cached, the least recently used entry is given to it.
+//Returns NULL if all the entries have been drawn this frame
+static IsoChunkCacheEntry *getEntry(IsoChunkCache *chunkCache,IsoMap *isoMap,int chunkIndex,int layer) {
+    IsoChunkCacheEntry *entry = NULL;
+    int chunkLayer = chunkIndex*isoMap->numLayers + layer;
+    int index = chunkCache->entryIndex[chunkLayer];
+    int i = 0;
+
+    if (index >= 0) {
+        return &chunkCache->entries[index];
+    }
+
+    //find an unused entry, or the least recently used one
+    for (i = 0; i < chunkCache->maxEntries; ++i) {
+        if (chunkCache->entries[i].chunkIndex == -1) {
+            index = i;
+            break;
+        }
+        if (chunkCache->entries[i].lastUsedFrame != chunkCache->frame
+        && (index == -1 || chunkCache->entries[i].lastUsedFrame < chunkCache->entries[index].lastUsedFrame)) {
+            index = i;
+        }
+    }
+    if (index == -1) {
+        return NULL;
+    }
+
+    entry = &chunkCache->entries[index];
+    //take the entry from the chunk layer that had it, the texture is reused
+    if (entry->chunkIndex != -1) {
+        chunkCache->entryIndex[entry->chunkIndex*isoMap->numLayers + entry->layer] = -1;
+    }
+    entry->chunkIndex = chunkIndex;
+    entry->layer = layer;
+    entry->isValid = 0;
+    chunkCache->entryIndex[chunkLayer] = index;
+    return entry;
+}
+
+//draws the tiles of the chunk layer into the texture of the entry
+static void renderEntry(IsoChunkCache *chunkCache,IsoEngine *isoEngine,IsoChunkCacheEntry *entry,int chunkX,int chunkY) {
+    SDL_Texture *target = NULL;
+    SDL_Rect clipRect;
+    int isClipped = 0;
+    int x = 0, y = 0;
+
+    entry->isValid = 1;
+    entry->isEmpty = 1;
+
+    //check if the chunk layer has any tiles to draw
+    for (y = chunkY << ISO_MAP_CHUNK_SHIFT; y < (chunkY+1) << ISO_MAP_CHUNK_SHIFT && entry->isEmpty; ++y) {
+        for (x = chunkX << ISO_MAP_CHUNK_SHIFT; x < (chunkX+1) << ISO_MAP_CHUNK_SHIFT; ++x) {
+            if (isoMapGetTile(isoEngine->isoMap,x,y,entry->layer) >= 0) {
+                entry->isEmpty = 0;
+                break;
+            }
+        }
+    }
+    if (entry->isEmpty) {
+        return;
+    }
+
+    if (entry->texture == NULL) {
+        entry->texture = RenderQueue_CreateTexture(SDL_PIXELFORMAT_ARGB8888,SDL_TEXTUREACCESS_TARGET,
+                                                   chunkCache->textureWidth,chunkCache->textureHeight,SDL_BLENDMODE_BLEND);
+        if (entry->texture == NULL) {
+            WriteError("Could not create chunk texture!");
+            return;
+        }
+    }
+
+    //draw the tiles into the texture, on a see-through background, and go back to the target the map is drawn to
+    target = RenderQueue_GetTarget();
+    isClipped = RenderQueue_GetClipRect(&clipRect);
+    RenderQueue_SetTarget(entry->texture);
+    RenderQueue_Clear(0x00,0x00,0x00,0x00);
+    drawChunkTiles(isoEngine,chunkX,chunkY,entry->layer,chunkCache->textureOffsetX,0);
+    RenderQueue_SetTarget(target);
+    if (isClipped) {
+        RenderQueue_SetClipRect(&clipRect);
+    }
+    chunkCache->numChunksRendered++;
+}
+
+//draws the tiles of a chunk layer one by one, with the first tile of the chunk at originX,originY
+static void drawChunkTiles(IsoEngine *isoEngine,int chunkX,int chunkY,int layer,int originX,int originY) {
+    IsoMap *isoMap = isoEngine->isoMap;
+    float zoomLevelTileSize = isoEngine->zoomLevel*isoMap->tileSize;
+    int diagonal = 0;
+    int localX = 0, localY = 0;
+    int tile = 0;
+
+    //draw the tiles in the same order as the rows of the map, back to front
+    for (diagonal = 0; diagonal < ISO_MAP_CHUNK_SIZE*2-1; ++diagonal) {
+        for (localX = 0; localX < ISO_MAP_CHUNK_SIZE; ++localX) {
+            localY = diagonal - localX;
+            if (localY < 0 || localY >= ISO_MAP_CHUNK_SIZE) {
+                continue;
+            }
+            tile = isoMapGetTile(isoMap,(chunkX << ISO_MAP_CHUNK_SHIFT) + localX,(chunkY << ISO_MAP_CHUNK_SHIFT) + localY,layer);
+            if (tile < 0) {
+                continue;
+            }
+            Texture_RenderXYClipScale(isoMap->tileSet->tilesTex,originX + (int)((localX-localY)*zoomLevelTileSize),
+                                      originY + (int)((localX+localY)*zoomLevelTileSize*0.5f),
+                                      &isoMap->tileSet->tileClipRects[tile],isoEngine->zoomLevel);
+        }
+    }
+}
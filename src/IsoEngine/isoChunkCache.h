@@ -0,0 +1,42 @@
+#ifndef __ISO_CHUNK_CACHE_H
+#define __ISO_CHUNK_CACHE_H
+
+#include <SDL2/SDL.h>
+#include "isoEngine.h"
+
+//maximum number of chunk layers kept in the cache
+#define ISO_CHUNK_CACHE_MAX_ENTRIES     128
+//maximum number of pixels in all the chunk textures together (256 MB)
+#define ISO_CHUNK_CACHE_MAX_PIXELS      (64*1024*1024)
+
+typedef struct IsoChunkCacheEntry {
+    int chunkIndex;             //index of the chunk in the map, -1 if the entry is not used
+    int layer;                  //layer of the chunk that is in the texture
+    SDL_Texture *texture;       //render target with the tiles of the chunk layer
+    int isValid;                //0 if the tiles have to be drawn into the texture again
+    int isEmpty;                //1 if the chunk layer has no tiles, then there is nothing to draw
+    Uint32 lastUsedFrame;       //frame the entry was drawn last, the least recently used entry is reused first
+} IsoChunkCacheEntry;
+
+//The chunk cache keeps the tiles of every visible chunk pre-drawn into a texture at the current zoom level,
+//so the terrain is drawn with a few chunk textures instead of one copy for every tile. The textures are drawn
+//again when the tiles of the chunk change (ISO_MAP_CHUNK_DIRTY_RENDER) or when the zoom level changes
+typedef struct IsoChunkCache {
+    IsoChunkCacheEntry entries[ISO_CHUNK_CACHE_MAX_ENTRIES];
+    int maxEntries;             //number of entries that fit in ISO_CHUNK_CACHE_MAX_PIXELS at the current zoom level
+    int *entryIndex;            //entry of every chunk layer (chunkIndex*numLayers+layer), -1 if it is not cached
+    int numChunkLayers;
+    float zoomLevel;            //zoom level the textures were drawn at
+    int textureWidth;
+    int textureHeight;
+    int textureOffsetX;         //x position of the first tile of the chunk in the texture
+    Uint32 frame;
+    int numChunksRendered;      //number of chunk textures drawn again this frame
+} IsoChunkCache;
+
+[[nodiscard]] IsoChunkCache *isoChunkCacheNew(IsoMap *isoMap);
+void isoChunkCacheFree(IsoChunkCache *chunkCache);
+int isoChunkCacheBeginFrame(IsoChunkCache *chunkCache,IsoEngine *isoEngine);
+int isoChunkCacheDrawLayer(IsoChunkCache *chunkCache,IsoEngine *isoEngine,int layer);
+
+#endif // __ISO_CHUNK_CACHE_H
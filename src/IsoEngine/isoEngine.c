@@ -21,6 +21,11 @@ IsoEngine *IsoEngine_New() {
     isoEngine->zoomLevel = 1.0;
     isoEngine->lastTileClicked = -1;
     isoEngine->isoMap = NULL;
+    isoEngine->minimap = NULL;
+    isoEngine->pathfinder = NULL;
+    isoEngine->flowFields = NULL;
+    isoEngine->showMinimap = 1;
+    isoEngine->partialRedraw = 0;
     isoEngine->gameMode = GAME_MODE_OVERVIEW;
 
     SetupRect(&isoEngine->mouseRect,0,0,1,1);
@@ -40,6 +45,9 @@ void IsoEngine_Free(IsoEngine *isoEngine) {
         if (isoEngine->isoMap!=NULL) {
             isoMapFreeMap(isoEngine->isoMap);
         }
+        isoMinimapFree(isoEngine->minimap);
+        isoFlowFieldCacheFree(isoEngine->flowFields);
+        isoPathfinderFree(isoEngine->pathfinder);
         free(isoEngine);
     }
 }
@@ -208,46 +216,159 @@ void IsoEngine_DrawIsoMouse(IsoEngine *isoEngine) {
                              (isoEngine->zoomLevel*isoEngine->mousePoint.y)+correctY,&isoEngine->isoMap->tileSet->tileClipRects[0],isoEngine->zoomLevel);
 }
 
+//rounds down, the division in C rounds towards zero
+static Sint64 floorDiv(Sint64 a,Sint64 b) {
+    Sint64 q = a/b;
+
+    if (a%b != 0 && ((a < 0) != (b < 0))) {
+        q--;
+    }
+    return q;
+}
+
+//gets the distance between two rows/columns on the screen, and the size of a tile image on the screen,
+//in fixed point. Returns 0 if there is nothing to draw
+static int getTileSpanSizes(IsoEngine *isoEngine,Sint64 *tileStep,Sint64 *imageWidth,Sint64 *imageHeight) {
+    float width = 0, height = 0;
+
+    if (isoEngine == NULL || isoEngine->isoMap == NULL) {
+        return 0;
+    }
+    if (isoEngine->isoMap->tileSet != NULL) {
+        width = isoEngine->isoMap->tileSet->tileWidth;
+        height = isoEngine->isoMap->tileSet->tileHeight;
+    } else {
+        width = isoEngine->isoMap->tileSize*2;
+        height = isoEngine->isoMap->tileSize;
+    }
+    *tileStep = (Sint64)(isoEngine->zoomLevel*isoEngine->isoMap->tileSize*(1 << ISO_ENGINE_FIXED_SHIFT));
+    //one extra pixel for the rounding of the scaled tile images
+    *imageWidth = (Sint64)((width*isoEngine->zoomLevel + 1)*(1 << ISO_ENGINE_FIXED_SHIFT));
+    *imageHeight = (Sint64)((height*isoEngine->zoomLevel + 1)*(1 << ISO_ENGINE_FIXED_SHIFT));
+    return *tileStep > 0;
+}
+
+int IsoEngine_GetVisibleRows(IsoEngine *isoEngine,int *firstRow,int *lastRow) {
+    SDL_Rect screen = {0,0,WINDOW_WIDTH,WINDOW_HEIGHT};
+
+    return IsoEngine_GetRowsInRect(isoEngine,&screen,firstRow,lastRow);
+}
+
+int IsoEngine_GetVisibleRowColumns(IsoEngine *isoEngine,int row,int *firstColumn,int *lastColumn) {
+    SDL_Rect screen = {0,0,WINDOW_WIDTH,WINDOW_HEIGHT};
+
+    return IsoEngine_GetRowColumnsInRect(isoEngine,row,&screen,firstColumn,lastColumn);
+}
+
+int IsoEngine_GetRowsInRect(IsoEngine *isoEngine,SDL_Rect *rect,int *firstRow,int *lastRow) {
+    Sint64 tileStep = 0, imageWidth = 0, imageHeight = 0;
+    //the screen y position of row 0, times 2
+    Sint64 rowOffset = 0;
+    Sint64 first = 0, last = 0;
+
+    if (rect == NULL || firstRow == NULL || lastRow == NULL || !getTileSpanSizes(isoEngine,&tileStep,&imageWidth,&imageHeight)) {
+        return 0;
+    }
+    rowOffset = (Sint64)(isoEngine->scrollX + isoEngine->scrollY) << ISO_ENGINE_FIXED_SHIFT;
+
+    //the screen y position of a row is (row*tileStep + rowOffset)/2. The bottom of the tile images has to be
+    //below the top of the rectangle, and the top of the tiles above the bottom of the rectangle
+    first = floorDiv(((Sint64)rect->y << (ISO_ENGINE_FIXED_SHIFT+1)) - 2*imageHeight - rowOffset,tileStep) + 1;
+    last = floorDiv(((Sint64)(rect->y+rect->h) << (ISO_ENGINE_FIXED_SHIFT+1)) - rowOffset - 1,tileStep);
+
+    //only the rows that are on the map
+    if (first < 0) {
+        first = 0;
+    }
+    if (last > isoEngine->isoMap->mapWidth + isoEngine->isoMap->mapHeight - 2) {
+        last = isoEngine->isoMap->mapWidth + isoEngine->isoMap->mapHeight - 2;
+    }
+    *firstRow = (int)first;
+    *lastRow = (int)last;
+    return first <= last;
+}
+
+int IsoEngine_GetRowColumnsInRect(IsoEngine *isoEngine,int row,SDL_Rect *rect,int *firstColumn,int *lastColumn) {
+    Sint64 tileStep = 0, imageWidth = 0, imageHeight = 0;
+    //the screen x position of column 0
+    Sint64 columnOffset = 0;
+    Sint64 first = 0, last = 0;
+
+    if (rect == NULL || firstColumn == NULL || lastColumn == NULL || !getTileSpanSizes(isoEngine,&tileStep,&imageWidth,&imageHeight)) {
+        return 0;
+    }
+    columnOffset = (Sint64)(isoEngine->scrollX - isoEngine->scrollY) << ISO_ENGINE_FIXED_SHIFT;
+
+    //the screen x position of a column is column*tileStep + columnOffset
+    first = floorDiv(((Sint64)rect->x << ISO_ENGINE_FIXED_SHIFT) - imageWidth - columnOffset,tileStep) + 1;
+    last = floorDiv(((Sint64)(rect->x+rect->w) << ISO_ENGINE_FIXED_SHIFT) - columnOffset - 1,tileStep);
+
+    //only the columns on the map, x = (row+column)/2 and y = (row-column)/2
+    if (first < -row) {
+        first = -row;
+    }
+    if (first < row - 2*(isoEngine->isoMap->mapHeight-1)) {
+        first = row - 2*(isoEngine->isoMap->mapHeight-1);
+    }
+    if (last > row) {
+        last = row;
+    }
+    if (last > 2*(isoEngine->isoMap->mapWidth-1) - row) {
+        last = 2*(isoEngine->isoMap->mapWidth-1) - row;
+    }
+
+    //the columns of the row are even when the row is even, and odd when it's odd
+    if ((first - row) & 1) {
+        first++;
+    }
+    if ((last - row) & 1) {
+        last--;
+    }
+    *firstColumn = (int)first;
+    *lastColumn = (int)last;
+    return first <= last;
+}
+
+//gets the screen position of the tile image of the tile at row, column
+void IsoEngine_GetTileScreenPos(IsoEngine *isoEngine,int row,int column,int *screenX,int *screenY) {
+    Sint64 tileStep = (Sint64)(isoEngine->zoomLevel*isoEngine->isoMap->tileSize*(1 << ISO_ENGINE_FIXED_SHIFT));
+
+    *screenX = (int)((column*tileStep + ((Sint64)(isoEngine->scrollX - isoEngine->scrollY) << ISO_ENGINE_FIXED_SHIFT)) >> ISO_ENGINE_FIXED_SHIFT);
+    *screenY = (int)((row*tileStep + ((Sint64)(isoEngine->scrollX + isoEngine->scrollY) << ISO_ENGINE_FIXED_SHIFT)) >> (ISO_ENGINE_FIXED_SHIFT+1));
+}
+
 //Is here for reference to older tutorials. Can be removed if you wish so, since it will be copied and modified to run
 //in the render isometric world system in the entity component system.
 void IsoEngine_DrawIsoMap(IsoEngine *isoEngine) {
-    int i,j;
+    int row,column;
+    int firstRow,lastRow,firstColumn,lastColumn;
     int x,y;
+    int screenX,screenY;
     int tile = 4;
-    SDL_FPoint point;
 
     if (isoEngine==NULL) {
         return;
     }
-    if (isoEngine->isoMap == NULL) {
+    if (isoEngine->isoMap == NULL || isoEngine->isoMap->tileSet == NULL) {
+        return;
+    }
+    if (!IsoEngine_GetVisibleRows(isoEngine,&firstRow,&lastRow)) {
         return;
     }
 
-    int startX = -3/isoEngine->zoomLevel +(isoEngine->mapScroll2Dpos.x/isoEngine->zoomLevel/isoEngine->isoMap->tileSize)*2;
-    int startY = -20/isoEngine->zoomLevel + fabsf((isoEngine->mapScroll2Dpos.y/isoEngine->zoomLevel/isoEngine->isoMap->tileSize))*2;
-    int numTilesInWidth = ((WINDOW_WIDTH/isoEngine->isoMap->tileSize)/isoEngine->zoomLevel);
-    int numTilesInHeight = ((WINDOW_HEIGHT/isoEngine->isoMap->tileSize)/isoEngine->zoomLevel)*2;
-
-    if (isoEngine->isoMap->tileSet != NULL) {
-
-        for (i=startY;i < startY+numTilesInHeight+26; ++i) {
-            for (j=startX;j < startX+numTilesInWidth+5; ++j) {
-
-                //only draw when both x & y is equal, so we skip here
-                if ((j&1) != (i&1)) {
-                    continue;
-                }
-                x = (i+j)/2;
-                y = (i-j)/2;
-
-                if (x>=0 && y>=0 && x<isoEngine->isoMap->mapWidth && y<isoEngine->isoMap->mapHeight) {
-                    tile = isoMapGetTile(isoEngine->isoMap,x,y,0);
-                    point.x = ((x*isoEngine->zoomLevel *isoEngine->isoMap->tileSize) + isoEngine->scrollX);
-                    point.y = ((y*isoEngine->zoomLevel *isoEngine->isoMap->tileSize) + isoEngine->scrollY);
-                    IsoEngine_Convert2DToIso(&point);
-                    Texture_RenderXYClipScale(isoEngine->isoMap->tileSet->tilesTex,point.x,point.y,
-                                             &isoEngine->isoMap->tileSet->tileClipRects[tile],isoEngine->zoomLevel);
-                }
+    for (row = firstRow; row <= lastRow; ++row) {
+        if (!IsoEngine_GetVisibleRowColumns(isoEngine,row,&firstColumn,&lastColumn)) {
+            continue;
+        }
+        for (column = firstColumn; column <= lastColumn; column += 2) {
+            x = (row+column)/2;
+            y = (row-column)/2;
+
+            tile = isoMapGetTile(isoEngine->isoMap,x,y,0);
+            if (tile >= 0) {
+                IsoEngine_GetTileScreenPos(isoEngine,row,column,&screenX,&screenY);
+                Texture_RenderXYClipScale(isoEngine->isoMap->tileSet->tilesTex,screenX,screenY,
+                                         &isoEngine->isoMap->tileSet->tileClipRects[tile],isoEngine->zoomLevel);
             }
         }
     }
@@ -409,7 +530,15 @@ void IsoEngine_GetMouseTileClick(IsoEngine *isoEngine) {
 }
 
 void IsoEngine_ZoomIn(IsoEngine *isoEngine) {
-    if (isoEngine->zoomLevel<3.0) {
+    //below 1.0 the zoom level is doubled, so zooming in from far out does not take forever
+    if (isoEngine->zoomLevel<1.0) {
+        isoEngine->zoomLevel*=2.0;
+
+        if (isoEngine->gameMode==GAME_MODE_OVERVIEW) {
+            IsoEngine_CenterMap(isoEngine,&isoEngine->tilePos,NULL);
+        }
+    }
+    else if (isoEngine->zoomLevel<3.0) {
         isoEngine->zoomLevel+=0.25;
 
         if (isoEngine->gameMode==GAME_MODE_OVERVIEW) {
@@ -421,6 +550,14 @@ void IsoEngine_ZoomOut(IsoEngine *isoEngine) {
     if (isoEngine->zoomLevel>1.0) {
         isoEngine->zoomLevel-=0.25;
 
+        if (isoEngine->gameMode==GAME_MODE_OVERVIEW) {
+            IsoEngine_CenterMap(isoEngine,&isoEngine->tilePos,NULL);
+        }
+    }
+    //zooming out further than 1.0 is only possible when the map can be drawn from the minimap
+    else if (isoEngine->minimap != NULL && isoEngine->zoomLevel>ISO_ENGINE_MIN_ZOOM_LEVEL) {
+        isoEngine->zoomLevel*=0.5;
+
         if (isoEngine->gameMode==GAME_MODE_OVERVIEW) {
             IsoEngine_CenterMap(isoEngine,&isoEngine->tilePos,NULL);
         }
@@ -3,6 +3,15 @@
 
 #include <SDL2/SDL.h>
 #include "isoMap.h"
+#include "isoMinimap.h"
+#include "isoPathfinder.h"
+#include "isoFlowField.h"
+
+//below a zoom level of 1.0 the map is drawn from the minimap instead of from the tiles.
+//At the smallest zoom level the whole map fits on the screen
+#define ISO_ENGINE_MIN_ZOOM_LEVEL   0.03125f
+//number of fraction bits in the fixed point positions used to find the tiles on the screen
+#define ISO_ENGINE_FIXED_SHIFT      16
 
 typedef enum IsoEngineGameMode {
     GAME_MODE_OVERVIEW = 0,
@@ -21,6 +30,11 @@ typedef struct IsoEngine {
     SDL_FPoint tilePos;
     int lastTileClicked;
     IsoMap*isoMap;
+    IsoMinimap *minimap;
+    IsoPathfinder *pathfinder;
+    IsoFlowFieldCache *flowFields;  //flow fields for the entities that walk to a shared goal
+    int showMinimap;
+    int partialRedraw;      //1 when only the parts of the screen that changed are drawn again while the camera is still
     int gameMode;
 } IsoEngine;
 
@@ -42,6 +56,17 @@ void IsoEngine_UpdateMousePos(IsoEngine *isoEngine);
 void IsoEngine_ScrollMapWithMouse(IsoEngine *isoEngine);
 void IsoEngine_DrawIsoMouse(IsoEngine *isoEngine);
 void IsoEngine_DrawIsoMap(IsoEngine *isoEngine);
+
+//The map is drawn in diagonal rows, where the row of tile x,y is x+y and its column is x-y. A row only has
+//every other column, since the row and the column of a tile are both even or both odd.
+//These return 0 when no tile of the map is on the screen, and the range of rows/columns with tiles on the screen
+//(including the full height of the tile images) if there are
+int IsoEngine_GetVisibleRows(IsoEngine *isoEngine,int *firstRow,int *lastRow);
+int IsoEngine_GetVisibleRowColumns(IsoEngine *isoEngine,int row,int *firstColumn,int *lastColumn);
+//the same for the tiles inside a rectangle on the screen
+int IsoEngine_GetRowsInRect(IsoEngine *isoEngine,SDL_Rect *rect,int *firstRow,int *lastRow);
+int IsoEngine_GetRowColumnsInRect(IsoEngine *isoEngine,int row,SDL_Rect *rect,int *firstColumn,int *lastColumn);
+void IsoEngine_GetTileScreenPos(IsoEngine *isoEngine,int row,int column,int *screenX,int *screenY);
 void IsoEngine_GetMouseTilePos(IsoEngine *isoEngine, SDL_FPoint *mouseTilePos);
 void IsoEngine_CenterMapToTileUnderMouse(IsoEngine *isoEngine);
 void IsoEngine_CenterMap(IsoEngine *isoEngine,SDL_FPoint *objectPoint,SDL_FPoint *objSize);
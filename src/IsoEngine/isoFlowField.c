@@ -0,0 +1,405 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "isoFlowField.h"
+#include "../logger.h"
+#include "../ThreadPool.h"
+
+#define ISO_FLOW_COST_INFINITE          0xffffffff
+//a tile is pushed on the heap at most once for every tile around it, and every entrance and the goal once more
+#define ISO_FLOW_CHUNK_HEAP_SIZE        (ISO_MAP_CHUNK_SIZE*ISO_MAP_CHUNK_SIZE*8 + ISO_PATH_MAX_CHUNK_NODES + 1)
+
+typedef struct IsoFlowHeapEntry {
+    Uint32 cost;
+    int index;
+} IsoFlowHeapEntry;
+
+//the heap of one thread, for the costs inside one chunk
+typedef struct IsoFlowScratch {
+    IsoFlowHeapEntry heap[ISO_FLOW_CHUNK_HEAP_SIZE];
+    int numEntries;
+} IsoFlowScratch;
+
+//the 8 steps to the tiles around a tile, the straight ones first, and the direction of every step
+static const int stepX[8] = {0,1,0,-1,1,1,-1,-1};
+static const int stepY[8] = {-1,0,1,0,-1,1,1,-1};
+static const SDL_FPoint stepDirections[8] = {
+    {0,-1},{1,0},{0,1},{-1,0},
+    {0.70710678f,-0.70710678f},{0.70710678f,0.70710678f},{-0.70710678f,0.70710678f},{-0.70710678f,-0.70710678f}
+};
+
+static void heapPush(IsoFlowHeapEntry *entries,int *numEntries,Uint32 cost,int index);
+static IsoFlowHeapEntry heapPop(IsoFlowHeapEntry *entries,int *numEntries);
+static int prepareScratch(IsoFlowFieldCache *cache);
+static void buildField(IsoFlowFieldCache *cache,IsoPathfinder *pathfinder,IsoFlowField *field,int goalX,int goalY);
+static void integrateChunkTask(int taskIndex,int threadIndex,void *data);
+static void directChunkTask(int taskIndex,int threadIndex,void *data);
+
+IsoFlowFieldCache *isoFlowFieldCacheNew(IsoPathfinder *pathfinder) {
+    IsoFlowFieldCache *cache = NULL;
+    int i = 0;
+
+    if (pathfinder == NULL) {
+        WriteError("Parameter: 'IsoPathfinder *pathfinder' is NULL!");
+        return NULL;
+    }
+
+    cache = calloc(1,sizeof(struct IsoFlowFieldCache));
+    if (cache == NULL) {
+        WriteError("Could not allocate memory for the flow field cache!");
+        return NULL;
+    }
+    cache->mapWidth = pathfinder->mapWidth;
+    cache->mapHeight = pathfinder->mapHeight;
+    cache->lastField = -1;
+    for (i = 0; i < ISO_FLOW_FIELD_MAX_FIELDS; ++i) {
+        cache->fields[i].goalX = -1;
+        cache->fields[i].goalY = -1;
+    }
+    cache->integration = malloc(sizeof(Uint32)*pathfinder->mapWidth*pathfinder->mapHeight);
+    cache->nodeCosts = malloc(sizeof(Uint32)*pathfinder->numChunksX*pathfinder->numChunksY*ISO_PATH_MAX_CHUNK_NODES);
+    if (cache->integration == NULL || cache->nodeCosts == NULL) {
+        WriteError("Could not allocate memory for the flow field cache!");
+        isoFlowFieldCacheFree(cache);
+        return NULL;
+    }
+    return cache;
+}
+
+void isoFlowFieldCacheFree(IsoFlowFieldCache *cache) {
+    int i = 0;
+
+    if (cache == NULL) {
+        return;
+    }
+    for (i = 0; i < ISO_FLOW_FIELD_MAX_FIELDS; ++i) {
+        free(cache->fields[i].directions);
+    }
+    free(cache->integration);
+    free(cache->nodeCosts);
+    free(cache->scratch);
+    free(cache);
+}
+
+//returns the flow field to the goal. The field is built if there is none for the goal, or if the walkable tiles
+//have changed since it was built. Returns NULL on error
+IsoFlowField *isoFlowFieldCacheGetField(IsoFlowFieldCache *cache,IsoPathfinder *pathfinder,int goalX,int goalY) {
+    IsoFlowField *field = NULL;
+    int i = 0, found = -1, leastUsed = 0;
+
+    if (cache == NULL || pathfinder == NULL) {
+        return NULL;
+    }
+    //most of the entities that ask for a field in a row walk to the same goal
+    if (cache->lastField >= 0 && cache->fields[cache->lastField].goalX == goalX && cache->fields[cache->lastField].goalY == goalY) {
+        found = cache->lastField;
+    }
+    for (i = 0; i < ISO_FLOW_FIELD_MAX_FIELDS && found == -1; ++i) {
+        if (cache->fields[i].goalX == goalX && cache->fields[i].goalY == goalY) {
+            found = i;
+        }
+    }
+    //take the least recently used field for the new goal, the fields that are not used yet first
+    if (found == -1) {
+        for (i = 1; i < ISO_FLOW_FIELD_MAX_FIELDS; ++i) {
+            if (cache->fields[i].lastUsed < cache->fields[leastUsed].lastUsed) {
+                leastUsed = i;
+            }
+        }
+        found = leastUsed;
+        cache->fields[found].goalX = -1;
+    }
+
+    field = &cache->fields[found];
+    if (field->goalX == -1 || field->version != pathfinder->version) {
+        if (field->directions == NULL) {
+            field->directions = malloc(sizeof(Uint8)*cache->mapWidth*cache->mapHeight);
+            if (field->directions == NULL) {
+                WriteError("Could not allocate memory for a flow field!");
+                return NULL;
+            }
+        }
+        if (prepareScratch(cache) == 0) {
+            return NULL;
+        }
+        buildField(cache,pathfinder,field,goalX,goalY);
+    }
+    field->lastUsed = ++cache->useCounter;
+    cache->lastField = found;
+    return field;
+}
+
+//gets the direction to walk in from the tile, one unit long. Returns 0 if there is nowhere to go, on the goal
+//and on the tiles that can not reach it
+int isoFlowFieldGetDirection(IsoFlowFieldCache *cache,IsoFlowField *field,int x,int y,SDL_FPoint *direction) {
+    Uint8 step = ISO_FLOW_DIRECTION_NONE;
+
+    if (cache == NULL || field == NULL || x < 0 || x >= cache->mapWidth || y < 0 || y >= cache->mapHeight) {
+        return 0;
+    }
+    step = field->directions[y*cache->mapWidth + x];
+    if (step == ISO_FLOW_DIRECTION_NONE) {
+        return 0;
+    }
+    if (direction != NULL) {
+        *direction = stepDirections[step];
+    }
+    return 1;
+}
+
+static void heapPush(IsoFlowHeapEntry *entries,int *numEntries,Uint32 cost,int index) {
+    IsoFlowHeapEntry entry = {cost,index};
+    int i = (*numEntries)++, parent = 0;
+
+    while (i > 0) {
+        parent = (i-1)/2;
+        if (entries[parent].cost <= cost) {
+            break;
+        }
+        entries[i] = entries[parent];
+        i = parent;
+    }
+    entries[i] = entry;
+}
+
+static IsoFlowHeapEntry heapPop(IsoFlowHeapEntry *entries,int *numEntries) {
+    IsoFlowHeapEntry top = entries[0];
+    IsoFlowHeapEntry last = entries[--(*numEntries)];
+    int i = 0, child = 0;
+
+    while ((child = i*2+1) < *numEntries) {
+        if (child+1 < *numEntries && entries[child+1].cost < entries[child].cost) {
+            child++;
+        }
+        if (last.cost <= entries[child].cost) {
+            break;
+        }
+        entries[i] = entries[child];
+        i = child;
+    }
+    entries[i] = last;
+    return top;
+}
+
+//makes sure there is a heap for every thread of the pool. Returns 0 if memory allocation failed
+static int prepareScratch(IsoFlowFieldCache *cache) {
+    IsoFlowScratch *newScratch = NULL;
+    int numThreads = ThreadPool_GetNumThreads();
+
+    if (cache->numScratch >= numThreads) {
+        return 1;
+    }
+    newScratch = realloc(cache->scratch,sizeof(struct IsoFlowScratch)*numThreads);
+    if (newScratch == NULL) {
+        WriteError("Could not allocate memory for the flow fields of %d threads!",numThreads);
+        return 0;
+    }
+    cache->scratch = newScratch;
+    cache->numScratch = numThreads;
+    return 1;
+}
+
+static int isWalkable(IsoPathfinder *pathfinder,int x,int y) {
+    if (x < 0 || x >= pathfinder->mapWidth || y < 0 || y >= pathfinder->mapHeight) {
+        return 0;
+    }
+    return pathfinder->walkable[y*pathfinder->mapWidth + x];
+}
+
+//finds the cost to the goal of every tile of the chunk, from the goal if it is in the chunk, and from the entrances
+//of the chunk if withEntrances is 1. The costs stay inside the chunk, the costs of the entrances bring in the rest
+//of the map
+static void integrateChunk(IsoFlowFieldCache *cache,IsoPathfinder *pathfinder,IsoFlowScratch *scratch,int chunkIndex,int withEntrances) {
+    IsoPathChunk *chunk = &pathfinder->chunks[chunkIndex];
+    IsoFlowHeapEntry entry;
+    int x0 = (chunkIndex % pathfinder->numChunksX) << ISO_MAP_CHUNK_SHIFT;
+    int y0 = (chunkIndex / pathfinder->numChunksX) << ISO_MAP_CHUNK_SHIFT;
+    int x1 = SDL_min(x0 + ISO_MAP_CHUNK_SIZE,pathfinder->mapWidth);
+    int y1 = SDL_min(y0 + ISO_MAP_CHUNK_SIZE,pathfinder->mapHeight);
+    int goalX = cache->buildField->goalX, goalY = cache->buildField->goalY;
+    int x = 0, y = 0, nextX = 0, nextY = 0;
+    int tile = 0, nextTile = 0, step = 0, i = 0;
+    Uint32 cost = 0;
+
+    for (y = y0; y < y1; ++y) {
+        for (x = x0; x < x1; ++x) {
+            cache->integration[y*cache->mapWidth + x] = ISO_FLOW_COST_INFINITE;
+        }
+    }
+    scratch->numEntries = 0;
+    if (goalX >= x0 && goalX < x1 && goalY >= y0 && goalY < y1) {
+        cache->integration[goalY*cache->mapWidth + goalX] = 0;
+        heapPush(scratch->heap,&scratch->numEntries,0,goalY*cache->mapWidth + goalX);
+    }
+    for (i = 0; i < chunk->numNodes && withEntrances; ++i) {
+        cost = cache->nodeCosts[chunkIndex*ISO_PATH_MAX_CHUNK_NODES + i];
+        tile = chunk->nodes[i].y*cache->mapWidth + chunk->nodes[i].x;
+        if (cost < cache->integration[tile]) {
+            cache->integration[tile] = cost;
+            heapPush(scratch->heap,&scratch->numEntries,cost,tile);
+        }
+    }
+
+    while (scratch->numEntries > 0) {
+        entry = heapPop(scratch->heap,&scratch->numEntries);
+        tile = entry.index;
+        if (entry.cost > cache->integration[tile]) {
+            continue;
+        }
+        x = tile % cache->mapWidth;
+        y = tile / cache->mapWidth;
+        for (step = 0; step < 8; ++step) {
+            nextX = x + stepX[step];
+            nextY = y + stepY[step];
+            nextTile = nextY*cache->mapWidth + nextX;
+            //the tiles around a tile inside the chunk are on the map, so the walkable tiles are read directly
+            if (nextX < x0 || nextX >= x1 || nextY < y0 || nextY >= y1 || !pathfinder->walkable[nextTile]) {
+                continue;
+            }
+            //a diagonal step may not cut the corner of a tile that can not be walked on
+            if (step >= 4 && (!pathfinder->walkable[y*cache->mapWidth + nextX] || !pathfinder->walkable[nextY*cache->mapWidth + x])) {
+                continue;
+            }
+            cost = entry.cost + (step < 4 ? ISO_PATH_COST_STRAIGHT : ISO_PATH_COST_DIAGONAL);
+            if (cost < cache->integration[nextTile]) {
+                cache->integration[nextTile] = cost;
+                heapPush(scratch->heap,&scratch->numEntries,cost,nextTile);
+            }
+        }
+    }
+}
+
+static void integrateChunkTask(int taskIndex,int threadIndex,void *data) {
+    IsoFlowFieldCache *cache = data;
+
+    integrateChunk(cache,cache->buildPathfinder,&cache->scratch[threadIndex],taskIndex,1);
+}
+
+//gives every tile of the chunk the step toward the tile around it that is closest to the goal. Every tile that
+//can reach the goal has a tile around it with a lower cost, so following the steps always ends at the goal
+static void directChunkTask(int taskIndex,int threadIndex,void *data) {
+    IsoFlowFieldCache *cache = data;
+    IsoPathfinder *pathfinder = cache->buildPathfinder;
+    int x0 = (taskIndex % pathfinder->numChunksX) << ISO_MAP_CHUNK_SHIFT;
+    int y0 = (taskIndex / pathfinder->numChunksX) << ISO_MAP_CHUNK_SHIFT;
+    int x1 = SDL_min(x0 + ISO_MAP_CHUNK_SIZE,pathfinder->mapWidth);
+    int y1 = SDL_min(y0 + ISO_MAP_CHUNK_SIZE,pathfinder->mapHeight);
+    int x = 0, y = 0, nextX = 0, nextY = 0;
+    int tile = 0, nextTile = 0, step = 0, bestStep = 0;
+    Uint32 cost = 0, bestCost = 0;
+
+    (void)threadIndex;
+    for (y = y0; y < y1; ++y) {
+        for (x = x0; x < x1; ++x) {
+            tile = y*cache->mapWidth + x;
+            cache->buildField->directions[tile] = ISO_FLOW_DIRECTION_NONE;
+            if (cache->integration[tile] == ISO_FLOW_COST_INFINITE || cache->integration[tile] == 0) {
+                continue;
+            }
+            bestStep = ISO_FLOW_DIRECTION_NONE;
+            bestCost = cache->integration[tile];
+            for (step = 0; step < 8; ++step) {
+                nextX = x + stepX[step];
+                nextY = y + stepY[step];
+                if (!isWalkable(pathfinder,nextX,nextY)) {
+                    continue;
+                }
+                if (step >= 4 && (!isWalkable(pathfinder,nextX,y) || !isWalkable(pathfinder,x,nextY))) {
+                    continue;
+                }
+                nextTile = nextY*cache->mapWidth + nextX;
+                if (cache->integration[nextTile] == ISO_FLOW_COST_INFINITE) {
+                    continue;
+                }
+                cost = cache->integration[nextTile] + (step < 4 ? ISO_PATH_COST_STRAIGHT : ISO_PATH_COST_DIAGONAL);
+                if (cost <= bestCost) {
+                    bestCost = cost;
+                    bestStep = step;
+                }
+            }
+            cache->buildField->directions[tile] = bestStep;
+        }
+    }
+}
+
+static void relaxNode(IsoFlowFieldCache *cache,IsoFlowHeapEntry **heap,int *numEntries,int *maxEntries,int node,Uint32 cost) {
+    IsoFlowHeapEntry *newHeap = NULL;
+
+    if (cost >= cache->nodeCosts[node]) {
+        return;
+    }
+    if (*numEntries >= *maxEntries) {
+        newHeap = realloc(*heap,sizeof(struct IsoFlowHeapEntry)*(*maxEntries > 0 ? *maxEntries*2 : 256));
+        if (newHeap == NULL) {
+            WriteError("Could not allocate memory for the flow field!");
+            return;
+        }
+        *heap = newHeap;
+        *maxEntries = *maxEntries > 0 ? *maxEntries*2 : 256;
+    }
+    cache->nodeCosts[node] = cost;
+    heapPush(*heap,numEntries,cost,node);
+}
+
+//finds the costs to the goal of the nodes of the abstract graph, and then of every tile one chunk at a time, and
+//the steps toward the goal from them
+static void buildField(IsoFlowFieldCache *cache,IsoPathfinder *pathfinder,IsoFlowField *field,int goalX,int goalY) {
+    Uint64 buildTimer = SDL_GetPerformanceCounter();
+    int numChunks = pathfinder->numChunksX*pathfinder->numChunksY;
+    IsoFlowHeapEntry *nodeHeap = NULL;
+    IsoFlowHeapEntry entry;
+    IsoPathChunk *chunk = NULL;
+    IsoPathNode *node = NULL;
+    int numEntries = 0, maxEntries = 0;
+    int goalChunk = 0, chunkIndex = 0, nodeIndex = 0;
+    int i = 0, j = 0;
+
+    field->goalX = goalX;
+    field->goalY = goalY;
+    field->version = pathfinder->version;
+    cache->buildField = field;
+    cache->buildPathfinder = pathfinder;
+    if (!isWalkable(pathfinder,goalX,goalY)) {
+        memset(field->directions,ISO_FLOW_DIRECTION_NONE,cache->mapWidth*cache->mapHeight);
+        return;
+    }
+
+    //the costs from the goal to the entrances of its chunk start the search in the abstract graph
+    for (i = 0; i < numChunks*ISO_PATH_MAX_CHUNK_NODES; ++i) {
+        cache->nodeCosts[i] = ISO_FLOW_COST_INFINITE;
+    }
+    goalChunk = (goalY >> ISO_MAP_CHUNK_SHIFT)*pathfinder->numChunksX + (goalX >> ISO_MAP_CHUNK_SHIFT);
+    integrateChunk(cache,pathfinder,&cache->scratch[0],goalChunk,0);
+    chunk = &pathfinder->chunks[goalChunk];
+    for (i = 0; i < chunk->numNodes; ++i) {
+        relaxNode(cache,&nodeHeap,&numEntries,&maxEntries,goalChunk*ISO_PATH_MAX_CHUNK_NODES + i,
+                  cache->integration[chunk->nodes[i].y*cache->mapWidth + chunk->nodes[i].x]);
+    }
+    while (numEntries > 0) {
+        entry = heapPop(nodeHeap,&numEntries);
+        if (entry.cost > cache->nodeCosts[entry.index]) {
+            continue;
+        }
+        chunkIndex = entry.index / ISO_PATH_MAX_CHUNK_NODES;
+        nodeIndex = entry.index % ISO_PATH_MAX_CHUNK_NODES;
+        chunk = &pathfinder->chunks[chunkIndex];
+        node = &chunk->nodes[nodeIndex];
+        for (j = 0; j < chunk->numNodes; ++j) {
+            if (chunk->costs[nodeIndex*ISO_PATH_MAX_CHUNK_NODES + j] != ISO_PATH_COST_INFINITE) {
+                relaxNode(cache,&nodeHeap,&numEntries,&maxEntries,chunkIndex*ISO_PATH_MAX_CHUNK_NODES + j,
+                          entry.cost + chunk->costs[nodeIndex*ISO_PATH_MAX_CHUNK_NODES + j]);
+            }
+        }
+        for (j = 0; j < node->numLinks; ++j) {
+            relaxNode(cache,&nodeHeap,&numEntries,&maxEntries,node->links[j],entry.cost + ISO_PATH_COST_STRAIGHT);
+        }
+    }
+    free(nodeHeap);
+
+    //every chunk only writes the costs and the steps of its own tiles, the steps are found when all the costs are
+    ThreadPool_ParallelFor(numChunks,integrateChunkTask,cache);
+    ThreadPool_ParallelFor(numChunks,directChunkTask,cache);
+
+    cache->numFieldsBuilt++;
+    cache->buildTimeLastField = (double)(SDL_GetPerformanceCounter()-buildTimer)*1000.0/SDL_GetPerformanceFrequency();
+}
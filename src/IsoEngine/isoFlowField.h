@@ -0,0 +1,49 @@
+#ifndef __ISO_FLOW_FIELD_H
+#define __ISO_FLOW_FIELD_H
+
+#include <SDL2/SDL.h>
+#include "isoPathfinder.h"
+
+//number of goals the flow fields are kept for, the least recently used field is built again for a new goal
+#define ISO_FLOW_FIELD_MAX_FIELDS       8
+//direction of the tiles where there is nowhere to go, the goal and the tiles that can not reach it
+#define ISO_FLOW_DIRECTION_NONE         0xff
+
+//the way to one goal from every tile of the map
+typedef struct IsoFlowField {
+    int goalX;                  //-1 if the field is not used
+    int goalY;
+    Uint8 *directions;          //the step to take on every tile (0-7), or ISO_FLOW_DIRECTION_NONE
+    Uint32 version;             //version of the walkable tiles of the pathfinder the field was built from
+    Uint32 lastUsed;            //the least recently used field is built again first
+} IsoFlowField;
+
+struct IsoFlowScratch;
+
+//Flow fields for many entities that walk to the same tile. The cost to the goal is found for every tile, and every
+//tile gets the step toward the neighbour that is closest to the goal, so an entity only has to look up the tile it
+//stands on. The costs are found on the abstract graph of the pathfinder first, and then inside every chunk from its
+//entrances, one chunk per task on the thread pool. Fields are built when they are asked for, and again when the
+//walkable tiles of the pathfinder have changed
+typedef struct IsoFlowFieldCache {
+    IsoFlowField fields[ISO_FLOW_FIELD_MAX_FIELDS];
+    int lastField;              //the field that was asked for last, most entities ask for the same one in a row
+    Uint32 useCounter;
+    int mapWidth;
+    int mapHeight;
+    Uint32 *integration;        //cost to the goal of every tile, for the field that is being built
+    Uint32 *nodeCosts;          //cost to the goal of every node of the abstract graph
+    struct IsoFlowScratch *scratch;
+    int numScratch;
+    IsoFlowField *buildField;   //the field the tasks are building
+    IsoPathfinder *buildPathfinder;
+    int numFieldsBuilt;
+    double buildTimeLastField;  //ms
+} IsoFlowFieldCache;
+
+[[nodiscard]] IsoFlowFieldCache *isoFlowFieldCacheNew(IsoPathfinder *pathfinder);
+void isoFlowFieldCacheFree(IsoFlowFieldCache *cache);
+[[nodiscard]] IsoFlowField *isoFlowFieldCacheGetField(IsoFlowFieldCache *cache,IsoPathfinder *pathfinder,int goalX,int goalY);
+[[nodiscard]] int isoFlowFieldGetDirection(IsoFlowFieldCache *cache,IsoFlowField *field,int x,int y,SDL_FPoint *direction);
+
+#endif // __ISO_FLOW_FIELD_H
@@ -4,25 +4,36 @@
 #include <math.h>
 #include "isoEngine.h"
 #include "isoMap.h"
+#include "isoMapFile.h"
 #include "../Texture.h"
 #include "../logger.h"
 #include "perlinNoise.h"
 
+//how many tiles around a changed terrain height the auto tiling passes can change
+#define RETILE_REACH 6
+
+//frequency (0.04) and persistence (0.02) of the terrain noise, in fixed point
+#define NOISE_FREQUENCY 2621
+#define NOISE_PERSISTENCE 1311
+
 static void isoGenerateMap(IsoMap *isoMap, int perlinSeed, int terrainHeight);
 static void generatePerlinNoiseMap(IsoMap *isoMap, float *noiseMap,int perlinSeed,int truncateTerrainHeight);
 static void rewriteNoiseMapTerrainHeight(IsoMap *isoMap, float *noiseMap, int truncateTerrainHeight);
 static void drawPerlinNoiseTerrain(IsoMap *isoMap,float *noiseMap);
 static void drawGreenGrass(IsoMap *isoMap);
-static int tileIsWithinTerrainHeight(int tileValue,int terrainHeight);
-static int countNumberOfNeighbouringTiles(IsoMap *isoMap,int x,int y,int layer,int terrainHeight);
-static void deleteSingleTiles(IsoMap *isoMap,int layer,float *noiseMap);
-static int bitWiseCalculateTile(IsoMap *isoMap,int x,int y,int layer,int terrainHeight);
+static void deleteSingleTiles(IsoMap *isoMap,int layer,int x0,int y0,int x1,int y1);
 static void autoTileTerrain(IsoMap *isoMap, int layer);
-static int bitWiseCalculateInnerTiles(IsoMap *isoMap,int x,int y,int layer,int terrainHeight);
+static void autoTileInnerCornerTiles(IsoMap *isoMap, int layer);
 static void correctMinorErrorsInSlopes(IsoMap *isoMap);
 static void deleteTilesAtMapEdges(IsoMap *isoMap);
+static void storeTerrainHeights(IsoMap *isoMap);
+static int retileRegion(IsoMap *isoMap,int x0,int y0,int x1,int y1,int deleteSingles);
+static void tilesCoveredBy(float start,float end,float delta,int tileSize,int *first,int *last);
+static int findTileWithFlags(IsoMap *isoMap,int x0,int y0,int x1,int y1,Uint8 flagMask,IsoMapSweepHit *hit);
+
+IsoMap* isoMapCreateEmptyMap(char *mapName,int width,int height,int numLayers,int tileSize) {
+    int i = 0;
 
-IsoMap* isoMapCreateNewMap(char *mapName,int width,int height,int numLayers,int tileSize,int perlinSeed, int terrainHeight) {
     //Set failsafe values
     if (height <= 0) {
         height = 10;
@@ -42,18 +53,42 @@ IsoMap* isoMapCreateNewMap(char *mapName,int width,int height,int numLayers,int
         WriteError("Could not allocate memory for isometric map!");
         return NULL;
     }
-    //allocate memory for map data (the actual tiles)
-    isoMap->mapData = malloc(1 + width * height * numLayers * sizeof(int));
-    if (isoMap->mapData == NULL) {
-        WriteError("Could not allocate memory for isometric map data!");
+
+    isoMap->mapHeight = height;
+    isoMap->mapWidth = width;
+    isoMap->numLayers = numLayers;
+    isoMap->mapFile = NULL;
+    isoMap->generatorVersion = 0;
+    isoMap->seed = 0;
+    isoMap->terrainHeight = 0;
+
+    //calculate the number of chunks needed to cover the map
+    isoMap->numChunksX = (width + ISO_MAP_CHUNK_SIZE-1) >> ISO_MAP_CHUNK_SHIFT;
+    isoMap->numChunksY = (height + ISO_MAP_CHUNK_SIZE-1) >> ISO_MAP_CHUNK_SHIFT;
+
+    //allocate memory for the chunk table. The tiles of a chunk are allocated
+    //the first time a tile in the chunk is written to, or paged in from the map file
+    isoMap->chunks = malloc(sizeof(struct IsoMapChunk) * isoMap->numChunksX * isoMap->numChunksY);
+    if (isoMap->chunks == NULL) {
+        WriteError("Could not allocate memory for isometric map chunks!");
+        free(isoMap);
         return NULL;
     }
-    memset(isoMap->mapData,-1,width * height *numLayers *sizeof(int));
+    for (i = 0; i < isoMap->numChunksX * isoMap->numChunksY; ++i) {
+        isoMap->chunks[i].tiles = NULL;
+        isoMap->chunks[i].flags = NULL;
+        isoMap->chunks[i].heights = NULL;
+        isoMap->chunks[i].dirtyFlags = 0;
+        isoMap->chunks[i].isResident = 0;
+        isoMap->chunks[i].ownsMemory = 0;
+    }
 
     //allocate memory for the tile set
     isoMap->tileSet = malloc(sizeof(struct IsoTileSet));
     if (isoMap->tileSet == NULL) {
         WriteError("Could not allocate memory for tile set!");
+        free(isoMap->chunks);
+        free(isoMap);
         return NULL;
     }
 
@@ -62,27 +97,51 @@ IsoMap* isoMapCreateNewMap(char *mapName,int width,int height,int numLayers,int
 
     isoMap->tileSet->tileClipRects = NULL;
     isoMap->tileSet->tileSetLoaded = 0;
-
-    isoMap->mapHeight = height;
-    isoMap->mapWidth = width;
-    isoMap->numLayers = numLayers;
+    isoMap->tileSet->textureName[0] = '\0';
+    isoMap->tileSet->tileWidth = 0;
+    isoMap->tileSet->tileHeight = 0;
 
     if (mapName == NULL) {
-        sprintf(isoMap->name,mapName,"Unnamed map");
+        snprintf(isoMap->name,MAP_NAME_LENGTH,"Unnamed map");
     }
     else {
         strncpy(isoMap->name,mapName,MAP_NAME_LENGTH-1);
+        isoMap->name[MAP_NAME_LENGTH-1] = '\0';
     }
     //Divide the tile size by two
     isoMap->tileSize = tileSize/2;
+    return isoMap;
+}
+
+IsoMap* isoMapCreateNewMap(char *mapName,int width,int height,int numLayers,int tileSize,int perlinSeed, int terrainHeight) {
+    IsoMap *isoMap = isoMapCreateEmptyMap(mapName,width,height,numLayers,tileSize);
+    if (isoMap == NULL) {
+        return NULL;
+    }
     isoGenerateMap(isoMap,perlinSeed,terrainHeight);
+    //remember how the map was generated, so a saved map can be checked against the generator
+    isoMap->generatorVersion = ISO_MAP_GENERATOR_VERSION;
+    isoMap->seed = perlinSeed;
+    isoMap->terrainHeight = terrainHeight;
     return isoMap;
 }
 
 void isoMapFreeMap(IsoMap *isoMap) {
+    int i = 0;
     if (isoMap != NULL) {
-        if (isoMap->mapData!=NULL) {
-            free(isoMap->mapData);
+        if (isoMap->chunks!=NULL) {
+            for (i = 0; i < isoMap->numChunksX * isoMap->numChunksY; ++i) {
+                //chunks pointing into the mapped file are released when the file is closed
+                if (isoMap->chunks[i].ownsMemory) {
+                    free(isoMap->chunks[i].tiles);
+                    free(isoMap->chunks[i].flags);
+                }
+                free(isoMap->chunks[i].heights);
+            }
+            free(isoMap->chunks);
+        }
+        if (isoMap->mapFile!=NULL) {
+            isoMapFileClose(isoMap->mapFile);
         }
         if (isoMap->tileSet!=NULL) {
             if (isoMap->tileSet->tileClipRects!=NULL) {
@@ -96,6 +155,55 @@ void isoMapFreeMap(IsoMap *isoMap) {
     }
 }
 
+int isoMapAllocateChunk(IsoMap *isoMap,IsoMapChunk *chunk) {
+    int numTiles = ISO_MAP_CHUNK_SIZE * ISO_MAP_CHUNK_SIZE;
+
+    chunk->tiles = malloc(sizeof(int) * numTiles * isoMap->numLayers);
+    chunk->flags = malloc(sizeof(Uint8) * numTiles);
+    chunk->heights = malloc(sizeof(Sint8) * numTiles);
+    if (chunk->tiles == NULL || chunk->flags == NULL || chunk->heights == NULL) {
+        WriteError("Could not allocate memory for isometric map chunk!");
+        free(chunk->tiles);
+        free(chunk->flags);
+        free(chunk->heights);
+        chunk->tiles = NULL;
+        chunk->flags = NULL;
+        chunk->heights = NULL;
+        return -1;
+    }
+    //all tiles start out empty, so they have no ground and block
+    memset(chunk->tiles,-1,sizeof(int) * numTiles * isoMap->numLayers);
+    memset(chunk->flags,ISO_TILE_FLAG_BLOCKING,sizeof(Uint8) * numTiles);
+    memset(chunk->heights,0,sizeof(Sint8) * numTiles);
+    chunk->dirtyFlags = ISO_MAP_CHUNK_DIRTY_ALL;
+    chunk->isResident = 1;
+    chunk->ownsMemory = 1;
+    return 1;
+}
+
+//returns the chunk the tile x,y belongs to, paging it in from the map file if needed.
+//Returns NULL if the chunk has no data and allocate is 0
+static IsoMapChunk *getChunk(IsoMap *isoMap,int x,int y,int allocate) {
+    int chunkIndex = (y >> ISO_MAP_CHUNK_SHIFT) * isoMap->numChunksX + (x >> ISO_MAP_CHUNK_SHIFT);
+    IsoMapChunk *chunk = &isoMap->chunks[chunkIndex];
+
+    if (chunk->isResident) {
+        return chunk;
+    }
+    //if the map was loaded from a file, page the chunk in
+    if (isoMap->mapFile != NULL) {
+        if (isoMapFilePageInChunk(isoMap,chunkIndex) == -1) {
+            return NULL;
+        }
+        return chunk;
+    }
+    //empty chunks are only allocated when they are written to
+    if (allocate == 0 || isoMapAllocateChunk(isoMap,chunk) == -1) {
+        return NULL;
+    }
+    return chunk;
+}
+
 int isoMapLoadTileSet(IsoMap *isoMap,Texture *texture,int tileWidth,int tileHeight) {
     int x=0,y=0;
     int w,h;
@@ -119,6 +227,8 @@ int isoMapLoadTileSet(IsoMap *isoMap,Texture *texture,int tileWidth,int tileHeig
     }
 
     isoMap->tileSet->tilesTex = texture;
+    isoMap->tileSet->tileWidth = tileWidth;
+    isoMap->tileSet->tileHeight = tileHeight;
 
     //get width and height
     w = isoMap->tileSet->tilesTex->width;
@@ -169,22 +279,358 @@ int isoMapLoadTileSet(IsoMap *isoMap,Texture *texture,int tileWidth,int tileHeig
     return 1;
 }
 
+void isoMapSetTileSetName(IsoMap *isoMap,char *textureName) {
+    if (isoMap == NULL || textureName == NULL) {
+        WriteError("Parameter: 'IsoMap *isoMap' or 'char *textureName' is NULL!");
+        return;
+    }
+    //the name is stored in the map file so the tile set can be found again when the map is loaded
+    strncpy(isoMap->tileSet->textureName,textureName,TILESET_NAME_LENGTH-1);
+    isoMap->tileSet->textureName[TILESET_NAME_LENGTH-1] = '\0';
+}
+
+//returns ISO_TILE_FLAG_BLOCKING if the tile has no ground tile, or a tile stands on it in a layer above the ground
+static Uint8 blockingFlag(IsoMap *isoMap,IsoMapChunk *chunk,int tileIndex) {
+    int *tiles = &chunk->tiles[tileIndex * isoMap->numLayers];
+    int layer = 0;
+
+    if (tiles[0] < 0) {
+        return ISO_TILE_FLAG_BLOCKING;
+    }
+    for (layer = 1; layer < isoMap->numLayers; ++layer) {
+        if (tiles[layer] >= 0) {
+            return ISO_TILE_FLAG_BLOCKING;
+        }
+    }
+    return 0;
+}
+
 int isoMapGetTile(IsoMap *isoMap,int x,int y,int layer) {
-    if (x < 0 || x > isoMap->mapWidth-1 || y < 0 || y > isoMap->mapHeight-1 || layer < 0 || layer > isoMap->numLayers) {
+    IsoMapChunk *chunk = NULL;
+    if (x < 0 || x > isoMap->mapWidth-1 || y < 0 || y > isoMap->mapHeight-1 || layer < 0 || layer >= isoMap->numLayers) {
+        return -1;
+    }
+    chunk = getChunk(isoMap,x,y,0);
+    if (chunk == NULL) {
         return -1;
     }
-    return isoMap->mapData[(y * isoMap->mapWidth + x) * isoMap->numLayers + layer];
+    return chunk->tiles[(((y & ISO_MAP_CHUNK_MASK) << ISO_MAP_CHUNK_SHIFT) + (x & ISO_MAP_CHUNK_MASK)) * isoMap->numLayers + layer];
 }
 
 void isoMapSetTile(IsoMap *isoMap,int x,int y,int layer,int value) {
+    IsoMapChunk *chunk = NULL;
+    int tileIndex = 0;
     if (isoMap == NULL) {
         return;
     }
 
-    if (x < 0 || x > isoMap->mapWidth-1 || y < 0 || y > isoMap->mapHeight-1 || layer < 0 || layer > isoMap->numLayers) {
+    if (x < 0 || x > isoMap->mapWidth-1 || y < 0 || y > isoMap->mapHeight-1 || layer < 0 || layer >= isoMap->numLayers) {
         return;
     }
-    isoMap->mapData[(y * isoMap->mapWidth + x) * isoMap->numLayers + layer] = value;
+    chunk = getChunk(isoMap,x,y,1);
+    if (chunk == NULL) {
+        return;
+    }
+    tileIndex = ((y & ISO_MAP_CHUNK_MASK) << ISO_MAP_CHUNK_SHIFT) + (x & ISO_MAP_CHUNK_MASK);
+    chunk->tiles[tileIndex * isoMap->numLayers + layer] = value;
+    chunk->flags[tileIndex] = (chunk->flags[tileIndex] & ~ISO_TILE_FLAG_BLOCKING) | blockingFlag(isoMap,chunk,tileIndex);
+    chunk->dirtyFlags = ISO_MAP_CHUNK_DIRTY_ALL;
+}
+
+Uint8 isoMapGetTileFlags(IsoMap *isoMap,int x,int y) {
+    IsoMapChunk *chunk = NULL;
+    if (x < 0 || x > isoMap->mapWidth-1 || y < 0 || y > isoMap->mapHeight-1) {
+        return 0;
+    }
+    chunk = getChunk(isoMap,x,y,0);
+    //a chunk that was never written to has no ground
+    if (chunk == NULL) {
+        return ISO_TILE_FLAG_BLOCKING;
+    }
+    return chunk->flags[((y & ISO_MAP_CHUNK_MASK) << ISO_MAP_CHUNK_SHIFT) + (x & ISO_MAP_CHUNK_MASK)];
+}
+
+void isoMapSetTileFlags(IsoMap *isoMap,int x,int y,Uint8 flags) {
+    IsoMapChunk *chunk = NULL;
+    int tileIndex = 0;
+    if (isoMap == NULL) {
+        return;
+    }
+    if (x < 0 || x > isoMap->mapWidth-1 || y < 0 || y > isoMap->mapHeight-1) {
+        return;
+    }
+    chunk = getChunk(isoMap,x,y,1);
+    if (chunk == NULL) {
+        return;
+    }
+    tileIndex = ((y & ISO_MAP_CHUNK_MASK) << ISO_MAP_CHUNK_SHIFT) + (x & ISO_MAP_CHUNK_MASK);
+    //the blocking flag comes from the tiles, so it is kept
+    chunk->flags[tileIndex] = (flags & ~ISO_TILE_FLAG_BLOCKING) | (chunk->flags[tileIndex] & ISO_TILE_FLAG_BLOCKING);
+    //the flags are not drawn on the map, so the rendered chunk stays valid
+    chunk->dirtyFlags |= ISO_MAP_CHUNK_DIRTY_MINIMAP | ISO_MAP_CHUNK_DIRTY_NAV;
+}
+
+//returns 1 if entities can walk on the tile: it is on the map, does not block and no static body stands on it.
+//The pathfinder and the flow fields get their walkable tiles from here, so they agree on where entities can go
+int isoMapTileIsWalkable(IsoMap *isoMap,int x,int y) {
+    if (isoMap == NULL || x < 0 || x > isoMap->mapWidth-1 || y < 0 || y > isoMap->mapHeight-1) {
+        return 0;
+    }
+    return (isoMapGetTileFlags(isoMap,x,y) & (ISO_TILE_FLAG_BLOCKING | ISO_TILE_FLAG_OCCUPIED)) == 0;
+}
+
+//sets the blocking flag of every tile in the chunk from its tiles. Flags that are already right are not written,
+//so a chunk used straight from a mapped map file is only copied when its flags were saved without the blocking flag.
+//Returns the number of tiles that changed
+int isoMapUpdateChunkFlags(IsoMap *isoMap,IsoMapChunk *chunk) {
+    int tileIndex = 0;
+    int numChanged = 0;
+    Uint8 flags = 0;
+
+    if (isoMap == NULL || chunk == NULL || chunk->isResident == 0) {
+        return 0;
+    }
+    for (tileIndex = 0; tileIndex < ISO_MAP_CHUNK_SIZE*ISO_MAP_CHUNK_SIZE; ++tileIndex) {
+        flags = (chunk->flags[tileIndex] & ~ISO_TILE_FLAG_BLOCKING) | blockingFlag(isoMap,chunk,tileIndex);
+        if (flags != chunk->flags[tileIndex]) {
+            chunk->flags[tileIndex] = flags;
+            numChanged++;
+        }
+    }
+    return numChanged;
+}
+
+//finds the tiles the range start - end covers on one axis. The end is not included, unless the range moves
+//towards it with delta, then a tile the range only touches is included, because the range enters it next
+static void tilesCoveredBy(float start,float end,float delta,int tileSize,int *first,int *last) {
+    *first = delta < 0 ? (int)ceilf(start/tileSize)-1 : (int)floorf(start/tileSize);
+    *last = delta > 0 ? (int)floorf(end/tileSize) : (int)ceilf(end/tileSize)-1;
+}
+
+//returns 1 if one of the tiles x0,y0 - x1,y1 (x1,y1 included) has one of the flags, and puts the tile in hit
+static int findTileWithFlags(IsoMap *isoMap,int x0,int y0,int x1,int y1,Uint8 flagMask,IsoMapSweepHit *hit) {
+    int x = 0, y = 0;
+
+    for (y = y0; y <= y1; ++y) {
+        for (x = x0; x <= x1; ++x) {
+            if (isoMapGetTileFlags(isoMap,x,y) & flagMask) {
+                hit->tileX = x;
+                hit->tileY = y;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+//sweeps the rectangle (in world units) by dx,dy and finds the first tile with one of the flags it runs into.
+//The grid lines are crossed in the order the leading edges of the rectangle reach them, and only the row or
+//column of tiles the edge enters is looked at, so the cost grows with the number of tiles crossed and not with
+//how fast the rectangle moves. Tiles the rectangle is already in are not hit, so it can always move out of them.
+//Returns 1 and fills in hit if a tile is hit before the end of the movement
+int isoMapSweepRect(IsoMap *isoMap,SDL_FRect *rect,float dx,float dy,Uint8 flagMask,IsoMapSweepHit *hit) {
+    int tileSize = 0;
+    int stepX = 0, stepY = 0;
+    int nextX = 0, nextY = 0;
+    int first = 0, last = 0;
+    float timeX = 2, timeY = 2;
+    float deltaTimeX = 0, deltaTimeY = 0;
+    float time = 0;
+
+    if (isoMap == NULL || rect == NULL || hit == NULL || (dx == 0 && dy == 0)) {
+        return 0;
+    }
+    tileSize = isoMap->tileSize;
+
+    //the first column and row of tiles the leading edges enter, and when they reach them
+    if (dx > 0) {
+        stepX = 1;
+        nextX = (int)ceilf((rect->x + rect->w)/tileSize);
+        timeX = (nextX*tileSize - (rect->x + rect->w))/dx;
+        deltaTimeX = tileSize/dx;
+    }
+    else if (dx < 0) {
+        stepX = -1;
+        nextX = (int)floorf(rect->x/tileSize)-1;
+        timeX = ((nextX+1)*tileSize - rect->x)/dx;
+        deltaTimeX = -tileSize/dx;
+    }
+    if (dy > 0) {
+        stepY = 1;
+        nextY = (int)ceilf((rect->y + rect->h)/tileSize);
+        timeY = (nextY*tileSize - (rect->y + rect->h))/dy;
+        deltaTimeY = tileSize/dy;
+    }
+    else if (dy < 0) {
+        stepY = -1;
+        nextY = (int)floorf(rect->y/tileSize)-1;
+        timeY = ((nextY+1)*tileSize - rect->y)/dy;
+        deltaTimeY = -tileSize/dy;
+    }
+
+    //a rectangle that ends exactly on a grid line only touches the tile behind it
+    while (timeX < 1 || timeY < 1) {
+        if (timeX <= timeY) {
+            time = timeX;
+            //the rows the rectangle covers when its edge reaches the column
+            tilesCoveredBy(rect->y + dy*time,rect->y + rect->h + dy*time,dy,tileSize,&first,&last);
+            if (findTileWithFlags(isoMap,nextX,first,nextX,last,flagMask,hit)) {
+                hit->time = time;
+                hit->normalX = -stepX;
+                hit->normalY = 0;
+                return 1;
+            }
+            nextX += stepX;
+            timeX += deltaTimeX;
+        }
+        else {
+            time = timeY;
+            //the columns the rectangle covers when its edge reaches the row
+            tilesCoveredBy(rect->x + dx*time,rect->x + rect->w + dx*time,dx,tileSize,&first,&last);
+            if (findTileWithFlags(isoMap,first,nextY,last,nextY,flagMask,hit)) {
+                hit->time = time;
+                hit->normalX = 0;
+                hit->normalY = -stepY;
+                return 1;
+            }
+            nextY += stepY;
+            timeY += deltaTimeY;
+        }
+    }
+    return 0;
+}
+
+int isoMapGetTerrainHeight(IsoMap *isoMap,int x,int y) {
+    IsoMapChunk *chunk = NULL;
+    if (x < 0 || x > isoMap->mapWidth-1 || y < 0 || y > isoMap->mapHeight-1) {
+        return 0;
+    }
+    chunk = getChunk(isoMap,x,y,0);
+    if (chunk == NULL) {
+        return 0;
+    }
+    return chunk->heights[((y & ISO_MAP_CHUNK_MASK) << ISO_MAP_CHUNK_SHIFT) + (x & ISO_MAP_CHUNK_MASK)];
+}
+
+static void setTerrainHeight(IsoMap *isoMap,int x,int y,int height) {
+    IsoMapChunk *chunk = NULL;
+    if (x < 0 || x > isoMap->mapWidth-1 || y < 0 || y > isoMap->mapHeight-1) {
+        return;
+    }
+    chunk = getChunk(isoMap,x,y,1);
+    if (chunk == NULL) {
+        return;
+    }
+    chunk->heights[((y & ISO_MAP_CHUNK_MASK) << ISO_MAP_CHUNK_SHIFT) + (x & ISO_MAP_CHUNK_MASK)] = (Sint8)height;
+}
+
+//changes the terrain height of all tiles within the radius of x,y towards the height,
+//and auto tiles the changed area again
+static int changeTerrainHeight(IsoMap *isoMap,int x,int y,int radius,int height,int raise) {
+    int i = 0, j = 0;
+    int tileHeight = 0;
+    int changed = 0;
+
+    //keep the height within the levels of the tile set
+    if (height < 0 || height > NUM_TILE_LEVELS_PER_LAYER) {
+        return 0;
+    }
+    if (radius < 0) {
+        radius = 0;
+    }
+
+    for (j = y-radius; j <= y+radius; ++j) {
+        for (i = x-radius; i <= x+radius; ++i) {
+            //skip tiles outside the map
+            if (i < 0 || i > isoMap->mapWidth-1 || j < 0 || j > isoMap->mapHeight-1) {
+                continue;
+            }
+            tileHeight = isoMapGetTerrainHeight(isoMap,i,j);
+            //only move tiles towards the new height, so the brush flattens the area
+            if ((raise && tileHeight < height) || (!raise && tileHeight > height)) {
+                setTerrainHeight(isoMap,i,j,height);
+                changed = 1;
+            }
+        }
+    }
+    if (changed) {
+        retileRegion(isoMap,x-radius,y-radius,x+radius,y+radius,1);
+    }
+    return changed;
+}
+
+//auto tiles the area x0,y0 - x1,y1 again from the stored terrain heights, without changing any height.
+//Retiling a whole map that was just generated gives back the same tiles
+int isoMapRetileArea(IsoMap *isoMap,int x0,int y0,int x1,int y1) {
+    if (isoMap == NULL) {
+        WriteError("Parameter: 'IsoMap *isoMap' is NULL!");
+        return -1;
+    }
+    return retileRegion(isoMap,x0,y0,x1,y1,0);
+}
+
+int isoMapRaiseTerrain(IsoMap *isoMap,int x,int y,int radius) {
+    if (isoMap == NULL) {
+        WriteError("Parameter: 'IsoMap *isoMap' is NULL!");
+        return 0;
+    }
+    return changeTerrainHeight(isoMap,x,y,radius,isoMapGetTerrainHeight(isoMap,x,y)+1,1);
+}
+
+int isoMapLowerTerrain(IsoMap *isoMap,int x,int y,int radius) {
+    if (isoMap == NULL) {
+        WriteError("Parameter: 'IsoMap *isoMap' is NULL!");
+        return 0;
+    }
+    return changeTerrainHeight(isoMap,x,y,radius,isoMapGetTerrainHeight(isoMap,x,y)-1,0);
+}
+
+//FNV-1a hash of one 32 bit value, byte by byte from the lowest byte
+static Uint64 hashValue(Uint64 hash,Uint32 value) {
+    int i = 0;
+    for (i = 0; i < 4; ++i) {
+        hash ^= (value >> (i*8)) & 0xff;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+Uint64 isoMapComputeHash(IsoMap *isoMap) {
+    Uint64 hash = 0xcbf29ce484222325ULL;
+    int x = 0, y = 0, layer = 0;
+
+    if (isoMap == NULL) {
+        WriteError("Parameter: 'IsoMap *isoMap' is NULL!");
+        return 0;
+    }
+    //hash the map size, every tile and every terrain height in map order,
+    //so the hash does not depend on how the map is stored in memory
+    hash = hashValue(hash,(Uint32)isoMap->mapWidth);
+    hash = hashValue(hash,(Uint32)isoMap->mapHeight);
+    hash = hashValue(hash,(Uint32)isoMap->numLayers);
+    for (y = 0; y < isoMap->mapHeight; ++y) {
+        for (x = 0; x < isoMap->mapWidth; ++x) {
+            for (layer = 0; layer < isoMap->numLayers; ++layer) {
+                hash = hashValue(hash,(Uint32)isoMapGetTile(isoMap,x,y,layer));
+            }
+            hash = hashValue(hash,(Uint32)isoMapGetTerrainHeight(isoMap,x,y));
+        }
+    }
+    return hash;
+}
+
+int isoMapChunkIsDirty(IsoMap *isoMap,int chunkIndex,Uint8 dirtyFlag) {
+    if (chunkIndex < 0 || chunkIndex >= isoMap->numChunksX * isoMap->numChunksY) {
+        return 0;
+    }
+    return (isoMap->chunks[chunkIndex].dirtyFlags & dirtyFlag) != 0;
+}
+
+void isoMapClearChunkDirty(IsoMap *isoMap,int chunkIndex,Uint8 dirtyFlag) {
+    if (chunkIndex < 0 || chunkIndex >= isoMap->numChunksX * isoMap->numChunksY) {
+        return;
+    }
+    isoMap->chunks[chunkIndex].dirtyFlags &= ~dirtyFlag;
 }
 
 static void rewriteNoiseMapTerrainHeight(IsoMap *isoMap, float *noiseMap, int truncateTerrainHeight) {
@@ -215,15 +661,16 @@ static void rewriteNoiseMapTerrainHeight(IsoMap *isoMap, float *noiseMap, int tr
 
 static void generatePerlinNoiseMap(IsoMap *isoMap, float *noiseMap,int perlinSeed,int truncateTerrainHeight) {
     int x=0,y=0;
-    float perlinHeightValue=0;
+    Sint32 perlinHeightValue=0;
     int maxHeight=0;
     int value=0;
 
     //loop over the map
     for (y=0;y<isoMap->mapHeight; ++y) {
         for (x=0;x<isoMap->mapWidth; ++x) {
-            perlinHeightValue = pnoise3d(y * 0.04, x * 0.04, 0, 0.02, 1, perlinSeed);
-            value = (int)((perlinHeightValue + 1) * (truncateTerrainHeight * 0.5));
+            //the noise is calculated in fixed point, so a seed gives the same map on every build
+            perlinHeightValue = pnoise2dFixed(y * NOISE_FREQUENCY, x * NOISE_FREQUENCY, NOISE_PERSISTENCE, 1, (Uint32)perlinSeed);
+            value = (int)(((Sint64)(perlinHeightValue + NOISE_FIXED_ONE) * truncateTerrainHeight) >> (NOISE_FIXED_SHIFT + 1));
 
             //keep values within lower range
             if (value < 0) {
@@ -266,178 +713,177 @@ static void drawGreenGrass(IsoMap *isoMap) {
     }
 }
 
-//This function checks if a tile is part of a terrain height in the tile set.
-//Each row in the tile set is equal to a terrain height
-static int tileIsWithinTerrainHeight(int tileValue,int terrainHeight) {
-    int minTileValue = terrainHeight * NUM_TILES_PER_ROW_IN_TILESET-1;
-    int maxTileValue = minTileValue + NUM_TILES_PER_ROW_IN_TILESET-1;
-
-    if (tileValue >= minTileValue && tileValue  <=  maxTileValue) {
-        return 1;
+//The auto tiling rules are compiled into lookup tables the first time a map is auto tiled.
+//Each row in the tile set is equal to a terrain height, and the rules only look at which row a
+//neighbouring tile is in, or at its position within the row (its local value).
+
+//the inner corner rules. A rule matches when the vertical neighbour is one of the two vertical
+//tiles and the horizontal neighbour is one of the two horizontal tiles. The first rule that
+//matches wins. Since autoTileTerrain() adds 1 to the tile it draws, the values are one less
+//than the tiles in the tile set
+typedef struct InnerCornerRule {
+    int vertical;               //0 for the tile above, 1 for the tile below
+    int verticalTiles[2];
+    int horizontal;             //0 for the tile to the left, 1 for the tile to the right
+    int horizontalTiles[2];
+    int paintTile;
+} InnerCornerRule;
+
+static const InnerCornerRule innerCornerRules[] = {
+    {0, {7,8},   0, {7,15},  8},     //inner tiles up left
+    {0, {13,14}, 1, {13,15}, 18},    //inner tiles up right
+    {1, {4,8},   0, {4,12},  17},    //inner tiles down left
+    {1, {10,14}, 1, {10,12}, 16},    //inner tiles down right
+};
+#define NUM_INNER_CORNER_RULES ((int)(sizeof(innerCornerRules)/sizeof(innerCornerRules[0])))
+
+//the local tile values correctMinorErrorsInSlopes() looks for
+static const int slopeTiles[] = {2,3,4,7,10,13};
+
+typedef struct AutoTileTables {
+    int isBuilt;
+    Uint8 numNeighbours[16];                                //number of bits set in a 4 neighbour mask
+    Uint8 outerTile[16];                                    //tile to draw for a 4 neighbour mask, 0 to keep the tile
+    Uint8 innerVertical[2][NUM_TILES_PER_ROW_IN_TILESET];   //inner corner rules matched by the tile above/below
+    Uint8 innerHorizontal[2][NUM_TILES_PER_ROW_IN_TILESET]; //inner corner rules matched by the tile left/right
+    Uint8 innerTile[1 << NUM_INNER_CORNER_RULES];           //tile to draw for the matching rules, 0 to keep the tile
+    Uint8 isSlopeTile[NUM_TILES_PER_ROW_IN_TILESET];        //1 if correctMinorErrorsInSlopes() has to look at the tile
+} AutoTileTables;
+
+static AutoTileTables autoTileTables;
+
+static void buildAutoTileTables() {
+    int i = 0, j = 0, rule = 0;
+
+    if (autoTileTables.isBuilt) {
+        return;
     }
-    //if not, return -1
-    return -1;
-}
-
-static int countNumberOfNeighbouringTiles(IsoMap *isoMap,int x,int y,int layer,int terrainHeight) {
-    int value = 0;
-    int tileValue = -2;
+    memset(&autoTileTables,0,sizeof(autoTileTables));
 
-    if (terrainHeight > NUM_TILE_LEVELS_PER_LAYER || terrainHeight <0) {
-        return 0;
+    for (i = 0; i < 16; ++i) {
+        //count the neighbours
+        autoTileTables.numNeighbours[i] = (i & 1) + ((i >> 1) & 1) + ((i >> 2) & 1) + ((i >> 3) & 1);
+        //the outer tiles are ordered by the neighbour mask in the tile set
+        autoTileTables.outerTile[i] = i > 0 ? i + 1 : 0;
     }
 
-    //if the tile above (up) is not empty
-    tileValue = isoMapGetTile(isoMap,x,y-1,layer);
-    if ((tileIsWithinTerrainHeight(tileValue,terrainHeight) != -1)
-    || (tileIsWithinTerrainHeight(tileValue,terrainHeight+1) != -1)) { value++; }
-
-    //if the tile to the right is not empty
-    tileValue = isoMapGetTile(isoMap,x+1,y,layer);
-    if ((tileIsWithinTerrainHeight(tileValue,terrainHeight) != -1)
-    || (tileIsWithinTerrainHeight(tileValue,terrainHeight+1) != -1)) { value++; }
-
-    //if the tile below is not empty
-    tileValue = isoMapGetTile(isoMap,x,y+1,layer);
-    if ((tileIsWithinTerrainHeight(tileValue,terrainHeight) != -1)
-    || (tileIsWithinTerrainHeight(tileValue,terrainHeight+1) != -1)) { value++; }
-
-    //if the tile to the left is not empty
-    tileValue = isoMapGetTile(isoMap,x-1,y,layer);
-    if ((tileIsWithinTerrainHeight(tileValue,terrainHeight) != -1)
-    || (tileIsWithinTerrainHeight(tileValue,terrainHeight+1) != -1)) { value++; }
-
-    return value;
-}
-
-static void deleteSingleTiles(IsoMap *isoMap, int layer, float *noiseMap) {
-    (void)noiseMap;
-
-    int numEmptyNeighbouringTiles = 0;
-    int x=0,y=0,terrainHeight=0,value=0;
-
-    //loop over the map
-    for (y=0;y<isoMap->mapHeight; ++y) {
-        for (x=0;x<isoMap->mapWidth; ++x) {
-            for (terrainHeight = NUM_TILE_LEVELS_PER_LAYER; terrainHeight>=0; --terrainHeight)
-            {
-                //if the value is of the current terrain height
-                if (tileIsWithinTerrainHeight(isoMapGetTile(isoMap,x,y,layer),terrainHeight) > -1) {
-                    numEmptyNeighbouringTiles = countNumberOfNeighbouringTiles(isoMap,x,y,layer,terrainHeight);
-                    if (numEmptyNeighbouringTiles<2) {
-                        value = isoMapGetTile(isoMap,x,y,layer);
-                        isoMapSetTile(isoMap,x,y,layer,value-NUM_TILES_PER_ROW_IN_TILESET);
-                    }
-                }
+    //store which rules every neighbour value takes part in
+    for (rule = 0; rule < NUM_INNER_CORNER_RULES; ++rule) {
+        for (j = 0; j < 2; ++j) {
+            autoTileTables.innerVertical[innerCornerRules[rule].vertical][innerCornerRules[rule].verticalTiles[j]] |= 1 << rule;
+            autoTileTables.innerHorizontal[innerCornerRules[rule].horizontal][innerCornerRules[rule].horizontalTiles[j]] |= 1 << rule;
+        }
+    }
+    //the first matching rule decides the tile
+    for (i = 1; i < (1 << NUM_INNER_CORNER_RULES); ++i) {
+        for (rule = 0; rule < NUM_INNER_CORNER_RULES; ++rule) {
+            if (i & (1 << rule)) {
+                autoTileTables.innerTile[i] = innerCornerRules[rule].paintTile + 1;
+                break;
             }
         }
     }
-}
-
-static int bitWiseCalculateTile(IsoMap *isoMap,int x,int y,int layer,int terrainHeight) {
-    int value = 0;
-    int tileValue = 0;
 
-    //make sure terrain is within lower bounds
-    if (terrainHeight <0 || terrainHeight > NUM_TILE_LEVELS_PER_LAYER) {
-        return -2;
+    for (i = 0; i < (int)(sizeof(slopeTiles)/sizeof(slopeTiles[0])); ++i) {
+        autoTileTables.isSlopeTile[slopeTiles[i]] = 1;
     }
-
-    //if the tile above (up) is not empty
-    tileValue = isoMapGetTile(isoMap,x,y-1,layer);
-    if ((tileIsWithinTerrainHeight(tileValue,terrainHeight) > -1)
-    || (tileIsWithinTerrainHeight(tileValue,terrainHeight+1) > -1)) { value++; }
-
-    //if the tile to the right is not empty
-    tileValue = isoMapGetTile(isoMap,x+1,y,layer);
-    if ((tileIsWithinTerrainHeight(tileValue,terrainHeight) > -1)
-    || (tileIsWithinTerrainHeight(tileValue,terrainHeight+1) > -1)) { value+=2; }
-
-    //if the tile below is not empty
-    tileValue = isoMapGetTile(isoMap,x,y+1,layer);
-    if ((tileIsWithinTerrainHeight(tileValue,terrainHeight) > -1)
-    || (tileIsWithinTerrainHeight(tileValue,terrainHeight+1) > -1)) { value+=4; }
-
-    //if the tile to the left is not empty
-    tileValue = isoMapGetTile(isoMap,x-1,y,layer);
-    if ((tileIsWithinTerrainHeight(tileValue,terrainHeight) > -1)
-    || (tileIsWithinTerrainHeight(tileValue,terrainHeight+1) >-1)) { value+=8; }
-
-    return value;
+    autoTileTables.isBuilt = 1;
 }
 
-static int bitWiseCalculateInnerTiles(IsoMap *isoMap,int x,int y,int layer,int terrainHeight) {
-    //int value = -1;
-
-    int tileOffset = (terrainHeight * NUM_TILES_PER_ROW_IN_TILESET);
-
-    //since the autoTileTerrain() function adds 1 to the tile set it should draw, we find the tile we want in
-    //the tile set, and subtract 1 from the value.
-
-    //inner tiles up left
-    if (isoMapGetTile(isoMap,x,y-1,layer) == 8 + tileOffset && isoMapGetTile(isoMap,x-1,y,layer) == 7 + tileOffset) { return 8; }
-    else if (isoMapGetTile(isoMap,x,y-1,layer) == 8 + tileOffset && isoMapGetTile(isoMap,x-1,y,layer) == 15 +tileOffset) { return 8; }
-    else if (isoMapGetTile(isoMap,x,y-1,layer) == 7 + tileOffset && isoMapGetTile(isoMap,x-1,y,layer) == 15 +tileOffset) { return 8; }
-    else if (isoMapGetTile(isoMap,x,y-1,layer) == 7 + tileOffset && isoMapGetTile(isoMap,x-1,y,layer) == 7 +tileOffset) { return 8; }
+//returns the terrain height (row in the tile set) of a tile, or -2 if the tile is not part of any row
+static inline int tileRow(int tileValue) {
+    return tileValue >= -1 ? (tileValue+1) / NUM_TILES_PER_ROW_IN_TILESET : -2;
+}
 
-    //inner tiles up right
-    else if (isoMapGetTile(isoMap,x,y-1,layer) == 14 + tileOffset && isoMapGetTile(isoMap,x+1,y,layer) == 15 +tileOffset) { return 18; }
-    else if (isoMapGetTile(isoMap,x,y-1,layer) == 14 + tileOffset && isoMapGetTile(isoMap,x+1,y,layer) == 13 +tileOffset) { return 18; }
-    else if (isoMapGetTile(isoMap,x,y-1,layer) == 13 + tileOffset && isoMapGetTile(isoMap,x+1,y,layer) == 15 +tileOffset) { return 18; }
-    else if (isoMapGetTile(isoMap,x,y-1,layer) == 13 + tileOffset && isoMapGetTile(isoMap,x+1,y,layer) == 13 +tileOffset) { return 18; }
+//returns the position of the tile within the row of the terrain height, or -1 if it is in another row
+static inline int tileLocalValue(int tileValue,int terrainHeight) {
+    int localValue = tileValue - terrainHeight * NUM_TILES_PER_ROW_IN_TILESET;
+    return (unsigned int)localValue < NUM_TILES_PER_ROW_IN_TILESET ? localValue : -1;
+}
 
-    //inner tiles down left
-    else if (isoMapGetTile(isoMap,x,y+1,layer) == 8 + tileOffset && isoMapGetTile(isoMap,x-1,y,layer) == 4 +tileOffset) { return 17; }
-    else if (isoMapGetTile(isoMap,x,y+1,layer) == 4 + tileOffset && isoMapGetTile(isoMap,x-1,y,layer) == 4 +tileOffset) { return 17; }
-    else if (isoMapGetTile(isoMap,x,y+1,layer) == 4 + tileOffset && isoMapGetTile(isoMap,x-1,y,layer) == 12 +tileOffset) { return 17; }
-    else if (isoMapGetTile(isoMap,x,y+1,layer) == 8 + tileOffset && isoMapGetTile(isoMap,x-1,y,layer) == 12 +tileOffset) { return 17; }
+//returns a mask of the neighbours (up = 1, right = 2, down = 4, left = 8)
+//that are on the terrain height or one height above it
+static int neighbourMask(IsoMap *isoMap,int x,int y,int layer,int terrainHeight) {
+    return ((unsigned int)(tileRow(isoMapGetTile(isoMap,x,y-1,layer)) - terrainHeight) <= 1)
+         | ((unsigned int)(tileRow(isoMapGetTile(isoMap,x+1,y,layer)) - terrainHeight) <= 1) << 1
+         | ((unsigned int)(tileRow(isoMapGetTile(isoMap,x,y+1,layer)) - terrainHeight) <= 1) << 2
+         | ((unsigned int)(tileRow(isoMapGetTile(isoMap,x-1,y,layer)) - terrainHeight) <= 1) << 3;
+}
 
-    //inner tiles down right
-    else if (isoMapGetTile(isoMap,x,y+1,layer) == 10 + tileOffset && isoMapGetTile(isoMap,x+1,y,layer) == 10 +tileOffset) { return 16; }
-    else if (isoMapGetTile(isoMap,x,y+1,layer) == 10 + tileOffset && isoMapGetTile(isoMap,x+1,y,layer) == 12 +tileOffset) { return 16; }
-    else if (isoMapGetTile(isoMap,x,y+1,layer) == 14 + tileOffset && isoMapGetTile(isoMap,x+1,y,layer) == 10 +tileOffset) { return 16; }
-    else if (isoMapGetTile(isoMap,x,y+1,layer) == 14 + tileOffset && isoMapGetTile(isoMap,x+1,y,layer) == 12 +tileOffset) { return 16; }
+//lowers the tiles in the area x0,y0 - x1,y1 that stand out on their own. Tiles outside the area are never changed
+static void deleteSingleTiles(IsoMap *isoMap,int layer,int x0,int y0,int x1,int y1) {
+    int x=0,y=0,terrainHeight=0,value=0;
 
-    return -1;
+    buildAutoTileTables();
+
+    //loop over the area
+    for (y=y0;y<=y1; ++y) {
+        for (x=x0;x<=x1; ++x) {
+            value = isoMapGetTile(isoMap,x,y,layer);
+            terrainHeight = tileRow(value);
+
+            //while the tile has less than 2 neighbours on its terrain height,
+            //lower it one terrain height at a time
+            while (terrainHeight >= 0 && terrainHeight <= NUM_TILE_LEVELS_PER_LAYER
+            && autoTileTables.numNeighbours[neighbourMask(isoMap,x,y,layer,terrainHeight)] < 2) {
+                value -= NUM_TILES_PER_ROW_IN_TILESET;
+                isoMapSetTile(isoMap,x,y,layer,value);
+                terrainHeight--;
+            }
+        }
+    }
 }
 
 static void autoTileInnerCornerTiles(IsoMap *isoMap, int layer) {
-    int x=0,y=0;//,value=0;
+    int x=0,y=0;
     int paintTile=0;
     int terrainHeight = 0;
+    int matchingRules = 0;
+    int up, right, down, left;
+
+    buildAutoTileTables();
 
     //loop over the map
     for (y=0;y<isoMap->mapHeight; ++y) {
         for (x=0;x<isoMap->mapWidth; ++x) {
-            for (terrainHeight = NUM_TILE_LEVELS_PER_LAYER; terrainHeight>=0; --terrainHeight) {
-                //if the value is one the right terrain height
-                if (tileIsWithinTerrainHeight(isoMapGetTile(isoMap,x,y,layer),terrainHeight) > -1) {
-                    paintTile = bitWiseCalculateInnerTiles(isoMap,x,y,layer,terrainHeight);
-                    if (paintTile>0) {
-                        isoMapSetTile(isoMap,x,y,layer,paintTile+1+(NUM_TILES_PER_ROW_IN_TILESET*terrainHeight));
-                    }
-                }
+            terrainHeight = tileRow(isoMapGetTile(isoMap,x,y,layer));
+            if (terrainHeight < 0 || terrainHeight > NUM_TILE_LEVELS_PER_LAYER) {
+                continue;
+            }
+            //get the neighbours position in the row of the terrain height
+            up = tileLocalValue(isoMapGetTile(isoMap,x,y-1,layer),terrainHeight);
+            right = tileLocalValue(isoMapGetTile(isoMap,x+1,y,layer),terrainHeight);
+            down = tileLocalValue(isoMapGetTile(isoMap,x,y+1,layer),terrainHeight);
+            left = tileLocalValue(isoMapGetTile(isoMap,x-1,y,layer),terrainHeight);
+
+            //a rule matches if both its vertical and its horizontal neighbour match
+            matchingRules = ((up < 0 ? 0 : autoTileTables.innerVertical[0][up]) | (down < 0 ? 0 : autoTileTables.innerVertical[1][down]))
+                          & ((left < 0 ? 0 : autoTileTables.innerHorizontal[0][left]) | (right < 0 ? 0 : autoTileTables.innerHorizontal[1][right]));
+            paintTile = autoTileTables.innerTile[matchingRules];
+            if (paintTile>0) {
+                isoMapSetTile(isoMap,x,y,layer,paintTile+(NUM_TILES_PER_ROW_IN_TILESET*terrainHeight));
             }
         }
     }
 }
 
 static void autoTileTerrain(IsoMap *isoMap, int layer) {
-    int x=0,y=0;//,value=0;
+    int x=0,y=0;
     int paintTile=0;
     int terrainHeight = 0;
 
+    buildAutoTileTables();
+
     //loop over the map
     for (y=0;y<isoMap->mapHeight; ++y) {
         for (x=0;x<isoMap->mapWidth; ++x) {
-            for (terrainHeight = NUM_TILE_LEVELS_PER_LAYER; terrainHeight>=0; --terrainHeight) {
-                //if the value is one the right terrain height
-                if (tileIsWithinTerrainHeight(isoMapGetTile(isoMap,x,y,layer),terrainHeight) > -1) {
-                    paintTile = bitWiseCalculateTile(isoMap,x,y,layer,terrainHeight);
-                    if (paintTile>0) {
-                        isoMapSetTile(isoMap,x,y,layer,paintTile+1+(NUM_TILES_PER_ROW_IN_TILESET*terrainHeight));
-                    }
-                }
+            terrainHeight = tileRow(isoMapGetTile(isoMap,x,y,layer));
+            if (terrainHeight < 0 || terrainHeight > NUM_TILE_LEVELS_PER_LAYER) {
+                continue;
+            }
+            paintTile = autoTileTables.outerTile[neighbourMask(isoMap,x,y,layer,terrainHeight)];
+            if (paintTile>0) {
+                isoMapSetTile(isoMap,x,y,layer,paintTile+(NUM_TILES_PER_ROW_IN_TILESET*terrainHeight));
             }
         }
     }
@@ -446,87 +892,213 @@ static void autoTileTerrain(IsoMap *isoMap, int layer) {
 static void deleteTilesAtMapEdges(IsoMap *isoMap) {
     int x=0,y=0,layer=0;
 
-    //loop over the map
+    //loop over the top and bottom rows
+    for (x=0;x<isoMap->mapWidth; ++x) {
+        for (layer = 0; layer<isoMap->numLayers; ++layer) {
+            isoMapSetTile(isoMap,x,0,layer,-1);
+            isoMapSetTile(isoMap,x,isoMap->mapHeight-1,layer,-1);
+        }
+    }
+    //loop over the left and right columns
     for (y=0;y<isoMap->mapHeight; ++y) {
-        for (x=0;x<isoMap->mapWidth; ++x) {
-            for (layer = 0; layer<isoMap->numLayers; ++layer) {
-                if (x==0 || y==0 || x == isoMap->mapWidth-1 || y == isoMap->mapHeight-1) {
-                    isoMapSetTile(isoMap,x,y,layer,-1);
-                }
-            }
+        for (layer = 0; layer<isoMap->numLayers; ++layer) {
+            isoMapSetTile(isoMap,0,y,layer,-1);
+            isoMapSetTile(isoMap,isoMap->mapWidth-1,y,layer,-1);
         }
     }
 }
 
 static void correctMinorErrorsInSlopes(IsoMap *isoMap) {
     int x=0,y=0,layer=0;
-    //int value=0;
-    //int paintTile=0;
+    int value=0;
     int tileHeight = 0;
 
+    buildAutoTileTables();
+
     //loop over the map
     for (y=0;y<isoMap->mapHeight; ++y) {
         for (x=0;x<isoMap->mapWidth; ++x) {
             for (layer=0;layer<isoMap->numLayers; ++layer) {
-                for (tileHeight = 0; tileHeight < NUM_TILE_LEVELS_PER_LAYER; ++tileHeight) {
-                    if (isoMapGetTile(isoMap,x,y,layer) == 4+(tileHeight*NUM_TILES_PER_ROW_IN_TILESET)
-                    && isoMapGetTile(isoMap,x+1,y,layer) == 4+((tileHeight+1)*NUM_TILES_PER_ROW_IN_TILESET))
-                    {
-                        isoMapSetTile(isoMap,x+1,y,layer,3+((tileHeight+1)*NUM_TILES_PER_ROW_IN_TILESET));
-                    }
-                    if (isoMapGetTile(isoMap,x,y,layer) == 3+(tileHeight*NUM_TILES_PER_ROW_IN_TILESET)
-                    && isoMapGetTile(isoMap,x+1,y,layer) == 4+((tileHeight+1)*NUM_TILES_PER_ROW_IN_TILESET))
-                    {
-                        isoMapSetTile(isoMap,x+1,y,layer,3+((tileHeight+1)*NUM_TILES_PER_ROW_IN_TILESET));
-                    }
-
-                    if (isoMapGetTile(isoMap,x,y,layer) == 10+((tileHeight)*NUM_TILES_PER_ROW_IN_TILESET)
-                    && isoMapGetTile(isoMap,x,y-1,layer) == 14+(tileHeight)*NUM_TILES_PER_ROW_IN_TILESET
-                    && isoMapGetTile(isoMap,x,y+1,layer) == 14+(tileHeight-1)*NUM_TILES_PER_ROW_IN_TILESET)
-                    {
-                        isoMapSetTile(isoMap,x,y,layer,5+((tileHeight+1)*NUM_TILES_PER_ROW_IN_TILESET));
-                    }
-                    if (isoMapGetTile(isoMap,x,y,layer) == 10+((tileHeight)*NUM_TILES_PER_ROW_IN_TILESET)
-                    && isoMapGetTile(isoMap,x,y+1,layer) == 10+(tileHeight-1)*NUM_TILES_PER_ROW_IN_TILESET)
-                    {
-                        isoMapSetTile(isoMap,x,y,layer,5+((tileHeight+1)*NUM_TILES_PER_ROW_IN_TILESET));
-                    }
-
-                    if (isoMapGetTile(isoMap,x,y,layer) == 13+(tileHeight*NUM_TILES_PER_ROW_IN_TILESET)
-                    && isoMapGetTile(isoMap,x-1,y,layer) == 13+((tileHeight+1)*NUM_TILES_PER_ROW_IN_TILESET))
-                    {
-                        isoMapSetTile(isoMap,x-1,y,layer,6+((tileHeight+1)*NUM_TILES_PER_ROW_IN_TILESET));
-                    }
-                    if (isoMapGetTile(isoMap,x,y,layer) == 7+(tileHeight*NUM_TILES_PER_ROW_IN_TILESET)
-                    && isoMapGetTile(isoMap,x+1,y,layer) == 7+((tileHeight+1)*NUM_TILES_PER_ROW_IN_TILESET))
-                    {
-                        isoMapSetTile(isoMap,x+1,y,layer,2+((tileHeight+1)*NUM_TILES_PER_ROW_IN_TILESET));
-                    }
-                    if (isoMapGetTile(isoMap,x,y,layer) == 7+(tileHeight*NUM_TILES_PER_ROW_IN_TILESET)
-                    && isoMapGetTile(isoMap,x,y+1,layer) == 7+((tileHeight+1)*NUM_TILES_PER_ROW_IN_TILESET))
-                    {
-                        isoMapSetTile(isoMap,x,y+1,layer,2+((tileHeight+1)*NUM_TILES_PER_ROW_IN_TILESET));
-                    }
-                    if (isoMapGetTile(isoMap,x,y,layer) == 2+(tileHeight*NUM_TILES_PER_ROW_IN_TILESET)
-                    && isoMapGetTile(isoMap,x+1,y,layer) == 7+((tileHeight+1)*NUM_TILES_PER_ROW_IN_TILESET))
-                    {
-                        isoMapSetTile(isoMap,x+1,y,layer,2+((tileHeight+1)*NUM_TILES_PER_ROW_IN_TILESET));
-                    }
-                    if (isoMapGetTile(isoMap,x,y,layer) == 2+(tileHeight*NUM_TILES_PER_ROW_IN_TILESET)
-                    && isoMapGetTile(isoMap,x,y+1,layer) == 7+((tileHeight+1)*NUM_TILES_PER_ROW_IN_TILESET))
-                    {
-                        isoMapSetTile(isoMap,x,y+1,layer,2+((tileHeight+1)*NUM_TILES_PER_ROW_IN_TILESET));
-                    }
+                //all the rules start by checking the tile itself, so only the
+                //terrain height the tile is in can match, and only for slope tiles
+                value = isoMapGetTile(isoMap,x,y,layer);
+                tileHeight = tileRow(value);
+                if (tileHeight < 0 || tileHeight >= NUM_TILE_LEVELS_PER_LAYER
+                || tileLocalValue(value,tileHeight) < 0
+                || autoTileTables.isSlopeTile[tileLocalValue(value,tileHeight)] == 0) {
+                    continue;
+                }
+
+                if (isoMapGetTile(isoMap,x,y,layer) == 4+(tileHeight*NUM_TILES_PER_ROW_IN_TILESET)
+                && isoMapGetTile(isoMap,x+1,y,layer) == 4+((tileHeight+1)*NUM_TILES_PER_ROW_IN_TILESET))
+                {
+                    isoMapSetTile(isoMap,x+1,y,layer,3+((tileHeight+1)*NUM_TILES_PER_ROW_IN_TILESET));
+                }
+                if (isoMapGetTile(isoMap,x,y,layer) == 3+(tileHeight*NUM_TILES_PER_ROW_IN_TILESET)
+                && isoMapGetTile(isoMap,x+1,y,layer) == 4+((tileHeight+1)*NUM_TILES_PER_ROW_IN_TILESET))
+                {
+                    isoMapSetTile(isoMap,x+1,y,layer,3+((tileHeight+1)*NUM_TILES_PER_ROW_IN_TILESET));
+                }
+
+                if (isoMapGetTile(isoMap,x,y,layer) == 10+((tileHeight)*NUM_TILES_PER_ROW_IN_TILESET)
+                && isoMapGetTile(isoMap,x,y-1,layer) == 14+(tileHeight)*NUM_TILES_PER_ROW_IN_TILESET
+                && isoMapGetTile(isoMap,x,y+1,layer) == 14+(tileHeight-1)*NUM_TILES_PER_ROW_IN_TILESET)
+                {
+                    isoMapSetTile(isoMap,x,y,layer,5+((tileHeight+1)*NUM_TILES_PER_ROW_IN_TILESET));
+                }
+                if (isoMapGetTile(isoMap,x,y,layer) == 10+((tileHeight)*NUM_TILES_PER_ROW_IN_TILESET)
+                && isoMapGetTile(isoMap,x,y+1,layer) == 10+(tileHeight-1)*NUM_TILES_PER_ROW_IN_TILESET)
+                {
+                    isoMapSetTile(isoMap,x,y,layer,5+((tileHeight+1)*NUM_TILES_PER_ROW_IN_TILESET));
                 }
+
+                if (isoMapGetTile(isoMap,x,y,layer) == 13+(tileHeight*NUM_TILES_PER_ROW_IN_TILESET)
+                && isoMapGetTile(isoMap,x-1,y,layer) == 13+((tileHeight+1)*NUM_TILES_PER_ROW_IN_TILESET))
+                {
+                    isoMapSetTile(isoMap,x-1,y,layer,6+((tileHeight+1)*NUM_TILES_PER_ROW_IN_TILESET));
+                }
+                if (isoMapGetTile(isoMap,x,y,layer) == 7+(tileHeight*NUM_TILES_PER_ROW_IN_TILESET)
+                && isoMapGetTile(isoMap,x+1,y,layer) == 7+((tileHeight+1)*NUM_TILES_PER_ROW_IN_TILESET))
+                {
+                    isoMapSetTile(isoMap,x+1,y,layer,2+((tileHeight+1)*NUM_TILES_PER_ROW_IN_TILESET));
+                }
+                if (isoMapGetTile(isoMap,x,y,layer) == 7+(tileHeight*NUM_TILES_PER_ROW_IN_TILESET)
+                && isoMapGetTile(isoMap,x,y+1,layer) == 7+((tileHeight+1)*NUM_TILES_PER_ROW_IN_TILESET))
+                {
+                    isoMapSetTile(isoMap,x,y+1,layer,2+((tileHeight+1)*NUM_TILES_PER_ROW_IN_TILESET));
+                }
+                if (isoMapGetTile(isoMap,x,y,layer) == 2+(tileHeight*NUM_TILES_PER_ROW_IN_TILESET)
+                && isoMapGetTile(isoMap,x+1,y,layer) == 7+((tileHeight+1)*NUM_TILES_PER_ROW_IN_TILESET))
+                {
+                    isoMapSetTile(isoMap,x+1,y,layer,2+((tileHeight+1)*NUM_TILES_PER_ROW_IN_TILESET));
+                }
+                if (isoMapGetTile(isoMap,x,y,layer) == 2+(tileHeight*NUM_TILES_PER_ROW_IN_TILESET)
+                && isoMapGetTile(isoMap,x,y+1,layer) == 7+((tileHeight+1)*NUM_TILES_PER_ROW_IN_TILESET))
+                {
+                    isoMapSetTile(isoMap,x,y+1,layer,2+((tileHeight+1)*NUM_TILES_PER_ROW_IN_TILESET));
+                }
+            }
+        }
+    }
+}
+
+//returns the terrain height of a tile that has not been auto tiled yet
+static int terrainHeightOfTile(int tileValue) {
+    //empty tiles are drawn with the value -7 (see drawPerlinNoiseTerrain())
+    if (tileValue < -1) {
+        return 0;
+    }
+    return (tileValue+1) / NUM_TILES_PER_ROW_IN_TILESET + 1;
+}
+
+//stores the terrain height of every tile, so the terrain can be auto tiled again when it is changed
+static void storeTerrainHeights(IsoMap *isoMap) {
+    int x=0,y=0;
+
+    //loop over the map
+    for (y=0;y<isoMap->mapHeight; ++y) {
+        for (x=0;x<isoMap->mapWidth; ++x) {
+            setTerrainHeight(isoMap,x,y,terrainHeightOfTile(isoMapGetTile(isoMap,x,y,0)));
+        }
+    }
+}
+
+//auto tiles the tiles in the area x0,y0 - x1,y1 again from the stored terrain heights.
+//The generation passes are run on a small scratch map around the area, which is big enough
+//that the edges of the scratch map never reach the tiles that are copied back.
+//If deleteSingles is 1, tiles in the area that stand out on their own are lowered first, like the generator does.
+//Only the area itself is cleaned up, so the terrain heights around it never change
+static int retileRegion(IsoMap *isoMap,int x0,int y0,int x1,int y1,int deleteSingles) {
+    IsoMap *scratchMap = NULL;
+    int scratchX = 0, scratchY = 0;
+    int cleanX0 = 0, cleanY0 = 0, cleanX1 = 0, cleanY1 = 0;
+    int x = 0, y = 0;
+    int value = 0;
+
+    //keep the area within the map
+    x0 = x0 < 0 ? 0 : x0;
+    y0 = y0 < 0 ? 0 : y0;
+    x1 = x1 > isoMap->mapWidth-1 ? isoMap->mapWidth-1 : x1;
+    y1 = y1 > isoMap->mapHeight-1 ? isoMap->mapHeight-1 : y1;
+    if (x0 > x1 || y0 > y1) {
+        return 1;
+    }
+    cleanX0 = x0;
+    cleanY0 = y0;
+    cleanX1 = x1;
+    cleanY1 = y1;
+
+    //grow the area by how far the auto tiling passes reach, and keep it within the map
+    x0 = x0 - RETILE_REACH < 0 ? 0 : x0 - RETILE_REACH;
+    y0 = y0 - RETILE_REACH < 0 ? 0 : y0 - RETILE_REACH;
+    x1 = x1 + RETILE_REACH > isoMap->mapWidth-1 ? isoMap->mapWidth-1 : x1 + RETILE_REACH;
+    y1 = y1 + RETILE_REACH > isoMap->mapHeight-1 ? isoMap->mapHeight-1 : y1 + RETILE_REACH;
+
+    //the scratch map has a border of RETILE_REACH tiles around the area
+    scratchX = x0 - RETILE_REACH;
+    scratchY = y0 - RETILE_REACH;
+    scratchMap = isoMapCreateEmptyMap(NULL,x1-x0+1 + 2*RETILE_REACH,y1-y0+1 + 2*RETILE_REACH,1,isoMap->tileSize*2);
+    if (scratchMap == NULL) {
+        return -1;
+    }
+
+    //draw the terrain heights into the scratch map, the same way drawPerlinNoiseTerrain() does.
+    //Tiles outside the map are left empty
+    for (y=0;y<scratchMap->mapHeight; ++y) {
+        for (x=0;x<scratchMap->mapWidth; ++x) {
+            if (scratchX+x < 0 || scratchX+x > isoMap->mapWidth-1 || scratchY+y < 0 || scratchY+y > isoMap->mapHeight-1) {
+                continue;
             }
+            value = -1 + isoMapGetTerrainHeight(isoMap,scratchX+x,scratchY+y);
+            isoMapSetTile(scratchMap,x,y,0,1 + ((NUM_TILES_PER_ROW_IN_TILESET * value))+15);
         }
     }
+
+    //run the same passes as isoGenerateMap(). The heights around the area were cleaned up when they were
+    //stored, so cleaning them up again could lower tiles that were never changed
+    if (deleteSingles) {
+        deleteSingleTiles(scratchMap,0,cleanX0-scratchX,cleanY0-scratchY,cleanX1-scratchX,cleanY1-scratchY);
+        deleteSingleTiles(scratchMap,0,cleanX0-scratchX,cleanY0-scratchY,cleanX1-scratchX,cleanY1-scratchY);
+
+        //keep the terrain heights of the area in sync with the tiles that were deleted
+        for (y=cleanY0;y<=cleanY1; ++y) {
+            for (x=cleanX0;x<=cleanX1; ++x) {
+                setTerrainHeight(isoMap,x,y,terrainHeightOfTile(isoMapGetTile(scratchMap,x-scratchX,y-scratchY,0)));
+            }
+        }
+    }
+
+    autoTileTerrain(scratchMap,0);
+    autoTileInnerCornerTiles(scratchMap,0);
+    correctMinorErrorsInSlopes(scratchMap);
+    drawGreenGrass(scratchMap);
+
+    //copy the area back into the map
+    for (y=y0;y<=y1; ++y) {
+        for (x=x0;x<=x1; ++x) {
+            //the tiles at the map edges are always empty (see deleteTilesAtMapEdges())
+            if (x==0 || y==0 || x == isoMap->mapWidth-1 || y == isoMap->mapHeight-1) {
+                isoMapSetTile(isoMap,x,y,0,-1);
+            } else {
+                isoMapSetTile(isoMap,x,y,0,isoMapGetTile(scratchMap,x-scratchX,y-scratchY,0));
+            }
+        }
+    }
+    isoMapFreeMap(scratchMap);
+    return 1;
 }
 
+//logs the time since the timer was started, and restarts the timer
+static void logStageTime(const char *stageName,Uint64 *stageTimer) {
+    Uint64 now = SDL_GetPerformanceCounter();
+    WriteDebug("%s took %.2f ms",stageName,(double)(now - *stageTimer)*1000.0/SDL_GetPerformanceFrequency());
+    *stageTimer = now;
+}
 
 static void isoGenerateMap(IsoMap *isoMap, int perlinSeed, int terrainHeight) {
     //int x,y;
     //int paintTile=0;
+    Uint64 stageTimer = 0;
 
     //makes sure the map exists
     if (isoMap == NULL) {
@@ -542,19 +1114,33 @@ static void isoGenerateMap(IsoMap *isoMap, int perlinSeed, int terrainHeight) {
         return;
     }
 
-    //generate the perlin noise map
+    //generate the perlin noise map, and log how long every stage takes
+    stageTimer = SDL_GetPerformanceCounter();
     generatePerlinNoiseMap(isoMap,noiseMap,perlinSeed,terrainHeight);
+    logStageTime("generatePerlinNoiseMap",&stageTimer);
     rewriteNoiseMapTerrainHeight(isoMap,noiseMap,terrainHeight);
+    logStageTime("rewriteNoiseMapTerrainHeight",&stageTimer);
     drawPerlinNoiseTerrain(isoMap,noiseMap);
-    deleteSingleTiles(isoMap,0,noiseMap);
-    deleteSingleTiles(isoMap,0,noiseMap);
+    logStageTime("drawPerlinNoiseTerrain",&stageTimer);
+    deleteSingleTiles(isoMap,0,0,0,isoMap->mapWidth-1,isoMap->mapHeight-1);
+    deleteSingleTiles(isoMap,0,0,0,isoMap->mapWidth-1,isoMap->mapHeight-1);
+    logStageTime("deleteSingleTiles",&stageTimer);
+    storeTerrainHeights(isoMap);
+    logStageTime("storeTerrainHeights",&stageTimer);
 
     autoTileTerrain(isoMap,0);
+    logStageTime("autoTileTerrain",&stageTimer);
     autoTileInnerCornerTiles(isoMap,0);
+    logStageTime("autoTileInnerCornerTiles",&stageTimer);
     correctMinorErrorsInSlopes(isoMap);
+    logStageTime("correctMinorErrorsInSlopes",&stageTimer);
     drawGreenGrass(isoMap);
+    logStageTime("drawGreenGrass",&stageTimer);
     deleteTilesAtMapEdges(isoMap);
+    logStageTime("deleteTilesAtMapEdges",&stageTimer);
 
+    //the noise map is not needed anymore
+    free(noiseMap);
 
     /*
     isoMapSetTile(isoMap,0,3,1,2);
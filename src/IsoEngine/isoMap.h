@@ -7,14 +7,62 @@
 #define MAP_NAME_LENGTH 50
 #define NUM_TILES_PER_ROW_IN_TILESET    23
 #define NUM_TILE_LEVELS_PER_LAYER       6
+#define TILESET_NAME_LENGTH             48
+
+//version of the world generator. Increase it when a change to the generator gives a different map for
+//the same seed, so maps saved by an older generator are recognised and generated again
+#define ISO_MAP_GENERATOR_VERSION       1
+
+//the map is stored in square chunks of ISO_MAP_CHUNK_SIZE x ISO_MAP_CHUNK_SIZE tiles
+#define ISO_MAP_CHUNK_SHIFT             4
+#define ISO_MAP_CHUNK_SIZE              (1 << ISO_MAP_CHUNK_SHIFT)
+#define ISO_MAP_CHUNK_MASK              (ISO_MAP_CHUNK_SIZE-1)
+
+//tile flags, stored per tile in the chunk flag plane.
+//The blocking flag follows the tiles: a tile blocks when it has no ground tile, or when a tile stands on it
+//in one of the layers above the ground. It is kept up to date by isoMapSetTile() and when a chunk is paged in
+#define ISO_TILE_FLAG_BLOCKING          0x01
+//a static body stands on the tile, set by the collision system. Entities can not walk on the tile, but it is not
+//saved with the map, since the bodies are not part of the map
+#define ISO_TILE_FLAG_OCCUPIED          0x02
+
+//chunk dirty flags, one per consumer of the map data.
+//They are set when tiles in the chunk change, and cleared by the consumer when it has caught up
+#define ISO_MAP_CHUNK_DIRTY_RENDER      0x01
+#define ISO_MAP_CHUNK_DIRTY_MINIMAP     0x02
+#define ISO_MAP_CHUNK_DIRTY_NAV         0x04
+#define ISO_MAP_CHUNK_DIRTY_ALL         (ISO_MAP_CHUNK_DIRTY_RENDER | ISO_MAP_CHUNK_DIRTY_MINIMAP | ISO_MAP_CHUNK_DIRTY_NAV)
+
+//the first tile a rectangle runs into when it is swept across the map
+typedef struct IsoMapSweepHit {
+    float time;         //how far along the movement the rectangle touches the tile, from 0 to 1
+    int tileX;
+    int tileY;
+    int normalX;        //the side of the tile that was hit, -1, 0 or 1 on each axis
+    int normalY;
+} IsoMapSweepHit;
 
 typedef struct IsoTileSet {
     int tileSetLoaded;
     int numTileClipRects;
     Texture *tilesTex;
     SDL_Rect *tileClipRects;
+    char textureName[TILESET_NAME_LENGTH];
+    int tileWidth;
+    int tileHeight;
 } IsoTileSet;
 
+typedef struct IsoMapChunk {
+    int *tiles;         //ISO_MAP_CHUNK_SIZE * ISO_MAP_CHUNK_SIZE * numLayers tiles
+    Uint8 *flags;       //one flag byte per tile (ISO_TILE_FLAG_*)
+    Sint8 *heights;     //terrain height of every tile in layer 0, used when the terrain is auto tiled again
+    Uint8 dirtyFlags;   //ISO_MAP_CHUNK_DIRTY_* flags
+    int isResident;     //1 if the tiles and flags are in memory
+    int ownsMemory;     //1 if tiles and flags were allocated, 0 if they point into a mapped map file
+} IsoMapChunk;
+
+struct IsoMapFile;
+
 typedef struct IsoMap {
     int mapHeight;
     int mapWidth;
@@ -22,16 +70,37 @@ typedef struct IsoMap {
     int tileSize;
     int tileSizeX;
     int tileSizeY;
-    int *mapData;
+    int numChunksX;
+    int numChunksY;
+    IsoMapChunk *chunks;
+    struct IsoMapFile *mapFile;     //map file the chunks are paged in from, NULL if the map was generated
     char name[MAP_NAME_LENGTH];
     IsoTileSet *tileSet;
+    int generatorVersion;           //ISO_MAP_GENERATOR_VERSION the map was generated with, 0 if it was not generated
+    int seed;                       //seed and terrain height the map was generated with
+    int terrainHeight;
 } IsoMap;
 
+[[nodiscard]] IsoMap* isoMapCreateEmptyMap(char *mapName,int width,int height,int numLayers,int tileSize);
 [[nodiscard]] IsoMap* isoMapCreateNewMap(char *mapName,int width,int height,int numLayers,int tileSize,int perlinSeed, int terrainHeight);
 void isoMapFreeMap(IsoMap *isoMap);
 int isoMapLoadTileSet(IsoMap *isoMap,Texture *texture,int tileWidth,int tileHeight);
+void isoMapSetTileSetName(IsoMap *isoMap,char *textureName);
 [[nodiscard]] int isoMapGetTile(IsoMap *isoMap,int x,int y,int layer);
 void isoMapSetTile(IsoMap *isoMap,int x,int y,int layer,int value);
+[[nodiscard]] Uint8 isoMapGetTileFlags(IsoMap *isoMap,int x,int y);
+void isoMapSetTileFlags(IsoMap *isoMap,int x,int y,Uint8 flags);
+int isoMapUpdateChunkFlags(IsoMap *isoMap,IsoMapChunk *chunk);
+[[nodiscard]] int isoMapTileIsWalkable(IsoMap *isoMap,int x,int y);
+[[nodiscard]] int isoMapSweepRect(IsoMap *isoMap,SDL_FRect *rect,float dx,float dy,Uint8 flagMask,IsoMapSweepHit *hit);
+int isoMapAllocateChunk(IsoMap *isoMap,IsoMapChunk *chunk);
+[[nodiscard]] int isoMapGetTerrainHeight(IsoMap *isoMap,int x,int y);
+int isoMapRetileArea(IsoMap *isoMap,int x0,int y0,int x1,int y1);
+int isoMapRaiseTerrain(IsoMap *isoMap,int x,int y,int radius);
+int isoMapLowerTerrain(IsoMap *isoMap,int x,int y,int radius);
+[[nodiscard]] int isoMapChunkIsDirty(IsoMap *isoMap,int chunkIndex,Uint8 dirtyFlag);
+void isoMapClearChunkDirty(IsoMap *isoMap,int chunkIndex,Uint8 dirtyFlag);
+[[nodiscard]] Uint64 isoMapComputeHash(IsoMap *isoMap);
 
 #endif // __ISO_MAP_H
 
@@ -0,0 +1,712 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#if defined(_WIN32) || defined(_WIN64)
+    #define ISO_MAP_FILE_NO_MMAP
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+#include "isoMapFile.h"
+#include "isoMap.h"
+#include "../logger.h"
+
+//The map file is little endian and laid out like this:
+//
+//  header (ISO_MAP_FILE_HEADER_SIZE bytes)
+//      0   char[4]  magic "ISOM"
+//      4   Uint32   version
+//      8   Uint32   header size
+//      12  Sint32   map width
+//      16  Sint32   map height
+//      20  Sint32   number of layers
+//      24  Sint32   tile size
+//      28  Uint32   chunk size
+//      32  Uint32   number of chunks x
+//      36  Uint32   number of chunks y
+//      40  Sint32   tile set tile width
+//      44  Sint32   tile set tile height
+//      48  char[56] map name
+//      104 char[48] tile set texture name
+//      152 Uint64   chunk table offset
+//      160 Uint32   world generator version, 0 if the map was not generated (version 3)
+//      164 Sint32   world generator seed (version 3)
+//      168 Sint32   world generator terrain height (version 3)
+//      172 Uint32   reserved
+//      (version 1 and 2 headers end after the chunk table offset, at 160 bytes)
+//  chunk table (numChunksX * numChunksY entries of ISO_MAP_FILE_CHUNK_ENTRY_SIZE bytes)
+//      0   Uint64   offset of the chunk data
+//      8   Uint32   stored size of the tile plane
+//      12  Uint32   stored size of the flag plane
+//      16  Uint32   compression
+//      20  Uint32   stored size of the terrain height plane (version 2, reserved in version 1)
+//  chunk data, every chunk starts at a 4 byte boundary
+//      tile plane      Sint32 per tile and layer, or RLE runs of (Uint32 count, Sint32 tile)
+//      flag plane      Uint8 per tile, or RLE runs of (Uint8 count, Uint8 flags). The blocking flag is derived
+//                      from the tiles again when the chunk is paged in
+//      height plane    Sint8 per tile, or RLE runs of (Uint8 count, Sint8 height) (version 2)
+//
+//Uncompressed chunks are used straight from the mapped file without copying them,
+//so only the chunks that are actually looked at are ever read from disk.
+
+#define HEADER_NAME_OFFSET              48
+#define HEADER_NAME_LENGTH              56
+#define HEADER_TILESET_NAME_OFFSET      104
+#define HEADER_CHUNK_TABLE_OFFSET       152
+#define HEADER_GENERATOR_OFFSET         160
+#define HEADER_SIZE_VERSION_2           160
+
+static IsoMapFile *openMapFile(char *fileName);
+static int readChunkTable(IsoMapFile *mapFile,Uint64 tableOffset,int numChunks);
+
+static void putUint32(Uint8 *buffer,Uint32 value) {
+    value = SDL_SwapLE32(value);
+    memcpy(buffer,&value,sizeof(Uint32));
+}
+
+static void putUint64(Uint8 *buffer,Uint64 value) {
+    value = SDL_SwapLE64(value);
+    memcpy(buffer,&value,sizeof(Uint64));
+}
+
+static Uint32 getUint32(const Uint8 *buffer) {
+    Uint32 value;
+    memcpy(&value,buffer,sizeof(Uint32));
+    return SDL_SwapLE32(value);
+}
+
+static Uint64 getUint64(const Uint8 *buffer) {
+    Uint64 value;
+    memcpy(&value,buffer,sizeof(Uint64));
+    return SDL_SwapLE64(value);
+}
+
+//encodes the tiles as runs of (count, tile). Returns the number of bytes written
+static Uint32 rleEncodeTiles(const int *tiles,int numTiles,Uint8 *out) {
+    Uint32 size = 0;
+    int i = 0;
+    Uint32 runLength = 0;
+
+    while (i < numTiles) {
+        runLength = 1;
+        //count how many times the tile is repeated
+        while (i + (int)runLength < numTiles && tiles[i + runLength] == tiles[i]) {
+            runLength++;
+        }
+        putUint32(out + size,runLength);
+        putUint32(out + size + 4,(Uint32)tiles[i]);
+        size += 8;
+        i += runLength;
+    }
+    return size;
+}
+
+static int rleDecodeTiles(const Uint8 *in,Uint32 size,int *tiles,int numTiles) {
+    Uint32 i = 0;
+    Uint32 j = 0;
+    Uint32 runLength = 0;
+    int tile = 0;
+    int written = 0;
+
+    for (i = 0; i + 8 <= size; i += 8) {
+        runLength = getUint32(in + i);
+        tile = (int)getUint32(in + i + 4);
+        //make sure the run does not write outside the chunk
+        if (runLength > (Uint32)(numTiles - written)) {
+            return -1;
+        }
+        for (j = 0; j < runLength; ++j) {
+            tiles[written++] = tile;
+        }
+    }
+    //the runs have to cover the whole chunk
+    if (written != numTiles || i != size) {
+        return -1;
+    }
+    return 1;
+}
+
+//encodes the bytes as runs of (count, byte). Returns the number of bytes written
+static Uint32 rleEncodeBytes(const Uint8 *bytes,int numBytes,Uint8 *out) {
+    Uint32 size = 0;
+    int i = 0;
+    int runLength = 0;
+
+    while (i < numBytes) {
+        runLength = 1;
+        //a run can be at most 255 bytes long
+        while (i + runLength < numBytes && runLength < 255 && bytes[i + runLength] == bytes[i]) {
+            runLength++;
+        }
+        out[size] = (Uint8)runLength;
+        out[size+1] = bytes[i];
+        size += 2;
+        i += runLength;
+    }
+    return size;
+}
+
+static int rleDecodeBytes(const Uint8 *in,Uint32 size,Uint8 *bytes,int numBytes) {
+    Uint32 i = 0;
+    int written = 0;
+
+    for (i = 0; i + 2 <= size; i += 2) {
+        //make sure the run does not write outside the chunk
+        if (in[i] > numBytes - written) {
+            return -1;
+        }
+        memset(bytes + written,in[i+1],in[i]);
+        written += in[i];
+    }
+    //the runs have to cover the whole chunk
+    if (written != numBytes || i != size) {
+        return -1;
+    }
+    return 1;
+}
+
+int isoMapSaveToFile(IsoMap *isoMap,char *fileName) {
+    char tmpFileName[512];
+    Uint8 header[ISO_MAP_FILE_HEADER_SIZE];
+    Uint8 entry[ISO_MAP_FILE_CHUNK_ENTRY_SIZE];
+    Uint8 padding[4] = {0,0,0,0};
+    Uint8 savedFlags[ISO_MAP_CHUNK_SIZE * ISO_MAP_CHUNK_SIZE];
+    int numTiles = ISO_MAP_CHUNK_SIZE * ISO_MAP_CHUNK_SIZE;
+    int numChunks = 0;
+    int i = 0, j = 0;
+    int *tiles = NULL;
+    Uint8 *flags = NULL;
+    Sint8 *heights = NULL;
+    int *emptyTiles = NULL;
+    Uint8 *emptyFlags = NULL;
+    Uint8 *tilesOut = NULL;
+    Uint8 *flagsOut = NULL;
+    Uint8 *heightsOut = NULL;
+    Uint32 tilesSize = 0;
+    Uint32 flagsSize = 0;
+    Uint32 heightsSize = 0;
+    Uint64 offset = 0;
+    IsoMapFileChunkEntry *chunkTable = NULL;
+    FILE *file = NULL;
+
+    if (isoMap == NULL) {
+        WriteError("Parameter: 'IsoMap *isoMap' is NULL!");
+        return -1;
+    }
+    if (fileName == NULL) {
+        WriteError("Parameter: 'char *fileName' is NULL!");
+        return -1;
+    }
+
+    numChunks = isoMap->numChunksX * isoMap->numChunksY;
+
+    //allocate the chunk table and the buffers used when encoding a chunk
+    chunkTable = calloc(numChunks,sizeof(struct IsoMapFileChunkEntry));
+    emptyTiles = malloc(sizeof(int) * numTiles * isoMap->numLayers);
+    emptyFlags = calloc(numTiles,sizeof(Uint8));
+    //the RLE encoded planes are never more than twice the size of the raw planes
+    tilesOut = malloc(sizeof(Uint32) * 2 * numTiles * isoMap->numLayers);
+    flagsOut = malloc(sizeof(Uint8) * 2 * numTiles);
+    heightsOut = malloc(sizeof(Uint8) * 2 * numTiles);
+    if (chunkTable == NULL || emptyTiles == NULL || emptyFlags == NULL || tilesOut == NULL || flagsOut == NULL || heightsOut == NULL) {
+        WriteError("Could not allocate memory for saving the map %s!",isoMap->name);
+        free(chunkTable);
+        free(emptyTiles);
+        free(emptyFlags);
+        free(tilesOut);
+        free(flagsOut);
+        free(heightsOut);
+        return -1;
+    }
+    memset(emptyTiles,-1,sizeof(int) * numTiles * isoMap->numLayers);
+
+    //write to a temporary file first, so that a map file that is currently
+    //mapped into memory is never changed while it is in use
+    //a name that does not fit is not cut short, the temporary file would be renamed to the wrong map file
+    if (snprintf(tmpFileName,sizeof(tmpFileName),"%s.tmp",fileName) >= (int)sizeof(tmpFileName)) {
+        WriteError("The map file name %s is too long!",fileName);
+        free(chunkTable);
+        free(emptyTiles);
+        free(emptyFlags);
+        free(tilesOut);
+        free(flagsOut);
+        free(heightsOut);
+        return -1;
+    }
+    file = fopen(tmpFileName,"wb");
+    if (file == NULL) {
+        WriteError("Could not open %s for writing!",tmpFileName);
+        free(chunkTable);
+        free(emptyTiles);
+        free(emptyFlags);
+        free(tilesOut);
+        free(flagsOut);
+        free(heightsOut);
+        return -1;
+    }
+
+    ///HEADER
+    memset(header,0,sizeof(header));
+    memcpy(header,ISO_MAP_FILE_MAGIC,4);
+    putUint32(header + 4,ISO_MAP_FILE_VERSION);
+    putUint32(header + 8,ISO_MAP_FILE_HEADER_SIZE);
+    putUint32(header + 12,(Uint32)isoMap->mapWidth);
+    putUint32(header + 16,(Uint32)isoMap->mapHeight);
+    putUint32(header + 20,(Uint32)isoMap->numLayers);
+    //the map stores half the tile size, so we store the full size in the file
+    putUint32(header + 24,(Uint32)isoMap->tileSize*2);
+    putUint32(header + 28,ISO_MAP_CHUNK_SIZE);
+    putUint32(header + 32,(Uint32)isoMap->numChunksX);
+    putUint32(header + 36,(Uint32)isoMap->numChunksY);
+    putUint32(header + 40,(Uint32)isoMap->tileSet->tileWidth);
+    putUint32(header + 44,(Uint32)isoMap->tileSet->tileHeight);
+    //the names are cut to fit and always terminated, the rest of the field stays zero
+    SDL_strlcpy((char*)header + HEADER_NAME_OFFSET,isoMap->name,HEADER_NAME_LENGTH);
+    SDL_strlcpy((char*)header + HEADER_TILESET_NAME_OFFSET,isoMap->tileSet->textureName,TILESET_NAME_LENGTH);
+    putUint64(header + HEADER_CHUNK_TABLE_OFFSET,ISO_MAP_FILE_HEADER_SIZE);
+    putUint32(header + HEADER_GENERATOR_OFFSET,(Uint32)isoMap->generatorVersion);
+    putUint32(header + HEADER_GENERATOR_OFFSET + 4,(Uint32)isoMap->seed);
+    putUint32(header + HEADER_GENERATOR_OFFSET + 8,(Uint32)isoMap->terrainHeight);
+    fwrite(header,1,sizeof(header),file);
+
+    //skip the chunk table, it is written when we know where the chunks are stored
+    offset = ISO_MAP_FILE_HEADER_SIZE + (Uint64)numChunks * ISO_MAP_FILE_CHUNK_ENTRY_SIZE;
+    fseek(file,(long)offset,SEEK_SET);
+
+    ///CHUNKS
+    for (i = 0; i < numChunks; ++i) {
+        //make sure chunks from a loaded map are in memory
+        if (isoMap->chunks[i].isResident == 0 && isoMap->mapFile != NULL) {
+            isoMapFilePageInChunk(isoMap,i);
+        }
+        //chunks that were never written to are saved as empty chunks
+        if (isoMap->chunks[i].isResident) {
+            tiles = isoMap->chunks[i].tiles;
+            heights = isoMap->chunks[i].heights;
+            //the static bodies on the tiles are not part of the map
+            for (j = 0; j < numTiles; ++j) {
+                savedFlags[j] = isoMap->chunks[i].flags[j] & ~ISO_TILE_FLAG_OCCUPIED;
+            }
+            flags = savedFlags;
+        } else {
+            tiles = emptyTiles;
+            flags = emptyFlags;
+            heights = (Sint8*)emptyFlags;
+        }
+
+        //try to compress the chunk
+        tilesSize = rleEncodeTiles(tiles,numTiles * isoMap->numLayers,tilesOut);
+        flagsSize = rleEncodeBytes(flags,numTiles,flagsOut);
+        heightsSize = rleEncodeBytes((Uint8*)heights,numTiles,heightsOut);
+
+        chunkTable[i].offset = offset;
+        //only keep the compressed chunk if it is smaller than the raw chunk
+        if (tilesSize + flagsSize + heightsSize < sizeof(int) * numTiles * isoMap->numLayers + 2 * numTiles) {
+            chunkTable[i].compression = ISO_MAP_FILE_COMPRESSION_RLE;
+        } else {
+            chunkTable[i].compression = ISO_MAP_FILE_COMPRESSION_NONE;
+            for (j = 0; j < numTiles * isoMap->numLayers; ++j) {
+                putUint32(tilesOut + j*4,(Uint32)tiles[j]);
+            }
+            memcpy(flagsOut,flags,numTiles);
+            memcpy(heightsOut,heights,numTiles);
+            tilesSize = sizeof(int) * numTiles * isoMap->numLayers;
+            flagsSize = numTiles;
+            heightsSize = numTiles;
+        }
+        chunkTable[i].tilesSize = tilesSize;
+        chunkTable[i].flagsSize = flagsSize;
+        chunkTable[i].heightsSize = heightsSize;
+
+        fwrite(tilesOut,1,tilesSize,file);
+        fwrite(flagsOut,1,flagsSize,file);
+        fwrite(heightsOut,1,heightsSize,file);
+        offset += tilesSize + flagsSize + heightsSize;
+
+        //align the next chunk to 4 bytes so the tiles can be used directly from the mapped file
+        if (offset % 4 != 0) {
+            fwrite(padding,1,4 - offset % 4,file);
+            offset += 4 - offset % 4;
+        }
+    }
+
+    ///CHUNK TABLE
+    fseek(file,ISO_MAP_FILE_HEADER_SIZE,SEEK_SET);
+    for (i = 0; i < numChunks; ++i) {
+        memset(entry,0,sizeof(entry));
+        putUint64(entry,chunkTable[i].offset);
+        putUint32(entry + 8,chunkTable[i].tilesSize);
+        putUint32(entry + 12,chunkTable[i].flagsSize);
+        putUint32(entry + 16,chunkTable[i].compression);
+        putUint32(entry + 20,chunkTable[i].heightsSize);
+        fwrite(entry,1,sizeof(entry),file);
+    }
+
+    free(chunkTable);
+    free(emptyTiles);
+    free(emptyFlags);
+    free(tilesOut);
+    free(flagsOut);
+    free(heightsOut);
+
+    if (ferror(file)) {
+        WriteError("Could not write the map %s to %s!",isoMap->name,tmpFileName);
+        fclose(file);
+        remove(tmpFileName);
+        return -1;
+    }
+    fclose(file);
+
+    //replace the old map file with the new one
+#ifdef ISO_MAP_FILE_NO_MMAP
+    remove(fileName);
+#endif
+    if (rename(tmpFileName,fileName) != 0) {
+        WriteError("Could not rename %s to %s!",tmpFileName,fileName);
+        remove(tmpFileName);
+        return -1;
+    }
+    WriteDebug("Saved map %s to %s (%d chunks, %llu bytes)",isoMap->name,fileName,numChunks,(unsigned long long)offset);
+    return 1;
+}
+
+IsoMap* isoMapLoadFromFile(char *fileName) {
+    IsoMapFile *mapFile = NULL;
+    IsoMap *isoMap = NULL;
+    char name[HEADER_NAME_LENGTH];
+    char tileSetName[TILESET_NAME_LENGTH];
+    const Uint8 *header = NULL;
+    int width, height, numLayers, tileSize;
+    int numChunksX, numChunksY;
+
+    if (fileName == NULL) {
+        WriteError("Parameter: 'char *fileName' is NULL!");
+        return NULL;
+    }
+
+    mapFile = openMapFile(fileName);
+    if (mapFile == NULL) {
+        return NULL;
+    }
+    header = mapFile->data;
+
+    //make sure it is a map file we know how to read
+    if (mapFile->size < HEADER_SIZE_VERSION_2 || memcmp(header,ISO_MAP_FILE_MAGIC,4) != 0) {
+        WriteError("%s is not a map file!",fileName);
+        isoMapFileClose(mapFile);
+        return NULL;
+    }
+    mapFile->version = (int)getUint32(header + 4);
+    if (mapFile->version < 1 || mapFile->version > ISO_MAP_FILE_VERSION) {
+        WriteError("%s has map file version %d, only version 1 to %d is supported!",fileName,mapFile->version,ISO_MAP_FILE_VERSION);
+        isoMapFileClose(mapFile);
+        return NULL;
+    }
+    if (mapFile->version >= 3 && mapFile->size < ISO_MAP_FILE_HEADER_SIZE) {
+        WriteError("%s is not a map file!",fileName);
+        isoMapFileClose(mapFile);
+        return NULL;
+    }
+    if (getUint32(header + 28) != ISO_MAP_CHUNK_SIZE) {
+        WriteError("%s uses a chunk size of %u, expected %d!",fileName,getUint32(header + 28),ISO_MAP_CHUNK_SIZE);
+        isoMapFileClose(mapFile);
+        return NULL;
+    }
+
+    width = (int)getUint32(header + 12);
+    height = (int)getUint32(header + 16);
+    numLayers = (int)getUint32(header + 20);
+    tileSize = (int)getUint32(header + 24);
+    numChunksX = (int)getUint32(header + 32);
+    numChunksY = (int)getUint32(header + 36);
+
+    //copy the names, making sure they are terminated
+    memcpy(name,header + HEADER_NAME_OFFSET,HEADER_NAME_LENGTH);
+    name[HEADER_NAME_LENGTH-1] = '\0';
+    memcpy(tileSetName,header + HEADER_TILESET_NAME_OFFSET,TILESET_NAME_LENGTH);
+    tileSetName[TILESET_NAME_LENGTH-1] = '\0';
+
+    //create the map without any tiles, the chunks are paged in when they are used
+    isoMap = isoMapCreateEmptyMap(name,width,height,numLayers,tileSize);
+    if (isoMap == NULL) {
+        isoMapFileClose(mapFile);
+        return NULL;
+    }
+    if (isoMap->mapWidth != width || isoMap->mapHeight != height || isoMap->numLayers != numLayers
+    || isoMap->numChunksX != numChunksX || isoMap->numChunksY != numChunksY) {
+        WriteError("%s has an invalid map size!",fileName);
+        isoMapFileClose(mapFile);
+        isoMapFreeMap(isoMap);
+        return NULL;
+    }
+    if (readChunkTable(mapFile,getUint64(header + HEADER_CHUNK_TABLE_OFFSET),numChunksX * numChunksY) == -1) {
+        WriteError("%s has an invalid chunk table!",fileName);
+        isoMapFileClose(mapFile);
+        isoMapFreeMap(isoMap);
+        return NULL;
+    }
+
+    //remember the tile set the map was saved with
+    isoMapSetTileSetName(isoMap,tileSetName);
+    isoMap->tileSet->tileWidth = (int)getUint32(header + 40);
+    isoMap->tileSet->tileHeight = (int)getUint32(header + 44);
+
+    //files from before version 3 do not say how they were generated, so they never match the generator
+    if (mapFile->version >= 3) {
+        isoMap->generatorVersion = (int)getUint32(header + HEADER_GENERATOR_OFFSET);
+        isoMap->seed = (int)getUint32(header + HEADER_GENERATOR_OFFSET + 4);
+        isoMap->terrainHeight = (int)getUint32(header + HEADER_GENERATOR_OFFSET + 8);
+    }
+
+    isoMap->mapFile = mapFile;
+    WriteDebug("Opened map %s from %s (%dx%d, %d layers, %d chunks)",isoMap->name,fileName,width,height,numLayers,mapFile->numChunks);
+    return isoMap;
+}
+
+//returns the terrain height of an auto tiled tile. Only used for version 1 files,
+//which do not store the terrain heights
+static Sint8 terrainHeightFromTile(int tileValue) {
+    //empty tiles and grass are at the lowest height
+    if (tileValue < 0 || tileValue == 1) {
+        return 0;
+    }
+    return (Sint8)((tileValue+1) / NUM_TILES_PER_ROW_IN_TILESET + 1);
+}
+
+int isoMapFilePageInChunk(IsoMap *isoMap,int chunkIndex) {
+    int numTiles = ISO_MAP_CHUNK_SIZE * ISO_MAP_CHUNK_SIZE;
+    Uint32 rawTilesSize = sizeof(int) * numTiles * isoMap->numLayers;
+    IsoMapChunk *chunk = NULL;
+    IsoMapFileChunkEntry *entry = NULL;
+    const Uint8 *data = NULL;
+    const Uint8 *heightsData = NULL;
+    int i = 0;
+    int decodeResult = 1;
+    int isRaw = 0;
+
+    if (isoMap->mapFile == NULL || chunkIndex < 0 || chunkIndex >= isoMap->mapFile->numChunks) {
+        return -1;
+    }
+    chunk = &isoMap->chunks[chunkIndex];
+    if (chunk->isResident) {
+        return 1;
+    }
+    entry = &isoMap->mapFile->chunkTable[chunkIndex];
+    data = isoMap->mapFile->data + entry->offset;
+    heightsData = data + entry->tilesSize + entry->flagsSize;
+    isRaw = entry->compression == ISO_MAP_FILE_COMPRESSION_NONE
+            && entry->tilesSize == rawTilesSize && entry->flagsSize == (Uint32)numTiles;
+
+    //uncompressed chunks can be used directly from the file, as long as the
+    //tiles in the file have the same byte order as the machine
+    if (isRaw && SDL_BYTEORDER == SDL_LIL_ENDIAN) {
+        //the terrain heights are small, so they are always copied
+        chunk->heights = malloc(sizeof(Sint8) * numTiles);
+        if (chunk->heights == NULL) {
+            WriteError("Could not allocate memory for isometric map chunk!");
+            return -1;
+        }
+        chunk->tiles = (int*)data;
+        chunk->flags = (Uint8*)data + entry->tilesSize;
+        chunk->dirtyFlags = ISO_MAP_CHUNK_DIRTY_ALL;
+        chunk->isResident = 1;
+        chunk->ownsMemory = 0;
+    }
+    else {
+        //allocate memory for the chunk and decode it
+        if (isoMapAllocateChunk(isoMap,chunk) == -1) {
+            return -1;
+        }
+        if (entry->compression == ISO_MAP_FILE_COMPRESSION_RLE) {
+            decodeResult = rleDecodeTiles(data,entry->tilesSize,chunk->tiles,numTiles * isoMap->numLayers);
+            if (decodeResult != -1) {
+                decodeResult = rleDecodeBytes(data + entry->tilesSize,entry->flagsSize,chunk->flags,numTiles);
+            }
+        }
+        else if (isRaw) {
+            for (i = 0; i < numTiles * isoMap->numLayers; ++i) {
+                chunk->tiles[i] = (int)getUint32(data + i*4);
+            }
+            memcpy(chunk->flags,data + entry->tilesSize,numTiles);
+        } else {
+            decodeResult = -1;
+        }
+    }
+
+    ///TERRAIN HEIGHTS
+    if (decodeResult != -1) {
+        if (isoMap->mapFile->version < 2) {
+            for (i = 0; i < numTiles; ++i) {
+                chunk->heights[i] = terrainHeightFromTile(chunk->tiles[i * isoMap->numLayers]);
+            }
+        }
+        else if (entry->compression == ISO_MAP_FILE_COMPRESSION_RLE) {
+            decodeResult = rleDecodeBytes(heightsData,entry->heightsSize,(Uint8*)chunk->heights,numTiles);
+        }
+        else if (entry->heightsSize == (Uint32)numTiles) {
+            memcpy(chunk->heights,heightsData,numTiles);
+        } else {
+            decodeResult = -1;
+        }
+    }
+
+    //a broken chunk is replaced with an empty chunk, so the rest of the map can still be used
+    if (decodeResult == -1) {
+        WriteError("Chunk %d in map %s is corrupt!",chunkIndex,isoMap->name);
+        //make sure we never write into the mapped file
+        if (chunk->ownsMemory == 0) {
+            free(chunk->heights);
+            chunk->heights = NULL;
+            if (isoMapAllocateChunk(isoMap,chunk) == -1) {
+                chunk->isResident = 0;
+                return -1;
+            }
+        }
+        memset(chunk->tiles,-1,rawTilesSize);
+        memset(chunk->flags,0,numTiles);
+        memset(chunk->heights,0,numTiles);
+    }
+    //the blocking flags are derived from the tiles again, since older maps were saved without them
+    isoMapUpdateChunkFlags(isoMap,chunk);
+    return 1;
+}
+
+void isoMapFileClose(IsoMapFile *mapFile) {
+    if (mapFile == NULL) {
+        return;
+    }
+    if (mapFile->data != NULL) {
+#ifndef ISO_MAP_FILE_NO_MMAP
+        if (mapFile->isMapped) {
+            munmap(mapFile->data,mapFile->size);
+        } else {
+            free(mapFile->data);
+        }
+#else
+        free(mapFile->data);
+#endif
+    }
+    free(mapFile->chunkTable);
+    free(mapFile);
+}
+
+static IsoMapFile *openMapFile(char *fileName) {
+    IsoMapFile *mapFile = malloc(sizeof(struct IsoMapFile));
+    if (mapFile == NULL) {
+        WriteError("Could not allocate memory for map file!");
+        return NULL;
+    }
+    mapFile->data = NULL;
+    mapFile->size = 0;
+    mapFile->isMapped = 0;
+    mapFile->version = 0;
+    mapFile->numChunks = 0;
+    mapFile->chunkTable = NULL;
+
+#ifndef ISO_MAP_FILE_NO_MMAP
+    struct stat fileStat;
+    int fd = open(fileName,O_RDONLY);
+    if (fd == -1) {
+        WriteError("Could not open map file %s!",fileName);
+        free(mapFile);
+        return NULL;
+    }
+    if (fstat(fd,&fileStat) == -1 || fileStat.st_size <= 0) {
+        WriteError("Could not get the size of map file %s!",fileName);
+        close(fd);
+        free(mapFile);
+        return NULL;
+    }
+    mapFile->size = (size_t)fileStat.st_size;
+
+    //map the file privately, so pages are only read from disk when they are touched
+    //and changes to the tiles are never written back to the file
+    mapFile->data = mmap(NULL,mapFile->size,PROT_READ | PROT_WRITE,MAP_PRIVATE,fd,0);
+    close(fd);
+    if (mapFile->data == MAP_FAILED) {
+        WriteError("Could not map file %s into memory!",fileName);
+        free(mapFile);
+        return NULL;
+    }
+    mapFile->isMapped = 1;
+#else
+    //no mmap available, so read the whole file into memory
+    FILE *file = fopen(fileName,"rb");
+    long fileSize = 0;
+    if (file == NULL) {
+        WriteError("Could not open map file %s!",fileName);
+        free(mapFile);
+        return NULL;
+    }
+    fseek(file,0,SEEK_END);
+    fileSize = ftell(file);
+    fseek(file,0,SEEK_SET);
+    if (fileSize <= 0) {
+        WriteError("Could not get the size of map file %s!",fileName);
+        fclose(file);
+        free(mapFile);
+        return NULL;
+    }
+    mapFile->size = (size_t)fileSize;
+    mapFile->data = malloc(mapFile->size);
+    if (mapFile->data == NULL || fread(mapFile->data,1,mapFile->size,file) != mapFile->size) {
+        WriteError("Could not read map file %s!",fileName);
+        fclose(file);
+        free(mapFile->data);
+        free(mapFile);
+        return NULL;
+    }
+    fclose(file);
+#endif
+    return mapFile;
+}
+
+static int readChunkTable(IsoMapFile *mapFile,Uint64 tableOffset,int numChunks) {
+    const Uint8 *entry = NULL;
+    Uint64 remaining = 0;
+    int i = 0;
+
+    //make sure the table is inside the file. The sizes are checked against what is left of the file, so a corrupt
+    //offset can not wrap the sum around and pass
+    if (numChunks <= 0 || tableOffset > mapFile->size
+    || (Uint64)numChunks > (mapFile->size - tableOffset) / ISO_MAP_FILE_CHUNK_ENTRY_SIZE) {
+        return -1;
+    }
+    mapFile->chunkTable = malloc(sizeof(struct IsoMapFileChunkEntry) * numChunks);
+    if (mapFile->chunkTable == NULL) {
+        WriteError("Could not allocate memory for the chunk table!");
+        return -1;
+    }
+    mapFile->numChunks = numChunks;
+
+    for (i = 0; i < numChunks; ++i) {
+        entry = mapFile->data + tableOffset + (Uint64)i * ISO_MAP_FILE_CHUNK_ENTRY_SIZE;
+        mapFile->chunkTable[i].offset = getUint64(entry);
+        mapFile->chunkTable[i].tilesSize = getUint32(entry + 8);
+        mapFile->chunkTable[i].flagsSize = getUint32(entry + 12);
+        mapFile->chunkTable[i].compression = getUint32(entry + 16);
+        //version 1 files have no terrain heights
+        mapFile->chunkTable[i].heightsSize = mapFile->version >= 2 ? getUint32(entry + 20) : 0;
+
+        //make sure the chunk is inside the file and aligned, one plane at a time
+        remaining = mapFile->size;
+        if (mapFile->chunkTable[i].offset % 4 != 0 || mapFile->chunkTable[i].offset > remaining) {
+            return -1;
+        }
+        remaining -= mapFile->chunkTable[i].offset;
+        if (mapFile->chunkTable[i].tilesSize > remaining) {
+            return -1;
+        }
+        remaining -= mapFile->chunkTable[i].tilesSize;
+        if (mapFile->chunkTable[i].flagsSize > remaining) {
+            return -1;
+        }
+        remaining -= mapFile->chunkTable[i].flagsSize;
+        if (mapFile->chunkTable[i].heightsSize > remaining) {
+            return -1;
+        }
+    }
+    return 1;
+}
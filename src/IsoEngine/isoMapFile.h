@@ -0,0 +1,37 @@
+#ifndef __ISO_MAP_FILE_H
+#define __ISO_MAP_FILE_H
+
+#include <SDL2/SDL.h>
+#include "isoMap.h"
+
+#define ISO_MAP_FILE_MAGIC                  "ISOM"
+#define ISO_MAP_FILE_VERSION                3
+#define ISO_MAP_FILE_HEADER_SIZE            176
+#define ISO_MAP_FILE_CHUNK_ENTRY_SIZE       24
+
+#define ISO_MAP_FILE_COMPRESSION_NONE       0
+#define ISO_MAP_FILE_COMPRESSION_RLE        1
+
+typedef struct IsoMapFileChunkEntry {
+    Uint64 offset;          //byte offset of the chunk data in the file
+    Uint32 tilesSize;       //stored size of the tile plane in bytes
+    Uint32 flagsSize;       //stored size of the flag plane in bytes
+    Uint32 heightsSize;     //stored size of the terrain height plane in bytes (version 2)
+    Uint32 compression;     //ISO_MAP_FILE_COMPRESSION_*
+} IsoMapFileChunkEntry;
+
+typedef struct IsoMapFile {
+    Uint8 *data;                        //contents of the file, mapped or read into memory
+    size_t size;                        //size of the file in bytes
+    int isMapped;                       //1 if data is a memory mapping of the file
+    int version;                        //version of the file format
+    int numChunks;                      //number of entries in the chunk table
+    IsoMapFileChunkEntry *chunkTable;   //where every chunk is stored in the file
+} IsoMapFile;
+
+int isoMapSaveToFile(IsoMap *isoMap,char *fileName);
+[[nodiscard]] IsoMap* isoMapLoadFromFile(char *fileName);
+int isoMapFilePageInChunk(IsoMap *isoMap,int chunkIndex);
+void isoMapFileClose(IsoMapFile *mapFile);
+
+#endif // __ISO_MAP_FILE_H
@@ -0,0 +1,275 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "isoMinimap.h"
+#include "isoMap.h"
+#include "../logger.h"
+#include "../renderer.h"
+#include "../RenderQueue.h"
+
+//colour of the tiles on every terrain height, from the grass at the bottom to the top of the hills
+static const Uint8 terrainHeightColors[NUM_TILE_LEVELS_PER_LAYER+1][3] = {
+    {0x3e,0x8a,0x2f},
+    {0x4b,0x96,0x33},
+    {0x5d,0xa1,0x3a},
+    {0x74,0xa8,0x45},
+    {0x8c,0xa6,0x55},
+    {0x9c,0x9a,0x6b},
+    {0xb4,0xb0,0x9c},
+};
+
+static Uint32 tileColor(IsoMap *isoMap,int x,int y);
+static void buildRegion(IsoMinimap *minimap,IsoMap *isoMap,int x0,int y0,int x1,int y1);
+static void uploadRegion(IsoMinimap *minimap,int x0,int y0,int x1,int y1);
+
+IsoMinimap *isoMinimapNew(IsoMap *isoMap) {
+    IsoMinimap *minimap = NULL;
+    Uint64 buildTimer = SDL_GetPerformanceCounter();
+    int level = 0;
+    int width = 0, height = 0;
+    int i = 0;
+
+    if (isoMap == NULL) {
+        WriteError("Parameter: 'IsoMap *isoMap' is NULL!");
+        return NULL;
+    }
+
+    minimap = calloc(1,sizeof(struct IsoMinimap));
+    if (minimap == NULL) {
+        WriteError("Could not allocate memory for the minimap!");
+        return NULL;
+    }
+
+    //add levels until the level is a single pixel
+    width = isoMap->mapWidth;
+    height = isoMap->mapHeight;
+    for (level = 0; level < ISO_MINIMAP_MAX_LEVELS; ++level) {
+        minimap->levelWidth[level] = width;
+        minimap->levelHeight[level] = height;
+        minimap->levelPixels[level] = malloc(sizeof(Uint32)*width*height);
+        if (minimap->levelPixels[level] == NULL) {
+            WriteError("Could not allocate memory for level %d of the minimap!",level);
+            isoMinimapFree(minimap);
+            return NULL;
+        }
+        minimap->levelTextures[level] = RenderQueue_CreateTexture(SDL_PIXELFORMAT_ARGB8888,SDL_TEXTUREACCESS_STATIC,width,height,SDL_BLENDMODE_BLEND);
+        if (minimap->levelTextures[level] == NULL) {
+            WriteError("Could not create the texture for level %d of the minimap!",level);
+            isoMinimapFree(minimap);
+            return NULL;
+        }
+        minimap->numLevels++;
+
+        if (width == 1 && height == 1) {
+            break;
+        }
+        width = (width+1)/2;
+        height = (height+1)/2;
+    }
+
+    //build the whole pyramid at once, and mark that the minimap has caught up with every chunk
+    buildRegion(minimap,isoMap,0,0,isoMap->mapWidth,isoMap->mapHeight);
+    uploadRegion(minimap,0,0,isoMap->mapWidth,isoMap->mapHeight);
+    for (i = 0; i < isoMap->numChunksX*isoMap->numChunksY; ++i) {
+        isoMapClearChunkDirty(isoMap,i,ISO_MAP_CHUNK_DIRTY_MINIMAP);
+    }
+    WriteDebug("Built %d minimap levels in %.2f ms",minimap->numLevels,(double)(SDL_GetPerformanceCounter()-buildTimer)*1000.0/SDL_GetPerformanceFrequency());
+
+    return minimap;
+}
+
+void isoMinimapFree(IsoMinimap *minimap) {
+    int level = 0;
+
+    if (minimap == NULL) {
+        return;
+    }
+    for (level = 0; level < ISO_MINIMAP_MAX_LEVELS; ++level) {
+        free(minimap->levelPixels[level]);
+        RenderQueue_DestroyTexture(minimap->levelTextures[level]);
+    }
+    free(minimap);
+}
+
+//builds the minimap again for every chunk that has changed since the last update.
+//Returns the number of chunks that were updated
+int isoMinimapUpdate(IsoMinimap *minimap,IsoMap *isoMap) {
+    int chunkX = 0, chunkY = 0;
+    int chunkIndex = 0;
+    int numUpdated = 0;
+    int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+
+    if (minimap == NULL || isoMap == NULL) {
+        return 0;
+    }
+    for (chunkY = 0; chunkY < isoMap->numChunksY; ++chunkY) {
+        for (chunkX = 0; chunkX < isoMap->numChunksX; ++chunkX) {
+            chunkIndex = chunkY*isoMap->numChunksX + chunkX;
+            if (!isoMapChunkIsDirty(isoMap,chunkIndex,ISO_MAP_CHUNK_DIRTY_MINIMAP)) {
+                continue;
+            }
+            x0 = chunkX << ISO_MAP_CHUNK_SHIFT;
+            y0 = chunkY << ISO_MAP_CHUNK_SHIFT;
+            x1 = x0 + ISO_MAP_CHUNK_SIZE > isoMap->mapWidth ? isoMap->mapWidth : x0 + ISO_MAP_CHUNK_SIZE;
+            y1 = y0 + ISO_MAP_CHUNK_SIZE > isoMap->mapHeight ? isoMap->mapHeight : y0 + ISO_MAP_CHUNK_SIZE;
+
+            buildRegion(minimap,isoMap,x0,y0,x1,y1);
+            uploadRegion(minimap,x0,y0,x1,y1);
+            isoMapClearChunkDirty(isoMap,chunkIndex,ISO_MAP_CHUNK_DIRTY_MINIMAP);
+            numUpdated++;
+        }
+    }
+    return numUpdated;
+}
+
+//returns the smallest level where one pixel is at least one pixel on screen,
+//when one tile is pixelsPerTile pixels on screen
+int isoMinimapGetLevelForScale(IsoMinimap *minimap,float pixelsPerTile) {
+    int level = 0;
+
+    if (minimap == NULL) {
+        return 0;
+    }
+    while (level < minimap->numLevels-1 && pixelsPerTile < 1.0f) {
+        pixelsPerTile *= 2.0f;
+        level++;
+    }
+    return level;
+}
+
+//draws a level of the minimap into the diamond with the corners at the screen positions of the map
+//corners: corners[0] is tile 0,0, corners[1] is the right end of the first row, corners[2] is the
+//far corner of the map and corners[3] is the bottom end of the first column
+void isoMinimapDraw(IsoMinimap *minimap,IsoMap *isoMap,int level,SDL_FPoint *corners) {
+    SDL_Vertex vertices[4];
+    const int indices[6] = {0,1,2, 0,2,3};
+    float texRight = 0, texBottom = 0;
+    int i = 0;
+
+    if (minimap == NULL || isoMap == NULL || corners == NULL) {
+        return;
+    }
+    if (level < 0) {
+        level = 0;
+    } else if (level > minimap->numLevels-1) {
+        level = minimap->numLevels-1;
+    }
+
+    //the pixels of a level cover a little more than the map when the map size is not divisible by the level size
+    texRight = ((float)isoMap->mapWidth/(float)(1 << level))/(float)minimap->levelWidth[level];
+    texBottom = ((float)isoMap->mapHeight/(float)(1 << level))/(float)minimap->levelHeight[level];
+
+    for (i = 0; i < 4; ++i) {
+        vertices[i].position = corners[i];
+        vertices[i].color.r = 0xff;
+        vertices[i].color.g = 0xff;
+        vertices[i].color.b = 0xff;
+        vertices[i].color.a = 0xff;
+    }
+    vertices[0].tex_coord.x = 0;
+    vertices[0].tex_coord.y = 0;
+    vertices[1].tex_coord.x = texRight;
+    vertices[1].tex_coord.y = 0;
+    vertices[2].tex_coord.x = texRight;
+    vertices[2].tex_coord.y = texBottom;
+    vertices[3].tex_coord.x = 0;
+    vertices[3].tex_coord.y = texBottom;
+
+    RenderQueue_AddGeometry(minimap->levelTextures[level],vertices,4,indices,6);
+}
+
+static Uint32 tileColor(IsoMap *isoMap,int x,int y) {
+    int terrainHeight = 0;
+    Uint32 r = 0, g = 0, b = 0;
+
+    //empty tiles are see-through
+    if (isoMapGetTile(isoMap,x,y,0) < 0) {
+        return 0;
+    }
+    terrainHeight = isoMapGetTerrainHeight(isoMap,x,y);
+    if (terrainHeight < 0) {
+        terrainHeight = 0;
+    } else if (terrainHeight > NUM_TILE_LEVELS_PER_LAYER) {
+        terrainHeight = NUM_TILE_LEVELS_PER_LAYER;
+    }
+    r = terrainHeightColors[terrainHeight][0];
+    g = terrainHeightColors[terrainHeight][1];
+    b = terrainHeightColors[terrainHeight][2];
+
+    //blocking tiles are drawn darker
+    if (isoMapGetTileFlags(isoMap,x,y) & ISO_TILE_FLAG_BLOCKING) {
+        r = r*3/4;
+        g = g*3/4;
+        b = b*3/4;
+    }
+    return 0xff000000 | (r << 16) | (g << 8) | b;
+}
+
+//builds the pixels of the tiles x0,y0 - x1,y1 (x1,y1 not included) in every level of the pyramid
+static void buildRegion(IsoMinimap *minimap,IsoMap *isoMap,int x0,int y0,int x1,int y1) {
+    int level = 0;
+    int x = 0, y = 0;
+    int childX = 0, childY = 0, childX1 = 0, childY1 = 0;
+    int childWidth = 0;
+    Uint32 *child = NULL;
+    Uint32 *pixels = NULL;
+    Uint32 p0 = 0, p1 = 0, p2 = 0, p3 = 0;
+    Uint32 channel = 0, color = 0;
+    int shift = 0;
+
+    //level 0 has the colour of every tile
+    for (y = y0; y < y1; ++y) {
+        for (x = x0; x < x1; ++x) {
+            minimap->levelPixels[0][y*minimap->levelWidth[0] + x] = tileColor(isoMap,x,y);
+        }
+    }
+
+    //every pixel in the next levels is the average of the four pixels below it
+    for (level = 1; level < minimap->numLevels; ++level) {
+        x0 = x0 >> 1;
+        y0 = y0 >> 1;
+        x1 = (x1+1) >> 1;
+        y1 = (y1+1) >> 1;
+        child = minimap->levelPixels[level-1];
+        childWidth = minimap->levelWidth[level-1];
+        pixels = minimap->levelPixels[level];
+
+        for (y = y0; y < y1; ++y) {
+            childY = y*2;
+            //use the last row twice when the level below has an odd height
+            childY1 = childY+1 < minimap->levelHeight[level-1] ? childY+1 : childY;
+            for (x = x0; x < x1; ++x) {
+                childX = x*2;
+                childX1 = childX+1 < childWidth ? childX+1 : childX;
+
+                p0 = child[childY*childWidth + childX];
+                p1 = child[childY*childWidth + childX1];
+                p2 = child[childY1*childWidth + childX];
+                p3 = child[childY1*childWidth + childX1];
+
+                color = 0;
+                for (shift = 0; shift < 32; shift += 8) {
+                    channel = ((p0 >> shift) & 0xff) + ((p1 >> shift) & 0xff) + ((p2 >> shift) & 0xff) + ((p3 >> shift) & 0xff);
+                    color |= ((channel + 2) >> 2) << shift;
+                }
+                pixels[y*minimap->levelWidth[level] + x] = color;
+            }
+        }
+    }
+}
+
+//uploads the pixels of the tiles x0,y0 - x1,y1 (x1,y1 not included) in every level to the textures.
+//The pixels are copied into the render queue, so they can be built again before the frame has been drawn
+static void uploadRegion(IsoMinimap *minimap,int x0,int y0,int x1,int y1) {
+    int level = 0;
+    SDL_Rect rect;
+
+    for (level = 0; level < minimap->numLevels; ++level) {
+        SetupRect(&rect,x0,y0,x1-x0,y1-y0);
+        RenderQueue_UpdateTexture(minimap->levelTextures[level],&rect,&minimap->levelPixels[level][y0*minimap->levelWidth[level] + x0],
+                                  minimap->levelWidth[level]*sizeof(Uint32));
+        x0 = x0 >> 1;
+        y0 = y0 >> 1;
+        x1 = (x1+1) >> 1;
+        y1 = (y1+1) >> 1;
+    }
+}
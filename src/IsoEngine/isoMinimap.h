@@ -0,0 +1,27 @@
+#ifndef __ISO_MINIMAP_H
+#define __ISO_MINIMAP_H
+
+#include <SDL2/SDL.h>
+#include "isoMap.h"
+
+//level 0 has one pixel per tile, every next level halves the width and height
+#define ISO_MINIMAP_MAX_LEVELS          12
+
+//The minimap is a pyramid of small textures of the map, where every pixel is the average colour
+//of the tiles below it. It is used for the minimap widget and for drawing the map when the camera
+//is zoomed far out, where drawing one quad per tile would be far too slow
+typedef struct IsoMinimap {
+    int numLevels;
+    int levelWidth[ISO_MINIMAP_MAX_LEVELS];
+    int levelHeight[ISO_MINIMAP_MAX_LEVELS];
+    Uint32 *levelPixels[ISO_MINIMAP_MAX_LEVELS];        //ARGB8888 pixels of every level
+    SDL_Texture *levelTextures[ISO_MINIMAP_MAX_LEVELS]; //the pixels of every level uploaded to the renderer
+} IsoMinimap;
+
+[[nodiscard]] IsoMinimap *isoMinimapNew(IsoMap *isoMap);
+void isoMinimapFree(IsoMinimap *minimap);
+int isoMinimapUpdate(IsoMinimap *minimap,IsoMap *isoMap);
+[[nodiscard]] int isoMinimapGetLevelForScale(IsoMinimap *minimap,float pixelsPerTile);
+void isoMinimapDraw(IsoMinimap *minimap,IsoMap *isoMap,int level,SDL_FPoint *corners);
+
+#endif // __ISO_MINIMAP_H
@@ -0,0 +1,936 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "isoPathfinder.h"
+#include "isoMap.h"
+#include "../logger.h"
+#include "../ThreadPool.h"
+
+//number of request slots there is room for before the first request
+#define ISO_PATH_INITIAL_REQUESTS       64
+//number of requests solved in one task of the parallel loop
+#define ISO_PATH_REQUESTS_PER_TASK      16
+//runs of walkable tiles on a border shorter than this get one entrance in the middle, longer ones one at each end
+#define ISO_PATH_LONG_ENTRANCE          6
+//marks of the chunks in an update: the tiles of the chunk changed, its graph is built again, its links are made again
+#define ISO_PATH_MARK_CHANGED           0x01
+#define ISO_PATH_MARK_BUILD             0x02
+#define ISO_PATH_MARK_LINK              0x04
+//the tiles of a chunk are searched in a grid with an extra tile on every side
+#define ISO_PATH_GRID_SIZE              (ISO_MAP_CHUNK_SIZE+2)
+#define ISO_PATH_GRID_TILES             (ISO_PATH_GRID_SIZE*ISO_PATH_GRID_SIZE)
+
+typedef struct IsoPathHeapEntry {
+    Uint64 key;
+    int index;
+} IsoPathHeapEntry;
+
+//binary min heap, entries are not updated in place, a cheaper entry is pushed again and the old one skipped
+typedef struct IsoPathHeap {
+    IsoPathHeapEntry *entries;
+    int numEntries;
+    int maxEntries;
+} IsoPathHeap;
+
+//what a search knows about a node, kept together since they are read together
+typedef struct IsoPathNodeState {
+    Uint32 cost;
+    Uint32 stamp;           //the cost and parent are from the current search if this is its stamp
+    Uint32 closedStamp;     //the node has been expanded in the current search if this is its stamp
+    int parent;
+} IsoPathNodeState;
+
+//the search memory of one thread. The costs are valid where the stamp is the stamp of the current search,
+//so nothing has to be cleared between the searches
+typedef struct IsoPathScratch {
+    //search in the abstract graph, one entry for every node and one for the goal
+    IsoPathNodeState *nodes;
+    Uint32 nodeStamp;
+    IsoPathHeap nodeHeap;
+    int *abstractPath;
+    int maxAbstractPath;
+    //search between the tiles of one chunk
+    Uint8 grid[ISO_PATH_GRID_TILES];        //the walkable tiles of the chunk that was searched last
+    int gridChunk;                          //-1 when the grid has to be loaded again
+    Uint32 tileCosts[ISO_PATH_GRID_TILES];
+    Sint16 tileParents[ISO_PATH_GRID_TILES];
+    Uint32 tileStamps[ISO_PATH_GRID_TILES];
+    Uint32 tileClosedStamps[ISO_PATH_GRID_TILES];
+    Uint32 tileStamp;
+    IsoPathHeap tileHeap;
+    //costs from the start to the nodes of its chunk, and from the nodes of the goal chunk to the goal
+    Uint16 startCosts[ISO_PATH_MAX_CHUNK_NODES];
+    Uint16 goalCosts[ISO_PATH_MAX_CHUNK_NODES];
+} IsoPathScratch;
+
+//the y of the 8 steps to the tiles around a tile, the straight ones first
+static const int stepY[8] = {-1,0,1,0,-1,1,1,-1};
+
+static int heapPush(IsoPathHeap *heap,Uint64 key,int index);
+static IsoPathHeapEntry heapPop(IsoPathHeap *heap);
+static int updateChunks(IsoPathfinder *pathfinder,IsoMap *isoMap,int allChunks);
+static void updateWalkable(IsoPathfinder *pathfinder,IsoMap *isoMap,int chunkIndex);
+static void buildChunkTask(int taskIndex,int threadIndex,void *data);
+static void linkChunk(IsoPathfinder *pathfinder,int chunkIndex);
+static int prepareScratch(IsoPathfinder *pathfinder);
+static void solveRequestsTask(int taskIndex,int threadIndex,void *data);
+static int solveRequest(IsoPathfinder *pathfinder,IsoPathScratch *scratch,IsoPathRequest *request);
+
+IsoPathfinder *isoPathfinderNew(IsoMap *isoMap) {
+    IsoPathfinder *pathfinder = NULL;
+    Uint64 buildTimer = SDL_GetPerformanceCounter();
+    int numChunks = 0;
+
+    if (isoMap == NULL) {
+        WriteError("Parameter: 'IsoMap *isoMap' is NULL!");
+        return NULL;
+    }
+
+    pathfinder = calloc(1,sizeof(struct IsoPathfinder));
+    if (pathfinder == NULL) {
+        WriteError("Could not allocate memory for the pathfinder!");
+        return NULL;
+    }
+    pathfinder->mapWidth = isoMap->mapWidth;
+    pathfinder->mapHeight = isoMap->mapHeight;
+    pathfinder->numChunksX = isoMap->numChunksX;
+    pathfinder->numChunksY = isoMap->numChunksY;
+    numChunks = isoMap->numChunksX*isoMap->numChunksY;
+    pathfinder->walkable = calloc(isoMap->mapWidth*isoMap->mapHeight,sizeof(Uint8));
+    pathfinder->chunks = calloc(numChunks,sizeof(struct IsoPathChunk));
+    pathfinder->nodeAreas = malloc(sizeof(int)*numChunks*ISO_PATH_MAX_CHUNK_NODES);
+    pathfinder->areaStack = malloc(sizeof(int)*numChunks*ISO_PATH_MAX_CHUNK_NODES);
+    pathfinder->chunkMarks = calloc(numChunks,sizeof(Uint8));
+    pathfinder->chunkList = malloc(sizeof(int)*numChunks);
+    pathfinder->pendingRequests = malloc(sizeof(int)*ISO_PATH_MAX_REQUESTS_PER_UPDATE);
+    if (pathfinder->walkable == NULL || pathfinder->chunks == NULL || pathfinder->nodeAreas == NULL || pathfinder->areaStack == NULL
+    || pathfinder->chunkMarks == NULL || pathfinder->chunkList == NULL || pathfinder->pendingRequests == NULL) {
+        WriteError("Could not allocate memory for the pathfinder!");
+        isoPathfinderFree(pathfinder);
+        return NULL;
+    }
+    if (prepareScratch(pathfinder) == 0) {
+        isoPathfinderFree(pathfinder);
+        return NULL;
+    }
+
+    //build the graph of every chunk at once, and mark that the pathfinder has caught up with every chunk
+    updateChunks(pathfinder,isoMap,1);
+    WriteDebug("Built the path graph of %d chunks in %.2f ms",numChunks,(double)(SDL_GetPerformanceCounter()-buildTimer)*1000.0/SDL_GetPerformanceFrequency());
+
+    return pathfinder;
+}
+
+void isoPathfinderFree(IsoPathfinder *pathfinder) {
+    int i = 0;
+
+    if (pathfinder == NULL) {
+        return;
+    }
+    for (i = 0; i < pathfinder->numRequests; ++i) {
+        free(pathfinder->requests[i].tiles);
+    }
+    for (i = 0; i < pathfinder->numScratch; ++i) {
+        free(pathfinder->scratch[i].nodes);
+        free(pathfinder->scratch[i].nodeHeap.entries);
+        free(pathfinder->scratch[i].abstractPath);
+        free(pathfinder->scratch[i].tileHeap.entries);
+    }
+    free(pathfinder->scratch);
+    free(pathfinder->requests);
+    free(pathfinder->freeRequests);
+    free(pathfinder->pendingRequests);
+    free(pathfinder->walkable);
+    free(pathfinder->chunks);
+    free(pathfinder->nodeAreas);
+    free(pathfinder->areaStack);
+    free(pathfinder->chunkMarks);
+    free(pathfinder->chunkList);
+    free(pathfinder);
+}
+
+//builds the graph again for every chunk that has changed since the last update, and solves the paths that have
+//been requested. Returns the number of paths that were solved
+int isoPathfinderUpdate(IsoPathfinder *pathfinder,IsoMap *isoMap) {
+    Uint64 solveTimer = 0;
+    int i = 0, slot = 0;
+
+    if (pathfinder == NULL || isoMap == NULL) {
+        return 0;
+    }
+    if (prepareScratch(pathfinder) == 0) {
+        return 0;
+    }
+    updateChunks(pathfinder,isoMap,0);
+
+    //take the pending requests, starting where the last update stopped
+    solveTimer = SDL_GetPerformanceCounter();
+    pathfinder->numPendingRequests = 0;
+    for (i = 0; i < pathfinder->numRequests && pathfinder->numPendingRequests < ISO_PATH_MAX_REQUESTS_PER_UPDATE; ++i) {
+        slot = (pathfinder->nextPendingScan + i) % pathfinder->numRequests;
+        if (pathfinder->requests[slot].state == ISO_PATH_STATE_PENDING) {
+            pathfinder->pendingRequests[pathfinder->numPendingRequests++] = slot;
+        }
+    }
+    if (pathfinder->numRequests > 0) {
+        pathfinder->nextPendingScan = (pathfinder->nextPendingScan + i) % pathfinder->numRequests;
+    }
+    ThreadPool_ParallelFor((pathfinder->numPendingRequests + ISO_PATH_REQUESTS_PER_TASK-1)/ISO_PATH_REQUESTS_PER_TASK,
+                           solveRequestsTask,pathfinder);
+    pathfinder->numPathsSolvedLastUpdate = pathfinder->numPendingRequests;
+    pathfinder->solveTimeLastUpdate = (double)(SDL_GetPerformanceCounter()-solveTimer)*1000.0/SDL_GetPerformanceFrequency();
+
+    return pathfinder->numPendingRequests;
+}
+
+//asks for a path between two tiles. The path is solved at the next isoPathfinderUpdate(), until then the request
+//is pending. Returns the request, or 0 on error
+int isoPathfinderRequestPath(IsoPathfinder *pathfinder,int startX,int startY,int goalX,int goalY) {
+    IsoPathRequest *newRequests = NULL;
+    int *newFreeRequests = NULL;
+    int newMax = 0;
+    int slot = 0;
+
+    if (pathfinder == NULL) {
+        return 0;
+    }
+    if (pathfinder->numFreeRequests > 0) {
+        slot = pathfinder->freeRequests[--pathfinder->numFreeRequests];
+    } else {
+        //the slot has to fit in the handle
+        if (pathfinder->numRequests >= ISO_PATH_REQUEST_SLOT_MASK) {
+            WriteError("Can not have more than %d path requests!",ISO_PATH_REQUEST_SLOT_MASK);
+            return 0;
+        }
+        if (pathfinder->numRequests >= pathfinder->maxRequests) {
+            newMax = pathfinder->maxRequests > 0 ? pathfinder->maxRequests*2 : ISO_PATH_INITIAL_REQUESTS;
+            newRequests = realloc(pathfinder->requests,sizeof(struct IsoPathRequest)*newMax);
+            if (newRequests == NULL) {
+                WriteError("Could not allocate memory for %d path requests!",newMax);
+                return 0;
+            }
+            memset(&newRequests[pathfinder->maxRequests],0,sizeof(struct IsoPathRequest)*(newMax-pathfinder->maxRequests));
+            pathfinder->requests = newRequests;
+            newFreeRequests = realloc(pathfinder->freeRequests,sizeof(int)*newMax);
+            if (newFreeRequests == NULL) {
+                WriteError("Could not allocate memory for %d path requests!",newMax);
+                return 0;
+            }
+            pathfinder->freeRequests = newFreeRequests;
+            pathfinder->maxRequests = newMax;
+        }
+        slot = pathfinder->numRequests++;
+    }
+    pathfinder->requests[slot].state = ISO_PATH_STATE_PENDING;
+    pathfinder->requests[slot].startX = startX;
+    pathfinder->requests[slot].startY = startY;
+    pathfinder->requests[slot].goalX = goalX;
+    pathfinder->requests[slot].goalY = goalY;
+    pathfinder->requests[slot].numTiles = 0;
+
+    return (pathfinder->requests[slot].generation << ISO_PATH_REQUEST_SLOT_BITS) | (slot+1);
+}
+
+//returns the request the handle is for, or NULL if it is not a handle, or the request it was for has been released
+static IsoPathRequest *getRequest(IsoPathfinder *pathfinder,int request) {
+    int slot = (request & ISO_PATH_REQUEST_SLOT_MASK) - 1;
+
+    if (pathfinder == NULL || request <= 0 || slot < 0 || slot >= pathfinder->numRequests
+    || pathfinder->requests[slot].generation != (request >> ISO_PATH_REQUEST_SLOT_BITS)) {
+        return NULL;
+    }
+    return &pathfinder->requests[slot];
+}
+
+//returns the state of the request (IsoPathState). When the path is found, tiles points to the tiles of the path
+//until the request is released
+int isoPathfinderGetPath(IsoPathfinder *pathfinder,int request,SDL_Point **tiles,int *numTiles) {
+    IsoPathRequest *pathRequest = NULL;
+
+    pathRequest = getRequest(pathfinder,request);
+    if (pathRequest == NULL) {
+        return ISO_PATH_STATE_FREE;
+    }
+    if (tiles != NULL) {
+        *tiles = pathRequest->state == ISO_PATH_STATE_FOUND ? pathRequest->tiles : NULL;
+    }
+    if (numTiles != NULL) {
+        *numTiles = pathRequest->state == ISO_PATH_STATE_FOUND ? pathRequest->numTiles : 0;
+    }
+    return pathRequest->state;
+}
+
+//hands the request back, also when it is still pending. The memory of the path is kept for the next request
+void isoPathfinderReleasePath(IsoPathfinder *pathfinder,int request) {
+    IsoPathRequest *pathRequest = getRequest(pathfinder,request);
+
+    if (pathRequest == NULL || pathRequest->state == ISO_PATH_STATE_FREE) {
+        return;
+    }
+    pathRequest->state = ISO_PATH_STATE_FREE;
+    pathRequest->generation = (pathRequest->generation + 1) & ISO_PATH_REQUEST_GENERATION_MASK;
+    pathfinder->freeRequests[pathfinder->numFreeRequests++] = (request & ISO_PATH_REQUEST_SLOT_MASK) - 1;
+}
+
+static int heapPush(IsoPathHeap *heap,Uint64 key,int index) {
+    IsoPathHeapEntry *newEntries = NULL;
+    IsoPathHeapEntry entry = {key,index};
+    int i = 0, parent = 0;
+
+    if (heap->numEntries >= heap->maxEntries) {
+        newEntries = realloc(heap->entries,sizeof(struct IsoPathHeapEntry)*(heap->maxEntries > 0 ? heap->maxEntries*2 : 256));
+        if (newEntries == NULL) {
+            WriteError("Could not allocate memory for the path search!");
+            return 0;
+        }
+        heap->entries = newEntries;
+        heap->maxEntries = heap->maxEntries > 0 ? heap->maxEntries*2 : 256;
+    }
+    i = heap->numEntries++;
+    while (i > 0) {
+        parent = (i-1)/2;
+        if (heap->entries[parent].key <= key) {
+            break;
+        }
+        heap->entries[i] = heap->entries[parent];
+        i = parent;
+    }
+    heap->entries[i] = entry;
+    return 1;
+}
+
+static IsoPathHeapEntry heapPop(IsoPathHeap *heap) {
+    IsoPathHeapEntry top = heap->entries[0];
+    IsoPathHeapEntry last = heap->entries[--heap->numEntries];
+    int i = 0, child = 0;
+
+    while ((child = i*2+1) < heap->numEntries) {
+        if (child+1 < heap->numEntries && heap->entries[child+1].key < heap->entries[child].key) {
+            child++;
+        }
+        if (last.key <= heap->entries[child].key) {
+            break;
+        }
+        heap->entries[i] = heap->entries[child];
+        i = child;
+    }
+    heap->entries[i] = last;
+    return top;
+}
+
+//the cost of the shortest way between two tiles on an open map
+static Uint32 octileDistance(int x0,int y0,int x1,int y1) {
+    int dx = abs(x1-x0), dy = abs(y1-y0);
+
+    return dx > dy ? ISO_PATH_COST_STRAIGHT*dx + (ISO_PATH_COST_DIAGONAL-ISO_PATH_COST_STRAIGHT)*dy
+                   : ISO_PATH_COST_STRAIGHT*dy + (ISO_PATH_COST_DIAGONAL-ISO_PATH_COST_STRAIGHT)*dx;
+}
+
+static int isWalkable(IsoPathfinder *pathfinder,int x,int y) {
+    if (x < 0 || x >= pathfinder->mapWidth || y < 0 || y >= pathfinder->mapHeight) {
+        return 0;
+    }
+    return pathfinder->walkable[y*pathfinder->mapWidth + x];
+}
+
+//copies the walkable tiles of the chunk into the grid of the scratch, with a row of tiles that can not be walked
+//on around it, so the search in the chunk never has to check if a step leaves the chunk
+static void loadChunkGrid(IsoPathfinder *pathfinder,IsoPathScratch *scratch,int chunkIndex) {
+    int x0 = (chunkIndex % pathfinder->numChunksX) << ISO_MAP_CHUNK_SHIFT;
+    int y0 = (chunkIndex / pathfinder->numChunksX) << ISO_MAP_CHUNK_SHIFT;
+    int width = SDL_min(ISO_MAP_CHUNK_SIZE,pathfinder->mapWidth - x0);
+    int height = SDL_min(ISO_MAP_CHUNK_SIZE,pathfinder->mapHeight - y0);
+    int y = 0;
+
+    if (scratch->gridChunk == chunkIndex) {
+        return;
+    }
+    memset(scratch->grid,0,sizeof(scratch->grid));
+    for (y = 0; y < height; ++y) {
+        memcpy(&scratch->grid[(y+1)*ISO_PATH_GRID_SIZE + 1],&pathfinder->walkable[(y0+y)*pathfinder->mapWidth + x0],width);
+    }
+    scratch->gridChunk = chunkIndex;
+}
+
+//returns the index of a tile of the chunk in the grid of the scratch
+static int gridIndex(IsoPathfinder *pathfinder,int chunkIndex,int x,int y) {
+    return (y - ((chunkIndex / pathfinder->numChunksX) << ISO_MAP_CHUNK_SHIFT) + 1)*ISO_PATH_GRID_SIZE
+           + (x - ((chunkIndex % pathfinder->numChunksX) << ISO_MAP_CHUNK_SHIFT) + 1);
+}
+
+//searches a path between two tiles of a chunk, without leaving the chunk. With goalX -1 every tile of the chunk
+//is visited, and the costs of all the tiles from the start are left in the scratch. Returns the cost of the path,
+//or ISO_PATH_COST_INFINITE if the goal can not be reached
+static Uint32 searchChunk(IsoPathfinder *pathfinder,IsoPathScratch *scratch,int chunkIndex,int startX,int startY,int goalX,int goalY) {
+    //the steps to the 8 tiles around a tile in the grid, the straight ones first
+    static const int gridSteps[8] = {-ISO_PATH_GRID_SIZE,1,ISO_PATH_GRID_SIZE,-1,
+                                     1-ISO_PATH_GRID_SIZE,1+ISO_PATH_GRID_SIZE,ISO_PATH_GRID_SIZE-1,-1-ISO_PATH_GRID_SIZE};
+    IsoPathHeapEntry entry;
+    int goalGridX = 0, goalGridY = 0;
+    int tile = 0, nextTile = 0, goalTile = -1, step = 0;
+    Uint32 cost = 0, heuristic = 0;
+
+    loadChunkGrid(pathfinder,scratch,chunkIndex);
+    if (goalX >= 0) {
+        goalTile = gridIndex(pathfinder,chunkIndex,goalX,goalY);
+        goalGridX = goalTile % ISO_PATH_GRID_SIZE;
+        goalGridY = goalTile / ISO_PATH_GRID_SIZE;
+    }
+    scratch->tileStamp++;
+    scratch->tileHeap.numEntries = 0;
+    tile = gridIndex(pathfinder,chunkIndex,startX,startY);
+    scratch->tileCosts[tile] = 0;
+    scratch->tileParents[tile] = -1;
+    scratch->tileStamps[tile] = scratch->tileStamp;
+    heapPush(&scratch->tileHeap,0,tile);
+
+    while (scratch->tileHeap.numEntries > 0) {
+        entry = heapPop(&scratch->tileHeap);
+        tile = entry.index;
+        if (scratch->tileClosedStamps[tile] == scratch->tileStamp) {
+            continue;
+        }
+        scratch->tileClosedStamps[tile] = scratch->tileStamp;
+        if (tile == goalTile) {
+            return scratch->tileCosts[tile];
+        }
+        for (step = 0; step < 8; ++step) {
+            nextTile = tile + gridSteps[step];
+            if (!scratch->grid[nextTile]) {
+                continue;
+            }
+            //a diagonal step may not cut the corner of a tile that can not be walked on
+            if (step >= 4 && (!scratch->grid[tile + gridSteps[step] - stepY[step]*ISO_PATH_GRID_SIZE]
+                              || !scratch->grid[tile + stepY[step]*ISO_PATH_GRID_SIZE])) {
+                continue;
+            }
+            cost = scratch->tileCosts[tile] + (step < 4 ? ISO_PATH_COST_STRAIGHT : ISO_PATH_COST_DIAGONAL);
+            if (scratch->tileStamps[nextTile] == scratch->tileStamp && scratch->tileCosts[nextTile] <= cost) {
+                continue;
+            }
+            scratch->tileStamps[nextTile] = scratch->tileStamp;
+            scratch->tileCosts[nextTile] = cost;
+            scratch->tileParents[nextTile] = tile;
+            heuristic = goalTile >= 0 ? octileDistance(nextTile % ISO_PATH_GRID_SIZE,nextTile / ISO_PATH_GRID_SIZE,goalGridX,goalGridY) : 0;
+            heapPush(&scratch->tileHeap,((Uint64)(cost + heuristic) << 32) | heuristic,nextTile);
+        }
+    }
+    return ISO_PATH_COST_INFINITE;
+}
+
+//returns the cost from the start of the last searchChunk() to a tile of the chunk
+static Uint16 chunkCostTo(IsoPathfinder *pathfinder,IsoPathScratch *scratch,int chunkIndex,int x,int y) {
+    int tile = gridIndex(pathfinder,chunkIndex,x,y);
+
+    if (scratch->tileStamps[tile] != scratch->tileStamp || scratch->tileCosts[tile] >= ISO_PATH_COST_INFINITE) {
+        return ISO_PATH_COST_INFINITE;
+    }
+    return scratch->tileCosts[tile];
+}
+
+//copies the walkable tiles of the chunk from the map (see isoMapTileIsWalkable())
+static void updateWalkable(IsoPathfinder *pathfinder,IsoMap *isoMap,int chunkIndex) {
+    int x0 = (chunkIndex % pathfinder->numChunksX) << ISO_MAP_CHUNK_SHIFT;
+    int y0 = (chunkIndex / pathfinder->numChunksX) << ISO_MAP_CHUNK_SHIFT;
+    int x1 = SDL_min(x0 + ISO_MAP_CHUNK_SIZE,pathfinder->mapWidth);
+    int y1 = SDL_min(y0 + ISO_MAP_CHUNK_SIZE,pathfinder->mapHeight);
+    int x = 0, y = 0;
+
+    for (y = y0; y < y1; ++y) {
+        for (x = x0; x < x1; ++x) {
+            pathfinder->walkable[y*pathfinder->mapWidth + x] = isoMapTileIsWalkable(isoMap,x,y);
+        }
+    }
+}
+
+//adds the tile as an entrance of the chunk on the border, a tile that already is an entrance gets the border added
+static void addEntrance(IsoPathChunk *chunk,int x,int y,Uint8 border) {
+    int i = 0;
+
+    for (i = 0; i < chunk->numNodes; ++i) {
+        if (chunk->nodes[i].x == x && chunk->nodes[i].y == y) {
+            chunk->nodes[i].borders |= border;
+            return;
+        }
+    }
+    if (chunk->numNodes >= ISO_PATH_MAX_CHUNK_NODES) {
+        return;
+    }
+    chunk->nodes[chunk->numNodes].x = x;
+    chunk->nodes[chunk->numNodes].y = y;
+    chunk->nodes[chunk->numNodes].borders = border;
+    chunk->nodes[chunk->numNodes].numLinks = 0;
+    chunk->numNodes++;
+}
+
+//finds the entrances on one border of the chunk. The tiles along the border start at x,y and go dx,dy, and the
+//tiles across the border are acrossX,acrossY away. The chunk on the other side finds the same runs of tiles, so
+//both chunks put their entrances at the same places
+static void addBorderEntrances(IsoPathfinder *pathfinder,IsoPathChunk *chunk,int x,int y,int dx,int dy,int length,int acrossX,int acrossY,Uint8 border) {
+    int i = 0, runStart = -1;
+    int open = 0;
+
+    for (i = 0; i <= length; ++i) {
+        open = i < length && isWalkable(pathfinder,x + i*dx,y + i*dy) && isWalkable(pathfinder,x + i*dx + acrossX,y + i*dy + acrossY);
+        if (open && runStart == -1) {
+            runStart = i;
+        }
+        else if (!open && runStart != -1) {
+            if (i - runStart < ISO_PATH_LONG_ENTRANCE) {
+                addEntrance(chunk,x + (runStart + (i-runStart)/2)*dx,y + (runStart + (i-runStart)/2)*dy,border);
+            } else {
+                addEntrance(chunk,x + runStart*dx,y + runStart*dy,border);
+                addEntrance(chunk,x + (i-1)*dx,y + (i-1)*dy,border);
+            }
+            runStart = -1;
+        }
+    }
+}
+
+//finds the entrances of a chunk and the costs between them. When the tiles of the chunk did not change and the
+//entrances are where they were, the costs are still right
+static void buildChunk(IsoPathfinder *pathfinder,IsoPathScratch *scratch,int chunkIndex) {
+    IsoPathChunk *chunk = &pathfinder->chunks[chunkIndex];
+    IsoPathNode oldNodes[ISO_PATH_MAX_CHUNK_NODES];
+    int numOldNodes = chunk->numNodes;
+    int chunkX = chunkIndex % pathfinder->numChunksX;
+    int chunkY = chunkIndex / pathfinder->numChunksX;
+    int x0 = chunkX << ISO_MAP_CHUNK_SHIFT;
+    int y0 = chunkY << ISO_MAP_CHUNK_SHIFT;
+    int x1 = SDL_min(x0 + ISO_MAP_CHUNK_SIZE,pathfinder->mapWidth);
+    int y1 = SDL_min(y0 + ISO_MAP_CHUNK_SIZE,pathfinder->mapHeight);
+    int i = 0, j = 0;
+
+    memcpy(oldNodes,chunk->nodes,sizeof(struct IsoPathNode)*numOldNodes);
+    chunk->numNodes = 0;
+    addBorderEntrances(pathfinder,chunk,x0,y0,1,0,x1-x0,0,-1,ISO_PATH_BORDER_NORTH);
+    addBorderEntrances(pathfinder,chunk,x1-1,y0,0,1,y1-y0,1,0,ISO_PATH_BORDER_EAST);
+    addBorderEntrances(pathfinder,chunk,x0,y1-1,1,0,x1-x0,0,1,ISO_PATH_BORDER_SOUTH);
+    addBorderEntrances(pathfinder,chunk,x0,y0,0,1,y1-y0,-1,0,ISO_PATH_BORDER_WEST);
+    if ((pathfinder->chunkMarks[chunkIndex] & ISO_PATH_MARK_CHANGED) == 0 && chunk->numNodes == numOldNodes) {
+        for (i = 0; i < numOldNodes; ++i) {
+            if (chunk->nodes[i].x != oldNodes[i].x || chunk->nodes[i].y != oldNodes[i].y || chunk->nodes[i].borders != oldNodes[i].borders) {
+                break;
+            }
+        }
+        if (i == numOldNodes) {
+            return;
+        }
+    }
+
+    for (i = 0; i < chunk->numNodes; ++i) {
+        searchChunk(pathfinder,scratch,chunkIndex,chunk->nodes[i].x,chunk->nodes[i].y,-1,-1);
+        for (j = 0; j < chunk->numNodes; ++j) {
+            chunk->costs[i*ISO_PATH_MAX_CHUNK_NODES + j] = chunkCostTo(pathfinder,scratch,chunkIndex,chunk->nodes[j].x,chunk->nodes[j].y);
+        }
+    }
+}
+
+static void buildChunkTask(int taskIndex,int threadIndex,void *data) {
+    IsoPathfinder *pathfinder = data;
+
+    buildChunk(pathfinder,&pathfinder->scratch[threadIndex],pathfinder->chunkList[taskIndex]);
+}
+
+//links the entrances of the chunk to the entrances on the other side of the borders
+static void linkChunk(IsoPathfinder *pathfinder,int chunkIndex) {
+    static const int borderX[4] = {0,1,0,-1};
+    static const int borderY[4] = {-1,0,1,0};
+    IsoPathChunk *chunk = &pathfinder->chunks[chunkIndex];
+    IsoPathChunk *other = NULL;
+    IsoPathNode *node = NULL;
+    int acrossX = 0, acrossY = 0, otherIndex = 0;
+    int i = 0, border = 0, j = 0;
+
+    for (i = 0; i < chunk->numNodes; ++i) {
+        node = &chunk->nodes[i];
+        node->numLinks = 0;
+        for (border = 0; border < 4; ++border) {
+            if ((node->borders & (1 << border)) == 0) {
+                continue;
+            }
+            acrossX = node->x + borderX[border];
+            acrossY = node->y + borderY[border];
+            otherIndex = (acrossY >> ISO_MAP_CHUNK_SHIFT)*pathfinder->numChunksX + (acrossX >> ISO_MAP_CHUNK_SHIFT);
+            other = &pathfinder->chunks[otherIndex];
+            for (j = 0; j < other->numNodes; ++j) {
+                if (other->nodes[j].x == acrossX && other->nodes[j].y == acrossY) {
+                    if (node->numLinks < ISO_PATH_MAX_NODE_LINKS) {
+                        node->links[node->numLinks++] = otherIndex*ISO_PATH_MAX_CHUNK_NODES + j;
+                    }
+                    break;
+                }
+            }
+        }
+    }
+}
+
+//gives every node the area of the nodes it is connected to, so a search between areas that are not connected
+//fails at once instead of visiting every node it can reach
+static void findAreas(IsoPathfinder *pathfinder) {
+    int numNodes = pathfinder->numChunksX*pathfinder->numChunksY*ISO_PATH_MAX_CHUNK_NODES;
+    IsoPathChunk *chunk = NULL;
+    IsoPathNode *node = NULL;
+    int numStack = 0, numAreas = 0;
+    int n = 0, first = 0, nodeIndex = 0, next = 0, j = 0;
+
+    for (n = 0; n < numNodes; ++n) {
+        pathfinder->nodeAreas[n] = -1;
+    }
+    for (first = 0; first < numNodes; ++first) {
+        if (pathfinder->nodeAreas[first] != -1 || first % ISO_PATH_MAX_CHUNK_NODES >= pathfinder->chunks[first / ISO_PATH_MAX_CHUNK_NODES].numNodes) {
+            continue;
+        }
+        pathfinder->nodeAreas[first] = numAreas;
+        pathfinder->areaStack[numStack++] = first;
+        while (numStack > 0) {
+            n = pathfinder->areaStack[--numStack];
+            chunk = &pathfinder->chunks[n / ISO_PATH_MAX_CHUNK_NODES];
+            nodeIndex = n % ISO_PATH_MAX_CHUNK_NODES;
+            node = &chunk->nodes[nodeIndex];
+            for (j = 0; j < chunk->numNodes + node->numLinks; ++j) {
+                if (j < chunk->numNodes) {
+                    if (chunk->costs[nodeIndex*ISO_PATH_MAX_CHUNK_NODES + j] == ISO_PATH_COST_INFINITE) {
+                        continue;
+                    }
+                    next = n - nodeIndex + j;
+                } else {
+                    next = node->links[j - chunk->numNodes];
+                }
+                if (pathfinder->nodeAreas[next] == -1) {
+                    pathfinder->nodeAreas[next] = numAreas;
+                    pathfinder->areaStack[numStack++] = next;
+                }
+            }
+        }
+        numAreas++;
+    }
+}
+
+//marks the chunk and the chunks next to it in chunkMarks with mark
+static void markChunkAndNeighbours(IsoPathfinder *pathfinder,int chunkIndex,Uint8 mark) {
+    int chunkX = chunkIndex % pathfinder->numChunksX;
+    int chunkY = chunkIndex / pathfinder->numChunksX;
+
+    pathfinder->chunkMarks[chunkIndex] |= mark;
+    if (chunkX > 0) pathfinder->chunkMarks[chunkIndex-1] |= mark;
+    if (chunkX < pathfinder->numChunksX-1) pathfinder->chunkMarks[chunkIndex+1] |= mark;
+    if (chunkY > 0) pathfinder->chunkMarks[chunkIndex-pathfinder->numChunksX] |= mark;
+    if (chunkY < pathfinder->numChunksY-1) pathfinder->chunkMarks[chunkIndex+pathfinder->numChunksX] |= mark;
+}
+
+//copies the walkable tiles of the changed chunks, and builds those chunks and the chunks next to them again, since
+//the entrances on their borders may have moved. The links of the chunks next to the built ones are made again as
+//well, since the nodes they link to may have moved. Returns the number of changed chunks
+static int updateChunks(IsoPathfinder *pathfinder,IsoMap *isoMap,int allChunks) {
+    int numChunks = pathfinder->numChunksX*pathfinder->numChunksY;
+    int numChanged = 0, numBuilt = 0;
+    int i = 0;
+
+    for (i = 0; i < numChunks; ++i) {
+        if (!allChunks && !isoMapChunkIsDirty(isoMap,i,ISO_MAP_CHUNK_DIRTY_NAV)) {
+            continue;
+        }
+        updateWalkable(pathfinder,isoMap,i);
+        isoMapClearChunkDirty(isoMap,i,ISO_MAP_CHUNK_DIRTY_NAV);
+        pathfinder->chunkMarks[i] |= ISO_PATH_MARK_CHANGED;
+        markChunkAndNeighbours(pathfinder,i,ISO_PATH_MARK_BUILD);
+        numChanged++;
+    }
+    if (numChanged == 0) {
+        return 0;
+    }
+    pathfinder->version++;
+    //the grids the threads have loaded may be old now
+    for (i = 0; i < pathfinder->numScratch; ++i) {
+        pathfinder->scratch[i].gridChunk = -1;
+    }
+
+    //the chunks are built on the thread pool, every chunk only writes its own graph
+    for (i = 0; i < numChunks; ++i) {
+        if (pathfinder->chunkMarks[i] & ISO_PATH_MARK_BUILD) {
+            pathfinder->chunkList[numBuilt++] = i;
+            markChunkAndNeighbours(pathfinder,i,ISO_PATH_MARK_LINK);
+        }
+    }
+    ThreadPool_ParallelFor(numBuilt,buildChunkTask,pathfinder);
+    for (i = 0; i < numChunks; ++i) {
+        if (pathfinder->chunkMarks[i] & ISO_PATH_MARK_LINK) {
+            linkChunk(pathfinder,i);
+        }
+        pathfinder->chunkMarks[i] = 0;
+    }
+    findAreas(pathfinder);
+    return numChanged;
+}
+
+//makes sure there is search memory for every thread of the pool. Returns 0 if memory allocation failed
+static int prepareScratch(IsoPathfinder *pathfinder) {
+    IsoPathScratch *newScratch = NULL;
+    int numThreads = ThreadPool_GetNumThreads();
+    int numNodes = pathfinder->numChunksX*pathfinder->numChunksY*ISO_PATH_MAX_CHUNK_NODES + 1;
+    IsoPathScratch *scratch = NULL;
+
+    if (pathfinder->numScratch >= numThreads) {
+        return 1;
+    }
+    newScratch = realloc(pathfinder->scratch,sizeof(struct IsoPathScratch)*numThreads);
+    if (newScratch == NULL) {
+        WriteError("Could not allocate memory for the path search of %d threads!",numThreads);
+        return 0;
+    }
+    pathfinder->scratch = newScratch;
+    while (pathfinder->numScratch < numThreads) {
+        scratch = &pathfinder->scratch[pathfinder->numScratch];
+        memset(scratch,0,sizeof(struct IsoPathScratch));
+        scratch->gridChunk = -1;
+        scratch->nodes = calloc(numNodes,sizeof(struct IsoPathNodeState));
+        //counted as in use before the check, so the memory is freed with the pathfinder
+        pathfinder->numScratch++;
+        if (scratch->nodes == NULL) {
+            WriteError("Could not allocate memory for the path search of %d threads!",numThreads);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void solveRequestsTask(int taskIndex,int threadIndex,void *data) {
+    IsoPathfinder *pathfinder = data;
+    IsoPathRequest *request = NULL;
+    int first = taskIndex*ISO_PATH_REQUESTS_PER_TASK;
+    int last = SDL_min(first + ISO_PATH_REQUESTS_PER_TASK,pathfinder->numPendingRequests);
+    int i = 0;
+
+    for (i = first; i < last; ++i) {
+        request = &pathfinder->requests[pathfinder->pendingRequests[i]];
+        request->numTiles = 0;
+        request->state = solveRequest(pathfinder,&pathfinder->scratch[threadIndex],request) ? ISO_PATH_STATE_FOUND : ISO_PATH_STATE_NOT_FOUND;
+    }
+}
+
+//makes room for numTiles more tiles in the path. Returns 0 if memory allocation failed
+static int growPath(IsoPathRequest *request,int numTiles) {
+    SDL_Point *newTiles = NULL;
+    int newMax = request->maxTiles > 0 ? request->maxTiles : 64;
+
+    if (request->numTiles + numTiles <= request->maxTiles) {
+        return 1;
+    }
+    while (newMax < request->numTiles + numTiles) {
+        newMax *= 2;
+    }
+    newTiles = realloc(request->tiles,sizeof(SDL_Point)*newMax);
+    if (newTiles == NULL) {
+        WriteError("Could not allocate memory for a path of %d tiles!",newMax);
+        return 0;
+    }
+    request->tiles = newTiles;
+    request->maxTiles = newMax;
+    return 1;
+}
+
+static int appendTile(IsoPathRequest *request,int x,int y) {
+    if (growPath(request,1) == 0) {
+        return 0;
+    }
+    request->tiles[request->numTiles].x = x;
+    request->tiles[request->numTiles].y = y;
+    request->numTiles++;
+    return 1;
+}
+
+//adds the tiles of the path from the last searchChunk() to the goal, the start of the search is left out,
+//since it is the last tile of the path already
+static int appendChunkPath(IsoPathfinder *pathfinder,IsoPathScratch *scratch,IsoPathRequest *request,int chunkIndex,int goalX,int goalY) {
+    int x0 = ((chunkIndex % pathfinder->numChunksX) << ISO_MAP_CHUNK_SHIFT) - 1;
+    int y0 = ((chunkIndex / pathfinder->numChunksX) << ISO_MAP_CHUNK_SHIFT) - 1;
+    int goalTile = gridIndex(pathfinder,chunkIndex,goalX,goalY);
+    int tile = goalTile;
+    int length = 0, i = 0;
+
+    while (scratch->tileParents[tile] != -1) {
+        length++;
+        tile = scratch->tileParents[tile];
+    }
+    if (growPath(request,length) == 0) {
+        return 0;
+    }
+    tile = goalTile;
+    for (i = request->numTiles + length - 1; i >= request->numTiles; --i) {
+        request->tiles[i].x = x0 + tile % ISO_PATH_GRID_SIZE;
+        request->tiles[i].y = y0 + tile / ISO_PATH_GRID_SIZE;
+        tile = scratch->tileParents[tile];
+    }
+    request->numTiles += length;
+    return 1;
+}
+
+//searches the path between two tiles of the same chunk and adds it to the path. Returns 0 if there is none
+static int refineInChunk(IsoPathfinder *pathfinder,IsoPathScratch *scratch,IsoPathRequest *request,int chunkIndex,int startX,int startY,int goalX,int goalY) {
+    if (startX == goalX && startY == goalY) {
+        return 1;
+    }
+    if (searchChunk(pathfinder,scratch,chunkIndex,startX,startY,goalX,goalY) == ISO_PATH_COST_INFINITE) {
+        return 0;
+    }
+    return appendChunkPath(pathfinder,scratch,request,chunkIndex,goalX,goalY);
+}
+
+static void relaxNode(IsoPathScratch *scratch,int node,Uint32 cost,int parent,Uint32 heuristic) {
+    IsoPathNodeState *state = &scratch->nodes[node];
+
+    if (state->closedStamp == scratch->nodeStamp) {
+        return;
+    }
+    if (state->stamp == scratch->nodeStamp && state->cost <= cost) {
+        return;
+    }
+    state->stamp = scratch->nodeStamp;
+    state->cost = cost;
+    state->parent = parent;
+    //of the nodes that look as good, the one closest to the goal is taken first
+    heapPush(&scratch->nodeHeap,((Uint64)(cost + heuristic) << 32) | heuristic,node);
+}
+
+//searches the abstract graph from the entrances of the start chunk to the goal, and then walks the path one chunk
+//at a time. Returns 1 if the path was found
+static int solveRequest(IsoPathfinder *pathfinder,IsoPathScratch *scratch,IsoPathRequest *request) {
+    IsoPathHeapEntry entry;
+    IsoPathChunk *chunk = NULL;
+    IsoPathNode *node = NULL;
+    int numChunks = pathfinder->numChunksX*pathfinder->numChunksY;
+    int goalNode = numChunks*ISO_PATH_MAX_CHUNK_NODES;
+    int startChunk = 0, goalChunk = 0, chunkIndex = 0, nodeIndex = 0;
+    int currentX = 0, currentY = 0, currentChunk = 0;
+    int *newAbstractPath = NULL;
+    int numAbstract = 0;
+    int n = 0, i = 0, j = 0, found = 0;
+    Uint32 cost = 0;
+
+    if (!isWalkable(pathfinder,request->startX,request->startY) || !isWalkable(pathfinder,request->goalX,request->goalY)) {
+        return 0;
+    }
+    if (appendTile(request,request->startX,request->startY) == 0) {
+        return 0;
+    }
+    startChunk = (request->startY >> ISO_MAP_CHUNK_SHIFT)*pathfinder->numChunksX + (request->startX >> ISO_MAP_CHUNK_SHIFT);
+    goalChunk = (request->goalY >> ISO_MAP_CHUNK_SHIFT)*pathfinder->numChunksX + (request->goalX >> ISO_MAP_CHUNK_SHIFT);
+    //a path inside one chunk does not need the abstract graph
+    if (startChunk == goalChunk && refineInChunk(pathfinder,scratch,request,startChunk,request->startX,request->startY,request->goalX,request->goalY)) {
+        return 1;
+    }
+
+    //the costs from the start to the entrances of its chunk, and from the entrances of the goal chunk to the goal
+    chunk = &pathfinder->chunks[goalChunk];
+    searchChunk(pathfinder,scratch,goalChunk,request->goalX,request->goalY,-1,-1);
+    for (i = 0; i < chunk->numNodes; ++i) {
+        scratch->goalCosts[i] = chunkCostTo(pathfinder,scratch,goalChunk,chunk->nodes[i].x,chunk->nodes[i].y);
+    }
+    chunk = &pathfinder->chunks[startChunk];
+    searchChunk(pathfinder,scratch,startChunk,request->startX,request->startY,-1,-1);
+    for (i = 0; i < chunk->numNodes; ++i) {
+        scratch->startCosts[i] = chunkCostTo(pathfinder,scratch,startChunk,chunk->nodes[i].x,chunk->nodes[i].y);
+    }
+
+    //there is no path if none of the entrances the start reaches is connected to one that reaches the goal
+    found = 0;
+    for (i = 0; i < chunk->numNodes && !found; ++i) {
+        for (j = 0; j < pathfinder->chunks[goalChunk].numNodes && scratch->startCosts[i] != ISO_PATH_COST_INFINITE; ++j) {
+            if (scratch->goalCosts[j] != ISO_PATH_COST_INFINITE
+            && pathfinder->nodeAreas[startChunk*ISO_PATH_MAX_CHUNK_NODES + i] == pathfinder->nodeAreas[goalChunk*ISO_PATH_MAX_CHUNK_NODES + j]) {
+                found = 1;
+                break;
+            }
+        }
+    }
+    if (!found) {
+        return 0;
+    }
+    found = 0;
+
+    //A* in the abstract graph, the goal is a node of its own that the entrances of the goal chunk lead to
+    scratch->nodeStamp++;
+    scratch->nodeHeap.numEntries = 0;
+    for (i = 0; i < chunk->numNodes; ++i) {
+        if (scratch->startCosts[i] != ISO_PATH_COST_INFINITE) {
+            relaxNode(scratch,startChunk*ISO_PATH_MAX_CHUNK_NODES + i,scratch->startCosts[i],-1,
+                      octileDistance(chunk->nodes[i].x,chunk->nodes[i].y,request->goalX,request->goalY));
+        }
+    }
+    while (scratch->nodeHeap.numEntries > 0) {
+        entry = heapPop(&scratch->nodeHeap);
+        n = entry.index;
+        if (scratch->nodes[n].closedStamp == scratch->nodeStamp) {
+            continue;
+        }
+        scratch->nodes[n].closedStamp = scratch->nodeStamp;
+        if (n == goalNode) {
+            found = 1;
+            break;
+        }
+        chunkIndex = n / ISO_PATH_MAX_CHUNK_NODES;
+        nodeIndex = n % ISO_PATH_MAX_CHUNK_NODES;
+        chunk = &pathfinder->chunks[chunkIndex];
+        node = &chunk->nodes[nodeIndex];
+        cost = scratch->nodes[n].cost;
+        if (chunkIndex == goalChunk && scratch->goalCosts[nodeIndex] != ISO_PATH_COST_INFINITE) {
+            relaxNode(scratch,goalNode,cost + scratch->goalCosts[nodeIndex],n,0);
+        }
+        for (j = 0; j < chunk->numNodes; ++j) {
+            if (j != nodeIndex && chunk->costs[nodeIndex*ISO_PATH_MAX_CHUNK_NODES + j] != ISO_PATH_COST_INFINITE) {
+                relaxNode(scratch,chunkIndex*ISO_PATH_MAX_CHUNK_NODES + j,cost + chunk->costs[nodeIndex*ISO_PATH_MAX_CHUNK_NODES + j],n,
+                          octileDistance(chunk->nodes[j].x,chunk->nodes[j].y,request->goalX,request->goalY));
+            }
+        }
+        for (j = 0; j < node->numLinks; ++j) {
+            relaxNode(scratch,node->links[j],cost + ISO_PATH_COST_STRAIGHT,n,
+                      octileDistance(pathfinder->chunks[node->links[j] / ISO_PATH_MAX_CHUNK_NODES].nodes[node->links[j] % ISO_PATH_MAX_CHUNK_NODES].x,
+                                     pathfinder->chunks[node->links[j] / ISO_PATH_MAX_CHUNK_NODES].nodes[node->links[j] % ISO_PATH_MAX_CHUNK_NODES].y,
+                                     request->goalX,request->goalY));
+        }
+    }
+    if (!found) {
+        return 0;
+    }
+
+    //the entrances along the path, from the start to the goal
+    for (n = scratch->nodes[goalNode].parent; n != -1; n = scratch->nodes[n].parent) {
+        numAbstract++;
+    }
+    if (numAbstract > scratch->maxAbstractPath) {
+        newAbstractPath = realloc(scratch->abstractPath,sizeof(int)*numAbstract*2);
+        if (newAbstractPath == NULL) {
+            WriteError("Could not allocate memory for the path search!");
+            return 0;
+        }
+        scratch->abstractPath = newAbstractPath;
+        scratch->maxAbstractPath = numAbstract*2;
+    }
+    i = numAbstract;
+    for (n = scratch->nodes[goalNode].parent; n != -1; n = scratch->nodes[n].parent) {
+        scratch->abstractPath[--i] = n;
+    }
+
+    //walk from entrance to entrance. Entrances in the same chunk are joined by a search in the chunk, and
+    //linked entrances are next to each other
+    currentX = request->startX;
+    currentY = request->startY;
+    currentChunk = startChunk;
+    for (i = 0; i < numAbstract; ++i) {
+        chunkIndex = scratch->abstractPath[i] / ISO_PATH_MAX_CHUNK_NODES;
+        node = &pathfinder->chunks[chunkIndex].nodes[scratch->abstractPath[i] % ISO_PATH_MAX_CHUNK_NODES];
+        if (chunkIndex == currentChunk) {
+            if (refineInChunk(pathfinder,scratch,request,chunkIndex,currentX,currentY,node->x,node->y) == 0) {
+                return 0;
+            }
+        }
+        else if (appendTile(request,node->x,node->y) == 0) {
+            return 0;
+        }
+        currentX = node->x;
+        currentY = node->y;
+        currentChunk = chunkIndex;
+    }
+    return refineInChunk(pathfinder,scratch,request,goalChunk,currentX,currentY,request->goalX,request->goalY);
+}
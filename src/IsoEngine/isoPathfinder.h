@@ -0,0 +1,107 @@
+#ifndef __ISO_PATHFINDER_H
+#define __ISO_PATHFINDER_H
+
+#include <SDL2/SDL.h>
+#include "isoMap.h"
+
+//most entrance nodes in one chunk. A border of 16 tiles has at most 8 entrances, so 4 borders fit
+#define ISO_PATH_MAX_CHUNK_NODES        32
+//most tiles across a border a node leads to, a tile in the corner of a chunk is on two borders
+#define ISO_PATH_MAX_NODE_LINKS         2
+//most path requests solved in one update, the rest wait for the next frame
+#define ISO_PATH_MAX_REQUESTS_PER_UPDATE 4096
+//a request handle is the slot of the request plus one in the low bits, and the generation of the slot above them.
+//The generation goes up when the request is released, so a handle that is kept after that does not find the request
+//that reuses the slot
+#define ISO_PATH_REQUEST_SLOT_BITS      18
+#define ISO_PATH_REQUEST_SLOT_MASK      ((1 << ISO_PATH_REQUEST_SLOT_BITS)-1)
+#define ISO_PATH_REQUEST_GENERATION_MASK ((1 << (31-ISO_PATH_REQUEST_SLOT_BITS))-1)
+//cost of a straight and a diagonal step between tiles
+#define ISO_PATH_COST_STRAIGHT          10
+#define ISO_PATH_COST_DIAGONAL          14
+#define ISO_PATH_COST_INFINITE          0xffff
+
+//sides of a chunk
+#define ISO_PATH_BORDER_NORTH           0x01
+#define ISO_PATH_BORDER_EAST            0x02
+#define ISO_PATH_BORDER_SOUTH           0x04
+#define ISO_PATH_BORDER_WEST            0x08
+
+//states of a path request
+typedef enum IsoPathState {
+    ISO_PATH_STATE_FREE = 0,
+    ISO_PATH_STATE_PENDING,
+    ISO_PATH_STATE_FOUND,
+    ISO_PATH_STATE_NOT_FOUND,
+} IsoPathState;
+
+//an entrance tile on the border of a chunk, and the entrance tiles in the chunks next to it
+typedef struct IsoPathNode {
+    Uint16 x;
+    Uint16 y;
+    Uint8 borders;      //ISO_PATH_BORDER_* sides of the chunk the tile is an entrance on
+    Uint8 numLinks;
+    int links[ISO_PATH_MAX_NODE_LINKS];     //node ids (chunk*ISO_PATH_MAX_CHUNK_NODES+node) of the tiles across the border
+} IsoPathNode;
+
+//the abstract graph of one chunk: its entrances and the cost of walking between them inside the chunk
+typedef struct IsoPathChunk {
+    int numNodes;
+    IsoPathNode nodes[ISO_PATH_MAX_CHUNK_NODES];
+    Uint16 costs[ISO_PATH_MAX_CHUNK_NODES*ISO_PATH_MAX_CHUNK_NODES];    //ISO_PATH_COST_INFINITE if there is no way
+} IsoPathChunk;
+
+typedef struct IsoPathRequest {
+    Uint8 state;            //IsoPathState
+    Uint16 generation;      //times the slot has been released, see ISO_PATH_REQUEST_SLOT_BITS
+    int startX;
+    int startY;
+    int goalX;
+    int goalY;
+    SDL_Point *tiles;       //the tiles of the path from the start to the goal, both included
+    int numTiles;
+    int maxTiles;
+} IsoPathRequest;
+
+struct IsoPathScratch;
+
+//Hierarchical A* over the map. Every chunk is a cluster, and its entrances to the chunks next to it are the nodes
+//of an abstract graph, with the costs between the entrances of a chunk computed ahead. A path is first searched in
+//the abstract graph and then refined one chunk at a time, so a search only visits the tiles along the path.
+//The walkable tiles are copied from the map, and the chunks that are marked with ISO_MAP_CHUNK_DIRTY_NAV are built
+//again in isoPathfinderUpdate(). Paths are requested with isoPathfinderRequestPath(), and are solved on the thread
+//pool at the next update
+typedef struct IsoPathfinder {
+    int mapWidth;
+    int mapHeight;
+    int numChunksX;
+    int numChunksY;
+    Uint8 *walkable;                //1 for every tile that can be walked on, mapWidth*mapHeight
+    Uint32 version;                 //counts the updates that changed the walkable tiles
+    IsoPathChunk *chunks;
+    int *nodeAreas;                 //the connected area of every node, there is only a path between nodes of the same area
+    int *areaStack;
+    Uint8 *chunkMarks;              //chunks that are built again or linked again in the current update
+    int *chunkList;
+    IsoPathRequest *requests;
+    int numRequests;                //number of request slots that have been used
+    int maxRequests;
+    int *freeRequests;              //slots below numRequests that have been released
+    int numFreeRequests;
+    int *pendingRequests;           //requests that are solved in the current update
+    int numPendingRequests;
+    int nextPendingScan;            //slot the search for pending requests starts at, so no request waits forever
+    struct IsoPathScratch *scratch; //search memory of every thread
+    int numScratch;
+    int numPathsSolvedLastUpdate;
+    double solveTimeLastUpdate;     //ms
+} IsoPathfinder;
+
+[[nodiscard]] IsoPathfinder *isoPathfinderNew(IsoMap *isoMap);
+void isoPathfinderFree(IsoPathfinder *pathfinder);
+int isoPathfinderUpdate(IsoPathfinder *pathfinder,IsoMap *isoMap);
+[[nodiscard]] int isoPathfinderRequestPath(IsoPathfinder *pathfinder,int startX,int startY,int goalX,int goalY);
+[[nodiscard]] int isoPathfinderGetPath(IsoPathfinder *pathfinder,int request,SDL_Point **tiles,int *numTiles);
+void isoPathfinderReleasePath(IsoPathfinder *pathfinder,int request);
+
+#endif // __ISO_PATHFINDER_H
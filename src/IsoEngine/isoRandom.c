@@ -0,0 +1,53 @@
+#include "isoRandom.h"
+
+//All arithmetic is done on unsigned integers, where overflow wraps around
+//the same way on every compiler
+
+void isoRandomSeed(IsoRandom *random,Uint64 seed,Uint64 stream) {
+    //the increment has to be odd
+    random->state = 0;
+    random->increment = (stream << 1) | 1;
+    (void)isoRandomNext(random);
+    random->state += seed;
+    (void)isoRandomNext(random);
+}
+
+void isoRandomSeedChunk(IsoRandom *random,Uint32 worldSeed,int chunkX,int chunkY) {
+    //every chunk gets its own stream, so a chunk generates the same way
+    //no matter which chunks were generated before it
+    isoRandomSeed(random,worldSeed,isoRandomHash3((Uint32)chunkX,(Uint32)chunkY,worldSeed));
+}
+
+Uint32 isoRandomNext(IsoRandom *random) {
+    Uint64 oldState = random->state;
+    Uint32 xorShifted = 0;
+    Uint32 rotation = 0;
+
+    random->state = oldState * 6364136223846793005ULL + random->increment;
+    xorShifted = (Uint32)(((oldState >> 18) ^ oldState) >> 27);
+    rotation = (Uint32)(oldState >> 59);
+    return (xorShifted >> rotation) | (xorShifted << ((32 - rotation) & 31));
+}
+
+//returns a number from min up to and including max
+int isoRandomRange(IsoRandom *random,int min,int max) {
+    Uint32 range = 0;
+    if (max <= min) {
+        return min;
+    }
+    range = (Uint32)(max - min) + 1;
+    return min + (int)(((Uint64)isoRandomNext(random) * range) >> 32);
+}
+
+Uint32 isoRandomHash(Uint32 value) {
+    value ^= value >> 16;
+    value *= 0x7feb352dU;
+    value ^= value >> 15;
+    value *= 0x846ca68bU;
+    value ^= value >> 16;
+    return value;
+}
+
+Uint32 isoRandomHash3(Uint32 x,Uint32 y,Uint32 z) {
+    return isoRandomHash(x ^ isoRandomHash(y ^ isoRandomHash(z)));
+}
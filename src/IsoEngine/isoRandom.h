@@ -0,0 +1,20 @@
+#ifndef __ISO_RANDOM_H
+#define __ISO_RANDOM_H
+
+#include <SDL2/SDL.h>
+
+//A small PCG32 random number generator. Unlike rand(), the sequence for a seed is
+//the same on every platform and build, so generated worlds can be reproduced
+typedef struct IsoRandom {
+    Uint64 state;
+    Uint64 increment;
+} IsoRandom;
+
+void isoRandomSeed(IsoRandom *random,Uint64 seed,Uint64 stream);
+void isoRandomSeedChunk(IsoRandom *random,Uint32 worldSeed,int chunkX,int chunkY);
+[[nodiscard]] Uint32 isoRandomNext(IsoRandom *random);
+[[nodiscard]] int isoRandomRange(IsoRandom *random,int min,int max);
+[[nodiscard]] Uint32 isoRandomHash(Uint32 value);
+[[nodiscard]] Uint32 isoRandomHash3(Uint32 x,Uint32 y,Uint32 z);
+
+#endif // __ISO_RANDOM_H
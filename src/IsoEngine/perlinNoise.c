@@ -1,9 +1,13 @@
 #include <stdio.h>
 #include <SDL2/SDL.h>
+#include "perlinNoise.h"
+#include "isoRandom.h"
 
 double rawnoise(int n) {
-    n = (n << 13) ^ n;
-    return (1.0 - ((n * (n * n * 15731 + 789221) + 1376312589) & 0x7fffffff) / 1073741824.0);
+    //calculate with unsigned integers, signed integer overflow is undefined
+    Uint32 value = (Uint32)n;
+    value = (value << 13) ^ value;
+    return (1.0 - ((value * (value * value * 15731U + 789221U) + 1376312589U) & 0x7fffffff) / 1073741824.0);
 }
 
 double noise1d(int x, int octave, int seed) {
@@ -124,3 +128,54 @@ double pnoise3d(double x, double y, double z, double persistence, int octaves, i
 
    return total;
 }
+
+//Fixed point value noise. It only uses integer arithmetic, so a seed gives the same
+//noise on every platform, compiler and optimization level
+
+//returns the noise value at a lattice point, from -NOISE_FIXED_ONE to NOISE_FIXED_ONE
+static Sint32 latticeNoiseFixed(Sint32 x,Sint32 y,int octave,Uint32 seed) {
+    Uint32 hash = isoRandomHash3((Uint32)x,(Uint32)y,seed + (Uint32)octave * 0x9e3779b9U);
+    return NOISE_FIXED_ONE - (Sint32)((hash & 0x7fffffff) >> (31 - NOISE_FIXED_SHIFT - 1));
+}
+
+//interpolates between a and b with a smoothstep curve. t goes from 0 to NOISE_FIXED_ONE
+static Sint32 interpolateFixed(Sint32 a,Sint32 b,Sint32 t) {
+    //3t^2 - 2t^3
+    Sint64 t2 = ((Sint64)t * t) >> NOISE_FIXED_SHIFT;
+    Sint64 curve = (t2 * (3 * (Sint64)NOISE_FIXED_ONE - 2 * (Sint64)t)) >> NOISE_FIXED_SHIFT;
+    return (Sint32)(a + ((((Sint64)b - a) * curve) >> NOISE_FIXED_SHIFT));
+}
+
+Sint32 smooth2dFixed(Sint32 x,Sint32 y,int octave,Uint32 seed) {
+    //split the position into the lattice point and the fraction
+    Sint32 intx = x >> NOISE_FIXED_SHIFT;
+    Sint32 fracx = x & (NOISE_FIXED_ONE - 1);
+    Sint32 inty = y >> NOISE_FIXED_SHIFT;
+    Sint32 fracy = y & (NOISE_FIXED_ONE - 1);
+
+    Sint32 v1 = latticeNoiseFixed(intx, inty, octave, seed);
+    Sint32 v2 = latticeNoiseFixed(intx + 1, inty, octave, seed);
+    Sint32 v3 = latticeNoiseFixed(intx, inty + 1, octave, seed);
+    Sint32 v4 = latticeNoiseFixed(intx + 1, inty + 1, octave, seed);
+
+    Sint32 i1 = interpolateFixed(v1, v2, fracx);
+    Sint32 i2 = interpolateFixed(v3, v4, fracx);
+
+    return interpolateFixed(i1, i2, fracy);
+}
+
+Sint32 pnoise2dFixed(Sint32 x,Sint32 y,Sint32 persistence,int octaves,Uint32 seed) {
+    Sint64 total = 0;
+    Sint32 amplitude = NOISE_FIXED_ONE;
+    int i = 0;
+
+    for (i = 0; i < octaves; i++) {
+        total += ((Sint64)smooth2dFixed(x, y, i, seed) * amplitude) >> NOISE_FIXED_SHIFT;
+        //halve the frequency for the next octave
+        x /= 2;
+        y /= 2;
+        amplitude = (Sint32)(((Sint64)amplitude * persistence) >> NOISE_FIXED_SHIFT);
+    }
+
+    return (Sint32)total;
+}
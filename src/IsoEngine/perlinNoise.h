@@ -1,6 +1,12 @@
 #ifndef PERLIN_HEADER
 #define PERLIN_HEADER
 
+#include <SDL2/SDL.h>
+
+//fixed point numbers used by the fixed point noise functions
+#define NOISE_FIXED_SHIFT   16
+#define NOISE_FIXED_ONE     (1 << NOISE_FIXED_SHIFT)
+
 [[nodiscard]] double rawnoise(int n);
 
 [[nodiscard]] double noise1d(int x, int octave, int seed);
@@ -23,4 +29,8 @@
 
 [[nodiscard]] double pnoise3d(double x, double y, double z, double persistence, int octaves, int seed);
 
+[[nodiscard]] Sint32 smooth2dFixed(Sint32 x, Sint32 y, int octave, Uint32 seed);
+
+[[nodiscard]] Sint32 pnoise2dFixed(Sint32 x, Sint32 y, Sint32 persistence, int octaves, Uint32 seed);
+
 #endif
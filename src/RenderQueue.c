@@ -0,0 +1,490 @@
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "RenderQueue.h"
+#include "SpriteBatch.h"
+#include "Texture.h"
+#include "logger.h"
+
+typedef struct RenderCommandList {
+    RenderCommand *commands;
+    int numCommands;
+    int maxCommands;
+    Uint8 *payload;
+    Uint32 payloadSize;
+    Uint32 maxPayloadSize;
+    SpriteBatchList spriteBatches;  //the sprite commands of the list, batched when the list is drawn
+} RenderCommandList;
+
+//the commands of the frame that is recorded, they are drawn and the list is emptied when the frame is presented
+static RenderCommandList recordList;
+
+//the renderer is created and used only on the thread that starts the render queue. Some platforms
+//(macOS, and Direct3D on Windows) do not support a renderer on any other thread
+static SDL_Renderer *renderer = NULL;
+//the target and the clip rectangle set by the last commands that were added, like SDL a new target turns the clipping off
+static SDL_Texture *recordTarget = NULL;
+static SDL_Rect recordClipRect = {0,0,0,0};
+
+//stats of the last frame that was drawn
+static int numCommandsLastFrame = 0;
+static int numBatchesLastFrame = 0;
+static int numQuadsLastFrame = 0;
+
+static int start();
+static void buildBatches(RenderCommandList *list);
+static void drawList(RenderCommandList *list);
+static void resetList(RenderCommandList *list);
+static RenderCommand *newCommand(RenderCommandType type);
+static Uint8 *allocPayload(Uint32 size,Uint32 *offset);
+
+int RenderQueue_Start(SDL_Window *window) {
+    if (window == NULL) {
+        WriteError("Parameter: 'SDL_Window *window' is NULL!");
+        return 0;
+    }
+    renderer = SDL_CreateRenderer(window,-1,SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE | SDL_RENDERER_PRESENTVSYNC);
+    if (renderer == NULL) {
+        WriteError("SDL_CreateRenderer failed:%s",SDL_GetError());
+        return 0;
+    }
+    return start();
+}
+
+//starts the render queue with a software renderer that draws into the surface instead of a window, without vsync.
+//The surface holds the last frame after RenderQueue_Present()
+int RenderQueue_StartHeadless(SDL_Surface *surface) {
+    if (surface == NULL) {
+        WriteError("Parameter: 'SDL_Surface *surface' is NULL!");
+        return 0;
+    }
+    renderer = SDL_CreateSoftwareRenderer(surface);
+    if (renderer == NULL) {
+        WriteError("SDL_CreateSoftwareRenderer failed:%s",SDL_GetError());
+        return 0;
+    }
+    return start();
+}
+
+static int start() {
+    recordList.commands = malloc(sizeof(struct RenderCommand)*RENDER_QUEUE_INITIAL_COMMANDS);
+    recordList.payload = malloc(RENDER_QUEUE_INITIAL_PAYLOAD);
+    if (recordList.commands == NULL || recordList.payload == NULL) {
+        WriteError("Could not allocate memory for the render command list!");
+        return 0;
+    }
+    recordList.maxCommands = RENDER_QUEUE_INITIAL_COMMANDS;
+    recordList.maxPayloadSize = RENDER_QUEUE_INITIAL_PAYLOAD;
+    resetList(&recordList);
+    if (SpriteBatch_InitList(&recordList.spriteBatches) == -1) {
+        return 0;
+    }
+    return 1;
+}
+
+//draws what is left in the queue, such as textures to destroy, and destroys the renderer
+void RenderQueue_Stop() {
+    if (renderer != NULL && recordList.commands != NULL) {
+        buildBatches(&recordList);
+        drawList(&recordList);
+    }
+    free(recordList.commands);
+    free(recordList.payload);
+    SpriteBatch_FreeList(&recordList.spriteBatches);
+    recordList.commands = NULL;
+    recordList.payload = NULL;
+    resetList(&recordList);
+    if (renderer != NULL) {
+        SDL_DestroyRenderer(renderer);
+        renderer = NULL;
+    }
+}
+
+SDL_Renderer *RenderQueue_GetRenderer() {
+    return renderer;
+}
+
+SDL_Texture *RenderQueue_CreateTexture(Uint32 format,int access,int width,int height,SDL_BlendMode blendMode) {
+    SDL_Texture *texture = NULL;
+
+    if (renderer == NULL) {
+        WriteError("The render queue has not been started!");
+        return NULL;
+    }
+    texture = SDL_CreateTexture(renderer,format,access,width,height);
+    if (texture == NULL) {
+        WriteError("Could not create texture! SDL Error:%s",SDL_GetError());
+        return NULL;
+    }
+    SDL_SetTextureBlendMode(texture,blendMode);
+    return texture;
+}
+
+SDL_Texture *RenderQueue_CreateTextureFromSurface(SDL_Surface *surface) {
+    SDL_Texture *texture = NULL;
+
+    if (surface == NULL) {
+        WriteError("Parameter: 'SDL_Surface *surface' is NULL!");
+        return NULL;
+    }
+    if (renderer == NULL) {
+        WriteError("The render queue has not been started!");
+        return NULL;
+    }
+    texture = SDL_CreateTextureFromSurface(renderer,surface);
+    if (texture == NULL) {
+        WriteError("Could not create texture! SDL Error:%s",SDL_GetError());
+    }
+    return texture;
+}
+
+//the texture is destroyed after the commands that were added before it have been drawn
+void RenderQueue_DestroyTexture(SDL_Texture *texture) {
+    RenderCommand *command = NULL;
+
+    if (texture == NULL) {
+        return;
+    }
+    command = newCommand(RENDER_COMMAND_DESTROY_TEXTURE);
+    if (command != NULL) {
+        command->texture = texture;
+    }
+}
+
+//uploads 32-bit pixels to the rectangle of the texture. The pixels are copied, so they can be changed right away
+void RenderQueue_UpdateTexture(SDL_Texture *texture,SDL_Rect *rect,const Uint32 *pixels,int pitch) {
+    RenderCommand *command = NULL;
+    Uint8 *payload = NULL;
+    Uint32 offset = 0;
+    int row = 0;
+
+    if (texture == NULL || rect == NULL || pixels == NULL || rect->w <= 0 || rect->h <= 0) {
+        return;
+    }
+    payload = allocPayload(sizeof(Uint32)*rect->w*rect->h,&offset);
+    if (payload == NULL) {
+        return;
+    }
+    for (row = 0; row < rect->h; ++row) {
+        memcpy(payload + sizeof(Uint32)*rect->w*row,(const Uint8*)pixels + pitch*row,sizeof(Uint32)*rect->w);
+    }
+    command = newCommand(RENDER_COMMAND_UPDATE_TEXTURE);
+    if (command != NULL) {
+        command->texture = texture;
+        command->data.update.rect = *rect;
+        command->data.update.payloadOffset = offset;
+    }
+}
+
+void RenderQueue_Clear(Uint8 r,Uint8 g,Uint8 b,Uint8 a) {
+    RenderCommand *command = newCommand(RENDER_COMMAND_CLEAR);
+
+    if (command != NULL) {
+        command->color.r = r;
+        command->color.g = g;
+        command->color.b = b;
+        command->color.a = a;
+    }
+}
+
+void RenderQueue_AddSprite(SDL_Texture *texture,int textureWidth,int textureHeight,SDL_Rect *srcRect,SDL_Rect *dstRect,SDL_Color color) {
+    RenderCommand *command = NULL;
+
+    if (texture == NULL || srcRect == NULL || dstRect == NULL) {
+        return;
+    }
+    command = newCommand(RENDER_COMMAND_SPRITE);
+    if (command != NULL) {
+        command->texture = texture;
+        command->color = color;
+        command->data.sprite.srcRect = *srcRect;
+        command->data.sprite.dstRect = *dstRect;
+        command->data.sprite.textureWidth = textureWidth;
+        command->data.sprite.textureHeight = textureHeight;
+    }
+}
+
+//a rotated or flipped sprite, which is drawn with SDL_RenderCopyEx instead of the sprite batch
+void RenderQueue_AddSpriteEx(SDL_Texture *texture,SDL_Rect *srcRect,SDL_Rect *dstRect,double angle,SDL_Point *center,
+                             SDL_RendererFlip flip,SDL_Color color) {
+    RenderCommand *command = NULL;
+
+    if (texture == NULL || dstRect == NULL) {
+        return;
+    }
+    command = newCommand(RENDER_COMMAND_SPRITE_EX);
+    if (command != NULL) {
+        command->texture = texture;
+        command->color = color;
+        command->flip = flip;
+        //a width of 0 means the whole texture
+        if (srcRect != NULL) {
+            command->data.spriteEx.srcRect = *srcRect;
+        } else {
+            memset(&command->data.spriteEx.srcRect,0,sizeof(SDL_Rect));
+        }
+        command->data.spriteEx.dstRect = *dstRect;
+        command->data.spriteEx.angle = angle;
+        command->data.spriteEx.hasCenter = center != NULL;
+        if (center != NULL) {
+            command->data.spriteEx.center = *center;
+        }
+    }
+}
+
+void RenderQueue_DrawRect(SDL_Rect *rect,SDL_Color color) {
+    RenderCommand *command = NULL;
+
+    if (rect == NULL) {
+        return;
+    }
+    command = newCommand(RENDER_COMMAND_DRAW_RECT);
+    if (command != NULL) {
+        command->color = color;
+        command->data.rect = *rect;
+    }
+}
+
+void RenderQueue_FillRect(SDL_FRect *rect,SDL_Color color) {
+    RenderCommand *command = NULL;
+
+    if (rect == NULL) {
+        return;
+    }
+    command = newCommand(RENDER_COMMAND_FILL_RECT);
+    if (command != NULL) {
+        command->color = color;
+        command->data.fRect = *rect;
+    }
+}
+
+void RenderQueue_AddGeometry(SDL_Texture *texture,SDL_Vertex *vertices,int numVertices,const int *indices,int numIndices) {
+    RenderCommand *command = NULL;
+    Uint8 *payload = NULL;
+    Uint32 offset = 0;
+
+    if (vertices == NULL || indices == NULL || numVertices <= 0 || numIndices <= 0) {
+        return;
+    }
+    payload = allocPayload(sizeof(SDL_Vertex)*numVertices + sizeof(int)*numIndices,&offset);
+    if (payload == NULL) {
+        return;
+    }
+    memcpy(payload,vertices,sizeof(SDL_Vertex)*numVertices);
+    memcpy(payload + sizeof(SDL_Vertex)*numVertices,indices,sizeof(int)*numIndices);
+    command = newCommand(RENDER_COMMAND_GEOMETRY);
+    if (command != NULL) {
+        command->texture = texture;
+        command->data.geometry.payloadOffset = offset;
+        command->data.geometry.numVertices = numVertices;
+        command->data.geometry.numIndices = numIndices;
+    }
+}
+
+//draws the next commands into the texture, or to the screen if the texture is NULL
+void RenderQueue_SetTarget(SDL_Texture *texture) {
+    RenderCommand *command = newCommand(RENDER_COMMAND_SET_TARGET);
+
+    if (command != NULL) {
+        command->texture = texture;
+    }
+    recordTarget = texture;
+    SetupRect(&recordClipRect,0,0,0,0);
+}
+
+//returns the target the commands added now are drawn to, NULL for the window
+SDL_Texture *RenderQueue_GetTarget() {
+    return recordTarget;
+}
+
+//only draws inside the rectangle of the target until the clip rectangle or the target is changed. NULL draws everywhere
+void RenderQueue_SetClipRect(SDL_Rect *rect) {
+    RenderCommand *command = newCommand(RENDER_COMMAND_SET_CLIP_RECT);
+
+    if (rect != NULL) {
+        recordClipRect = *rect;
+    } else {
+        SetupRect(&recordClipRect,0,0,0,0);
+    }
+    if (command != NULL) {
+        command->data.rect = recordClipRect;
+    }
+}
+
+//gets the clip rectangle the commands added now are drawn with. Returns 0 when there is no clipping
+int RenderQueue_GetClipRect(SDL_Rect *rect) {
+    if (rect != NULL) {
+        *rect = recordClipRect;
+    }
+    return recordClipRect.w > 0 && recordClipRect.h > 0;
+}
+
+//batches the sprites of the frame, draws the commands and presents the frame, then the list is emptied for the next
+//frame. With vsync this waits for the display, so the game loop calls it after it has let go of the scene, and the
+//simulation goes on in the meantime. A frame without commands is not presented
+void RenderQueue_Present() {
+    if (renderer == NULL || recordList.commands == NULL || recordList.numCommands == 0) {
+        return;
+    }
+    buildBatches(&recordList);
+    drawList(&recordList);
+    SDL_RenderPresent(renderer);
+    resetList(&recordList);
+}
+
+//the stats are written and read on the thread that owns the renderer
+void RenderQueue_GetStats(int *numCommands,int *numBatches,int *numQuads) {
+    if (numCommands != NULL) {
+        *numCommands = numCommandsLastFrame;
+    }
+    if (numBatches != NULL) {
+        *numBatches = numBatchesLastFrame;
+    }
+    if (numQuads != NULL) {
+        *numQuads = numQuadsLastFrame;
+    }
+}
+
+//turns the runs of sprite commands in the list into sprite batches
+static void buildBatches(RenderCommandList *list) {
+    RenderCommand *command = NULL;
+    int i = 0;
+
+    SpriteBatch_ResetList(&list->spriteBatches);
+    for (i = 0; i < list->numCommands; ++i) {
+        command = &list->commands[i];
+        if (command->type == RENDER_COMMAND_SPRITE) {
+            SpriteBatch_AddQuad(&list->spriteBatches,i,command->texture,command->data.sprite.textureWidth,command->data.sprite.textureHeight,
+                                &command->data.sprite.srcRect,&command->data.sprite.dstRect,command->color);
+        } else {
+            //anything else is drawn between the batches, so the next sprite starts a new batch
+            SpriteBatch_EndBatch(&list->spriteBatches);
+        }
+    }
+}
+
+//draws a list whose sprites have been batched
+static void drawList(RenderCommandList *list) {
+    RenderCommand *command = NULL;
+    SDL_Vertex *vertices = NULL;
+    int nextBatch = 0;
+    int i = 0;
+
+    for (i = 0; i < list->numCommands; ++i) {
+        command = &list->commands[i];
+        //the sprite a batch starts at draws the whole batch, the sprites after it are part of the batch
+        if (command->type == RENDER_COMMAND_SPRITE) {
+            if (nextBatch < list->spriteBatches.numBatches && list->spriteBatches.batches[nextBatch].firstCommand == i) {
+                SpriteBatch_Draw(renderer,&list->spriteBatches,nextBatch);
+                nextBatch++;
+            }
+            continue;
+        }
+
+        switch (command->type) {
+            case RENDER_COMMAND_CLEAR:
+                SDL_SetRenderDrawColor(renderer,command->color.r,command->color.g,command->color.b,command->color.a);
+                SDL_RenderClear(renderer);
+                break;
+            case RENDER_COMMAND_SPRITE_EX:
+                SDL_SetTextureColorMod(command->texture,command->color.r,command->color.g,command->color.b);
+                SDL_RenderCopyEx(renderer,command->texture,command->data.spriteEx.srcRect.w > 0 ? &command->data.spriteEx.srcRect : NULL,
+                                 &command->data.spriteEx.dstRect,command->data.spriteEx.angle,
+                                 command->data.spriteEx.hasCenter ? &command->data.spriteEx.center : NULL,(SDL_RendererFlip)command->flip);
+                break;
+            case RENDER_COMMAND_DRAW_RECT:
+                SDL_SetRenderDrawColor(renderer,command->color.r,command->color.g,command->color.b,command->color.a);
+                SDL_RenderDrawRect(renderer,&command->data.rect);
+                break;
+            case RENDER_COMMAND_FILL_RECT:
+                SDL_SetRenderDrawColor(renderer,command->color.r,command->color.g,command->color.b,command->color.a);
+                SDL_RenderFillRectF(renderer,&command->data.fRect);
+                break;
+            case RENDER_COMMAND_GEOMETRY:
+                vertices = (SDL_Vertex*)(list->payload + command->data.geometry.payloadOffset);
+                SDL_RenderGeometry(renderer,command->texture,vertices,command->data.geometry.numVertices,
+                                   (int*)(vertices + command->data.geometry.numVertices),command->data.geometry.numIndices);
+                break;
+            case RENDER_COMMAND_SET_TARGET:
+                SDL_SetRenderTarget(renderer,command->texture);
+                break;
+            case RENDER_COMMAND_SET_CLIP_RECT:
+                SDL_RenderSetClipRect(renderer,command->data.rect.w > 0 && command->data.rect.h > 0 ? &command->data.rect : NULL);
+                break;
+            case RENDER_COMMAND_UPDATE_TEXTURE:
+                SDL_UpdateTexture(command->texture,&command->data.update.rect,list->payload + command->data.update.payloadOffset,
+                                  sizeof(Uint32)*command->data.update.rect.w);
+                break;
+            case RENDER_COMMAND_DESTROY_TEXTURE:
+                SDL_DestroyTexture(command->texture);
+                break;
+            default:
+                break;
+        }
+    }
+    numCommandsLastFrame = list->numCommands;
+    numBatchesLastFrame = list->spriteBatches.numBatches;
+    numQuadsLastFrame = list->spriteBatches.numQuads;
+}
+
+static void resetList(RenderCommandList *list) {
+    list->numCommands = 0;
+    list->payloadSize = 0;
+}
+
+static RenderCommand *newCommand(RenderCommandType type) {
+    RenderCommand *newCommands = NULL;
+    RenderCommand *command = NULL;
+
+    if (recordList.commands == NULL) {
+        return NULL;
+    }
+    //double the list when it is full, so it stops growing once the frames are about the same size
+    if (recordList.numCommands >= recordList.maxCommands) {
+        newCommands = realloc(recordList.commands,sizeof(struct RenderCommand)*recordList.maxCommands*2);
+        if (newCommands == NULL) {
+            WriteError("Could not allocate memory for more render commands!");
+            return NULL;
+        }
+        recordList.commands = newCommands;
+        recordList.maxCommands *= 2;
+    }
+    command = &recordList.commands[recordList.numCommands++];
+    command->type = type;
+    command->flip = SDL_FLIP_NONE;
+    command->texture = NULL;
+    command->color.r = 0xff;
+    command->color.g = 0xff;
+    command->color.b = 0xff;
+    command->color.a = 0xff;
+    return command;
+}
+
+//returns room for size bytes in the payload of the record list, and the offset of it in *offset
+static Uint8 *allocPayload(Uint32 size,Uint32 *offset) {
+    Uint8 *newPayload = NULL;
+    Uint32 newSize = 0;
+
+    if (recordList.payload == NULL) {
+        return NULL;
+    }
+    //keep the payload 8 byte aligned for the vertices
+    size = (size + 7) & ~7u;
+    if (recordList.payloadSize + size > recordList.maxPayloadSize) {
+        newSize = recordList.maxPayloadSize*2;
+        while (recordList.payloadSize + size > newSize) {
+            newSize *= 2;
+        }
+        newPayload = realloc(recordList.payload,newSize);
+        if (newPayload == NULL) {
+            WriteError("Could not allocate %u bytes for the render command payload!",newSize);
+            return NULL;
+        }
+        recordList.payload = newPayload;
+        recordList.maxPayloadSize = newSize;
+    }
+    *offset = recordList.payloadSize;
+    recordList.payloadSize += size;
+    return recordList.payload + *offset;
+}
@@ -0,0 +1,89 @@
+#ifndef __RENDERQUEUE_H
+#define __RENDERQUEUE_H
+
+#include <SDL2/SDL.h>
+
+//number of commands and bytes of payload a command list starts with, the lists grow when they are full
+#define RENDER_QUEUE_INITIAL_COMMANDS       4096
+#define RENDER_QUEUE_INITIAL_PAYLOAD        (64*1024)
+
+typedef enum RenderCommandType {
+    RENDER_COMMAND_CLEAR = 0,
+    RENDER_COMMAND_SPRITE,
+    RENDER_COMMAND_SPRITE_EX,
+    RENDER_COMMAND_DRAW_RECT,
+    RENDER_COMMAND_FILL_RECT,
+    RENDER_COMMAND_GEOMETRY,
+    RENDER_COMMAND_SET_TARGET,
+    RENDER_COMMAND_SET_CLIP_RECT,
+    RENDER_COMMAND_UPDATE_TEXTURE,
+    RENDER_COMMAND_DESTROY_TEXTURE,
+} RenderCommandType;
+
+//one thing to draw. Vertices, indices and pixels are copied into the payload of the command list,
+//so the caller can change or free them right after adding the command
+typedef struct RenderCommand {
+    Uint8 type;
+    Uint8 flip;                 //SDL_RendererFlip of a SPRITE_EX
+    SDL_Color color;
+    SDL_Texture *texture;
+    union {
+        struct {
+            SDL_Rect srcRect;
+            SDL_Rect dstRect;
+            Uint16 textureWidth;
+            Uint16 textureHeight;
+        } sprite;
+        struct {
+            SDL_Rect srcRect;
+            SDL_Rect dstRect;
+            float angle;
+            SDL_Point center;
+            int hasCenter;
+        } spriteEx;
+        SDL_Rect rect;
+        SDL_FRect fRect;
+        struct {
+            Uint32 payloadOffset;
+            int numVertices;
+            int numIndices;
+        } geometry;
+        struct {
+            SDL_Rect rect;
+            Uint32 payloadOffset;
+        } update;
+    } data;
+} RenderCommand;
+
+//The render queue records what the systems draw in a frame as a list of commands, so the frame can be drawn without
+//the scene. The game loop records the frame while it holds the scene, lets go of it, and then RenderQueue_Present()
+//turns the runs of sprite commands into sprite batches, draws the commands and presents the frame. The vsync wait
+//of the present does not hold up the simulation thread, see SceneManager_RunActiveScene().
+//The SDL renderer is created, used and destroyed only on the thread that calls RenderQueue_Start(), which has to be
+//the main thread, because macOS and Direct3D do not support rendering from other threads. The same goes for
+//getRenderer(), the functions below and RenderQueue_Present()
+int RenderQueue_Start(SDL_Window *window);
+int RenderQueue_StartHeadless(SDL_Surface *surface);
+void RenderQueue_Stop();
+[[nodiscard]] SDL_Renderer *RenderQueue_GetRenderer();
+
+[[nodiscard]] SDL_Texture *RenderQueue_CreateTexture(Uint32 format,int access,int width,int height,SDL_BlendMode blendMode);
+[[nodiscard]] SDL_Texture *RenderQueue_CreateTextureFromSurface(SDL_Surface *surface);
+void RenderQueue_DestroyTexture(SDL_Texture *texture);
+void RenderQueue_UpdateTexture(SDL_Texture *texture,SDL_Rect *rect,const Uint32 *pixels,int pitch);
+
+void RenderQueue_Clear(Uint8 r,Uint8 g,Uint8 b,Uint8 a);
+void RenderQueue_AddSprite(SDL_Texture *texture,int textureWidth,int textureHeight,SDL_Rect *srcRect,SDL_Rect *dstRect,SDL_Color color);
+void RenderQueue_AddSpriteEx(SDL_Texture *texture,SDL_Rect *srcRect,SDL_Rect *dstRect,double angle,SDL_Point *center,
+                             SDL_RendererFlip flip,SDL_Color color);
+void RenderQueue_DrawRect(SDL_Rect *rect,SDL_Color color);
+void RenderQueue_FillRect(SDL_FRect *rect,SDL_Color color);
+void RenderQueue_AddGeometry(SDL_Texture *texture,SDL_Vertex *vertices,int numVertices,const int *indices,int numIndices);
+void RenderQueue_SetTarget(SDL_Texture *texture);
+[[nodiscard]] SDL_Texture *RenderQueue_GetTarget();
+void RenderQueue_SetClipRect(SDL_Rect *rect);
+int RenderQueue_GetClipRect(SDL_Rect *rect);
+void RenderQueue_Present();
+void RenderQueue_GetStats(int *numCommands,int *numBatches,int *numQuads);
+
+#endif // __RENDERQUEUE_H
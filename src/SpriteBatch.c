@@ -0,0 +1,143 @@
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "SpriteBatch.h"
+#include "logger.h"
+
+//every quad is two triangles, so the indices are the same for every batch.
+//They are only used by SpriteBatch_Draw(), on the thread that owns the renderer
+static int indices[SPRITE_BATCH_MAX_QUADS*6];
+static int indicesInitialized = 0;
+
+static void setVertex(SDL_Vertex *vertex,float x,float y,float u,float v,SDL_Color color) {
+    vertex->position.x = x;
+    vertex->position.y = y;
+    vertex->tex_coord.x = u;
+    vertex->tex_coord.y = v;
+    vertex->color = color;
+}
+
+int SpriteBatch_InitList(SpriteBatchList *list) {
+    if (list == NULL) {
+        WriteError("Parameter: 'SpriteBatchList *list' is NULL!");
+        return -1;
+    }
+    list->vertices = malloc(sizeof(SDL_Vertex)*4*SPRITE_BATCH_INITIAL_QUADS);
+    list->batches = malloc(sizeof(struct SpriteBatch)*SPRITE_BATCH_INITIAL_BATCHES);
+    if (list->vertices == NULL || list->batches == NULL) {
+        WriteError("Could not allocate memory for the sprite batches!");
+        SpriteBatch_FreeList(list);
+        return -1;
+    }
+    list->maxQuads = SPRITE_BATCH_INITIAL_QUADS;
+    list->maxBatches = SPRITE_BATCH_INITIAL_BATCHES;
+    SpriteBatch_ResetList(list);
+    return 1;
+}
+
+void SpriteBatch_FreeList(SpriteBatchList *list) {
+    if (list == NULL) {
+        return;
+    }
+    free(list->vertices);
+    free(list->batches);
+    list->vertices = NULL;
+    list->batches = NULL;
+    list->maxQuads = 0;
+    list->maxBatches = 0;
+    SpriteBatch_ResetList(list);
+}
+
+//empties the list, and keeps the memory for the next frame
+void SpriteBatch_ResetList(SpriteBatchList *list) {
+    list->numQuads = 0;
+    list->numBatches = 0;
+    list->isBatchOpen = 0;
+}
+
+int SpriteBatch_AddQuad(SpriteBatchList *list,int command,SDL_Texture *texture,int textureWidth,int textureHeight,
+                        SDL_Rect *srcRect,SDL_Rect *dstRect,SDL_Color color) {
+    SDL_Vertex *newVertices = NULL;
+    SpriteBatch *newBatches = NULL;
+    SpriteBatch *batch = NULL;
+    SDL_Vertex *quad = NULL;
+    float u0,v0,u1,v1;
+
+    if (list == NULL || list->vertices == NULL || texture == NULL || srcRect == NULL || dstRect == NULL
+    || textureWidth <= 0 || textureHeight <= 0) {
+        return -1;
+    }
+
+    //double the vertices and the batches when they are full, so they stop growing once the frames are about the same size
+    if (list->numQuads >= list->maxQuads) {
+        newVertices = realloc(list->vertices,sizeof(SDL_Vertex)*4*list->maxQuads*2);
+        if (newVertices == NULL) {
+            WriteError("Could not allocate memory for more sprite quads!");
+            return -1;
+        }
+        list->vertices = newVertices;
+        list->maxQuads *= 2;
+    }
+
+    //start a new batch when the texture changes or when the batch is full
+    batch = list->numBatches > 0 ? &list->batches[list->numBatches-1] : NULL;
+    if (list->isBatchOpen == 0 || batch->texture != texture || batch->numQuads >= SPRITE_BATCH_MAX_QUADS) {
+        if (list->numBatches >= list->maxBatches) {
+            newBatches = realloc(list->batches,sizeof(struct SpriteBatch)*list->maxBatches*2);
+            if (newBatches == NULL) {
+                WriteError("Could not allocate memory for more sprite batches!");
+                return -1;
+            }
+            list->batches = newBatches;
+            list->maxBatches *= 2;
+        }
+        batch = &list->batches[list->numBatches++];
+        batch->texture = texture;
+        batch->firstQuad = list->numQuads;
+        batch->numQuads = 0;
+        batch->firstCommand = command;
+        list->isBatchOpen = 1;
+    }
+
+    u0 = (float)srcRect->x/textureWidth;
+    v0 = (float)srcRect->y/textureHeight;
+    u1 = (float)(srcRect->x+srcRect->w)/textureWidth;
+    v1 = (float)(srcRect->y+srcRect->h)/textureHeight;
+
+    quad = &list->vertices[list->numQuads*4];
+    setVertex(&quad[0],dstRect->x,dstRect->y,u0,v0,color);
+    setVertex(&quad[1],dstRect->x+dstRect->w,dstRect->y,u1,v0,color);
+    setVertex(&quad[2],dstRect->x+dstRect->w,dstRect->y+dstRect->h,u1,v1,color);
+    setVertex(&quad[3],dstRect->x,dstRect->y+dstRect->h,u0,v1,color);
+    list->numQuads++;
+    batch->numQuads++;
+    return 1;
+}
+
+//ends the last batch, so the next quad starts a new one that is drawn after whatever comes in between
+void SpriteBatch_EndBatch(SpriteBatchList *list) {
+    list->isBatchOpen = 0;
+}
+
+void SpriteBatch_Draw(SDL_Renderer *renderer,SpriteBatchList *list,int batch) {
+    int i = 0;
+
+    if (batch < 0 || batch >= list->numBatches || list->batches[batch].numQuads == 0) {
+        return;
+    }
+    if (indicesInitialized == 0) {
+        for (i = 0; i < SPRITE_BATCH_MAX_QUADS; ++i) {
+            indices[i*6+0] = i*4+0;
+            indices[i*6+1] = i*4+1;
+            indices[i*6+2] = i*4+2;
+            indices[i*6+3] = i*4+2;
+            indices[i*6+4] = i*4+3;
+            indices[i*6+5] = i*4+0;
+        }
+        indicesInitialized = 1;
+    }
+    if (SDL_RenderGeometry(renderer,list->batches[batch].texture,&list->vertices[list->batches[batch].firstQuad*4],
+                           list->batches[batch].numQuads*4,indices,list->batches[batch].numQuads*6) != 0) {
+        WriteError("SDL_RenderGeometry failed:%s",SDL_GetError());
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef __SPRITEBATCH_H
+#define __SPRITEBATCH_H
+
+#include <SDL2/SDL.h>
+
+//maximum number of quads in one batch, a new batch is started when it is full
+#define SPRITE_BATCH_MAX_QUADS  2048
+
+//number of quads and batches a batch list starts with, the list grows when it is full
+#define SPRITE_BATCH_INITIAL_QUADS      SPRITE_BATCH_MAX_QUADS
+#define SPRITE_BATCH_INITIAL_BATCHES    64
+
+//quads that use the same texture, and are drawn with one SDL_RenderGeometry call
+typedef struct SpriteBatch {
+    SDL_Texture *texture;
+    int firstQuad;
+    int numQuads;
+    int firstCommand;       //index of the render command the batch starts at
+} SpriteBatch;
+
+//The sprite batch list collects the textured quads of a frame into batches. A batch ends when the texture changes,
+//when it is full, or when SpriteBatch_EndBatch() is called because something else is drawn in between.
+//Only SpriteBatch_Draw() uses the renderer, so it has to be called on the thread that created the renderer
+typedef struct SpriteBatchList {
+    SDL_Vertex *vertices;   //4 vertices per quad
+    int numQuads;
+    int maxQuads;
+    SpriteBatch *batches;
+    int numBatches;
+    int maxBatches;
+    int isBatchOpen;        //1 if the next quad can be added to the last batch
+} SpriteBatchList;
+
+int SpriteBatch_InitList(SpriteBatchList *list);
+void SpriteBatch_FreeList(SpriteBatchList *list);
+void SpriteBatch_ResetList(SpriteBatchList *list);
+int SpriteBatch_AddQuad(SpriteBatchList *list,int command,SDL_Texture *texture,int textureWidth,int textureHeight,
+                        SDL_Rect *srcRect,SDL_Rect *dstRect,SDL_Color color);
+void SpriteBatch_EndBatch(SpriteBatchList *list);
+void SpriteBatch_Draw(SDL_Renderer *renderer,SpriteBatchList *list,int batch);
+
+#endif // __SPRITEBATCH_H
@@ -5,6 +5,8 @@
 #include "IsoEngine/isoEngine.h"
 #include "renderer.h"
 #include "Texture.h"
+#include "RenderQueue.h"
+#include "TextureAtlas.h"
 #include "logger.h"
 
 void SetupRect(SDL_Rect *rect,int x,int y,int w,int h) {
@@ -15,18 +17,30 @@ void SetupRect(SDL_Rect *rect,int x,int y,int w,int h) {
 }
 
 int Texture_loadFromFile(Texture *texture, char *filename) {
+    SDL_Rect region;
+
     if (texture == NULL) {
         WriteError("Parameter: 'Texture *texture' is NULL!");
         return 0;
     }
 
+    //use the region in the texture atlas when the image has been packed into it
+    if (TextureAtlas_FindRegion(filename,&texture->texture,&region,&texture->textureWidth,&texture->textureHeight)) {
+        texture->atlasX = region.x;
+        texture->atlasY = region.y;
+        texture->width = region.w;
+        texture->height = region.h;
+        texture->isAtlasRegion = 1;
+        return 1;
+    }
+
     SDL_Surface *tmpSurface = IMG_Load(filename);
 
     if (tmpSurface == NULL) {
         WriteError("Could not load image:%s! SDL_image Error:%s",filename,IMG_GetError());
         return 0;
     } else {
-        texture->texture = SDL_CreateTextureFromSurface(getRenderer(),tmpSurface);
+        texture->texture = RenderQueue_CreateTextureFromSurface(tmpSurface);
 
         if (texture->texture == NULL) {
             WriteError("Could not load image:%s! SDL_image Error:%s",filename,IMG_GetError());
@@ -35,6 +49,11 @@ int Texture_loadFromFile(Texture *texture, char *filename) {
         } else{
             texture->width = tmpSurface->w;
             texture->height = tmpSurface->h;
+            texture->atlasX = 0;
+            texture->atlasY = 0;
+            texture->textureWidth = tmpSurface->w;
+            texture->textureHeight = tmpSurface->h;
+            texture->isAtlasRegion = 0;
         }
         SDL_FreeSurface(tmpSurface);
         return 1;
@@ -47,6 +66,10 @@ int Texture_Init(Texture *texture, int x,int y, double angle, SDL_Point *center,
     texture->y = y;
     texture->angle = angle;
     texture->fliptype = fliptype;
+    texture->colorMod.r = 0xff;
+    texture->colorMod.g = 0xff;
+    texture->colorMod.b = 0xff;
+    texture->colorMod.a = 0xff;
 
     if (cliprect!=NULL) {
         texture->cliprect = *cliprect;
@@ -70,18 +93,25 @@ void Texture_RenderXYClip(Texture *texture, int x, int y, SDL_Rect *cliprect) {
     texture->y = y;
     texture->cliprect = *cliprect;
     SDL_Rect quad = { texture->x, texture->y, texture->width, texture->height };
+    //the clip rectangle is in the image, move it to where the image is in the texture
+    SDL_Rect srcRect = { texture->cliprect.x+texture->atlasX, texture->cliprect.y+texture->atlasY, texture->cliprect.w, texture->cliprect.h };
 
     quad.w = texture->cliprect.w;
     quad.h = texture->cliprect.h;
 
-
-    SDL_RenderCopyEx(getRenderer(),texture->texture,&texture->cliprect,&quad,texture->angle, &texture->center,texture->fliptype);
+    //textures that are not rotated or flipped are drawn with the sprite batch
+    if (texture->angle == 0 && texture->fliptype == SDL_FLIP_NONE) {
+        RenderQueue_AddSprite(texture->texture,texture->textureWidth,texture->textureHeight,&srcRect,&quad,texture->colorMod);
+        return;
+    }
+    RenderQueue_AddSpriteEx(texture->texture,&srcRect,&quad,texture->angle,&texture->center,texture->fliptype,texture->colorMod);
 }
 
 void Texture_RenderXYClipScale(Texture *texture, int x, int y, SDL_Rect *cliprect,float scale) {
     float w,h;
     float diffx,diffy;
     SDL_Rect quad;
+    SDL_Rect srcRect;
     w=(float)texture->width*scale;
     h=(float)texture->height*scale;
 
@@ -103,22 +133,47 @@ void Texture_RenderXYClipScale(Texture *texture, int x, int y, SDL_Rect *cliprec
             quad.h +=1;
             quad.w +=1;
         }
+        //textures that are not rotated or flipped are drawn with the sprite batch
+        //the clip rectangle is in the image, move it to where the image is in the texture
+        SetupRect(&srcRect,texture->cliprect.x+texture->atlasX,texture->cliprect.y+texture->atlasY,texture->cliprect.w,texture->cliprect.h);
+        if (texture->angle == 0 && texture->fliptype == SDL_FLIP_NONE) {
+            RenderQueue_AddSprite(texture->texture,texture->textureWidth,texture->textureHeight,&srcRect,&quad,texture->colorMod);
+            return;
+        }
         //Center point is passed in as NULL. If/When a function is needed to change center point on a sprite, we'll add one.
-        SDL_RenderCopyEx(getRenderer(),texture->texture,&texture->cliprect,&quad,texture->angle,NULL,texture->fliptype);
+        RenderQueue_AddSpriteEx(texture->texture,&srcRect,&quad,texture->angle,NULL,texture->fliptype,texture->colorMod);
     }
     //if the cliprect is NULL
     else {
+        //the whole image, which is only a part of the texture when it is in the atlas
+        SetupRect(&srcRect,texture->atlasX,texture->atlasY,texture->width,texture->height);
+        if (texture->angle == 0 && texture->fliptype == SDL_FLIP_NONE) {
+            RenderQueue_AddSprite(texture->texture,texture->textureWidth,texture->textureHeight,&srcRect,&quad,texture->colorMod);
+            return;
+        }
         //Center point is passed in as NULL. If/When a function is needed to change center point on a sprite, we'll add one.
         //Draw without clip rectangle
-        SDL_RenderCopyEx(getRenderer(),texture->texture,NULL,&quad,texture->angle,NULL,texture->fliptype);
+        RenderQueue_AddSpriteEx(texture->texture,&srcRect,&quad,texture->angle,NULL,texture->fliptype,texture->colorMod);
+    }
+}
+
+void Texture_SetColorMod(Texture *texture, Uint8 r, Uint8 g, Uint8 b) {
+    if (texture == NULL) {
+        WriteError("Parameter: 'Texture *texture' is NULL!");
+        return;
     }
+    //the color is given to the vertices of the sprite batch, so it is only used for what is drawn after this
+    texture->colorMod.r = r;
+    texture->colorMod.g = g;
+    texture->colorMod.b = b;
 }
 
 void Texture_Delete(Texture *texture) {
     if (texture!=NULL) {
-        //if the texture is allocated
-        if (texture->texture != NULL) {
-            SDL_DestroyTexture(texture->texture);
+        //if the texture is allocated, destroy it after the frames that use it have been drawn.
+        //The pages of the atlas are destroyed by TextureAtlas_Free()
+        if (texture->texture != NULL && texture->isAtlasRegion == 0) {
+            RenderQueue_DestroyTexture(texture->texture);
         }
     }
 }
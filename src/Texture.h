@@ -12,13 +12,20 @@ typedef struct Texture {
     SDL_Point center;
     SDL_Rect cliprect;
     SDL_RendererFlip fliptype;
+    SDL_Color colorMod;
     SDL_Texture *texture;
+    int atlasX;                 //position of the image in the texture, when the texture is a page in the texture atlas
+    int atlasY;
+    int textureWidth;           //size of the SDL texture, larger than the image when it is a page in the atlas
+    int textureHeight;
+    int isAtlasRegion;          //1 when the SDL texture belongs to the texture atlas
 } Texture;
 
 int Texture_loadFromFile(Texture *texture, char *filename);
 int Texture_Init(Texture *texture, int x,int y, double angle, SDL_Point *center, SDL_Rect *cliprect, SDL_RendererFlip fliptype);
 void Texture_RenderXYClip(Texture *texture, int x, int y, SDL_Rect *cliprect);
 void Texture_RenderXYClipScale(Texture *texture, int x, int y, SDL_Rect *cliprect,float scale);
+void Texture_SetColorMod(Texture *texture, Uint8 r, Uint8 g, Uint8 b);
 void Texture_Delete(Texture *texture);
 void SetupRect(SDL_Rect *rect,int x,int y,int w,int h);
 
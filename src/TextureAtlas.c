@@ -0,0 +1,415 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include "TextureAtlas.h"
+#include "RenderQueue.h"
+#include "Texture.h"
+#include "logger.h"
+
+//a segment of the skyline, the top edge of the images that have been packed into a page
+typedef struct SkylineNode {
+    int x;
+    int y;
+    int width;
+} SkylineNode;
+
+typedef struct AtlasPage {
+    SDL_Texture *texture;
+    int width;
+    int height;                 //the page is cut off below the lowest image
+    SkylineNode *skyline;       //segments of the skyline from left to right, only used while the atlas is built
+    int numNodes;
+} AtlasPage;
+
+static TextureAtlasRegion *regions = NULL;
+static int numRegions = 0;
+static int maxRegions = 0;
+static AtlasPage pages[TEXTURE_ATLAS_MAX_PAGES];
+static int numPages = 0;
+
+//images are packed from the largest to the smallest, and from the tallest to the lowest when they are
+//equally large. The filename keeps the order the same between runs
+static SDL_Surface **sortSurfaces = NULL;
+static int compareRegions(const void *a,const void *b) {
+    int indexA = *(const int*)a;
+    int indexB = *(const int*)b;
+    SDL_Surface *surfaceA = sortSurfaces[indexA];
+    SDL_Surface *surfaceB = sortSurfaces[indexB];
+
+    if (surfaceA->w*surfaceA->h != surfaceB->w*surfaceB->h) {
+        return surfaceB->w*surfaceB->h - surfaceA->w*surfaceA->h;
+    }
+    if (surfaceA->h != surfaceB->h) {
+        return surfaceB->h - surfaceA->h;
+    }
+    if (surfaceA->w != surfaceB->w) {
+        return surfaceB->w - surfaceA->w;
+    }
+    return strcmp(regions[indexA].filename,regions[indexB].filename);
+}
+
+//returns the y position an image of width w gets when it is placed at the start of skyline node i,
+//or -1 if it does not fit there
+static int skylineFit(AtlasPage *page,int i,int w,int h) {
+    int x = page->skyline[i].x;
+    int y = 0;
+    int widthLeft = w;
+
+    if (x + w > page->width) {
+        return -1;
+    }
+    //the image rests on the highest node below it
+    while (widthLeft > 0) {
+        if (page->skyline[i].y > y) {
+            y = page->skyline[i].y;
+        }
+        if (y + h > page->height) {
+            return -1;
+        }
+        widthLeft -= page->skyline[i].width;
+        i++;
+    }
+    return y;
+}
+
+//finds the lowest place for the image in the page, and the narrowest node when two places are equally low.
+//Returns the index of the skyline node or -1 when the image does not fit in the page
+static int skylineFind(AtlasPage *page,int w,int h,int *bestY) {
+    int bestIndex = -1;
+    int bestWidth = 0;
+    int y = 0;
+    int i = 0;
+
+    for (i = 0; i < page->numNodes; ++i) {
+        y = skylineFit(page,i,w,h);
+        if (y < 0) {
+            continue;
+        }
+        if (bestIndex < 0 || y < *bestY || (y == *bestY && page->skyline[i].width < bestWidth)) {
+            bestIndex = i;
+            bestWidth = page->skyline[i].width;
+            *bestY = y;
+        }
+    }
+    return bestIndex;
+}
+
+//raises the skyline over the image placed at node index
+static void skylineAdd(AtlasPage *page,int index,int w,int h,int y) {
+    int x = page->skyline[index].x;
+    int shrink = 0;
+    int i = 0;
+
+    //insert the top of the image as a new node
+    memmove(&page->skyline[index+1],&page->skyline[index],sizeof(SkylineNode)*(page->numNodes-index));
+    page->skyline[index].x = x;
+    page->skyline[index].y = y + h;
+    page->skyline[index].width = w;
+    page->numNodes++;
+
+    //remove or shorten the nodes that are now under the image
+    i = index+1;
+    while (i < page->numNodes) {
+        if (page->skyline[i].x >= x + w) {
+            break;
+        }
+        shrink = x + w - page->skyline[i].x;
+        if (shrink < page->skyline[i].width) {
+            page->skyline[i].x += shrink;
+            page->skyline[i].width -= shrink;
+            break;
+        }
+        memmove(&page->skyline[i],&page->skyline[i+1],sizeof(SkylineNode)*(page->numNodes-i-1));
+        page->numNodes--;
+    }
+
+    //join the nodes that have the same height
+    for (i = 0; i < page->numNodes-1; ++i) {
+        if (page->skyline[i].y == page->skyline[i+1].y) {
+            page->skyline[i].width += page->skyline[i+1].width;
+            memmove(&page->skyline[i+1],&page->skyline[i+2],sizeof(SkylineNode)*(page->numNodes-i-2));
+            page->numNodes--;
+            i--;
+        }
+    }
+}
+
+//returns a new empty page, or NULL when there is no room for more pages
+static AtlasPage *newPage() {
+    AtlasPage *page = NULL;
+
+    if (numPages >= TEXTURE_ATLAS_MAX_PAGES) {
+        return NULL;
+    }
+    page = &pages[numPages];
+    page->texture = NULL;
+    page->width = TEXTURE_ATLAS_PAGE_SIZE;
+    page->height = TEXTURE_ATLAS_PAGE_SIZE;
+    //the skyline never has more nodes than there are pixels across the page
+    page->skyline = malloc(sizeof(SkylineNode)*(TEXTURE_ATLAS_PAGE_SIZE+1));
+    if (page->skyline == NULL) {
+        WriteError("Could not allocate memory for a texture atlas page!");
+        return NULL;
+    }
+    page->skyline[0].x = 0;
+    page->skyline[0].y = 0;
+    page->skyline[0].width = TEXTURE_ATLAS_PAGE_SIZE;
+    page->numNodes = 1;
+    numPages++;
+    return page;
+}
+
+int TextureAtlas_AddFile(char *filename) {
+    TextureAtlasRegion *newRegions = NULL;
+    int i = 0;
+
+    if (filename == NULL) {
+        WriteError("Parameter: 'char *filename' is NULL!");
+        return 0;
+    }
+    if (numPages > 0) {
+        WriteWarning("The texture atlas has already been built, %s was not added!",filename);
+        return 0;
+    }
+    for (i = 0; i < numRegions; ++i) {
+        if (strcmp(regions[i].filename,filename) == 0) {
+            return 1;
+        }
+    }
+
+    if (numRegions >= maxRegions) {
+        newRegions = realloc(regions,sizeof(struct TextureAtlasRegion)*(maxRegions > 0 ? maxRegions*2 : 16));
+        if (newRegions == NULL) {
+            WriteError("Could not allocate memory for more images in the texture atlas! %s was not added!",filename);
+            return 0;
+        }
+        regions = newRegions;
+        maxRegions = maxRegions > 0 ? maxRegions*2 : 16;
+    }
+
+    regions[numRegions].filename = malloc(sizeof(char)*(strlen(filename)+1));
+    if (regions[numRegions].filename == NULL) {
+        WriteError("Could not allocate memory for the filename! %s was not added to the texture atlas!",filename);
+        return 0;
+    }
+    strcpy(regions[numRegions].filename,filename);
+    regions[numRegions].page = -1;
+    SetupRect(&regions[numRegions].rect,0,0,0,0);
+    numRegions++;
+    return 1;
+}
+
+//adds every png image in the directory. Returns the number of images that were added
+int TextureAtlas_AddDirectory(char *directory) {
+    DIR *dir = NULL;
+    struct dirent *entry = NULL;
+    char filename[512];
+    int len = 0;
+    int numAdded = 0;
+
+    if (directory == NULL) {
+        WriteError("Parameter: 'char *directory' is NULL!");
+        return 0;
+    }
+    dir = opendir(directory);
+    if (dir == NULL) {
+        WriteError("Could not open the directory:%s",directory);
+        return 0;
+    }
+    while ((entry = readdir(dir)) != NULL) {
+        len = strlen(entry->d_name);
+        if (len < 4 || strcmp(&entry->d_name[len-4],".png") != 0) {
+            continue;
+        }
+        snprintf(filename,sizeof(filename),"%s/%s",directory,entry->d_name);
+        numAdded += TextureAtlas_AddFile(filename);
+    }
+    closedir(dir);
+    return numAdded;
+}
+
+//loads the images that have been added and packs them into the pages with a skyline packer.
+//Returns the number of images that were packed
+int TextureAtlas_Build() {
+    Uint64 buildTimer = SDL_GetPerformanceCounter();
+    SDL_Surface **surfaces = NULL;
+    SDL_Surface *loaded = NULL;
+    SDL_Surface *pageSurface = NULL;
+    AtlasPage *page = NULL;
+    int *order = NULL;
+    int numLoaded = 0;
+    int numPacked = 0;
+    int index = 0, node = 0, y = 0;
+    int w = 0, h = 0;
+    int i = 0, p = 0;
+
+    if (numPages > 0) {
+        WriteWarning("The texture atlas has already been built!");
+        return 0;
+    }
+    if (numRegions == 0) {
+        return 0;
+    }
+
+    surfaces = calloc(numRegions,sizeof(SDL_Surface*));
+    order = malloc(sizeof(int)*numRegions);
+    if (surfaces == NULL || order == NULL) {
+        WriteError("Could not allocate memory to build the texture atlas!");
+        free(surfaces);
+        free(order);
+        return 0;
+    }
+
+    //load the images in the same pixel format as the pages
+    for (i = 0; i < numRegions; ++i) {
+        loaded = IMG_Load(regions[i].filename);
+        if (loaded == NULL) {
+            WriteWarning("Could not load image:%s to the texture atlas! SDL_image Error:%s",regions[i].filename,IMG_GetError());
+            continue;
+        }
+        surfaces[i] = SDL_ConvertSurfaceFormat(loaded,SDL_PIXELFORMAT_ARGB8888,0);
+        SDL_FreeSurface(loaded);
+    }
+
+    //pack the images that could be loaded from the largest to the smallest
+    for (i = 0; i < numRegions; ++i) {
+        if (surfaces[i] != NULL) {
+            order[numLoaded++] = i;
+        }
+    }
+    sortSurfaces = surfaces;
+    qsort(order,numLoaded,sizeof(int),compareRegions);
+    sortSurfaces = NULL;
+
+    for (i = 0; i < numLoaded; ++i) {
+        index = order[i];
+        w = surfaces[index]->w + TEXTURE_ATLAS_PADDING;
+        h = surfaces[index]->h + TEXTURE_ATLAS_PADDING;
+        if (w > TEXTURE_ATLAS_PAGE_SIZE || h > TEXTURE_ATLAS_PAGE_SIZE) {
+            WriteDebug("Image:%s is too large for the texture atlas and will be loaded on its own",regions[index].filename);
+            continue;
+        }
+
+        //use the first page the image fits in, and start a new page when it does not fit in any of them
+        node = -1;
+        for (p = 0; p < numPages && node < 0; ++p) {
+            page = &pages[p];
+            node = skylineFind(page,w,h,&y);
+        }
+        if (node < 0 && (page = newPage()) != NULL) {
+            node = skylineFind(page,w,h,&y);
+        }
+        if (node < 0) {
+            WriteWarning("The texture atlas is full, image:%s will be loaded on its own",regions[index].filename);
+            continue;
+        }
+        regions[index].page = page - pages;
+        SetupRect(&regions[index].rect,page->skyline[node].x,y,surfaces[index]->w,surfaces[index]->h);
+        skylineAdd(page,node,w,h,y);
+        numPacked++;
+    }
+
+    //copy the images into the pages and create the textures
+    for (p = 0; p < numPages; ++p) {
+        page = &pages[p];
+        //cut the page off below the highest point of the skyline
+        page->height = 0;
+        for (i = 0; i < page->numNodes; ++i) {
+            if (page->skyline[i].y > page->height) {
+                page->height = page->skyline[i].y;
+            }
+        }
+        free(page->skyline);
+        page->skyline = NULL;
+
+        pageSurface = SDL_CreateRGBSurfaceWithFormat(0,page->width,page->height,32,SDL_PIXELFORMAT_ARGB8888);
+        if (pageSurface == NULL) {
+            WriteError("Could not create surface for texture atlas page %d! SDL Error:%s",p,SDL_GetError());
+            continue;
+        }
+        for (i = 0; i < numRegions; ++i) {
+            if (regions[i].page != p) {
+                continue;
+            }
+            //copy the alpha as it is instead of blending it with the empty page
+            SDL_SetSurfaceBlendMode(surfaces[i],SDL_BLENDMODE_NONE);
+            SDL_BlitSurface(surfaces[i],NULL,pageSurface,&regions[i].rect);
+        }
+        page->texture = RenderQueue_CreateTextureFromSurface(pageSurface);
+        if (page->texture == NULL) {
+            WriteError("Could not create texture for texture atlas page %d!",p);
+        }
+        SDL_FreeSurface(pageSurface);
+    }
+
+    //images on pages without a texture are loaded on their own
+    for (i = 0; i < numRegions; ++i) {
+        if (regions[i].page >= 0 && pages[regions[i].page].texture == NULL) {
+            regions[i].page = -1;
+            numPacked--;
+        }
+        SDL_FreeSurface(surfaces[i]);
+    }
+    free(surfaces);
+    free(order);
+
+    WriteDebug("Packed %d of %d images into %d texture atlas pages in %.2f ms",numPacked,numRegions,numPages,
+               (double)(SDL_GetPerformanceCounter()-buildTimer)*1000.0/SDL_GetPerformanceFrequency());
+    for (p = 0; p < numPages; ++p) {
+        WriteDebug("Texture atlas page %d: %dx%d",p,pages[p].width,pages[p].height);
+    }
+    return numPacked;
+}
+
+//gets the page texture and the rectangle of an image in the atlas. Returns 0 if the image is not in the atlas
+int TextureAtlas_FindRegion(char *filename,SDL_Texture **texture,SDL_Rect *rect,int *pageWidth,int *pageHeight) {
+    int i = 0;
+
+    if (filename == NULL) {
+        return 0;
+    }
+    for (i = 0; i < numRegions; ++i) {
+        if (regions[i].page < 0 || strcmp(regions[i].filename,filename) != 0) {
+            continue;
+        }
+        if (texture != NULL) {
+            *texture = pages[regions[i].page].texture;
+        }
+        if (rect != NULL) {
+            *rect = regions[i].rect;
+        }
+        if (pageWidth != NULL) {
+            *pageWidth = pages[regions[i].page].width;
+        }
+        if (pageHeight != NULL) {
+            *pageHeight = pages[regions[i].page].height;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+int TextureAtlas_GetNumPages() {
+    return numPages;
+}
+
+//destroys the pages. The textures that use regions in the atlas can not be drawn after this
+void TextureAtlas_Free() {
+    int i = 0;
+
+    for (i = 0; i < numPages; ++i) {
+        RenderQueue_DestroyTexture(pages[i].texture);
+        pages[i].texture = NULL;
+    }
+    numPages = 0;
+    for (i = 0; i < numRegions; ++i) {
+        free(regions[i].filename);
+    }
+    free(regions);
+    regions = NULL;
+    numRegions = 0;
+    maxRegions = 0;
+}
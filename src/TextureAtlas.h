@@ -0,0 +1,29 @@
+#ifndef __TEXTUREATLAS_H
+#define __TEXTUREATLAS_H
+
+#include <SDL2/SDL.h>
+
+//size of the atlas pages. 2048 is supported by almost every renderer, images that are larger are loaded on their own
+#define TEXTURE_ATLAS_PAGE_SIZE     2048
+#define TEXTURE_ATLAS_MAX_PAGES     8
+//empty pixels between the images, so a sprite never samples the pixels of its neighbour
+#define TEXTURE_ATLAS_PADDING       1
+
+//where an image was packed in the atlas
+typedef struct TextureAtlasRegion {
+    char *filename;         //path of the image, as it was added to the atlas
+    int page;               //page the image is on, -1 when it did not fit in a page
+    SDL_Rect rect;          //position and size of the image on the page
+} TextureAtlasRegion;
+
+//The texture atlas packs many images into a few large pages at startup, so sprites from different images
+//can be drawn in the same batch. Add the images, build the atlas, and Texture_loadFromFile() will use the
+//region in the atlas when the filename was packed, and load the image on its own when it was not
+int TextureAtlas_AddFile(char *filename);
+int TextureAtlas_AddDirectory(char *directory);
+int TextureAtlas_Build();
+int TextureAtlas_FindRegion(char *filename,SDL_Texture **texture,SDL_Rect *rect,int *pageWidth,int *pageHeight);
+[[nodiscard]] int TextureAtlas_GetNumPages();
+void TextureAtlas_Free();
+
+#endif // __TEXTUREATLAS_H
@@ -0,0 +1,159 @@
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "ThreadPool.h"
+#include "logger.h"
+
+//the most threads the pool starts, the calling thread included
+#define THREAD_POOL_MAX_THREADS 16
+
+static SDL_Thread *workers[THREAD_POOL_MAX_THREADS];
+static int numWorkers = 0;
+static SDL_mutex *mutex = NULL;
+static SDL_cond *workCond = NULL;       //signaled when a loop starts or the pool stops
+static SDL_cond *doneCond = NULL;       //signaled when the last worker is done with the loop
+//the loop the threads are running
+static threadPoolTaskFuncPointer taskFunc = NULL;
+static void *taskData = NULL;
+static int numTasks = 0;
+static SDL_atomic_t nextTask;
+static int numBusyWorkers = 0;
+static Uint32 loopNumber = 0;           //counts the loops, so a worker knows that there is a new one
+static int quitWorkers = 0;
+
+static int workerMain(void *data);
+static void runTasks(int threadIndex);
+
+//starts the worker threads. With 0 threads, one thread is used for every CPU core. Returns 0 on error,
+//the loops still run on the calling thread then
+int ThreadPool_Start(int numThreads) {
+    int i = 0;
+
+    if (numThreads <= 0) {
+        numThreads = SDL_GetCPUCount();
+    }
+    if (numThreads > THREAD_POOL_MAX_THREADS) {
+        numThreads = THREAD_POOL_MAX_THREADS;
+    }
+
+    mutex = SDL_CreateMutex();
+    workCond = SDL_CreateCond();
+    doneCond = SDL_CreateCond();
+    if (mutex == NULL || workCond == NULL || doneCond == NULL) {
+        WriteError("Could not create the thread pool mutex! SDL Error:%s",SDL_GetError());
+        return 0;
+    }
+    quitWorkers = 0;
+    loopNumber = 0;
+    //the calling thread is thread 0
+    for (i = 1; i < numThreads; ++i) {
+        workers[numWorkers] = SDL_CreateThread(workerMain,"WorkerThread",(void*)(intptr_t)i);
+        if (workers[numWorkers] == NULL) {
+            WriteError("Could not create worker thread %d! SDL Error:%s",i,SDL_GetError());
+            return 0;
+        }
+        numWorkers++;
+    }
+    WriteDebug("Thread pool: started %d worker threads",numWorkers);
+    return 1;
+}
+
+void ThreadPool_Stop() {
+    int i = 0;
+
+    if (mutex != NULL) {
+        SDL_LockMutex(mutex);
+        quitWorkers = 1;
+        SDL_CondBroadcast(workCond);
+        SDL_UnlockMutex(mutex);
+    }
+    for (i = 0; i < numWorkers; ++i) {
+        SDL_WaitThread(workers[i],NULL);
+        workers[i] = NULL;
+    }
+    numWorkers = 0;
+    SDL_DestroyCond(doneCond);
+    SDL_DestroyCond(workCond);
+    SDL_DestroyMutex(mutex);
+    doneCond = NULL;
+    workCond = NULL;
+    mutex = NULL;
+}
+
+//returns the number of threads that run the tasks, the calling thread included
+int ThreadPool_GetNumThreads() {
+    return numWorkers+1;
+}
+
+//runs func for the tasks 0 - numTasks-1 on all the threads, and returns when all of them are done.
+//The order the tasks run in is not known, so the tasks should write their results apart and not depend on
+//each other
+void ThreadPool_ParallelFor(int numLoopTasks,threadPoolTaskFuncPointer func,void *data) {
+    int i = 0;
+
+    if (numLoopTasks <= 0 || func == NULL) {
+        return;
+    }
+    //without workers, or with a single task, there is nothing to wake up the workers for
+    if (numWorkers == 0 || numLoopTasks == 1) {
+        for (i = 0; i < numLoopTasks; ++i) {
+            func(i,0,data);
+        }
+        return;
+    }
+
+    SDL_LockMutex(mutex);
+    taskFunc = func;
+    taskData = data;
+    numTasks = numLoopTasks;
+    SDL_AtomicSet(&nextTask,0);
+    numBusyWorkers = numWorkers;
+    loopNumber++;
+    SDL_CondBroadcast(workCond);
+    SDL_UnlockMutex(mutex);
+
+    runTasks(0);
+
+    //wait for the tasks the workers took
+    SDL_LockMutex(mutex);
+    while (numBusyWorkers > 0) {
+        SDL_CondWait(doneCond,mutex);
+    }
+    SDL_UnlockMutex(mutex);
+}
+
+static void runTasks(int threadIndex) {
+    int task = 0;
+
+    while ((task = SDL_AtomicAdd(&nextTask,1)) < numTasks) {
+        taskFunc(task,threadIndex,taskData);
+    }
+}
+
+static int workerMain(void *data) {
+    int threadIndex = (int)(intptr_t)data;
+    //the workers are started before the first loop
+    Uint32 lastLoop = 0;
+
+    SDL_LockMutex(mutex);
+    while (1) {
+        while (!quitWorkers && loopNumber == lastLoop) {
+            SDL_CondWait(workCond,mutex);
+        }
+        if (quitWorkers) {
+            break;
+        }
+        lastLoop = loopNumber;
+        SDL_UnlockMutex(mutex);
+
+        runTasks(threadIndex);
+
+        SDL_LockMutex(mutex);
+        numBusyWorkers--;
+        if (numBusyWorkers == 0) {
+            SDL_CondSignal(doneCond);
+        }
+    }
+    SDL_UnlockMutex(mutex);
+    return 0;
+}
@@ -0,0 +1,19 @@
+#ifndef __THREADPOOL_H
+#define __THREADPOOL_H
+
+#include <SDL2/SDL.h>
+
+//runs one task. threadIndex is 0 for the calling thread and 1 - ThreadPool_GetNumThreads()-1 for the workers,
+//so the task can use data that belongs to the thread without locking
+typedef void (*threadPoolTaskFuncPointer)(int taskIndex,int threadIndex,void *data);
+
+//A set of worker threads that run the tasks of a parallel loop together with the thread that started the loop.
+//The tasks are handed out one at a time, so a thread that finishes early takes the next one. Only one thread at a
+//time may start a loop, the game loop and the simulation thread only start them while they hold the scene, and a
+//task may not start a loop of its own
+int ThreadPool_Start(int numThreads);
+void ThreadPool_Stop();
+[[nodiscard]] int ThreadPool_GetNumThreads();
+void ThreadPool_ParallelFor(int numTasks,threadPoolTaskFuncPointer func,void *data);
+
+#endif // __THREADPOOL_H
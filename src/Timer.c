@@ -1,16 +1,17 @@
 #include <SDL2/SDL.h>
 #include "Timer.h"
+#include "DeltaTimer.h"
 
 //this function initializes the timer and set how long it shall wait in milliseconds
 void Timer_Init(Timer *timer,int ms) {
-    timer->timeLog = SDL_GetTicks();
+    timer->timeLog = DeltaTimer_GetTicks();
     timer->timeDuration = ms;
 }
 
 //this function updates the timer and resets it when it comes to its end.
 int Timer_Update(Timer *timer) {
     //get current time
-    timer->currentTime = SDL_GetTicks();
+    timer->currentTime = DeltaTimer_GetTicks();
 
     //if the timer has passed its duration
     if (timer->currentTime >= timer->timeLog + timer->timeDuration) {
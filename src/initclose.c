@@ -4,10 +4,16 @@
 #include <stdlib.h>
 #include "initclose.h"
 #include "renderer.h"
+#include "TextureAtlas.h"
 #include "logger.h"
+#include "ThreadPool.h"
 
-void initSDL(char *windowName) {
+void initSDL(char *windowName,int headless) {
     
+    //without a window, SDL does not need a display. The SDL_VIDEODRIVER environment variable still wins
+    if (headless) {
+        SDL_SetHint(SDL_HINT_VIDEODRIVER,"dummy");
+    }
     if (SDL_Init(SDL_INIT_VIDEO)< 0) {
         WriteError("Could not initialize SDL! SDL Error:%s",SDL_GetError());
         exit(1);
@@ -20,7 +26,10 @@ void initSDL(char *windowName) {
         WriteWarning("Linear texture filtering was not enabled!");
     }*/
 
-    initRenderer(windowName);
+    initRenderer(windowName,headless);
+
+    //one thread for every CPU core, the systems split their work over them
+    ThreadPool_Start(0);
 
     if ( !(IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG)) {
         WriteError("Could not initialize SDL_Image!) SDL_image error:%s",IMG_GetError());
@@ -29,6 +38,9 @@ void initSDL(char *windowName) {
 }
 
 void closeDownSDL() {
+    //the atlas pages are destroyed through the render queue, so it has to be done before the renderer is closed
+    TextureAtlas_Free();
+    ThreadPool_Stop();
     closeRenderer();
     IMG_Quit();
     SDL_Quit();
@@ -1,7 +1,7 @@
 #ifndef __INIT_CLOSE_H
 #define __INIT_CLOSE_H
 
-void initSDL(char *windowName);
+void initSDL(char *windowName,int headless);
 
 void closeDownSDL();
 
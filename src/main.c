@@ -2,18 +2,23 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
-#include <time.h>
 #include "initclose.h"
 #include "renderer.h"
 #include "Texture.h"
 #include "TexturePool.h"
+#include "TextureAtlas.h"
 #include "IsoEngine/isoEngine.h"
+#include "IsoEngine/isoMapFile.h"
+#include "IsoEngine/isoRandom.h"
 #include "ECS/Scene/SceneManager.h"
 #include "logger.h"
 #include "FontPool.h"
+#include "Headless.h"
+#include "GameMap.h"
 
-#define MAP_HEIGHT 640
-#define MAP_WIDTH 640
+#define NUM_TREES 1000
+//set to 1 to give the trees a random velocity for testing, they are static colliders otherwise
+#define MOVING_TREES 0
 
 typedef struct Game {
     SceneManager *sceneManager;
@@ -54,22 +59,23 @@ static void updateComponentPointers(Scene *scene,int firstRun) {
     }
 }
 
-void init() {
-    srand(time(NULL));
+//returns 1 if the saved map was generated with the map settings and world generator the game uses now
+static int mapFileIsCurrent(IsoMap *isoMap) {
+    return isoMap->generatorVersion == ISO_MAP_GENERATOR_VERSION && isoMap->seed == MAP_SEED
+        && isoMap->terrainHeight == MAP_TERRAIN_HEIGHT && isoMap->mapWidth == MAP_WIDTH && isoMap->mapHeight == MAP_HEIGHT
+        && isoMap->numLayers == MAP_NUM_LAYERS;
+}
 
+void init() {
     int entity;
     int entityAnimation;
     int i = 0;
+    int chunkX = 0, chunkY = 0;
+    int numChunks = (MAP_WIDTH/ISO_MAP_CHUNK_SIZE) * (MAP_HEIGHT/ISO_MAP_CHUNK_SIZE);
+    IsoRandom random;
     
     SDL_Rect tmpRect;
-
-    // initialize SDL
-    LoggerInitialize();
-    LoggerWriteSeparator();
-
-#if DEBUG
-    LoggerSetLevel(LOG_DEBUG);
-#endif
+    Uint64 mapTimer = 0;
 
     //Create a new pool to hold all textures
     game.texturePool = TexturePool_New();
@@ -87,6 +93,12 @@ void init() {
         exit(-1);
     }
 
+    //pack the textures and fonts into the texture atlas, so the textures loaded below are regions in
+    //a few large pages, and sprites from different textures can be drawn in the same batch
+    TextureAtlas_AddDirectory("data/textures");
+    TextureAtlas_AddDirectory("data/fonts");
+    TextureAtlas_Build();
+
     ///Load the textures to the texture pool
     TexturePool_AddTexture(game.texturePool, "data/textures/isotiles.png");
     TexturePool_AddTexture(game.texturePool, "data/textures/character.png");
@@ -175,6 +187,8 @@ void init() {
     ComponentInputMouse_AddAction(inputMouse,entity,"rightButton",COMPONENT_INPUTMOUSE_ACTION_RIGHTBUTTON);
     ComponentInputMouse_AddAction(inputMouse,entity,"middleButton",COMPONENT_INPUTMOUSE_ACTION_MIDDLEBUTTON);
     ComponentInputKeyboard_AddAction(inputKeyboard,entity,"toggleGameMode",SDL_SCANCODE_SPACE);
+    ComponentInputKeyboard_AddAction(inputKeyboard,entity,"toggleMinimap",SDL_SCANCODE_M);
+    ComponentInputKeyboard_AddAction(inputKeyboard,entity,"togglePartialRedraw",SDL_SCANCODE_P);
 
     //activate the mouse input
     ComponentInputMouse_SetActiveState(inputMouse,entity,1);
@@ -208,6 +222,8 @@ void init() {
     ComponentInputKeyboard_AddAction(inputKeyboard,entity,"down",SDL_SCANCODE_S);
     ComponentInputKeyboard_AddAction(inputKeyboard,entity,"left",SDL_SCANCODE_A);
     ComponentInputKeyboard_AddAction(inputKeyboard,entity,"right",SDL_SCANCODE_D);
+    //a click sends the player along the flow field to the tile instead of along a path, until the key is pressed again
+    ComponentInputKeyboard_AddAction(inputKeyboard,entity,"toggleFlowField",SDL_SCANCODE_F);
 
     //enable the keyboard input for the player entity
     ComponentInputKeyboard_SetActiveState(inputKeyboard,entity,1);
@@ -217,7 +233,8 @@ void init() {
 
     //set the kind of collisions the entity will handle
     ComponentCollision_SetCollisionType(collision,entity,COLLISIONTYPE_WORLD_AND_ENTITY);
-    SetupRect(&tmpRect,0,0,8,8);
+    //the collision rectangle is in the world, around the feet of the player sprite
+    SetupRect(&tmpRect,46,11,8,8);
     ComponentCollision_SetCollisionRectangle(collision,entity,&tmpRect);
 
     //set the clip rectangle (forward frame of the character)
@@ -274,36 +291,60 @@ void init() {
 
     char msg[100];
     WriteDebug("Adding trees to scene...");
-    for (i = 0; i < 1000; ++i) {
-        //Add a tree entity to the scene
-        entity = Scene_AddEntityToScene(testScene,
-             COMPONENT_SET1_POSITION | COMPONENT_SET1_NAMETAG | COMPONENT_SET1_RENDER2D | COMPONENT_SET1_VELOCITY | COMPONENT_SET1_COLLISION);
-
-        //every time we add a new entity to the scene, we have to check if the component pointers should be updated
-        updateComponentPointers(testScene,0);
-
-        //give the tree a name
-        snprintf(msg, sizeof(msg), "tree %d",i);
-        ComponentNameTag_SetName(nameTag,entity,msg);
-
-        //set the tree start position
-        ComponentPosition_SetPosition(position,entity,rand()%MAP_WIDTH*32,rand()%MAP_HEIGHT*32);
-
-        // set random velocity for the tree for testing
-        ComponentVelocity_SetVelocity(velocity,entity,10+rand()%100,10+rand()%100);
-        ComponentVelocity_SetFriction(velocity,entity,0);
-
-        //move the tree offset y position up a bit
-        ComponentPosition_SetOffset(position,entity,0,-96);
-
-        //create the collision rectangle for the tree
-        SetupRect(&tmpRect,0,0,20,20);
-        ComponentCollision_SetCollisionRectangle(collision,entity,&tmpRect);
-
-        //set the texture to render
-        ComponentRender2D_SetTextureAndClipRect(render,entity,TexturePool_GetTexture(game.texturePool,"isotree.png"),NULL);
-        ComponentRender2D_SetLayer(render,entity,1);
+    //place the trees chunk by chunk. Every chunk has its own random numbers, so the
+    //trees in a chunk are always the same for the map seed
+    for (chunkY = 0; chunkY < MAP_HEIGHT/ISO_MAP_CHUNK_SIZE; ++chunkY) {
+        for (chunkX = 0; chunkX < MAP_WIDTH/ISO_MAP_CHUNK_SIZE; ++chunkX) {
+            isoRandomSeedChunk(&random,MAP_SEED,chunkX,chunkY);
+
+            //give the chunk a tree with a chance of NUM_TREES out of the number of chunks
+            if (isoRandomRange(&random,0,numChunks-1) >= NUM_TREES) {
+                continue;
+            }
+
+            //Add a tree entity to the scene
+            entity = Scene_AddEntityToScene(testScene,
+                 COMPONENT_SET1_POSITION | COMPONENT_SET1_NAMETAG | COMPONENT_SET1_RENDER2D | COMPONENT_SET1_COLLISION
+                 | (MOVING_TREES ? COMPONENT_SET1_VELOCITY : 0));
+
+            //every time we add a new entity to the scene, we have to check if the component pointers should be updated
+            updateComponentPointers(testScene,0);
+
+            //give the tree a name
+            snprintf(msg, sizeof(msg), "tree %d",i++);
+            ComponentNameTag_SetName(nameTag,entity,msg);
+
+            //set the tree start position somewhere in the chunk
+            ComponentPosition_SetPosition(position,entity,(chunkX*ISO_MAP_CHUNK_SIZE + isoRandomRange(&random,0,ISO_MAP_CHUNK_SIZE-1))*32,
+                                          (chunkY*ISO_MAP_CHUNK_SIZE + isoRandomRange(&random,0,ISO_MAP_CHUNK_SIZE-1))*32);
+
+            // set random velocity for the tree for testing
+            if (MOVING_TREES) {
+                ComponentVelocity_SetVelocity(velocity,entity,isoRandomRange(&random,10,109),isoRandomRange(&random,10,109));
+                ComponentVelocity_SetFriction(velocity,entity,0);
+            }
+            //the tree never moves, it is only put in the static broadphase of the collision system once
+            else {
+                ComponentCollision_SetBodyType(collision,entity,COLLISIONBODY_STATIC);
+            }
+
+            //move the tree offset y position up a bit
+            ComponentPosition_SetOffset(position,entity,0,-96);
+
+            //create the collision rectangle for the tree, in the world around the bottom of the trunk
+            SetupRect(&tmpRect,70,38,20,20);
+            ComponentCollision_SetCollisionRectangle(collision,entity,&tmpRect);
+
+            //set the texture to render
+            ComponentRender2D_SetTextureAndClipRect(render,entity,TexturePool_GetTexture(game.texturePool,"isotree.png"),NULL);
+            ComponentRender2D_SetLayer(render,entity,1);
+        }
     }
+    WriteDebug("Added %d trees",i);
+
+    //the trees are spread out over the map, so the spatial hash finds the collisions fastest.
+    //Use COLLISION_BROADPHASE_SWEEP_AND_PRUNE for scenes where many entities are close together
+    Scene_SetCollisionBroadphase(testScene,COLLISION_BROADPHASE_SPATIAL_HASH);
 
 /// -----------------------------------------------------------------------------------------------------------------
     //Setup the isometric engine
@@ -313,38 +354,82 @@ void init() {
         closeDownSDL();
         exit(1);
     }
-    //create an empty map
-    testScene->isoEngine->isoMap = isoMapCreateNewMap("Testmap",MAP_WIDTH,MAP_HEIGHT,2,64,1232,20);
-    if (testScene->isoEngine->isoMap == NULL) {
-        SceneManager_FreeSceneManager(game.sceneManager);
-        closeDownSDL();
-        exit(1);
+    //load the map from the map file if it has been saved before
+    mapTimer = SDL_GetPerformanceCounter();
+    testScene->isoEngine->isoMap = isoMapLoadFromFile(MAP_FILE);
+    if (testScene->isoEngine->isoMap != NULL && mapFileIsCurrent(testScene->isoEngine->isoMap) == 0) {
+        WriteWarning("%s was generated with generator version %d, seed %d and terrain height %d, generating the map again",MAP_FILE,
+                     testScene->isoEngine->isoMap->generatorVersion,testScene->isoEngine->isoMap->seed,testScene->isoEngine->isoMap->terrainHeight);
+        isoMapFreeMap(testScene->isoEngine->isoMap);
+        testScene->isoEngine->isoMap = NULL;
+    }
+    if (testScene->isoEngine->isoMap != NULL) {
+        WriteDebug("Loaded map %s in %.2f ms",MAP_FILE,(double)(SDL_GetPerformanceCounter()-mapTimer)*1000.0/SDL_GetPerformanceFrequency());
+
+        //load the isometric tile set the map was saved with from the texture pool
+        isoMapLoadTileSet(testScene->isoEngine->isoMap,TexturePool_GetTexture(game.texturePool,testScene->isoEngine->isoMap->tileSet->textureName),
+                          testScene->isoEngine->isoMap->tileSet->tileWidth,testScene->isoEngine->isoMap->tileSet->tileHeight);
+    } else {
+        //generate a new map
+        testScene->isoEngine->isoMap = isoMapCreateNewMap("Testmap",MAP_WIDTH,MAP_HEIGHT,MAP_NUM_LAYERS,MAP_TILE_SIZE,MAP_SEED,MAP_TERRAIN_HEIGHT);
+        if (testScene->isoEngine->isoMap == NULL) {
+            SceneManager_FreeSceneManager(game.sceneManager);
+            closeDownSDL();
+            exit(1);
+        }
+        WriteDebug("Generated map in %.2f ms",(double)(SDL_GetPerformanceCounter()-mapTimer)*1000.0/SDL_GetPerformanceFrequency());
+
+        //load the isometric tile set from the texture pool
+        isoMapLoadTileSet(testScene->isoEngine->isoMap,TexturePool_GetTexture(game.texturePool,"isotiles.png"),64,80);
+        isoMapSetTileSetName(testScene->isoEngine->isoMap,"isotiles.png");
+
+        //save the map so the next start can load it instead of generating it again
+        mapTimer = SDL_GetPerformanceCounter();
+        if (isoMapSaveToFile(testScene->isoEngine->isoMap,MAP_FILE) == 1) {
+            WriteDebug("Saved map %s in %.2f ms",MAP_FILE,(double)(SDL_GetPerformanceCounter()-mapTimer)*1000.0/SDL_GetPerformanceFrequency());
+        }
     }
-    //load the isometric tile set from the texture pool
-    isoMapLoadTileSet(testScene->isoEngine->isoMap,TexturePool_GetTexture(game.texturePool,"isotiles.png"),64,80);
 
     //set isometric game mode to focus at the selected entity
     IsoEngine_SetGameMode(testScene->isoEngine,GAME_MODE_OBJECT_FOCUS);
+    testScene->isoEngine->partialRedraw = Headless_GetOptions()->partialRedraw;
 }
 
 
 int main(int argc, char *argv[]) {
-    //get rid of compiler warnings for argc and argv
-    (void)argv;
-    (void)argc;
+    int numFramesFailed = 0;
+
+    LoggerInitialize();
+    LoggerWriteSeparator();
 
-    initSDL("Isometric Game");
+#if DEBUG
+    LoggerSetLevel(LOG_DEBUG);
+#endif
+
+    //--headless draws a number of frames without a window, see Headless.h
+    if (Headless_ParseArguments(argc,argv) == 0) {
+        return 1;
+    }
+
+    // initialize SDL
+    initSDL("Isometric Game",Headless_GetOptions()->enabled);
     init();
 
-    SDL_ShowCursor(0);
-    SDL_SetWindowGrab(getWindow(),SDL_TRUE);
-    SDL_WarpMouseInWindow(getWindow(),WINDOW_WIDTH/2,WINDOW_HEIGHT/2);
+    //a headless run has no window to grab the mouse in
+    if (getWindow() != NULL) {
+        SDL_ShowCursor(0);
+        SDL_SetWindowGrab(getWindow(),SDL_TRUE);
+        SDL_WarpMouseInWindow(getWindow(),WINDOW_WIDTH/2,WINDOW_HEIGHT/2);
+    }
 
     SceneManager_SetActiveScene(game.sceneManager, "testScene");
+    Headless_Start();
     SceneManager_RunActiveScene(game.sceneManager);
+    numFramesFailed = Headless_Finish();
     SceneManager_FreeSceneManager(game.sceneManager);
     TexturePool_Free(game.texturePool);
     FontPool_Free(game.fontPool);
     closeDownSDL();
-    return 0;
+    //a headless run fails when a frame did not match its golden image
+    return numFramesFailed > 0 ? 1 : 0;
 }
@@ -2,13 +2,29 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "renderer.h"
+#include "RenderQueue.h"
 #include "logger.h"
 
 static SDL_Window *window = NULL;
-static SDL_Renderer *renderer = NULL;
+//the surface the frames are drawn into when there is no window
+static SDL_Surface *frameSurface = NULL;
+
+//creates the window and the renderer. A headless renderer draws into a surface in memory instead of a window,
+//so it runs without a display and is not held back by vsync
+void initRenderer(char *windowCaption,int headless) {
+    if (headless) {
+        //no alpha channel, like a window, so the saved frames are not see-through where nothing was drawn
+        frameSurface = SDL_CreateRGBSurfaceWithFormat(0,WINDOW_WIDTH,WINDOW_HEIGHT,32,SDL_PIXELFORMAT_RGB888);
+        if (frameSurface == NULL) {
+            WriteError("Could not create the headless frame surface:%s",SDL_GetError());
+            exit(1);
+        }
+        if (RenderQueue_StartHeadless(frameSurface) == 0) {
+            exit(1);
+        }
+        return;
+    }
 
-void initRenderer(char *windowCaption) {
-    
     window = SDL_CreateWindow(windowCaption,SDL_WINDOWPOS_CENTERED,SDL_WINDOWPOS_CENTERED,
                               WINDOW_WIDTH,WINDOW_HEIGHT,SDL_WINDOW_RESIZABLE);
     if (window == NULL) {
@@ -16,22 +32,34 @@ void initRenderer(char *windowCaption) {
         exit(1);
     }
 
-    renderer = SDL_CreateRenderer(window,-1,SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE | SDL_RENDERER_PRESENTVSYNC);
-    if (renderer == NULL) {
-        WriteError("SDL_CreateRenderer failed:%s",SDL_GetError());
+    //the renderer is created by the render queue, on this thread
+    if (RenderQueue_Start(window) == 0) {
         exit(1);
     }
 }
 
+//only the main thread may use the renderer, and everything draws with the render queue
 SDL_Renderer *getRenderer() {
-    return renderer;
+    return RenderQueue_GetRenderer();
 }
 
+//NULL when the renderer is headless
 SDL_Window *getWindow() {
     return window;
 }
 
+//the surface a headless renderer draws into, NULL when drawing to a window.
+//It holds the last frame that was presented
+SDL_Surface *getFrameSurface() {
+    return frameSurface;
+}
+
 void closeRenderer() {
-    SDL_DestroyRenderer(renderer);
-    SDL_DestroyWindow(window);
+    RenderQueue_Stop();
+    if (window != NULL) {
+        SDL_DestroyWindow(window);
+        window = NULL;
+    }
+    SDL_FreeSurface(frameSurface);
+    frameSurface = NULL;
 }
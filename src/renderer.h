@@ -4,9 +4,10 @@
 #define WINDOW_WIDTH     1280
 #define WINDOW_HEIGHT    720
 
-void initRenderer(char *windowCaption);
+void initRenderer(char *windowCaption,int headless);
 [[nodiscard]] SDL_Renderer *getRenderer();
 [[nodiscard]] SDL_Window *getWindow();
+[[nodiscard]] SDL_Surface *getFrameSurface();
 void closeRenderer();
 
 
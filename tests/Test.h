@@ -0,0 +1,41 @@
+#ifndef __TEST_H
+#define __TEST_H
+
+#include <stdio.h>
+#include "logger.h"
+
+//the test programs are run from the project directory, and write their files next to them in the build directory
+#define TEST_OUTPUT_DIR "build/tests"
+
+//number of checks that failed in the test program
+static int testNumFailed = 0;
+
+//checks a condition and reports where it failed. The test keeps running, so one run shows every failure
+#define TEST_CHECK(condition,message, ...) do { \
+    if (!(condition)) { \
+        testNumFailed++; \
+        printf("%s:%d: check '%s' failed: " message "\n",__FILE__,__LINE__,#condition,##__VA_ARGS__); \
+    } \
+} while (0)
+
+//sends the log to a file in the output directory, so only the test results are printed
+static inline void Test_Init(const char *testName) {
+    LoggerSetDirectory(TEST_OUTPUT_DIR);
+    LoggerSetFilename(testName);
+    LoggerSetExtension("log");
+    LoggerSetLevel(LOG_WARNING);
+    LoggerSetRepeatInStdout(0);
+    LoggerSetTimeStamp(0);
+}
+
+//prints the result and returns the exit code of the test program
+static inline int Test_Finish(const char *testName) {
+    if (testNumFailed > 0) {
+        printf("%s: %d checks failed\n",testName,testNumFailed);
+        return 1;
+    }
+    printf("%s: passed\n",testName);
+    return 0;
+}
+
+#endif // __TEST_H
@@ -0,0 +1,185 @@
+#include <stdio.h>
+#include <string.h>
+#include "Test.h"
+#include "ECS/Spatial/AABBBatch.h"
+#include "IsoEngine/isoRandom.h"
+
+#define TEST_NAME "TestAABBBatch"
+
+//the largest number of boxes in a batch. Every count up to it is tested, so every number of left over boxes
+//after the groups of 4 is covered, and the hit masks use more than one word
+#define MAX_TEST_BOXES  70
+#define NUM_ROUNDS      200
+
+//boxes that only touch do not overlap. Written out here, so the test does not depend on the code it tests
+static int boxesOverlap(SDL_FRect *a,SDL_FRect *b) {
+    return a->x < b->x + b->w && b->x < a->x + a->w && a->y < b->y + b->h && b->y < a->y + a->h;
+}
+
+//a box on a coarse grid, so boxes often share edges, and often have no width or height
+static void randomBox(Uint32 round,Uint32 index,SDL_FRect *box) {
+    Uint32 hash = isoRandomHash3(round,index,7);
+
+    box->x = (float)((int)(hash & 7) - 3);
+    box->y = (float)((int)((hash >> 3) & 7) - 3);
+    box->w = (float)((hash >> 6) % 4);
+    box->h = (float)((hash >> 8) % 4);
+}
+
+//returns 1 if the hit masks have the same bits for the first numBoxes boxes, and no bits after them
+static int sameHitMask(Uint32 *hitMask,Uint32 *expected,Uint32 numBoxes) {
+    return memcmp(hitMask,expected,sizeof(Uint32)*((numBoxes+31)/32)) == 0;
+}
+
+//tests one box against batches of every size. The SSE2 and the scalar test have to find the same boxes
+static void testOverlap() {
+    AABBBatch *batch = AABBBatch_New();
+    SDL_FRect boxes[MAX_TEST_BOXES];
+    SDL_FRect box;
+    Uint32 expected[(MAX_TEST_BOXES+31)/32];
+    Uint32 round = 0, numBoxes = 0, i = 0;
+    int numExpected = 0, numHits = 0, numScalarHits = 0;
+    int numMismatches = 0, numOverlaps = 0;
+
+    TEST_CHECK(batch != NULL,"could not create the batch");
+    if (batch == NULL) {
+        return;
+    }
+    for (round = 0; round < NUM_ROUNDS; ++round) {
+        randomBox(round,MAX_TEST_BOXES,&box);
+        for (numBoxes = 0; numBoxes <= MAX_TEST_BOXES; ++numBoxes) {
+            AABBBatch_Clear(batch);
+            memset(expected,0,sizeof(expected));
+            numExpected = 0;
+            for (i = 0; i < numBoxes; ++i) {
+                randomBox(round,i,&boxes[i]);
+                AABBBatch_Add(batch,i,&boxes[i]);
+                if (boxesOverlap(&box,&boxes[i])) {
+                    expected[i/32] |= 1u << (i%32);
+                    numExpected++;
+                }
+            }
+            numOverlaps += numExpected;
+
+            numHits = AABBBatch_Overlap(batch,&box);
+            if ((numHits != numExpected || !sameHitMask(batch->hitMask,expected,numBoxes)) && numMismatches++ == 0) {
+                printf("%s: round %u with %u boxes: AABBBatch_Overlap() found %d overlaps, expected %d\n",TEST_NAME,round,numBoxes,numHits,numExpected);
+            }
+            numScalarHits = AABBBatch_OverlapScalar(batch,&box);
+            if ((numScalarHits != numExpected || !sameHitMask(batch->hitMask,expected,numBoxes)) && numMismatches++ == 0) {
+                printf("%s: round %u with %u boxes: AABBBatch_OverlapScalar() found %d overlaps, expected %d\n",TEST_NAME,round,numBoxes,numScalarHits,numExpected);
+            }
+        }
+    }
+    TEST_CHECK(numMismatches == 0,"%d box tests did not find the expected overlaps",numMismatches);
+    TEST_CHECK(numOverlaps > 0,"the random boxes never overlap, so the test proves nothing");
+    AABBBatch_Free(batch);
+}
+
+//tests pairs of boxes in batches of every size, where batch B can have more or fewer boxes than batch A
+static void testOverlapPairs() {
+    AABBBatch *batchA = AABBBatch_New();
+    AABBBatch *batchB = AABBBatch_New();
+    SDL_FRect boxA, boxB;
+    Uint32 expected[(MAX_TEST_BOXES+31)/32];
+    Uint32 round = 0, numBoxes = 0, numBoxesB = 0, i = 0;
+    int numExpected = 0, numHits = 0, numScalarHits = 0;
+    int numMismatches = 0;
+
+    TEST_CHECK(batchA != NULL && batchB != NULL,"could not create the batches");
+    if (batchA == NULL || batchB == NULL) {
+        AABBBatch_Free(batchA);
+        AABBBatch_Free(batchB);
+        return;
+    }
+    for (round = 0; round < NUM_ROUNDS; ++round) {
+        for (numBoxes = 0; numBoxes <= MAX_TEST_BOXES; ++numBoxes) {
+            numBoxesB = (numBoxes + round) % (MAX_TEST_BOXES+1);
+            AABBBatch_Clear(batchA);
+            AABBBatch_Clear(batchB);
+            memset(expected,0,sizeof(expected));
+            numExpected = 0;
+            for (i = 0; i < numBoxes || i < numBoxesB; ++i) {
+                randomBox(round,i,&boxA);
+                randomBox(round + NUM_ROUNDS,i,&boxB);
+                if (i < numBoxes) {
+                    AABBBatch_Add(batchA,i,&boxA);
+                }
+                if (i < numBoxesB) {
+                    AABBBatch_Add(batchB,i,&boxB);
+                }
+                //only the boxes both batches have are pairs
+                if (i < numBoxes && i < numBoxesB && boxesOverlap(&boxA,&boxB)) {
+                    expected[i/32] |= 1u << (i%32);
+                    numExpected++;
+                }
+            }
+
+            numHits = AABBBatch_OverlapPairs(batchA,batchB);
+            if ((numHits != numExpected || !sameHitMask(batchA->hitMask,expected,numBoxes)) && numMismatches++ == 0) {
+                printf("%s: round %u with %u and %u boxes: AABBBatch_OverlapPairs() found %d overlaps, expected %d\n",TEST_NAME,
+                       round,numBoxes,numBoxesB,numHits,numExpected);
+            }
+            numScalarHits = AABBBatch_OverlapPairsScalar(batchA,batchB);
+            if ((numScalarHits != numExpected || !sameHitMask(batchA->hitMask,expected,numBoxes)) && numMismatches++ == 0) {
+                printf("%s: round %u with %u and %u boxes: AABBBatch_OverlapPairsScalar() found %d overlaps, expected %d\n",TEST_NAME,
+                       round,numBoxes,numBoxesB,numScalarHits,numExpected);
+            }
+        }
+    }
+    TEST_CHECK(numMismatches == 0,"%d pair tests did not find the expected overlaps",numMismatches);
+    AABBBatch_Free(batchA);
+    AABBBatch_Free(batchB);
+}
+
+//boxes that touch, and boxes without a size, in the SIMD lanes and in the left over boxes
+static void testEdgeCases() {
+    //box 0-3 are tested 4 at a time, box 4 and 5 are left over
+    SDL_FRect boxes[] = {
+        {10,0,10,10},       //touches the right edge
+        {0,10,10,10},       //touches the bottom edge
+        {5,5,0,0},          //a point inside
+        {10,10,0,0},        //a point on the corner
+        {-10,0,10,10},      //touches the left edge
+        {2,-5,0,20},        //a line through the box
+    };
+    int expectedHits[] = {0,0,1,0,0,1};
+    SDL_FRect box = {0,0,10,10};
+    SDL_FRect point = {5,5,0,0};
+    AABBBatch *batch = AABBBatch_New();
+    int numBoxes = (int)(sizeof(boxes)/sizeof(boxes[0]));
+    int i = 0, hit = 0, scalarHit = 0;
+
+    TEST_CHECK(batch != NULL,"could not create the batch");
+    if (batch == NULL) {
+        return;
+    }
+    for (i = 0; i < numBoxes; ++i) {
+        AABBBatch_Add(batch,i,&boxes[i]);
+    }
+    TEST_CHECK(AABBBatch_Overlap(batch,&box) == 2,"the box overlaps %d boxes, expected 2",AABBBatch_Overlap(batch,&box));
+    for (i = 0; i < numBoxes; ++i) {
+        AABBBatch_Overlap(batch,&box);
+        hit = (batch->hitMask[0] >> i) & 1;
+        AABBBatch_OverlapScalar(batch,&box);
+        scalarHit = (batch->hitMask[0] >> i) & 1;
+        TEST_CHECK(hit == expectedHits[i] && scalarHit == expectedHits[i],"box %d overlaps %d with SSE2 and %d without, expected %d",
+                   i,hit,scalarHit,expectedHits[i]);
+    }
+
+    //two points in the same place have no area in common
+    AABBBatch_Clear(batch);
+    for (i = 0; i < 5; ++i) {
+        AABBBatch_Add(batch,i,&point);
+    }
+    TEST_CHECK(AABBBatch_Overlap(batch,&point) == 0 && AABBBatch_OverlapScalar(batch,&point) == 0,"a point overlaps itself");
+    AABBBatch_Free(batch);
+}
+
+int main() {
+    Test_Init(TEST_NAME);
+    testOverlap();
+    testOverlapPairs();
+    testEdgeCases();
+    return Test_Finish(TEST_NAME);
+}
@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "Test.h"
+#include "IsoEngine/isoMap.h"
+#include "IsoEngine/isoPathfinder.h"
+#include "IsoEngine/isoFlowField.h"
+#include "ECS/Components/ComponentVelocity.h"
+
+#define TEST_NAME "TestFlowField"
+#define MAP_WIDTH 96
+#define MAP_HEIGHT 80
+#define TILE_SIZE 64
+#define WALK_SPEED 100.0f
+//the time of one frame of the walk, and the most frames it can take
+#define FRAME_TIME (1.0f/60.0f)
+#define MAX_FRAMES 100000
+
+//walks an entity from the middle of the start tile the way the move system does: the velocity is set from the tile the
+//entity stands on every frame, until it is handed back. The tiles it stands on are written to tiles.
+//Returns the number of tiles, and the number of tiles that can not be walked on in numUnwalkable
+static int walkFlowField(ComponentVelocity *velocity,IsoFlowFieldCache *flowFields,IsoPathfinder *pathfinder,IsoMap *isoMap,
+                         int startX,int startY,int goalX,int goalY,SDL_Point *tiles,int maxTiles,int *numUnwalkable) {
+    float x = (startX + 0.5f)*TILE_SIZE;
+    float y = (startY + 0.5f)*TILE_SIZE;
+    int tileX = startX, tileY = startY;
+    int numTiles = 0;
+    int frame = 0;
+
+    *numUnwalkable = 0;
+    ComponentVelocity_FollowFlowField(velocity,0,goalX,goalY,WALK_SPEED);
+    for (frame = 0; frame < MAX_FRAMES && numTiles < maxTiles; ++frame) {
+        tileX = (int)(x/TILE_SIZE);
+        tileY = (int)(y/TILE_SIZE);
+        if (numTiles == 0 || tiles[numTiles-1].x != tileX || tiles[numTiles-1].y != tileY) {
+            tiles[numTiles].x = tileX;
+            tiles[numTiles].y = tileY;
+            numTiles++;
+            if (!isoMapTileIsWalkable(isoMap,tileX,tileY)) {
+                (*numUnwalkable)++;
+            }
+        }
+        if (!ComponentVelocity_SteerAlongFlowField(velocity,0,flowFields,pathfinder,tileX,tileY)) {
+            break;
+        }
+        x += velocity[0].x*FRAME_TIME;
+        y += velocity[0].y*FRAME_TIME;
+    }
+    return numTiles;
+}
+
+int main() {
+    IsoMap *isoMap = NULL;
+    IsoPathfinder *pathfinder = NULL;
+    IsoFlowFieldCache *flowFields = NULL;
+    ComponentVelocity velocity[1] = {{0}};
+    SDL_Point *tiles = NULL;
+    SDL_Point *blockedTiles = NULL;
+    int numTiles = 0, numBlockedTiles = 0, numUnwalkable = 0;
+    int startX = 2, startY = 2, goalX = MAP_WIDTH-3, goalY = MAP_HEIGHT-3;
+    int i = 0;
+
+    Test_Init(TEST_NAME);
+    isoMap = isoMapCreateNewMap("Flow field",MAP_WIDTH,MAP_HEIGHT,2,TILE_SIZE,1232,20);
+    tiles = malloc(sizeof(SDL_Point)*MAP_WIDTH*MAP_HEIGHT);
+    blockedTiles = malloc(sizeof(SDL_Point)*MAP_WIDTH*MAP_HEIGHT);
+    if (isoMap == NULL || tiles == NULL || blockedTiles == NULL) {
+        printf("%s: could not create the map\n",TEST_NAME);
+        return 1;
+    }
+    pathfinder = isoPathfinderNew(isoMap);
+    flowFields = pathfinder != NULL ? isoFlowFieldCacheNew(pathfinder) : NULL;
+    TEST_CHECK(pathfinder != NULL && flowFields != NULL,"could not create the pathfinder and the flow fields");
+    if (pathfinder == NULL || flowFields == NULL) {
+        return Test_Finish(TEST_NAME);
+    }
+
+    //an entity sent to a tile walks across the map to it, next to the edges and the tiles that block
+    numTiles = walkFlowField(velocity,flowFields,pathfinder,isoMap,startX,startY,goalX,goalY,tiles,MAP_WIDTH*MAP_HEIGHT,&numUnwalkable);
+    TEST_CHECK(numTiles > 0 && tiles[numTiles-1].x == goalX && tiles[numTiles-1].y == goalY,"the entity stopped at %d,%d, expected %d,%d",
+               tiles[numTiles-1].x,tiles[numTiles-1].y,goalX,goalY);
+    TEST_CHECK(numUnwalkable == 0,"the entity walked on %d tiles that can not be walked on",numUnwalkable);
+    TEST_CHECK(velocity[0].mode == COMPONENT_VELOCITY_MODE_FREE && velocity[0].x == 0 && velocity[0].y == 0,
+               "the entity on the goal still walks along the flow field");
+
+    //static bodies on the middle of the way, like trees, make the entity go around them once the pathfinder knows of them
+    for (i = numTiles/3; i < numTiles*2/3; ++i) {
+        isoMapSetTileFlags(isoMap,tiles[i].x,tiles[i].y,isoMapGetTileFlags(isoMap,tiles[i].x,tiles[i].y) | ISO_TILE_FLAG_OCCUPIED);
+    }
+    isoPathfinderUpdate(pathfinder,isoMap);
+    numBlockedTiles = walkFlowField(velocity,flowFields,pathfinder,isoMap,startX,startY,goalX,goalY,blockedTiles,MAP_WIDTH*MAP_HEIGHT,&numUnwalkable);
+    TEST_CHECK(numBlockedTiles > 0 && blockedTiles[numBlockedTiles-1].x == goalX && blockedTiles[numBlockedTiles-1].y == goalY,
+               "the entity did not get around the static bodies, it stopped at %d,%d",blockedTiles[numBlockedTiles-1].x,blockedTiles[numBlockedTiles-1].y);
+    TEST_CHECK(numUnwalkable == 0,"the entity walked on %d tiles with static bodies on them",numUnwalkable);
+
+    //a goal that can not be walked on stops the entity where it is
+    numBlockedTiles = walkFlowField(velocity,flowFields,pathfinder,isoMap,startX,startY,tiles[numTiles/2].x,tiles[numTiles/2].y,
+                                    blockedTiles,MAP_WIDTH*MAP_HEIGHT,&numUnwalkable);
+    TEST_CHECK(numBlockedTiles == 1 && velocity[0].mode == COMPONENT_VELOCITY_MODE_FREE,"the entity walks to a tile with a static body on it");
+
+    //an entity the game takes the velocity back from is not steered any more
+    ComponentVelocity_FollowFlowField(velocity,0,goalX,goalY,WALK_SPEED);
+    ComponentVelocity_StopFlowField(velocity,0);
+    velocity[0].x = 0;
+    velocity[0].y = 0;
+    TEST_CHECK(ComponentVelocity_SteerAlongFlowField(velocity,0,flowFields,pathfinder,startX,startY) == 0 && velocity[0].x == 0 && velocity[0].y == 0,
+               "an entity that stopped following the flow field is still steered");
+
+    isoFlowFieldCacheFree(flowFields);
+    isoPathfinderFree(pathfinder);
+    isoMapFreeMap(isoMap);
+    free(tiles);
+    free(blockedTiles);
+    return Test_Finish(TEST_NAME);
+}
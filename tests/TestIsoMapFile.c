@@ -0,0 +1,279 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Test.h"
+#include "IsoEngine/isoMap.h"
+#include "IsoEngine/isoMapFile.h"
+#include "IsoEngine/isoRandom.h"
+
+#define TEST_NAME "TestIsoMapFile"
+//where the offset of the chunk table is written in the header of the file
+#define CHUNK_TABLE_OFFSET_FIELD 152
+
+//saves the map, loads it again and checks that every tile, terrain height and tile flag came back unchanged
+static void testRoundTrip(IsoMap *isoMap,char *fileName) {
+    IsoMap *loadedMap = NULL;
+    int x = 0, y = 0, layer = 0;
+    int numMismatches = 0;
+    int firstX = 0, firstY = 0, firstLayer = 0;
+
+    TEST_CHECK(isoMapSaveToFile(isoMap,fileName) == 1,"could not save %s",fileName);
+    loadedMap = isoMapLoadFromFile(fileName);
+    TEST_CHECK(loadedMap != NULL,"could not load %s",fileName);
+    if (loadedMap == NULL) {
+        return;
+    }
+
+    TEST_CHECK(loadedMap->mapWidth == isoMap->mapWidth && loadedMap->mapHeight == isoMap->mapHeight,
+               "map size %dx%d, expected %dx%d",loadedMap->mapWidth,loadedMap->mapHeight,isoMap->mapWidth,isoMap->mapHeight);
+    TEST_CHECK(loadedMap->numLayers == isoMap->numLayers,"%d layers, expected %d",loadedMap->numLayers,isoMap->numLayers);
+    TEST_CHECK(loadedMap->tileSize == isoMap->tileSize,"tile size %d, expected %d",loadedMap->tileSize,isoMap->tileSize);
+    TEST_CHECK(strcmp(loadedMap->name,isoMap->name) == 0,"map name '%s', expected '%s'",loadedMap->name,isoMap->name);
+    TEST_CHECK(strcmp(loadedMap->tileSet->textureName,isoMap->tileSet->textureName) == 0,"tile set name '%s', expected '%s'",
+               loadedMap->tileSet->textureName,isoMap->tileSet->textureName);
+    TEST_CHECK(loadedMap->tileSet->tileWidth == isoMap->tileSet->tileWidth && loadedMap->tileSet->tileHeight == isoMap->tileSet->tileHeight,
+               "tile set tile size %dx%d, expected %dx%d",loadedMap->tileSet->tileWidth,loadedMap->tileSet->tileHeight,
+               isoMap->tileSet->tileWidth,isoMap->tileSet->tileHeight);
+    if (loadedMap->mapWidth != isoMap->mapWidth || loadedMap->mapHeight != isoMap->mapHeight || loadedMap->numLayers != isoMap->numLayers) {
+        isoMapFreeMap(loadedMap);
+        return;
+    }
+
+    //every plane is compared in full, and the first tile that differs is reported
+    for (y = 0; y < isoMap->mapHeight; ++y) {
+        for (x = 0; x < isoMap->mapWidth; ++x) {
+            for (layer = 0; layer < isoMap->numLayers; ++layer) {
+                if (isoMapGetTile(loadedMap,x,y,layer) != isoMapGetTile(isoMap,x,y,layer) && numMismatches++ == 0) {
+                    firstX = x;
+                    firstY = y;
+                    firstLayer = layer;
+                }
+            }
+        }
+    }
+    TEST_CHECK(numMismatches == 0,"%d tiles differ in %s, the first is %d,%d on layer %d",numMismatches,fileName,firstX,firstY,firstLayer);
+
+    numMismatches = 0;
+    for (y = 0; y < isoMap->mapHeight; ++y) {
+        for (x = 0; x < isoMap->mapWidth; ++x) {
+            if (isoMapGetTerrainHeight(loadedMap,x,y) != isoMapGetTerrainHeight(isoMap,x,y) && numMismatches++ == 0) {
+                firstX = x;
+                firstY = y;
+            }
+        }
+    }
+    TEST_CHECK(numMismatches == 0,"%d terrain heights differ in %s, the first is %d,%d",numMismatches,fileName,firstX,firstY);
+
+    numMismatches = 0;
+    for (y = 0; y < isoMap->mapHeight; ++y) {
+        for (x = 0; x < isoMap->mapWidth; ++x) {
+            if (isoMapGetTileFlags(loadedMap,x,y) != isoMapGetTileFlags(isoMap,x,y) && numMismatches++ == 0) {
+                firstX = x;
+                firstY = y;
+            }
+        }
+    }
+    TEST_CHECK(numMismatches == 0,"%d tile flags differ in %s, the first is %d,%d",numMismatches,fileName,firstX,firstY);
+
+    isoMapFreeMap(loadedMap);
+}
+
+//a generated map, with a size that is not a multiple of the chunk size, so the last chunks are only partly used
+static void testGeneratedMap() {
+    IsoMap *isoMap = NULL;
+    int x = 0, y = 0;
+
+    isoMap = isoMapCreateNewMap("Round trip",100,70,2,64,1232,20);
+    TEST_CHECK(isoMap != NULL,"could not generate the map");
+    if (isoMap == NULL) {
+        return;
+    }
+    isoMapSetTileSetName(isoMap,"isotiles.png");
+    isoMap->tileSet->tileWidth = 64;
+    isoMap->tileSet->tileHeight = 80;
+
+    //flags that change from tile to tile, so the flag plane does not compress into a single run.
+    //The occupied flag is left out, it is never saved
+    for (y = 0; y < isoMap->mapHeight; ++y) {
+        for (x = 0; x < isoMap->mapWidth; ++x) {
+            isoMapSetTileFlags(isoMap,x,y,(Uint8)(isoRandomHash3(x,y,1) & 0xff & ~ISO_TILE_FLAG_OCCUPIED));
+        }
+    }
+    //noise in the first chunk, so it is stored uncompressed and used straight from the mapped file
+    for (y = 0; y < ISO_MAP_CHUNK_SIZE; ++y) {
+        for (x = 0; x < ISO_MAP_CHUNK_SIZE; ++x) {
+            isoMapSetTile(isoMap,x,y,0,(int)(isoRandomHash3(x,y,2) % 200));
+            isoMapSetTile(isoMap,x,y,1,(int)(isoRandomHash3(x,y,3) % 200) - 1);
+        }
+    }
+    testRoundTrip(isoMap,TEST_OUTPUT_DIR "/generated.isomap");
+
+    //names as long as they can be have to come back whole. The tile set name fills its field in the header
+    memset(isoMap->name,'n',MAP_NAME_LENGTH-1);
+    isoMap->name[MAP_NAME_LENGTH-1] = '\0';
+    memset(isoMap->tileSet->textureName,'t',TILESET_NAME_LENGTH-1);
+    isoMap->tileSet->textureName[TILESET_NAME_LENGTH-1] = '\0';
+    testRoundTrip(isoMap,TEST_OUTPUT_DIR "/longname.isomap");
+    isoMapFreeMap(isoMap);
+}
+
+//a map where most chunks were never written to, so they are saved as empty chunks
+static void testSparseMap() {
+    IsoMap *isoMap = NULL;
+
+    isoMap = isoMapCreateEmptyMap("Sparse",40,40,3,64);
+    TEST_CHECK(isoMap != NULL,"could not create the map");
+    if (isoMap == NULL) {
+        return;
+    }
+    isoMapSetTile(isoMap,20,20,0,5);
+    isoMapSetTile(isoMap,20,20,2,7);
+    isoMapSetTileFlags(isoMap,39,39,ISO_TILE_FLAG_BLOCKING);
+    testRoundTrip(isoMap,TEST_OUTPUT_DIR "/sparse.isomap");
+    isoMapFreeMap(isoMap);
+}
+
+//the static bodies on the map are not saved with it
+static void testOccupiedNotSaved() {
+    IsoMap *isoMap = NULL;
+    IsoMap *loadedMap = NULL;
+    char *fileName = TEST_OUTPUT_DIR "/occupied.isomap";
+
+    isoMap = isoMapCreateEmptyMap("Occupied",20,20,1,64);
+    TEST_CHECK(isoMap != NULL,"could not create the map");
+    if (isoMap == NULL) {
+        return;
+    }
+    isoMapSetTile(isoMap,5,5,0,1);
+    isoMapSetTileFlags(isoMap,5,5,ISO_TILE_FLAG_OCCUPIED | 0x40);
+    TEST_CHECK(isoMapTileIsWalkable(isoMap,5,5) == 0,"a tile with a static body on it can be walked on");
+    TEST_CHECK(isoMapSaveToFile(isoMap,fileName) == 1,"could not save %s",fileName);
+    TEST_CHECK(isoMapGetTileFlags(isoMap,5,5) == (ISO_TILE_FLAG_OCCUPIED | 0x40),"saving the map changed the flags to %d",
+               isoMapGetTileFlags(isoMap,5,5));
+    loadedMap = isoMapLoadFromFile(fileName);
+    TEST_CHECK(loadedMap != NULL,"could not load %s",fileName);
+    if (loadedMap != NULL) {
+        TEST_CHECK(isoMapGetTileFlags(loadedMap,5,5) == 0x40,"the loaded tile has flags %d, expected %d",isoMapGetTileFlags(loadedMap,5,5),0x40);
+        TEST_CHECK(isoMapTileIsWalkable(loadedMap,5,5) == 1,"the loaded tile can not be walked on");
+        isoMapFreeMap(loadedMap);
+    }
+    isoMapFreeMap(isoMap);
+}
+
+//writes a little endian 64 bit value, the way the map file stores them
+static void putFileUint64(Uint8 *buffer,Uint64 value) {
+    int i = 0;
+
+    for (i = 0; i < 8; ++i) {
+        buffer[i] = (Uint8)(value >> (i*8));
+    }
+}
+
+//copies the file with the bytes at offset changed, and returns 1 if the map in the copy could be loaded
+static int loadChangedFile(Uint8 *data,long size,long offset,Uint8 *bytes,int numBytes,char *fileName) {
+    IsoMap *loadedMap = NULL;
+    Uint8 *copy = malloc(size);
+    FILE *file = NULL;
+
+    if (copy == NULL) {
+        return 0;
+    }
+    memcpy(copy,data,size);
+    memcpy(copy + offset,bytes,numBytes);
+    file = fopen(fileName,"wb");
+    if (file != NULL) {
+        fwrite(copy,1,size,file);
+        fclose(file);
+    }
+    free(copy);
+    loadedMap = isoMapLoadFromFile(fileName);
+    if (loadedMap == NULL) {
+        return 0;
+    }
+    isoMapFreeMap(loadedMap);
+    return 1;
+}
+
+//offsets near the end of the 64 bit range wrap around when sizes are added to them, the map has to be rejected anyway
+static void testCorruptChunkTable() {
+    IsoMap *isoMap = NULL;
+    char *fileName = TEST_OUTPUT_DIR "/corrupt.isomap";
+    char *changedFileName = TEST_OUTPUT_DIR "/corruptchanged.isomap";
+    Uint8 *data = NULL;
+    Uint8 bytes[12];
+    FILE *file = NULL;
+    long size = 0;
+
+    isoMap = isoMapCreateEmptyMap("Corrupt",40,40,1,64);
+    TEST_CHECK(isoMap != NULL,"could not create the map");
+    if (isoMap == NULL) {
+        return;
+    }
+    isoMapSetTile(isoMap,3,3,0,1);
+    TEST_CHECK(isoMapSaveToFile(isoMap,fileName) == 1,"could not save %s",fileName);
+    isoMapFreeMap(isoMap);
+    file = fopen(fileName,"rb");
+    if (file == NULL) {
+        TEST_CHECK(0,"could not open %s",fileName);
+        return;
+    }
+    fseek(file,0,SEEK_END);
+    size = ftell(file);
+    fseek(file,0,SEEK_SET);
+    data = malloc(size);
+    if (data == NULL || fread(data,1,size,file) != (size_t)size) {
+        TEST_CHECK(0,"could not read %s",fileName);
+        fclose(file);
+        free(data);
+        return;
+    }
+    fclose(file);
+
+    //the file loads when nothing is changed
+    putFileUint64(bytes,ISO_MAP_FILE_HEADER_SIZE);
+    TEST_CHECK(loadChangedFile(data,size,CHUNK_TABLE_OFFSET_FIELD,bytes,8,changedFileName) == 1,"the unchanged map file does not load");
+
+    //a chunk table that starts near the end of the range, so the end of the table wraps around to the start of the file
+    putFileUint64(bytes,(Uint64)0 - 8);
+    TEST_CHECK(loadChangedFile(data,size,CHUNK_TABLE_OFFSET_FIELD,bytes,8,changedFileName) == 0,"a map with the chunk table outside the file was loaded");
+
+    //an aligned chunk near the end of the range, that wraps around to the start of the file with the size of its tiles
+    putFileUint64(bytes,(Uint64)0 - 64);
+    bytes[8] = 128;
+    bytes[9] = 0;
+    bytes[10] = 0;
+    bytes[11] = 0;
+    TEST_CHECK(loadChangedFile(data,size,ISO_MAP_FILE_HEADER_SIZE,bytes,12,changedFileName) == 0,"a map with a chunk outside the file was loaded");
+    free(data);
+}
+
+//a file name too long for the temporary file is not cut short, the map would be saved under a different name
+static void testLongFileName() {
+    IsoMap *isoMap = NULL;
+    char fileName[511];
+    int length = 0;
+
+    isoMap = isoMapCreateEmptyMap("Long file name",20,20,1,64);
+    TEST_CHECK(isoMap != NULL,"could not create the map");
+    if (isoMap == NULL) {
+        return;
+    }
+    //a valid path that only has room for part of the .tmp ending
+    length = snprintf(fileName,sizeof(fileName),"%s/",TEST_OUTPUT_DIR);
+    while (length < (int)sizeof(fileName) - 1 - (int)strlen("long.isomap")) {
+        fileName[length++] = '/';
+    }
+    strcpy(fileName + length,"long.isomap");
+    TEST_CHECK(isoMapSaveToFile(isoMap,fileName) == -1,"the map was saved with a file name that does not fit");
+    isoMapFreeMap(isoMap);
+}
+
+int main() {
+    Test_Init(TEST_NAME);
+    testGeneratedMap();
+    testSparseMap();
+    testOccupiedNotSaved();
+    testCorruptChunkTable();
+    testLongFileName();
+    return Test_Finish(TEST_NAME);
+}
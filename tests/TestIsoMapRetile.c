@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "Test.h"
+#include "IsoEngine/isoMap.h"
+
+#define TEST_NAME "TestIsoMapRetile"
+#define MAP_WIDTH 96
+#define MAP_HEIGHT 80
+
+typedef struct TerrainEdit {
+    int x;
+    int y;
+    int radius;
+    int raise;
+} TerrainEdit;
+
+//raises and lowers the terrain in the middle of the map, next to the map edges and on top of earlier edits
+static const TerrainEdit terrainEdits[] = {
+    {30,30,2,1},
+    {50,40,1,0},
+    {2,3,3,1},
+    {70,60,2,1},
+    {70,60,0,0},
+    {31,33,1,1},
+    {93,77,2,1},
+    {12,70,4,1},
+    {56,20,2,0},
+};
+#define NUM_TERRAIN_EDITS ((int)(sizeof(terrainEdits)/sizeof(terrainEdits[0])))
+
+static void copyTiles(IsoMap *isoMap,int *tiles) {
+    int x = 0, y = 0;
+    for (y = 0; y < isoMap->mapHeight; ++y) {
+        for (x = 0; x < isoMap->mapWidth; ++x) {
+            tiles[y*isoMap->mapWidth+x] = isoMapGetTile(isoMap,x,y,0);
+        }
+    }
+}
+
+//checks the tiles of the map against the copy, and reports the first tile that differs
+static void checkTiles(IsoMap *isoMap,int *tiles,const char *what) {
+    int x = 0, y = 0;
+    int numMismatches = 0;
+    int firstX = 0, firstY = 0;
+
+    for (y = 0; y < isoMap->mapHeight; ++y) {
+        for (x = 0; x < isoMap->mapWidth; ++x) {
+            if (isoMapGetTile(isoMap,x,y,0) != tiles[y*isoMap->mapWidth+x] && numMismatches++ == 0) {
+                firstX = x;
+                firstY = y;
+            }
+        }
+    }
+    TEST_CHECK(numMismatches == 0,"%s: %d tiles differ, the first is %d,%d (%d, expected %d)",what,numMismatches,firstX,firstY,
+               isoMapGetTile(isoMap,firstX,firstY,0),tiles[firstY*isoMap->mapWidth+firstX]);
+}
+
+//returns 1 if the tile is inside the square one of the edits changed
+static int isEdited(int x,int y) {
+    int i = 0;
+    for (i = 0; i < NUM_TERRAIN_EDITS; ++i) {
+        if (abs(x - terrainEdits[i].x) <= terrainEdits[i].radius && abs(y - terrainEdits[i].y) <= terrainEdits[i].radius) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main() {
+    IsoMap *isoMap = NULL;
+    int *tiles = NULL;
+    Sint8 *heights = NULL;
+    int x = 0, y = 0, i = 0;
+    int numChanged = 0;
+    int numMismatches = 0;
+
+    Test_Init(TEST_NAME);
+    isoMap = isoMapCreateNewMap("Retile",MAP_WIDTH,MAP_HEIGHT,2,64,1232,20);
+    tiles = malloc(sizeof(int) * MAP_WIDTH * MAP_HEIGHT);
+    heights = malloc(sizeof(Sint8) * MAP_WIDTH * MAP_HEIGHT);
+    if (isoMap == NULL || tiles == NULL || heights == NULL) {
+        printf("%s: could not create the map\n",TEST_NAME);
+        return 1;
+    }
+
+    //auto tiling a generated map again from its terrain heights has to give back the same tiles
+    copyTiles(isoMap,tiles);
+    TEST_CHECK(isoMapRetileArea(isoMap,0,0,MAP_WIDTH-1,MAP_HEIGHT-1) == 1,"could not retile the map");
+    checkTiles(isoMap,tiles,"retiling the generated map");
+
+    for (y = 0; y < MAP_HEIGHT; ++y) {
+        for (x = 0; x < MAP_WIDTH; ++x) {
+            heights[y*MAP_WIDTH+x] = (Sint8)isoMapGetTerrainHeight(isoMap,x,y);
+        }
+    }
+    for (i = 0; i < NUM_TERRAIN_EDITS; ++i) {
+        if (terrainEdits[i].raise) {
+            numChanged += isoMapRaiseTerrain(isoMap,terrainEdits[i].x,terrainEdits[i].y,terrainEdits[i].radius);
+        } else {
+            numChanged += isoMapLowerTerrain(isoMap,terrainEdits[i].x,terrainEdits[i].y,terrainEdits[i].radius);
+        }
+    }
+    TEST_CHECK(numChanged == NUM_TERRAIN_EDITS,"only %d of %d edits changed the terrain",numChanged,NUM_TERRAIN_EDITS);
+
+    //an edit may only change the terrain heights under the brush
+    for (y = 0; y < MAP_HEIGHT; ++y) {
+        for (x = 0; x < MAP_WIDTH; ++x) {
+            if (!isEdited(x,y) && isoMapGetTerrainHeight(isoMap,x,y) != heights[y*MAP_WIDTH+x] && numMismatches++ == 0) {
+                printf("%s: the terrain height at %d,%d changed from %d to %d\n",TEST_NAME,x,y,heights[y*MAP_WIDTH+x],isoMapGetTerrainHeight(isoMap,x,y));
+            }
+        }
+    }
+    TEST_CHECK(numMismatches == 0,"%d terrain heights outside the edits changed",numMismatches);
+
+    //the tiles the edits auto tiled locally have to be the same as auto tiling the whole map
+    copyTiles(isoMap,tiles);
+    TEST_CHECK(isoMapRetileArea(isoMap,0,0,MAP_WIDTH-1,MAP_HEIGHT-1) == 1,"could not retile the map");
+    checkTiles(isoMap,tiles,"retiling the edited map");
+
+    free(tiles);
+    free(heights);
+    isoMapFreeMap(isoMap);
+    return Test_Finish(TEST_NAME);
+}
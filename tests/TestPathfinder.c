@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "Test.h"
+#include "IsoEngine/isoMap.h"
+#include "IsoEngine/isoPathfinder.h"
+
+#define TEST_NAME "TestPathfinder"
+#define MAP_WIDTH 96
+#define MAP_HEIGHT 80
+
+//solves the path at the next update, and copies it. Returns the number of tiles, 0 if there is no path
+static int findPath(IsoPathfinder *pathfinder,IsoMap *isoMap,int startX,int startY,int goalX,int goalY,SDL_Point *path,int maxTiles) {
+    SDL_Point *tiles = NULL;
+    int numTiles = 0;
+    int request = 0;
+    int i = 0;
+
+    request = isoPathfinderRequestPath(pathfinder,startX,startY,goalX,goalY);
+    isoPathfinderUpdate(pathfinder,isoMap);
+    if (isoPathfinderGetPath(pathfinder,request,&tiles,&numTiles) != ISO_PATH_STATE_FOUND || numTiles > maxTiles) {
+        isoPathfinderReleasePath(pathfinder,request);
+        return 0;
+    }
+    for (i = 0; i < numTiles; ++i) {
+        path[i] = tiles[i];
+    }
+    isoPathfinderReleasePath(pathfinder,request);
+    return numTiles;
+}
+
+//returns the number of tiles of the path that can not be walked on
+static int countUnwalkableTiles(IsoMap *isoMap,SDL_Point *path,int numTiles) {
+    int i = 0;
+    int numUnwalkable = 0;
+
+    for (i = 0; i < numTiles; ++i) {
+        if (!isoMapTileIsWalkable(isoMap,path[i].x,path[i].y)) {
+            numUnwalkable++;
+        }
+    }
+    return numUnwalkable;
+}
+
+//the pathfinder has to see the same walkable tiles as the map
+static void checkWalkable(IsoPathfinder *pathfinder,IsoMap *isoMap,const char *what) {
+    int x = 0, y = 0;
+    int numMismatches = 0;
+    int firstX = 0, firstY = 0;
+
+    for (y = 0; y < MAP_HEIGHT; ++y) {
+        for (x = 0; x < MAP_WIDTH; ++x) {
+            if (pathfinder->walkable[y*MAP_WIDTH + x] != isoMapTileIsWalkable(isoMap,x,y) && numMismatches++ == 0) {
+                firstX = x;
+                firstY = y;
+            }
+        }
+    }
+    TEST_CHECK(numMismatches == 0,"%s: %d walkable tiles of the pathfinder differ from the map, the first is %d,%d",what,numMismatches,firstX,firstY);
+}
+
+//a handle that was released does not find the request that reuses its slot, and can not release it
+static void testStaleRequest(IsoPathfinder *pathfinder,IsoMap *isoMap) {
+    int staleRequest = 0, request = 0;
+    SDL_Point *tiles = NULL;
+    int numTiles = 0;
+
+    staleRequest = isoPathfinderRequestPath(pathfinder,2,2,5,5);
+    isoPathfinderReleasePath(pathfinder,staleRequest);
+    request = isoPathfinderRequestPath(pathfinder,2,2,MAP_WIDTH-3,MAP_HEIGHT-3);
+    TEST_CHECK(request != 0 && request != staleRequest,"the new request has the same handle %d as the released one",request);
+    TEST_CHECK(isoPathfinderGetPath(pathfinder,staleRequest,NULL,NULL) == ISO_PATH_STATE_FREE,"the released handle finds the new request");
+    isoPathfinderReleasePath(pathfinder,staleRequest);
+    isoPathfinderUpdate(pathfinder,isoMap);
+    TEST_CHECK(isoPathfinderGetPath(pathfinder,request,&tiles,&numTiles) == ISO_PATH_STATE_FOUND && tiles[numTiles-1].x == MAP_WIDTH-3,
+               "the new request was released with the old handle");
+    isoPathfinderReleasePath(pathfinder,request);
+    TEST_CHECK(isoPathfinderGetPath(pathfinder,request,NULL,NULL) == ISO_PATH_STATE_FREE,"the request is not free after it was released");
+}
+
+int main() {
+    IsoMap *isoMap = NULL;
+    IsoPathfinder *pathfinder = NULL;
+    SDL_Point *path = NULL;
+    SDL_Point *blockedPath = NULL;
+    int numTiles = 0, numBlockedTiles = 0;
+    int startX = 2, startY = 2, goalX = MAP_WIDTH-3, goalY = MAP_HEIGHT-3;
+    int i = 0;
+
+    Test_Init(TEST_NAME);
+    isoMap = isoMapCreateNewMap("Pathfinder",MAP_WIDTH,MAP_HEIGHT,2,64,1232,20);
+    path = malloc(sizeof(SDL_Point)*MAP_WIDTH*MAP_HEIGHT);
+    blockedPath = malloc(sizeof(SDL_Point)*MAP_WIDTH*MAP_HEIGHT);
+    if (isoMap == NULL || path == NULL || blockedPath == NULL) {
+        printf("%s: could not create the map\n",TEST_NAME);
+        return 1;
+    }
+    pathfinder = isoPathfinderNew(isoMap);
+    TEST_CHECK(pathfinder != NULL,"could not create the pathfinder");
+    if (pathfinder == NULL) {
+        return Test_Finish(TEST_NAME);
+    }
+    checkWalkable(pathfinder,isoMap,"generated map");
+    TEST_CHECK(!pathfinder->walkable[0] && !pathfinder->walkable[MAP_WIDTH*MAP_HEIGHT-1],"the edges of the map can be walked on");
+
+    //a path across the map, next to the edges that block
+    numTiles = findPath(pathfinder,isoMap,startX,startY,goalX,goalY,path,MAP_WIDTH*MAP_HEIGHT);
+    TEST_CHECK(numTiles > 0,"no path from %d,%d to %d,%d",startX,startY,goalX,goalY);
+    TEST_CHECK(countUnwalkableTiles(isoMap,path,numTiles) == 0,"the path crosses tiles that can not be walked on");
+
+    //static bodies on the middle of the path, like trees, make the path go around them
+    for (i = numTiles/3; i < numTiles*2/3; ++i) {
+        isoMapSetTileFlags(isoMap,path[i].x,path[i].y,isoMapGetTileFlags(isoMap,path[i].x,path[i].y) | ISO_TILE_FLAG_OCCUPIED);
+    }
+    numBlockedTiles = findPath(pathfinder,isoMap,startX,startY,goalX,goalY,blockedPath,MAP_WIDTH*MAP_HEIGHT);
+    checkWalkable(pathfinder,isoMap,"map with static bodies");
+    TEST_CHECK(numBlockedTiles > 0,"no path around the static bodies");
+    TEST_CHECK(countUnwalkableTiles(isoMap,blockedPath,numBlockedTiles) == 0,"the path goes through tiles with static bodies on them");
+
+    //when the bodies are gone, the path is as short as it was
+    for (i = numTiles/3; i < numTiles*2/3; ++i) {
+        isoMapSetTileFlags(isoMap,path[i].x,path[i].y,isoMapGetTileFlags(isoMap,path[i].x,path[i].y) & ~ISO_TILE_FLAG_OCCUPIED);
+    }
+    numBlockedTiles = findPath(pathfinder,isoMap,startX,startY,goalX,goalY,blockedPath,MAP_WIDTH*MAP_HEIGHT);
+    checkWalkable(pathfinder,isoMap,"map without static bodies");
+    TEST_CHECK(numBlockedTiles == numTiles,"the path has %d tiles after the static bodies are gone, expected %d",numBlockedTiles,numTiles);
+
+    testStaleRequest(pathfinder,isoMap);
+
+    isoPathfinderFree(pathfinder);
+    isoMapFreeMap(isoMap);
+    free(path);
+    free(blockedPath);
+    return Test_Finish(TEST_NAME);
+}
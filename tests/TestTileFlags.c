@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include "Test.h"
+#include "GameMap.h"
+#include "IsoEngine/isoMap.h"
+#include "IsoEngine/isoMapFile.h"
+
+#define TEST_NAME "TestTileFlags"
+
+//returns 1 if the tiles of x,y say it has to block: it has no ground, or something stands on it
+static int tileBlocks(IsoMap *isoMap,int x,int y) {
+    int layer = 0;
+
+    if (isoMapGetTile(isoMap,x,y,0) < 0) {
+        return 1;
+    }
+    for (layer = 1; layer < isoMap->numLayers; ++layer) {
+        if (isoMapGetTile(isoMap,x,y,layer) >= 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+//checks the blocking flag of every tile against its tiles, and reports the first tile that is wrong
+static void checkBlockingFlags(IsoMap *isoMap,const char *what) {
+    int x = 0, y = 0;
+    int numMismatches = 0;
+    int firstX = 0, firstY = 0;
+
+    for (y = 0; y < isoMap->mapHeight; ++y) {
+        for (x = 0; x < isoMap->mapWidth; ++x) {
+            if (((isoMapGetTileFlags(isoMap,x,y) & ISO_TILE_FLAG_BLOCKING) != 0) != tileBlocks(isoMap,x,y) && numMismatches++ == 0) {
+                firstX = x;
+                firstY = y;
+            }
+        }
+    }
+    TEST_CHECK(numMismatches == 0,"%s: %d blocking flags do not match the tiles, the first is %d,%d (tile %d, flags %d)",what,
+               numMismatches,firstX,firstY,isoMapGetTile(isoMap,firstX,firstY,0),isoMapGetTileFlags(isoMap,firstX,firstY));
+}
+
+//finds a tile in the middle of the map that does not block
+static int findOpenTile(IsoMap *isoMap,int *tileX,int *tileY) {
+    int x = 0, y = 0;
+
+    for (y = isoMap->mapHeight/2; y < isoMap->mapHeight-1; ++y) {
+        for (x = isoMap->mapWidth/2; x < isoMap->mapWidth-1; ++x) {
+            if ((isoMapGetTileFlags(isoMap,x,y) & ISO_TILE_FLAG_BLOCKING) == 0) {
+                *tileX = x;
+                *tileY = y;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+//the map the game generates has to come with blocking flags that the collision sweep runs into
+static void testGeneratedMap(IsoMap *isoMap) {
+    IsoMapSweepHit hit;
+    SDL_FRect rect;
+    int x = 0, y = 0;
+    int numBlocking = 0;
+    int numOpenEdges = 0;
+
+    checkBlockingFlags(isoMap,"generated map");
+    for (y = 0; y < isoMap->mapHeight; ++y) {
+        for (x = 0; x < isoMap->mapWidth; ++x) {
+            if (isoMapGetTileFlags(isoMap,x,y) & ISO_TILE_FLAG_BLOCKING) {
+                numBlocking++;
+            }
+            else if (x == 0 || y == 0 || x == isoMap->mapWidth-1 || y == isoMap->mapHeight-1) {
+                numOpenEdges++;
+            }
+        }
+    }
+    TEST_CHECK(numBlocking > 0,"the generated map has no blocking tiles");
+    TEST_CHECK(numOpenEdges == 0,"%d tiles at the map edges do not block, so entities can leave the map",numOpenEdges);
+
+    //a rectangle in the middle of the map that moves far to the left is stopped by the edge of the map
+    rect.x = isoMap->tileSize * 10.5f;
+    rect.y = isoMap->tileSize * 20.5f;
+    rect.w = isoMap->tileSize / 4.0f;
+    rect.h = isoMap->tileSize / 4.0f;
+    TEST_CHECK(isoMapSweepRect(isoMap,&rect,-isoMap->tileSize * 50.0f,0,ISO_TILE_FLAG_BLOCKING,&hit) == 1,
+               "a rectangle moving out of the map did not hit anything");
+    TEST_CHECK(hit.normalX == 1 && hit.normalY == 0,"the rectangle hit the side %d,%d, expected 1,0",hit.normalX,hit.normalY);
+    TEST_CHECK(hit.tileY == 20 && (isoMapGetTileFlags(isoMap,hit.tileX,hit.tileY) & ISO_TILE_FLAG_BLOCKING),
+               "the rectangle hit tile %d,%d, which does not block",hit.tileX,hit.tileY);
+}
+
+//placing something on a tile makes it block, taking it away opens the tile again. Other flags are kept
+static void testSetTile(IsoMap *isoMap) {
+    IsoMapSweepHit hit;
+    SDL_FRect rect;
+    int x = 0, y = 0;
+
+    if (!findOpenTile(isoMap,&x,&y)) {
+        TEST_CHECK(0,"the generated map has no open tile");
+        return;
+    }
+    isoMapSetTileFlags(isoMap,x,y,0x80);
+    isoMapSetTile(isoMap,x,y,1,2);
+    TEST_CHECK(isoMapGetTileFlags(isoMap,x,y) == (0x80 | ISO_TILE_FLAG_BLOCKING),"tile %d,%d has flags %d after a tile was placed on it",
+               x,y,isoMapGetTileFlags(isoMap,x,y));
+
+    //a rectangle right of the tile that moves through it is stopped at its right side
+    rect.x = (x+1) * (float)isoMap->tileSize + 1;
+    rect.y = y * (float)isoMap->tileSize + 1;
+    rect.w = 2;
+    rect.h = 2;
+    TEST_CHECK(isoMapSweepRect(isoMap,&rect,-isoMap->tileSize * 0.5f,0,ISO_TILE_FLAG_BLOCKING,&hit) == 1 && hit.tileX == x && hit.tileY == y,
+               "a rectangle moving into tile %d,%d did not hit it",x,y);
+
+    //setting the flags can not take the blocking flag away from the tile
+    isoMapSetTileFlags(isoMap,x,y,0);
+    TEST_CHECK(isoMapGetTileFlags(isoMap,x,y) == ISO_TILE_FLAG_BLOCKING,"setting the flags of tile %d,%d cleared the blocking flag",x,y);
+
+    isoMapSetTile(isoMap,x,y,1,-1);
+    TEST_CHECK(isoMapGetTileFlags(isoMap,x,y) == 0,"tile %d,%d still has flags %d after the tile on it was taken away",
+               x,y,isoMapGetTileFlags(isoMap,x,y));
+    checkBlockingFlags(isoMap,"map after setting tiles");
+}
+
+//the blocking flags are saved with the map, and derived again for maps that were saved without them
+static void testMapFile(IsoMap *isoMap) {
+    IsoMap *loadedMap = NULL;
+    char *fileName = TEST_OUTPUT_DIR "/tileflags.isomap";
+    int i = 0, j = 0;
+    int x = 0, y = 0;
+
+    if (!findOpenTile(isoMap,&x,&y)) {
+        TEST_CHECK(0,"the generated map has no open tile");
+        return;
+    }
+    isoMapSetTile(isoMap,x,y,1,7);
+    TEST_CHECK(isoMapSaveToFile(isoMap,fileName) == 1,"could not save %s",fileName);
+    loadedMap = isoMapLoadFromFile(fileName);
+    TEST_CHECK(loadedMap != NULL,"could not load %s",fileName);
+    if (loadedMap != NULL) {
+        TEST_CHECK(isoMapGetTileFlags(loadedMap,x,y) & ISO_TILE_FLAG_BLOCKING,"the tile %d,%d with a tile on it does not block after loading",x,y);
+        checkBlockingFlags(loadedMap,"loaded map");
+        isoMapFreeMap(loadedMap);
+    }
+
+    //a map saved before the blocking flags were derived has none
+    for (i = 0; i < isoMap->numChunksX*isoMap->numChunksY; ++i) {
+        if (isoMap->chunks[i].isResident) {
+            for (j = 0; j < ISO_MAP_CHUNK_SIZE*ISO_MAP_CHUNK_SIZE; ++j) {
+                isoMap->chunks[i].flags[j] &= ~ISO_TILE_FLAG_BLOCKING;
+            }
+        }
+    }
+    TEST_CHECK(isoMapSaveToFile(isoMap,fileName) == 1,"could not save %s",fileName);
+    loadedMap = isoMapLoadFromFile(fileName);
+    TEST_CHECK(loadedMap != NULL,"could not load %s",fileName);
+    if (loadedMap != NULL) {
+        checkBlockingFlags(loadedMap,"map saved without blocking flags");
+        isoMapFreeMap(loadedMap);
+    }
+}
+
+int main() {
+    IsoMap *isoMap = NULL;
+
+    Test_Init(TEST_NAME);
+    isoMap = isoMapCreateNewMap("Tile flags",MAP_WIDTH,MAP_HEIGHT,MAP_NUM_LAYERS,MAP_TILE_SIZE,MAP_SEED,MAP_TERRAIN_HEIGHT);
+    if (isoMap == NULL) {
+        printf("%s: could not generate the map\n",TEST_NAME);
+        return 1;
+    }
+    testGeneratedMap(isoMap);
+    testSetTile(isoMap);
+    testMapFile(isoMap);
+    isoMapFreeMap(isoMap);
+    return Test_Finish(TEST_NAME);
+}
@@ -0,0 +1,79 @@
+#include <stdio.h>
+#include "Test.h"
+#include "GameMap.h"
+#include "IsoEngine/isoMap.h"
+#include "IsoEngine/isoMapFile.h"
+
+#define TEST_NAME "TestWorldGenerator"
+
+//the world generator has to create exactly the same map for the game's seed every time, on every build
+static void testGoldenHash() {
+    IsoMap *isoMap = NULL;
+    Uint64 mapHash = 0;
+
+    isoMap = isoMapCreateNewMap("Testmap",MAP_WIDTH,MAP_HEIGHT,MAP_NUM_LAYERS,MAP_TILE_SIZE,MAP_SEED,MAP_TERRAIN_HEIGHT);
+    TEST_CHECK(isoMap != NULL,"could not generate the map");
+    if (isoMap == NULL) {
+        return;
+    }
+    mapHash = isoMapComputeHash(isoMap);
+    TEST_CHECK(mapHash == MAP_GOLDEN_HASH,"map hash %016llx does not match the golden hash %016llx, the world generator output has changed",
+               (unsigned long long)mapHash,(unsigned long long)MAP_GOLDEN_HASH);
+    TEST_CHECK(isoMap->generatorVersion == ISO_MAP_GENERATOR_VERSION,"generator version %d, expected %d",isoMap->generatorVersion,ISO_MAP_GENERATOR_VERSION);
+    TEST_CHECK(isoMap->seed == MAP_SEED && isoMap->terrainHeight == MAP_TERRAIN_HEIGHT,"seed %d and terrain height %d, expected %d and %d",
+               isoMap->seed,isoMap->terrainHeight,MAP_SEED,MAP_TERRAIN_HEIGHT);
+    isoMapFreeMap(isoMap);
+
+    //a second map from the same seed, so state left over from the first one would show up
+    isoMap = isoMapCreateNewMap("Testmap",MAP_WIDTH,MAP_HEIGHT,MAP_NUM_LAYERS,MAP_TILE_SIZE,MAP_SEED,MAP_TERRAIN_HEIGHT);
+    TEST_CHECK(isoMap != NULL && isoMapComputeHash(isoMap) == mapHash,"generating the map a second time gives a different map");
+    isoMapFreeMap(isoMap);
+
+    isoMap = isoMapCreateNewMap("Testmap",MAP_WIDTH,MAP_HEIGHT,MAP_NUM_LAYERS,MAP_TILE_SIZE,MAP_SEED+1,MAP_TERRAIN_HEIGHT);
+    TEST_CHECK(isoMap != NULL && isoMapComputeHash(isoMap) != mapHash,"another seed gives the same map");
+    isoMapFreeMap(isoMap);
+}
+
+//the map file has to remember how the map was generated, so the game can tell when it is out of date
+static void testGeneratorInMapFile() {
+    IsoMap *isoMap = NULL;
+    IsoMap *loadedMap = NULL;
+    char *fileName = TEST_OUTPUT_DIR "/generator.isomap";
+
+    isoMap = isoMapCreateNewMap("Generator",64,48,MAP_NUM_LAYERS,MAP_TILE_SIZE,4711,15);
+    TEST_CHECK(isoMap != NULL,"could not generate the map");
+    if (isoMap == NULL) {
+        return;
+    }
+    TEST_CHECK(isoMapSaveToFile(isoMap,fileName) == 1,"could not save %s",fileName);
+    loadedMap = isoMapLoadFromFile(fileName);
+    TEST_CHECK(loadedMap != NULL,"could not load %s",fileName);
+    if (loadedMap != NULL) {
+        TEST_CHECK(loadedMap->generatorVersion == ISO_MAP_GENERATOR_VERSION,"generator version %d, expected %d",
+                   loadedMap->generatorVersion,ISO_MAP_GENERATOR_VERSION);
+        TEST_CHECK(loadedMap->seed == 4711 && loadedMap->terrainHeight == 15,"seed %d and terrain height %d, expected 4711 and 15",
+                   loadedMap->seed,loadedMap->terrainHeight);
+        TEST_CHECK(isoMapComputeHash(loadedMap) == isoMapComputeHash(isoMap),"the loaded map is not the generated map");
+        isoMapFreeMap(loadedMap);
+    }
+    isoMapFreeMap(isoMap);
+
+    //maps that were not generated are saved without a generator
+    isoMap = isoMapCreateEmptyMap("Empty",32,32,1,MAP_TILE_SIZE);
+    TEST_CHECK(isoMap != NULL,"could not create the map");
+    if (isoMap == NULL) {
+        return;
+    }
+    TEST_CHECK(isoMapSaveToFile(isoMap,fileName) == 1,"could not save %s",fileName);
+    loadedMap = isoMapLoadFromFile(fileName);
+    TEST_CHECK(loadedMap != NULL && loadedMap->generatorVersion == 0,"an empty map was loaded with a generator version");
+    isoMapFreeMap(loadedMap);
+    isoMapFreeMap(isoMap);
+}
+
+int main() {
+    Test_Init(TEST_NAME);
+    testGoldenHash();
+    testGeneratorInMapFile();
+    return Test_Finish(TEST_NAME);
+}